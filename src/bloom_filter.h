@@ -0,0 +1,212 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "types.h"
+#include "page.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Mixes the bits of a word, so that keys that differ in a few bits hash far apart.
+ */
+inline uint64_t hashWord(uint64_t value)
+{
+	value ^= value >> 33;
+	value *= 0xff51afd7ed558ccdULL;
+	value ^= value >> 33;
+	value *= 0xc4ceb9fe1a85ec53ULL;
+	value ^= value >> 33;
+	return value;
+}
+
+/**
+ * @brief Hashes a run of bytes.
+ */
+inline uint64_t hashBytes(const void* data, const size_t length)
+{
+	const unsigned char* bytes = (const unsigned char*) data;
+	uint64_t value = 0xcbf29ce484222325ULL;
+	for (size_t i = 0; i < length; i++)
+	{
+		value = (value ^ bytes[i]) * 0x100000001b3ULL;
+	}
+	return hashWord(value);
+}
+
+/**
+ * @brief A page of a Bloom filter in the index file: the page number of the next one,
+ * then as many words of the filter as fit.
+ */
+struct BloomFilterPage
+{
+	PageId nextPageNo;
+
+  /**
+   * Number of words of the filter each page holds.
+   */
+	static const int WORDS = (int) ((Page::SIZE - sizeof(uint64_t)) / sizeof(uint64_t));
+
+	uint64_t words[ WORDS ];
+};
+
+/**
+ * @brief Blocked Bloom filter over the key hashes of an index. Each key sets PROBES bits
+ * of one block of 512 bits, a cache line, picked by the high half of its hash; a test
+ * reads that one line. BITSPERKEY bits for each key give about one false positive in a
+ * hundred tests. Bits are set and read atomically, so concurrent inserts and lookups can
+ * share the filter.
+ */
+class BloomFilter
+{
+ public:
+  /**
+   * Bits of filter sized for each key.
+   */
+	static const int BITSPERKEY = 10;
+
+  /**
+   * Words of a block.
+   */
+	static const int BLOCKWORDS = 8;
+
+  /**
+   * Bytes of a block, a cache line.
+   */
+	static const int BLOCKBYTES = BLOCKWORDS * sizeof(uint64_t);
+
+  /**
+   * Bits each key sets in its block.
+   */
+	static const int PROBES = 7;
+
+  /**
+   * Blocks start on a cache line: the words are allocated with a block to spare, and
+   * start at the first 64 byte boundary in them.
+   */
+	explicit BloomFilter(const long numBlocks)
+		: numBlocks(numBlocks < 1 ? 1 : numBlocks), numKeys(0)
+	{
+		storage = new std::atomic<uint64_t>[numWords() + BLOCKWORDS - 1];
+		words = (std::atomic<uint64_t>*) (((uintptr_t) storage + BLOCKBYTES - 1) / BLOCKBYTES * BLOCKBYTES);
+		for (long i = 0; i < numWords(); i++)
+		{
+			words[i].store(0, std::memory_order_relaxed);
+		}
+	}
+
+	~BloomFilter()
+	{
+		delete [] storage;
+	}
+
+  /**
+   * Number of blocks a filter for the given number of keys takes.
+   */
+	static long blocksFor(const long keys)
+	{
+		long bits = (keys < 1 ? 1 : keys) * BITSPERKEY;
+		return (bits + BLOCKWORDS * 64 - 1) / (BLOCKWORDS * 64);
+	}
+
+	long blocks() const
+	{
+		return numBlocks;
+	}
+
+	long numWords() const
+	{
+		return numBlocks * BLOCKWORDS;
+	}
+
+  /**
+   * Number of keys the filter was sized for.
+   */
+	long capacity() const
+	{
+		return numBlocks * BLOCKWORDS * 64 / BITSPERKEY;
+	}
+
+  /**
+   * Number of keys added, counting every duplicate.
+   */
+	long count() const
+	{
+		return numKeys.load(std::memory_order_relaxed);
+	}
+
+	void setCount(const long keys)
+	{
+		numKeys.store(keys, std::memory_order_relaxed);
+	}
+
+	void add(const uint64_t hash)
+	{
+		std::atomic<uint64_t>* block = blockOf(hash);
+		uint32_t probe = (uint32_t) hash;
+		uint32_t delta = (probe >> 17) | (probe << 15);
+		for (int p = 0; p < PROBES; p++)
+		{
+			block[(probe >> 6) % BLOCKWORDS].fetch_or(1ULL << (probe % 64), std::memory_order_relaxed);
+			probe += delta;
+		}
+		numKeys.fetch_add(1, std::memory_order_relaxed);
+	}
+
+  /**
+   * False if no key with this hash was added.
+   */
+	bool mayContain(const uint64_t hash) const
+	{
+		const std::atomic<uint64_t>* block = blockOf(hash);
+		uint32_t probe = (uint32_t) hash;
+		uint32_t delta = (probe >> 17) | (probe << 15);
+		for (int p = 0; p < PROBES; p++)
+		{
+			if ((block[(probe >> 6) % BLOCKWORDS].load(std::memory_order_relaxed) & (1ULL << (probe % 64))) == 0)
+			{
+				return false;
+			}
+			probe += delta;
+		}
+		return true;
+	}
+
+  /**
+   * Word i of the filter, to write it to the index file.
+   */
+	uint64_t word(const long i) const
+	{
+		return words[i].load(std::memory_order_relaxed);
+	}
+
+	void setWord(const long i, const uint64_t value)
+	{
+		words[i].store(value, std::memory_order_relaxed);
+	}
+
+ private:
+	long numBlocks;
+	std::atomic<long> numKeys;
+	std::atomic<uint64_t>* storage;
+	std::atomic<uint64_t>* words;
+
+	std::atomic<uint64_t>* blockOf(const uint64_t hash) const
+	{
+		return &words[(long) (((hash >> 32) * (uint64_t) numBlocks) >> 32) * BLOCKWORDS];
+	}
+
+	BloomFilter(const BloomFilter&);
+	BloomFilter& operator=(const BloomFilter&);
+};
+
+}
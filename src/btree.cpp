@@ -5,8 +5,18 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <numeric>
+#include <queue>
+#include <vector>
 #include "btree.h"
 #include "filescan.h"
+#include "key_search.h"
+#include "node_buffer.h"
+#include "packed_leaf.h"
 #include "exceptions/bad_index_info_exception.h"
 #include "exceptions/bad_opcodes_exception.h"
 #include "exceptions/bad_scanrange_exception.h"
@@ -23,6 +33,20 @@
 namespace badgerdb
 {
 
+template <class T>
+struct PlainLeaf;
+
+template <class T>
+struct PostingLeaf;
+
+template <class T>
+struct PayloadLeaf;
+
+/**
+ * @brief Number of entries each part of a parallel scan hands to the consumer at once.
+ */
+const int PARTBATCH = 1024;
+
 // -----------------------------------------------------------------------------
 // BTreeIndex::BTreeIndex -- Constructor
 // -----------------------------------------------------------------------------
@@ -37,616 +61,5917 @@ namespace badgerdb
  * @param attrByteOffset    The byte offset of the attribute in the tuple used to
  *                          build the index.
  * @param attrType          The data type of the indexed attribute.
+ * @param options           Whether to bulk load a new index, and how full to pack it.
  */
 BTreeIndex::BTreeIndex(const std::string & relationName,
 		std::string & outIndexName,
 		BufMgr *bufMgrIn,
 		const int attrByteOffset,
-		const Datatype attrType)
+		const Datatype attrType,
+		const IndexOptions & options)
+    : openCursors(0), scanCursor(this)
 {
-        // Global scanning variable used to check if a scan is in progress.
-        // Initialize as false.
-        scanExecuting = false;
+        attributeType = attrType;
+        this->attrByteOffset = attrByteOffset;
+        keyType = attrType == INTEGER ? INTEGER_KEY : attrType == DOUBLE ? DOUBLE_KEY : STRING_KEY;
+        numKeyAttributes = 0;
+        bufMgr = bufMgrIn;
+
+        // Name the index file accordingly.
+        std::ostringstream idxStr;
+        idxStr << relationName << "." << attrByteOffset;
+        outIndexName = idxStr.str();
+        openIndex(relationName, outIndexName, options);
+}
 
-        // Global initializations of the node and leaf occupancies.
-        leafOccupancy = INTARRAYLEAFSIZE;
-        nodeOccupancy = INTARRAYNONLEAFSIZE;
+/**
+ * Composite key constructor. Picks the key type from the attribute types, then
+ * opens or builds the index like the single attribute constructor. Keys are read
+ * from whole records, so attrByteOffset is 0.
+ *
+ * @param relationName      Name of the file to be used.
+ * @param outIndexName      Name of the index file.
+ * @param bufMgrIn          Global buffer manager instance.
+ * @param keyAttributes     Offsets and types of the key attributes, in key order.
+ * @param options           Whether to bulk load a new index, and how full to pack it.
+ */
+BTreeIndex::BTreeIndex(const std::string & relationName,
+		std::string & outIndexName,
+		BufMgr *bufMgrIn,
+		const std::vector<KeyAttribute> & keyAttributes,
+		const IndexOptions & options)
+    : openCursors(0), scanCursor(this)
+{
+        // Name the index file after every attribute of the key.
+        std::ostringstream idxStr;
+        idxStr << relationName;
+        int keyBytes = 0;
+        for (size_t a = 0; a < keyAttributes.size(); a++) {
+            idxStr << "." << keyAttributes[a].byteOffset;
+            keyBytes += keyAttributeSize(keyAttributes[a].type);
+        }
+        outIndexName = idxStr.str();
+        if (keyAttributes.size() < 2 || keyAttributes.size() > (size_t) MAXKEYATTRIBUTES
+            || keyBytes > COMPOSITESIZE) {
+            throw BadIndexInfoException(outIndexName);
+        }
 
-        // Initialize the buffer manager.
+        numKeyAttributes = (int) keyAttributes.size();
+        std::copy(keyAttributes.begin(), keyAttributes.end(), this->keyAttributes);
+        attributeType = keyAttributes[0].type;
+        attrByteOffset = 0;
+        if (numKeyAttributes == 2 && keyAttributes[0].type == INTEGER && keyAttributes[1].type == INTEGER) {
+            keyType = INT_PAIR_KEY;
+        } else if (numKeyAttributes == 2 && keyAttributes[0].type == INTEGER && keyAttributes[1].type == DOUBLE) {
+            keyType = INT_DOUBLE_KEY;
+        } else {
+            keyType = COMPOSITE_KEY;
+        }
         bufMgr = bufMgrIn;
+        openIndex(relationName, outIndexName, options);
+}
+
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::~BTreeIndex -- destructor
+// -----------------------------------------------------------------------------
+/**
+ * This destructor method flushes the B-Tree index file and unpins any pages
+ * associated with it. Scans hold no pages between calls, so a scan still running
+ * on the built-in cursor simply ends with it, once its read-ahead has stopped.
+ * Nothing is thrown out of it: if the file cannot be flushed, for instance because
+ * an earlier exception left a page pinned, the file object is kept for the frames
+ * of it still in the buffer pool.
+ */
+BTreeIndex::~BTreeIndex()
+{
+    scanCursor.stopReadAhead();
+    if (prefetchThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> guard(prefetchLock);
+            prefetchStop = true;
+        }
+        prefetchWake.notify_one();
+        prefetchThread.join();
+    }
+    try
+    {
+        saveFilter();
+        saveStatistics();
+        // Flush the file, deconstruct the file, free the file object.
+        releaseNodes();
+        bufMgr->flushFile(file);
+        delete file;
+    }
+    catch(...)
+    {
+    }
+    file = nullptr;
+    delete latches;
+    delete nodeCache;
+    delete filter;
+//    cout << file->getFirstPageNo() << endl;
+}
+
+// -----------------------------------------------------------------------------
+// Node search helpers
+// -----------------------------------------------------------------------------
+/**
+ * Returns the index of the first key in keys[0, numKeys) that is not less than key.
+ * Used to position scans on the first entry that can satisfy a GTE bound.
+ * @param keys      Sorted key array of a node.
+ * @param numKeys   Number of keys in use.
+ * @param key       The key to search for.
+ */
+template <class T>
+static int lowerBound(const T* keys, int numKeys, const T& key) {
+    int low = 0;
+    int high = numKeys;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (KeyTraits<T>::compare(keys[mid], key) < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+/**
+ * Returns the index of the first key in keys[0, numKeys) that is greater than key.
+ * In a non-leaf this is the slot of the child that covers key, and in a leaf it is
+ * the slot a new entry goes into after any duplicates.
+ * @param keys      Sorted key array of a node.
+ * @param numKeys   Number of keys in use.
+ * @param key       The key to search for.
+ */
+template <class T>
+static int upperBound(const T* keys, int numKeys, const T& key) {
+    int low = 0;
+    int high = numKeys;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (KeyTraits<T>::compare(keys[mid], key) <= 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+/**
+ * INTEGER nodes use the vectorized search kernel picked for this CPU.
+ */
+template <>
+int lowerBound<int>(const int* keys, int numKeys, const int& key) {
+    return intLowerBound(keys, numKeys, key);
+}
+
+template <>
+int upperBound<int>(const int* keys, int numKeys, const int& key) {
+    return intUpperBound(keys, numKeys, key);
+}
+
+/**
+ * Non-leaf searches. Only INTEGER nodes carry a search directory, which follows the
+ * nodeOccupancy keys of the key array.
+ */
+template <class T>
+int BTreeIndex::childLowerBound(const NonLeafNode<T>* node, const T& key) const {
+    return lowerBound(node->keyArray, node->numKeys, key);
+}
+
+template <class T>
+int BTreeIndex::childUpperBound(const NonLeafNode<T>* node, const T& key) const {
+    return upperBound(node->keyArray, node->numKeys, key);
+}
+
+template <class T>
+const void BTreeIndex::indexNode(NonLeafNode<T>* node) {
+}
+
+template <>
+int BTreeIndex::childLowerBound<int>(const NonLeafNode<int>* node, const int& key) const {
+    if (nodeDirectories) {
+        return intDirectoryLowerBound(node->keyArray, node->numKeys, node->keyArray + nodeOccupancy, key);
+    }
+    return intLowerBound(node->keyArray, node->numKeys, key);
+}
+
+template <>
+int BTreeIndex::childUpperBound<int>(const NonLeafNode<int>* node, const int& key) const {
+    if (nodeDirectories) {
+        return intDirectoryUpperBound(node->keyArray, node->numKeys, node->keyArray + nodeOccupancy, key);
+    }
+    return intUpperBound(node->keyArray, node->numKeys, key);
+}
+
+template <>
+const void BTreeIndex::indexNode<int>(NonLeafNode<int>* node) {
+    if (nodeDirectories) {
+        intBuildDirectory(node->keyArray, node->numKeys, node->keyArray + nodeOccupancy);
+    }
+}
+
+/**
+ * Subtree counts start at the first 8 byte boundary after the keys in use, which
+ * OccupancyOp leaves room for.
+ */
+template <class T>
+long* BTreeIndex::childCounts(NonLeafNode<T>* node) const {
+    size_t offset = ((size_t) nodeOccupancy * sizeof(T) + sizeof(long) - 1) / sizeof(long) * sizeof(long);
+    return (long*) ((char*) node->keyArray + offset);
+}
+
+template <class T>
+long BTreeIndex::subtreeCount(NonLeafNode<T>* node) const {
+    const long* counts = childCounts(node);
+    return std::accumulate(counts, counts + node->numKeys + 1, 0L);
+}
+
+// -----------------------------------------------------------------------------
+// Slotted string nodes
+// -----------------------------------------------------------------------------
+/**
+ * Helpers for the slotted nodes of VarStringKey keys. A node stores the bytes all
+ * its keys start with once, at the end of its data, and each key by the rest of
+ * it, which a StringSlot points at. The slots of a node are stride bytes apart.
+ */
+static int sharedBytes(const char* a, const int aLength, const char* b, const int bLength) {
+    int n = std::min(aLength, bLength);
+    int i = 0;
+    while (i < n && a[i] == b[i]) {
+        i++;
+    }
+    return i;
+}
+
+static int commonPrefix(const VarStringKey& a, const VarStringKey& b) {
+    return sharedBytes(a.data, a.length, b.data, b.length);
+}
+
+static const StringSlot& stringSlot(const char* slots, const int stride, const int i) {
+    return *(const StringSlot*) (slots + i * stride);
+}
+
+/**
+ * Reads a key of a node back whole.
+ * @param data      Data of the node, ending with the prefix.
+ * @param size      Bytes of data.
+ */
+static VarStringKey storedString(const char* data, const int size, const int prefixLength,
+                                 const StringSlot& slot) {
+    VarStringKey key;
+    key.length = (unsigned char) (prefixLength + slot.length);
+    memcpy(key.data, data + size - prefixLength, prefixLength);
+    memcpy(key.data + prefixLength, data + slot.offset, slot.length);
+    return key;
+}
+
+/**
+ * Bytes keys[0, n) take in a node with slotBytes for each of their slots.
+ */
+static int stringBytes(const VarStringKey* keys, const int n, const int slotBytes) {
+    if (n == 0) {
+        return 0;
+    }
+    int prefixLength = commonPrefix(keys[0], keys[n - 1]);
+    int bytes = prefixLength + n * (slotBytes - prefixLength);
+    for (int i = 0; i < n; i++) {
+        bytes += keys[i].length;
+    }
+    return bytes;
+}
+
+/**
+ * Writes keys[0, n), which must fit, into the data of a node: the prefix the first
+ * and last share at the end, then the rests of the keys below it, in order.
+ * @param prefixLength  Set to the bytes of the prefix.
+ * @param heapBytes     Set to the bytes taken at the end of data.
+ */
+static void writeStrings(char* data, const int size, char* slots, const int stride,
+                         const VarStringKey* keys, const int n,
+                         unsigned short& prefixLength, unsigned short& heapBytes) {
+    int prefix = n == 0 ? 0 : commonPrefix(keys[0], keys[n - 1]);
+    int end = size - prefix;
+    if (n > 0) {
+        memcpy(data + end, keys[0].data, prefix);
+    }
+    for (int i = 0; i < n; i++) {
+        StringSlot slot;
+        slot.length = (unsigned short) (keys[i].length - prefix);
+        end -= slot.length;
+        slot.offset = (unsigned short) end;
+        memcpy(data + end, keys[i].data + prefix, slot.length);
+        memcpy(slots + i * stride, &slot, sizeof(slot));
+    }
+    prefixLength = (unsigned short) prefix;
+    heapBytes = (unsigned short) (size - end);
+}
+
+/**
+ * Binary search over the n keys of a node: the first key not less than key, or with
+ * upper set the first key greater than it. The prefix is compared once, and after it
+ * only the rests of the keys.
+ */
+static int searchStrings(const char* data, const int size, const int prefixLength,
+                         const char* slots, const int stride, const int n,
+                         const VarStringKey& key, const bool upper) {
+    int c = memcmp(key.data, data + size - prefixLength, std::min((int) key.length, prefixLength));
+    if (c == 0 && key.length < prefixLength) {
+        c = -1;
+    }
+    if (c != 0) {
+        return c < 0 ? 0 : n;
+    }
+    const char* rest = key.data + prefixLength;
+    int restLength = key.length - prefixLength;
+    int low = 0;
+    int high = n;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        const StringSlot& slot = stringSlot(slots, stride, mid);
+        int cmp = KeyTraits<VarStringKey>::compareBytes(data + slot.offset, slot.length, rest, restLength);
+        if (cmp < 0 || (upper && cmp == 0)) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+/**
+ * Returns the key to tell two neighbouring children apart by in their parent: the
+ * first key of the right one.
+ */
+template <class T>
+static T separatorBetween(const T& left, const T& right) {
+    return right;
+}
+
+/**
+ * VarStringKey separators are suffix truncated: the shortest prefix of right that
+ * still sorts after left.
+ */
+static VarStringKey separatorBetween(const VarStringKey& left, const VarStringKey& right) {
+    VarStringKey separator = right;
+    int shared = commonPrefix(left, right);
+    if (shared < right.length) {
+        separator.length = (unsigned char) (shared + 1);
+    }
+    return separator;
+}
+
+// -----------------------------------------------------------------------------
+// Separators
+// -----------------------------------------------------------------------------
+/**
+ * Key operations of non-leaf nodes. Fixed-width keys sit in the key array and a node
+ * holds up to nodeOccupancy of them. VarStringKey nodes hold as many as their bytes
+ * allow, so whether a key fits depends on the key, and a node is split and merged by
+ * bytes rather than by counts.
+ */
+template <class T>
+struct Separators {
+    static const bool VARIABLE = false;
+
+    static const T& key(const NonLeafNode<T>* node, const int i) {
+        return node->keyArray[i];
+    }
+
+    static void set(NonLeafNode<T>* node, const int i, const T& key) {
+        node->keyArray[i] = key;
+    }
+
+    static void insert(NonLeafNode<T>* node, const int i, const T& key) {
+        memmove(&node->keyArray[i + 1], &node->keyArray[i], (node->numKeys - i) * sizeof(T));
+        node->keyArray[i] = key;
+        node->numKeys++;
+    }
+
+    /**
+     * Inserts keys [src, src + count) of from at slot dst of to.
+     */
+    static void insertRange(NonLeafNode<T>* to, const int dst, const NonLeafNode<T>* from, const int src,
+                            const int count) {
+        memmove(&to->keyArray[dst + count], &to->keyArray[dst], (to->numKeys - dst) * sizeof(T));
+        memcpy(&to->keyArray[dst], &from->keyArray[src], count * sizeof(T));
+        to->numKeys += count;
+    }
+
+    static void erase(NonLeafNode<T>* node, const int i, const int count) {
+        memmove(&node->keyArray[i], &node->keyArray[i + count], (node->numKeys - i - count) * sizeof(T));
+        node->numKeys -= count;
+    }
+
+    static void assign(NonLeafNode<T>* node, const T* keys, const int count) {
+        memcpy(node->keyArray, keys, count * sizeof(T));
+        node->numKeys = count;
+    }
+
+    /**
+     * Whether any key can be added.
+     */
+    static bool hasRoom(const NonLeafNode<T>* node, const int occupancy) {
+        return node->numKeys < occupancy;
+    }
+
+    static bool fits(const NonLeafNode<T>* node, const T& key, const int occupancy) {
+        return node->numKeys < occupancy;
+    }
+
+    static bool underfull(const NonLeafNode<T>* node, const int occupancy) {
+        return node->numKeys < occupancy / 2;
+    }
+
+    /**
+     * Whether left, the separator between them and right fit in one node.
+     */
+    static bool fitsMerged(const NonLeafNode<T>* left, const T& separator, const NonLeafNode<T>* right,
+                           const int occupancy) {
+        return left->numKeys + right->numKeys + 1 <= occupancy;
+    }
+
+    /**
+     * Whether a node built from count keys stays within fillFactor of its bytes. The
+     * bulk load already caps the count of fixed-width keys.
+     */
+    static bool fitsKeys(const T* keys, const int count, const double fillFactor) {
+        return true;
+    }
+
+    /**
+     * Slot of the key to push up when key is added at pos of a full node.
+     */
+    static int splitPoint(const NonLeafNode<T>* node, const int pos, const T& key) {
+        return (node->numKeys + 1) / 2;
+    }
+};
+
+template <>
+struct Separators<VarStringKey> {
+    static const bool VARIABLE = true;
+
+    static const int SLOTBYTES = sizeof(StringSlot);
+
+    static VarStringKey key(const NonLeafNode<VarStringKey>* node, const int i) {
+        return storedString(node->data, STRINGNODEDATA, node->prefixLength, slots(node)[i]);
+    }
+
+    /**
+     * Stores the new key below the other rests, or over the old one when it is no longer.
+     */
+    static void set(NonLeafNode<VarStringKey>* node, const int i, const VarStringKey& key) {
+        keepPrefix(node, key);
+        StringSlot* s = slots(node);
+        int length = key.length - node->prefixLength;
+        node->deadBytes += s[i].length;
+        if (length <= s[i].length) {
+            memcpy(node->data + s[i].offset, key.data + node->prefixLength, length);
+            s[i].length = (unsigned short) length;
+            node->deadBytes -= length;
+            return;
+        }
+        s[i].length = 0;
+        makeRoom(node, 0, length);
+        s[i] = appendRest(node, key.data + node->prefixLength, length);
+    }
+
+    /**
+     * The first key of an empty node becomes its prefix.
+     */
+    static void insert(NonLeafNode<VarStringKey>* node, const int i, const VarStringKey& key) {
+        if (node->numKeys == 0) {
+            startPrefix(node, key.data, key.length);
+        }
+        keepPrefix(node, key);
+        int length = key.length - node->prefixLength;
+        makeRoom(node, 1, length);
+        StringSlot* s = slots(node);
+        memmove(&s[i + 1], &s[i], (node->numKeys - i) * sizeof(StringSlot));
+        s[i] = appendRest(node, key.data + node->prefixLength, length);
+        node->numKeys++;
+    }
+
+    /**
+     * The moved keys are a run in key order, so the first and last of them share the
+     * least of the prefix of to, and an empty to takes the prefix those two share.
+     */
+    static void insertRange(NonLeafNode<VarStringKey>* to, const int dst, const NonLeafNode<VarStringKey>* from,
+                            const int src, const int count) {
+        if (count == 0) {
+            return;
+        }
+        VarStringKey first = key(from, src);
+        VarStringKey last = key(from, src + count - 1);
+        if (to->numKeys == 0) {
+            startPrefix(to, first.data, commonPrefix(first, last));
+        }
+        keepPrefix(to, first);
+        keepPrefix(to, last);
+        const StringSlot* moved = slots(from) + src;
+        int length = 0;
+        for (int j = 0; j < count; j++) {
+            length += from->prefixLength + moved[j].length - to->prefixLength;
+        }
+        makeRoom(to, count, length);
+        StringSlot* s = slots(to);
+        memmove(&s[dst + count], &s[dst], (to->numKeys - dst) * sizeof(StringSlot));
+        for (int j = 0; j < count; j++) {
+            VarStringKey k = key(from, src + j);
+            s[dst + j] = appendRest(to, k.data + to->prefixLength, k.length - to->prefixLength);
+        }
+        to->numKeys += count;
+    }
+
+    /**
+     * Drops the slots; the prefix stays, as the keys left still start with it.
+     */
+    static void erase(NonLeafNode<VarStringKey>* node, const int i, const int count) {
+        StringSlot* s = slots(node);
+        for (int j = i; j < i + count; j++) {
+            node->deadBytes += s[j].length;
+        }
+        memmove(&s[i], &s[i + count], (node->numKeys - i - count) * sizeof(StringSlot));
+        node->numKeys -= count;
+        if (node->numKeys == 0) {
+            node->prefixLength = 0;
+            node->heapBytes = 0;
+            node->deadBytes = 0;
+        }
+    }
+
+    static void assign(NonLeafNode<VarStringKey>* node, const VarStringKey* keys, const int count) {
+        node->numKeys = count;
+        node->deadBytes = 0;
+        writeStrings(node->data, STRINGNODEDATA, node->data, SLOTBYTES, keys, count,
+                     node->prefixLength, node->heapBytes);
+    }
+
+    /**
+     * Leaves room for a key of MAXSTRINGKEY bytes that shares none of the prefix.
+     */
+    static bool hasRoom(const NonLeafNode<VarStringKey>* node, const int occupancy) {
+        return node->numKeys < STRINGFANOUT
+            && usedBytes(node) + node->numKeys * node->prefixLength + SLOTBYTES + MAXSTRINGKEY <= STRINGNODEDATA;
+    }
+
+    /**
+     * A key that does not start with the prefix cuts it short, and every key then
+     * stores the bytes cut off.
+     */
+    static bool fits(const NonLeafNode<VarStringKey>* node, const VarStringKey& key, const int occupancy) {
+        int n = node->numKeys;
+        if (n >= STRINGFANOUT) {
+            return false;
+        }
+        int prefix = node->prefixLength;
+        int shared = n == 0 ? 0 : sharedBytes(key.data, key.length, node->data + STRINGNODEDATA - prefix, prefix);
+        return usedBytes(node) + n * (prefix - shared) + SLOTBYTES + key.length - shared <= STRINGNODEDATA;
+    }
+
+    static bool underfull(const NonLeafNode<VarStringKey>* node, const int occupancy) {
+        return usedBytes(node) < STRINGNODEDATA / 3;
+    }
+
+    /**
+     * The merged keys run from the first of left to the last of right, and share the
+     * prefix of those two.
+     */
+    static bool fitsMerged(const NonLeafNode<VarStringKey>* left, const VarStringKey& separator,
+                           const NonLeafNode<VarStringKey>* right, const int occupancy) {
+        int n = left->numKeys + 1 + right->numKeys;
+        if (n > STRINGFANOUT) {
+            return false;
+        }
+        int prefix = commonPrefix(left->numKeys == 0 ? separator : key(left, 0),
+                                  right->numKeys == 0 ? separator : key(right, right->numKeys - 1));
+        int bytes = keyBytes(left) + separator.length + keyBytes(right);
+        return prefix + n * (SLOTBYTES - prefix) + bytes <= STRINGNODEDATA;
+    }
+
+    static bool fitsKeys(const VarStringKey* keys, const int count, const double fillFactor) {
+        return count <= STRINGFANOUT && stringBytes(keys, count, SLOTBYTES) <= STRINGNODEDATA * fillFactor;
+    }
+
+    /**
+     * Splits the keys with key added at pos so that the fuller of the two halves takes
+     * as few bytes as it can. The bytes of a run of keys are its slots, the prefix its
+     * first and last key share, and the rest of each key.
+     */
+    static int splitPoint(const NonLeafNode<VarStringKey>* node, const int pos, const VarStringKey& key) {
+        int n = node->numKeys;
+        if (n < 2) {
+            return (n + 1) / 2;
+        }
+        // Bytes of the first j keys, with key among them.
+        int lengths[STRINGFANOUT + 2];
+        lengths[0] = 0;
+        for (int j = 0; j <= n; j++) {
+            int length = j == pos ? key.length : node->prefixLength + slots(node)[j < pos ? j : j - 1].length;
+            lengths[j + 1] = lengths[j] + length;
+        }
+        int best = (n + 1) / 2;
+        int bestBytes = STRINGNODEDATA * 2;
+        for (int m = 1; m < n; m++) {
+            int leftPrefix = commonPrefix(keyWith(node, pos, key, 0), keyWith(node, pos, key, m - 1));
+            int rightPrefix = commonPrefix(keyWith(node, pos, key, m + 1), keyWith(node, pos, key, n));
+            int bytes = std::max(leftPrefix + m * (SLOTBYTES - leftPrefix) + lengths[m],
+                                 rightPrefix + (n - m) * (SLOTBYTES - rightPrefix) + lengths[n + 1] - lengths[m + 1]);
+            if (bytes < bestBytes) {
+                best = m;
+                bestBytes = bytes;
+            }
+        }
+        return best;
+    }
+
+    static int search(const NonLeafNode<VarStringKey>* node, const VarStringKey& key, const bool upper) {
+        return searchStrings(node->data, STRINGNODEDATA, node->prefixLength, node->data, SLOTBYTES,
+                             node->numKeys, key, upper);
+    }
+
+ private:
+    static StringSlot* slots(const NonLeafNode<VarStringKey>* node) {
+        return (StringSlot*) node->data;
+    }
+
+    /**
+     * Bytes the slots and the live rests take.
+     */
+    static int usedBytes(const NonLeafNode<VarStringKey>* node) {
+        return node->numKeys * SLOTBYTES + node->heapBytes - node->deadBytes;
+    }
+
+    /**
+     * Bytes of the keys of a node, prefix included in each.
+     */
+    static int keyBytes(const NonLeafNode<VarStringKey>* node) {
+        if (node->numKeys == 0) {
+            return 0;
+        }
+        return node->numKeys * node->prefixLength + node->heapBytes - node->deadBytes - node->prefixLength;
+    }
+
+    /**
+     * Key j of the node with key added at pos.
+     */
+    static VarStringKey keyWith(const NonLeafNode<VarStringKey>* node, const int pos, const VarStringKey& key,
+                                const int j) {
+        return j == pos ? key : Separators<VarStringKey>::key(node, j < pos ? j : j - 1);
+    }
+
+    static void startPrefix(NonLeafNode<VarStringKey>* node, const char* prefix, const int length) {
+        memcpy(node->data + STRINGNODEDATA - length, prefix, length);
+        node->prefixLength = (unsigned short) length;
+        node->heapBytes = (unsigned short) length;
+        node->deadBytes = 0;
+    }
+
+    /**
+     * Cuts the prefix of a node short to what key shares of it.
+     */
+    static void keepPrefix(NonLeafNode<VarStringKey>* node, const VarStringKey& key) {
+        int prefix = node->prefixLength;
+        int shared = sharedBytes(key.data, key.length, node->data + STRINGNODEDATA - prefix, prefix);
+        if (shared < prefix) {
+            compact(node, shared);
+        }
+    }
+
+    /**
+     * Compacts the node when the free bytes between the slots and the rests do not
+     * hold count more slots and length more bytes of rests.
+     */
+    static void makeRoom(NonLeafNode<VarStringKey>* node, const int count, const int length) {
+        if ((node->numKeys + count) * SLOTBYTES + node->heapBytes + length > STRINGNODEDATA) {
+            compact(node, node->prefixLength);
+        }
+    }
+
+    static StringSlot appendRest(NonLeafNode<VarStringKey>* node, const char* rest, const int length) {
+        StringSlot slot;
+        slot.length = (unsigned short) length;
+        slot.offset = (unsigned short) (STRINGNODEDATA - node->heapBytes - length);
+        memcpy(node->data + slot.offset, rest, length);
+        node->heapBytes += length;
+        return slot;
+    }
+
+    /**
+     * Rewrites the rests of the keys below a prefix of prefix bytes, which must be no
+     * longer than the one of the node, dropping the bytes left behind.
+     */
+    static void compact(NonLeafNode<VarStringKey>* node, const int prefix) {
+        char heap[STRINGNODEDATA];
+        int bottom = STRINGNODEDATA - node->heapBytes;
+        memcpy(heap + bottom, node->data + bottom, node->heapBytes);
+        const char* cut = heap + STRINGNODEDATA - node->prefixLength + prefix;
+        int cutLength = node->prefixLength - prefix;
+        int end = STRINGNODEDATA - node->prefixLength;
+        memcpy(node->data + STRINGNODEDATA - prefix, heap + end, prefix);
+        end = STRINGNODEDATA - prefix;
+        StringSlot* s = slots(node);
+        for (int i = 0; i < node->numKeys; i++) {
+            end -= cutLength + s[i].length;
+            memcpy(node->data + end, cut, cutLength);
+            memcpy(node->data + end + cutLength, heap + s[i].offset, s[i].length);
+            s[i].offset = (unsigned short) end;
+            s[i].length = (unsigned short) (cutLength + s[i].length);
+        }
+        node->prefixLength = (unsigned short) prefix;
+        node->heapBytes = (unsigned short) (STRINGNODEDATA - end);
+        node->deadBytes = 0;
+    }
+};
+
+/**
+ * VarStringKey nodes are searched through their slots, and keep no counts.
+ */
+template <>
+int BTreeIndex::childLowerBound<VarStringKey>(const NonLeafNode<VarStringKey>* node, const VarStringKey& key) const {
+    return Separators<VarStringKey>::search(node, key, false);
+}
+
+template <>
+int BTreeIndex::childUpperBound<VarStringKey>(const NonLeafNode<VarStringKey>* node, const VarStringKey& key) const {
+    return Separators<VarStringKey>::search(node, key, true);
+}
+
+template <>
+long* BTreeIndex::childCounts<VarStringKey>(NonLeafNode<VarStringKey>* node) const {
+    return nullptr;
+}
+
+template <class T>
+bool BTreeIndex::keepsCounts() const {
+    return !Separators<T>::VARIABLE && countedNodes;
+}
+
+// -----------------------------------------------------------------------------
+// Key positions and histograms
+// -----------------------------------------------------------------------------
+/**
+ * Maps keys to doubles in key order, so that histogram buckets can be split by
+ * the share of their key range a scan covers. Keys compared bytewise are read
+ * as a big-endian number from their first eight bytes.
+ */
+static double leadingBytes(const unsigned char* bytes, int length) {
+    uint64_t value = 0;
+    for (int b = 0; b < 8; b++) {
+        value = value << 8 | (b < length ? bytes[b] : 0);
+    }
+    return (double) value;
+}
+
+static double keyPosition(const int& key) {
+    return key;
+}
+
+static double keyPosition(const double& key) {
+    return key;
+}
+
+static double keyPosition(const StringKey& key) {
+    return leadingBytes((const unsigned char*) key.data, STRINGSIZE);
+}
+
+static double keyPosition(const IntPairKey& key) {
+    return key.first * 4294967296.0 + ((double) key.second - INT_MIN);
+}
+
+static double keyPosition(const IntDoubleKey& key) {
+    return key.first;
+}
+
+static double keyPosition(const CompositeKey& key) {
+    return leadingBytes(key.data, COMPOSITESIZE);
+}
+
+static double keyPosition(const VarStringKey& key) {
+    return leadingBytes((const unsigned char*) key.data, key.length);
+}
+
+/**
+ * @brief Builds an equi-depth histogram from keys in ascending order. A bucket is
+ * closed at the first new key once it holds its share of the entries, so the
+ * entries of a key are never split between buckets. A key with a share of entries
+ * or more of its own gets a bucket to itself, so that its count is not averaged
+ * over the keys it shares a bucket with.
+ */
+class HistogramBuilder {
+ public:
+    /**
+     * @param entries   About how many entries will be added.
+     */
+    explicit HistogramBuilder(long entries)
+        : share(std::max(1L, (entries + HISTOGRAMBUCKETS - 1) / HISTOGRAMBUCKETS)),
+          runStart(0), beforeRun(0)
+    {
+    }
+
+    /**
+     * Adds the next entry.
+     * @param position  Position of its key.
+     * @param newKey    Whether its key differs from that of the entry before.
+     */
+    void add(double position, bool newKey) {
+        if (newKey || buckets.empty()) {
+            splitFrequentKey();
+            if (buckets.empty() || (buckets.back().entries >= share && (int) buckets.size() < HISTOGRAMBUCKETS)) {
+                HistogramBucket bucket = { position, position, 0, 0 };
+                buckets.push_back(bucket);
+            }
+            runStart = buckets.back().entries;
+            beforeRun = buckets.back().upperBound;
+            buckets.back().distinctKeys++;
+        }
+        HistogramBucket& bucket = buckets.back();
+        bucket.upperBound = position;
+        bucket.entries++;
+    }
+
+    /**
+     * Ends the last bucket once every entry was added.
+     */
+    void finish() {
+        splitFrequentKey();
+    }
+
+    std::vector<HistogramBucket> buckets;
+
+ private:
+    long share;
+
+    /**
+     * Entries of the last bucket before the key being added, and the position of the
+     * key before it.
+     */
+    long runStart;
+    double beforeRun;
+
+    void splitFrequentKey() {
+        if (buckets.empty() || (int) buckets.size() >= HISTOGRAMBUCKETS) {
+            return;
+        }
+        HistogramBucket& last = buckets.back();
+        long run = last.entries - runStart;
+        if (runStart == 0 || run < share) {
+            return;
+        }
+        HistogramBucket single = { last.upperBound, last.upperBound, run, 1 };
+        last.upperBound = beforeRun;
+        last.entries = runStart;
+        last.distinctKeys--;
+        buckets.push_back(single);
+        runStart = 0;
+    }
+};
+
+// -----------------------------------------------------------------------------
+// PlainLeaf
+// -----------------------------------------------------------------------------
+/**
+ * Leaf operations over the LeafNode layout, with the same interface as
+ * PackedIntLeaf and PostingLeaf. The typed tree code reaches the entries of a
+ * leaf only through one of them, picked once per call from the attribute type
+ * and the layout recorded in the meta page.
+ * A leaf is underfull below half its slots.
+ */
+template <class T>
+struct PlainLeaf {
+    /**
+     * Most entries a leaf holds.
+     */
+    static const int MAXENTRIES = NodeSize<T>::LEAF;
+
+    static int size(const Page* page) {
+        return ((const LeafNode<T>*) page)->numKeys;
+    }
+
+    static PageId rightSib(const Page* page) {
+        return ((const LeafNode<T>*) page)->rightSibPageNo;
+    }
+
+    static void setRightSib(Page* page, const PageId pageNo) {
+        ((LeafNode<T>*) page)->rightSibPageNo = pageNo;
+    }
+
+    static PageId leftSib(const Page* page) {
+        return ((const LeafNode<T>*) page)->leftSibPageNo;
+    }
+
+    static void setLeftSib(Page* page, const PageId pageNo) {
+        ((LeafNode<T>*) page)->leftSibPageNo = pageNo;
+    }
+
+    static const T& key(const Page* page, const int i) {
+        return ((const LeafNode<T>*) page)->keyArray[i];
+    }
+
+    static const RecordId& rid(const Page* page, const int i) {
+        return ((const LeafNode<T>*) page)->ridArray[i];
+    }
+
+    static void copyRids(const Page* page, const int from, const int n, RecordId* out) {
+        memcpy(out, &((const LeafNode<T>*) page)->ridArray[from], n * sizeof(RecordId));
+    }
+
+    /**
+     * Entries of this layout carry no included attributes.
+     */
+    static void copyPayloads(const Page* page, const int from, const int n, char* out) {
+    }
+
+    static int lowerBound(const Page* page, const T& key) {
+        const LeafNode<T>* leaf = (const LeafNode<T>*) page;
+        return badgerdb::lowerBound(leaf->keyArray, leaf->numKeys, key);
+    }
+
+    static int upperBound(const Page* page, const T& key) {
+        const LeafNode<T>* leaf = (const LeafNode<T>*) page;
+        return badgerdb::upperBound(leaf->keyArray, leaf->numKeys, key);
+    }
+
+    static bool hasRoom(const Page* page) {
+        return size(page) < NodeSize<T>::LEAF;
+    }
+
+    /**
+     * Binary searches for the place of the entry and shifts the larger entries
+     * over by one. Duplicates keep their insertion order.
+     */
+    static bool insert(Page* page, const T& key, const RecordId& rid, const char* payload) {
+        LeafNode<T>* leaf = (LeafNode<T>*) page;
+        int n = leaf->numKeys;
+        if (n == NodeSize<T>::LEAF) {
+            return false;
+        }
+        int i = badgerdb::upperBound(leaf->keyArray, n, key);
+        memmove(&leaf->keyArray[i+1], &leaf->keyArray[i], (n - i) * sizeof(T));
+        memmove(&leaf->ridArray[i+1], &leaf->ridArray[i], (n - i) * sizeof(RecordId));
+        leaf->keyArray[i] = key;
+        leaf->ridArray[i] = rid;
+        leaf->numKeys = n + 1;
+        return true;
+    }
+
+    /**
+     * Adds an entry whose key is not below any key of the leaf, without a search.
+     */
+    static bool append(Page* page, const T& key, const RecordId& rid, const char* payload) {
+        LeafNode<T>* leaf = (LeafNode<T>*) page;
+        int n = leaf->numKeys;
+        if (n == NodeSize<T>::LEAF) {
+            return false;
+        }
+        leaf->keyArray[n] = key;
+        leaf->ridArray[n] = rid;
+        leaf->numKeys = n + 1;
+        return true;
+    }
+
+    static void erase(Page* page, const int i) {
+        LeafNode<T>* leaf = (LeafNode<T>*) page;
+        int n = leaf->numKeys;
+        memmove(&leaf->keyArray[i], &leaf->keyArray[i+1], (n - i - 1) * sizeof(T));
+        memmove(&leaf->ridArray[i], &leaf->ridArray[i+1], (n - i - 1) * sizeof(RecordId));
+        leaf->numKeys = n - 1;
+    }
+
+    static void split(Page* old, Page* fresh, const int at) {
+        LeafNode<T>* left = (LeafNode<T>*) old;
+        LeafNode<T>* right = (LeafNode<T>*) fresh;
+        right->numKeys = left->numKeys - at;
+        memcpy(&right->keyArray[0], &left->keyArray[at], right->numKeys * sizeof(T));
+        memcpy(&right->ridArray[0], &left->ridArray[at], right->numKeys * sizeof(RecordId));
+        left->numKeys = at;
+    }
+
+    /**
+     * Merges while the two leaves hold fewer entries than two half full ones.
+     */
+    static bool merge(Page* leftPage, Page* rightPage) {
+        LeafNode<T>* left = (LeafNode<T>*) leftPage;
+        LeafNode<T>* right = (LeafNode<T>*) rightPage;
+        int l = left->numKeys;
+        int r = right->numKeys;
+        if (l + r >= 2 * (NodeSize<T>::LEAF / 2)) {
+            return false;
+        }
+        memcpy(&left->keyArray[l], &right->keyArray[0], r * sizeof(T));
+        memcpy(&left->ridArray[l], &right->ridArray[0], r * sizeof(RecordId));
+        left->numKeys = l + r;
+        left->rightSibPageNo = right->rightSibPageNo;
+        return true;
+    }
+
+    static bool redistribute(Page* leftPage, Page* rightPage) {
+        LeafNode<T>* left = (LeafNode<T>*) leftPage;
+        LeafNode<T>* right = (LeafNode<T>*) rightPage;
+        int l = left->numKeys;
+        int r = right->numKeys;
+        int newLeft = (l + r) / 2;
+        if (l > newLeft) {
+            // Move the tail of the left leaf to the front of the right one.
+            int k = l - newLeft;
+            memmove(&right->keyArray[k], &right->keyArray[0], r * sizeof(T));
+            memmove(&right->ridArray[k], &right->ridArray[0], r * sizeof(RecordId));
+            memcpy(&right->keyArray[0], &left->keyArray[newLeft], k * sizeof(T));
+            memcpy(&right->ridArray[0], &left->ridArray[newLeft], k * sizeof(RecordId));
+        } else {
+            // Move the head of the right leaf to the end of the left one.
+            int k = newLeft - l;
+            memcpy(&left->keyArray[l], &right->keyArray[0], k * sizeof(T));
+            memcpy(&left->ridArray[l], &right->ridArray[0], k * sizeof(RecordId));
+            memmove(&right->keyArray[0], &right->keyArray[k], (r - k) * sizeof(T));
+            memmove(&right->ridArray[0], &right->ridArray[k], (r - k) * sizeof(RecordId));
+        }
+        left->numKeys = newLeft;
+        right->numKeys = l + r - newLeft;
+        return true;
+    }
+
+    static bool underfull(const Page* page) {
+        return size(page) < NodeSize<T>::LEAF / 2;
+    }
+
+    static bool safeToRemove(const Page* page) {
+        return size(page) > NodeSize<T>::LEAF / 2;
+    }
+
+    /**
+     * Tells whether a bulk load has filled the leaf to the fill factor.
+     */
+    static bool filled(const Page* page, const double fillFactor) {
+        return size(page) >= std::max(1, (int) (NodeSize<T>::LEAF * fillFactor));
+    }
+};
+
+// -----------------------------------------------------------------------------
+// PostingLeaf
+// -----------------------------------------------------------------------------
+/**
+ * Leaf operations over the PostingLeafHeader layout, with the same interface as
+ * PlainLeaf. Entry i is the i-th rid of the leaf; its key is the key of the run
+ * holding it. Adding or removing a rid shifts the later rids and run ends in place,
+ * and only a rid outside the current encoding makes the leaf be rebuilt wider.
+ * Splits, merges and redistribution decode both leaves and encode them again.
+ * A leaf is underfull below a third of its bytes.
+ */
+template <class T>
+struct PostingLeaf {
+    /**
+     * Bytes a distinct key takes besides its rids: the key and the end of its run.
+     */
+    static const int KEYBYTES = sizeof(T) + sizeof(unsigned short);
+
+    /**
+     * Most bytes one rid can take.
+     */
+    static const int MAXRID = sizeof(PageId) + sizeof(SlotId);
+
+    /**
+     * Most entries a leaf holds: a single key with 3 byte rids.
+     */
+    static const int MAXENTRIES = (POSTINGLEAFDATA - KEYBYTES) / 3;
+
+    static int size(const Page* page) {
+        return header(page)->numKeys;
+    }
+
+    static PageId rightSib(const Page* page) {
+        return header(page)->rightSibPageNo;
+    }
+
+    static void setRightSib(Page* page, const PageId pageNo) {
+        ((PostingLeafHeader*) page)->rightSibPageNo = pageNo;
+    }
+
+    static PageId leftSib(const Page* page) {
+        return header(page)->leftSibPageNo;
+    }
+
+    static void setLeftSib(Page* page, const PageId pageNo) {
+        ((PostingLeafHeader*) page)->leftSibPageNo = pageNo;
+    }
+
+    static const T& key(const Page* page, const int i) {
+        return keys(page)[runOf(page, i)];
+    }
+
+    static RecordId rid(const Page* page, const int i) {
+        const PostingLeafHeader* h = header(page);
+        return readRid(h, rids(page) + i * ridBytes(h));
+    }
+
+    /**
+     * Rids of nearby records, in 3 bytes each, are unpacked in a loop of their own.
+     */
+    static void copyRids(const Page* page, const int from, const int n, RecordId* out) {
+        const PostingLeafHeader* h = header(page);
+        int rb = ridBytes(h);
+        const unsigned char* r = (const unsigned char*) rids(page) + from * rb;
+        if (h->pageBytes == 2 && h->slotBytes == 1) {
+            PageId base = h->pageBase;
+            for (int i = 0; i < n; i++, r += 3) {
+                out[i].page_number = base + (r[0] | (r[1] << 8));
+                out[i].slot_number = r[2];
+            }
+            return;
+        }
+        for (int i = 0; i < n; i++, r += rb) {
+            out[i] = readRid(h, (const char*) r);
+        }
+    }
+
+    static void copyPayloads(const Page* page, const int from, const int n, char* out) {
+    }
+
+    static int lowerBound(const Page* page, const T& key) {
+        return runStart(page, badgerdb::lowerBound(keys(page), header(page)->numGroups, key));
+    }
+
+    static int upperBound(const Page* page, const T& key) {
+        return runStart(page, badgerdb::upperBound(keys(page), header(page)->numGroups, key));
+    }
+
+    /**
+     * Allows for a new key and for every rid growing to the widest encoding.
+     */
+    static bool hasRoom(const Page* page) {
+        const PostingLeafHeader* h = header(page);
+        return (h->numKeys + 1) * MAXRID + (h->numGroups + 1) * KEYBYTES <= POSTINGLEAFDATA;
+    }
+
+    /**
+     * Adds the rid to the run of its key, in rid order, or opens a run for the key.
+     */
+    static bool insert(Page* page, const T& key, const RecordId& rid, const char* payload) {
+        PostingLeafHeader* h = (PostingLeafHeader*) page;
+        int n = h->numKeys;
+        int numRuns = h->numGroups;
+        if (n > 0 && !encodable(h, rid)) {
+            // Rebuild the leaf with an encoding wide enough for the new rid.
+            Postings all;
+            decode(page, all);
+            all.add(key, rid);
+            return encode(page, all, 0, n + 1);
+        }
+        if (n == 0) {
+            h->pageBase = rid.page_number;
+            h->pageBytes = 2;
+            h->slotBytes = rid.slot_number < 256 ? 1 : 2;
+        }
+        int g = badgerdb::lowerBound(keys(page), numRuns, key);
+        bool found = g < numRuns && KeyTraits<T>::compare(keys(page)[g], key) == 0;
+        int rb = ridBytes(h);
+        if (usedBytes(h) + rb + (found ? 0 : KEYBYTES) > POSTINGLEAFDATA) {
+            return false;
+        }
+        char* d = data(page);
+        int pos = runStart(page, g);
+        if (found) {
+            // After every rid of the run that is not above the new one.
+            int high = runEnd(page, g);
+            while (pos < high) {
+                int mid = (pos + high) / 2;
+                if (ridLess(rid, readRid(h, rids(page) + mid * rb))) {
+                    high = mid;
+                } else {
+                    pos = mid + 1;
+                }
+            }
+        } else {
+            // Open a key slot, moving the later keys and all rids up, and an empty run.
+            memmove(d + (g + 1) * sizeof(T), d + g * sizeof(T), (numRuns - g) * sizeof(T) + n * rb);
+            memcpy(d + g * sizeof(T), &key, sizeof(T));
+            memmove(endSlot(page, numRuns), endSlot(page, numRuns - 1), (numRuns - g) * sizeof(unsigned short));
+            setRunEnd(page, g, pos);
+            h->numGroups = ++numRuns;
+        }
+        char* r = rids(page) + pos * rb;
+        memmove(r + rb, r, (n - pos) * rb);
+        writeRid(h, r, rid);
+        for (int k = g; k < numRuns; k++) {
+            setRunEnd(page, k, runEnd(page, k) + 1);
+        }
+        h->numKeys = n + 1;
+        return true;
+    }
+
+    static bool append(Page* page, const T& key, const RecordId& rid, const char* payload) {
+        return insert(page, key, rid, payload);
+    }
+
+    /**
+     * Removes the rid, and the key with it if it was the last of its run.
+     */
+    static void erase(Page* page, const int i) {
+        PostingLeafHeader* h = (PostingLeafHeader*) page;
+        int n = h->numKeys;
+        int numRuns = h->numGroups;
+        int g = runOf(page, i);
+        int rb = ridBytes(h);
+        char* r = rids(page) + i * rb;
+        memmove(r, r + rb, (n - i - 1) * rb);
+        for (int k = g; k < numRuns; k++) {
+            setRunEnd(page, k, runEnd(page, k) - 1);
+        }
+        h->numKeys = --n;
+        if (runStart(page, g) == runEnd(page, g)) {
+            char* d = data(page);
+            memmove(d + g * sizeof(T), d + (g + 1) * sizeof(T), (numRuns - g - 1) * sizeof(T) + n * rb);
+            memmove(endSlot(page, numRuns - 2), endSlot(page, numRuns - 1), (numRuns - g - 1) * sizeof(unsigned short));
+            h->numGroups = --numRuns;
+        }
+        if (n == 0) {
+            // The next entry picks the encoding afresh.
+            h->pageBytes = 0;
+        }
+    }
+
+    /**
+     * Each half needs no wider an encoding than the whole leaf, and a run cut in two
+     * costs one more key on a side that gives up all the rids of the other, so both
+     * halves always fit.
+     */
+    static void split(Page* old, Page* fresh, const int at) {
+        Postings all;
+        decode(old, all);
+        encode(fresh, all, at, all.size());
+        encode(old, all, 0, at);
+    }
+
+    /**
+     * Merges if the entries of both leaves fit in one.
+     */
+    static bool merge(Page* left, Page* right) {
+        Postings all;
+        decode(left, all);
+        decode(right, all);
+        if (!encode(left, all, 0, all.size())) {
+            return false;
+        }
+        setRightSib(left, rightSib(right));
+        return true;
+    }
+
+    static bool redistribute(Page* left, Page* right) {
+        Postings all;
+        decode(left, all);
+        decode(right, all);
+        int n = all.size();
+        int at = n / 2;
+        if (encodedBytes(all, 0, at) > POSTINGLEAFDATA || encodedBytes(all, at, n) > POSTINGLEAFDATA) {
+            return false;
+        }
+        encode(left, all, 0, at);
+        encode(right, all, at, n);
+        return true;
+    }
+
+    static bool underfull(const Page* page) {
+        return usedBytes(header(page)) < POSTINGLEAFDATA / 3;
+    }
+
+    static bool safeToRemove(const Page* page) {
+        const PostingLeafHeader* h = header(page);
+        return usedBytes(h) - ridBytes(h) - KEYBYTES >= POSTINGLEAFDATA / 3;
+    }
+
+    /**
+     * Tells whether a bulk load has filled the leaf's bytes to the fill factor.
+     */
+    static bool filled(const Page* page, const double fillFactor) {
+        return usedBytes(header(page)) >= POSTINGLEAFDATA * fillFactor;
+    }
+
+ private:
+    /**
+     * Entries of one or two leaves while they are re-encoded, with the same runs.
+     */
+    struct Postings {
+        std::vector<T> keys;
+        std::vector<int> ends;
+        std::vector<RecordId> rids;
+
+        int size() const {
+            return (int) rids.size();
+        }
+
+        /**
+         * Index of the run holding entry i.
+         */
+        int runOf(const int i) const {
+            return (int) (std::upper_bound(ends.begin(), ends.end(), i) - ends.begin());
+        }
+
+        /**
+         * Adds an entry in key and rid order.
+         */
+        void add(const T& key, const RecordId& rid) {
+            int g = badgerdb::lowerBound(keys.data(), (int) keys.size(), key);
+            int start = g == 0 ? 0 : ends[g-1];
+            if (g == (int) keys.size() || KeyTraits<T>::compare(keys[g], key) != 0) {
+                keys.insert(keys.begin() + g, key);
+                ends.insert(ends.begin() + g, start);
+            }
+            std::vector<RecordId>::iterator pos =
+                std::upper_bound(rids.begin() + start, rids.begin() + ends[g], rid, ridLess);
+            rids.insert(pos, rid);
+            for (size_t k = g; k < ends.size(); k++) {
+                ends[k]++;
+            }
+        }
+    };
+
+    static const PostingLeafHeader* header(const Page* page) {
+        return (const PostingLeafHeader*) page;
+    }
+
+    static const char* data(const Page* page) {
+        return (const char*) page + sizeof(PostingLeafHeader);
+    }
+
+    static char* data(Page* page) {
+        return (char*) page + sizeof(PostingLeafHeader);
+    }
+
+    static const T* keys(const Page* page) {
+        return (const T*) data(page);
+    }
+
+    static const char* rids(const Page* page) {
+        return data(page) + header(page)->numGroups * sizeof(T);
+    }
+
+    static char* rids(Page* page) {
+        return data(page) + header(page)->numGroups * sizeof(T);
+    }
+
+    /**
+     * Run ends are stored backwards from the end of the page, so that adding a key
+     * moves only the ends after it.
+     */
+    static char* endSlot(Page* page, const int g) {
+        return data(page) + POSTINGLEAFDATA - (g + 1) * sizeof(unsigned short);
+    }
+
+    static int runEnd(const Page* page, const int g) {
+        unsigned short end;
+        memcpy(&end, data(page) + POSTINGLEAFDATA - (g + 1) * sizeof(unsigned short), sizeof(end));
+        return end;
+    }
+
+    static void setRunEnd(Page* page, const int g, const int end) {
+        unsigned short e = (unsigned short) end;
+        memcpy(endSlot(page, g), &e, sizeof(e));
+    }
+
+    static int runStart(const Page* page, const int g) {
+        return g == 0 ? 0 : runEnd(page, g - 1);
+    }
+
+    /**
+     * Index of the run holding entry i, the first one that ends after it.
+     */
+    static int runOf(const Page* page, const int i) {
+        int low = 0;
+        int high = header(page)->numGroups - 1;
+        while (low < high) {
+            int mid = (low + high) / 2;
+            if (runEnd(page, mid) > i) {
+                high = mid;
+            } else {
+                low = mid + 1;
+            }
+        }
+        return low;
+    }
+
+    static int ridBytes(const PostingLeafHeader* h) {
+        return h->pageBytes + h->slotBytes;
+    }
+
+    static int usedBytes(const PostingLeafHeader* h) {
+        return h->numGroups * KEYBYTES + h->numKeys * ridBytes(h);
+    }
+
+    static bool ridLess(const RecordId& a, const RecordId& b) {
+        return a.page_number < b.page_number
+            || (a.page_number == b.page_number && a.slot_number < b.slot_number);
+    }
+
+    /**
+     * Tells whether the rid fits the encoding of a non-empty leaf.
+     */
+    static bool encodable(const PostingLeafHeader* h, const RecordId& rid) {
+        return (h->pageBytes == 4
+                || (rid.page_number >= h->pageBase && rid.page_number - h->pageBase <= 0xFFFF))
+            && (h->slotBytes == 2 || rid.slot_number < 256);
+    }
+
+    static RecordId readRid(const PostingLeafHeader* h, const char* r) {
+        RecordId rid;
+        if (h->pageBytes == 2) {
+            unsigned short p;
+            memcpy(&p, r, sizeof(p));
+            rid.page_number = h->pageBase + p;
+        } else {
+            memcpy(&rid.page_number, r, sizeof(PageId));
+        }
+        r += h->pageBytes;
+        if (h->slotBytes == 1) {
+            rid.slot_number = (unsigned char) *r;
+        } else {
+            memcpy(&rid.slot_number, r, sizeof(SlotId));
+        }
+        return rid;
+    }
+
+    static void writeRid(const PostingLeafHeader* h, char* r, const RecordId& rid) {
+        if (h->pageBytes == 2) {
+            unsigned short p = (unsigned short) (rid.page_number - h->pageBase);
+            memcpy(r, &p, sizeof(p));
+        } else {
+            memcpy(r, &rid.page_number, sizeof(PageId));
+        }
+        r += h->pageBytes;
+        if (h->slotBytes == 1) {
+            *r = (char) rid.slot_number;
+        } else {
+            memcpy(r, &rid.slot_number, sizeof(SlotId));
+        }
+    }
+
+    /**
+     * Appends the entries of the leaf. A first run with the last key already decoded
+     * is joined to that run, keeping its rids sorted.
+     */
+    static void decode(const Page* page, Postings& all) {
+        const PostingLeafHeader* h = header(page);
+        int first = all.size();
+        all.rids.resize(first + h->numKeys);
+        copyRids(page, 0, h->numKeys, &all.rids[first]);
+        for (int g = 0; g < h->numGroups; g++) {
+            int end = first + runEnd(page, g);
+            if (g == 0 && !all.keys.empty() && KeyTraits<T>::compare(all.keys.back(), keys(page)[0]) == 0) {
+                std::inplace_merge(all.rids.begin() + (all.ends.size() > 1 ? all.ends[all.ends.size() - 2] : 0),
+                                   all.rids.begin() + first, all.rids.begin() + end, ridLess);
+                all.ends.back() = end;
+            } else {
+                all.keys.push_back(keys(page)[g]);
+                all.ends.push_back(end);
+            }
+        }
+    }
+
+    /**
+     * Picks the narrowest encoding for entries [from, to) and returns the bytes it takes.
+     */
+    static int encodedBytes(const Postings& all, const int from, const int to,
+                            PageId* pageBase = nullptr, int* pageBytes = nullptr, int* slotBytes = nullptr) {
+        if (from == to) {
+            return 0;
+        }
+        PageId low = all.rids[from].page_number;
+        PageId high = low;
+        SlotId slots = 0;
+        for (int i = from; i < to; i++) {
+            low = std::min(low, all.rids[i].page_number);
+            high = std::max(high, all.rids[i].page_number);
+            slots = std::max(slots, all.rids[i].slot_number);
+        }
+        int pb = high - low <= 0xFFFF ? 2 : 4;
+        int sb = slots < 256 ? 1 : 2;
+        if (pageBase != nullptr) {
+            *pageBase = low;
+            *pageBytes = pb;
+            *slotBytes = sb;
+        }
+        return (all.runOf(to - 1) - all.runOf(from) + 1) * KEYBYTES + (to - from) * (pb + sb);
+    }
+
+    /**
+     * Rewrites the leaf with entries [from, to), keeping its sibling links.
+     * @return  False, with nothing changed, if they do not fit.
+     */
+    static bool encode(Page* page, const Postings& all, const int from, const int to) {
+        PageId pageBase = 0;
+        int pageBytes = 0;
+        int slotBytes = 0;
+        if (encodedBytes(all, from, to, &pageBase, &pageBytes, &slotBytes) > POSTINGLEAFDATA) {
+            return false;
+        }
+        PageId sib = rightSib(page);
+        PageId leftNum = leftSib(page);
+        memset((void*) page, 0, Page::SIZE);
+        PostingLeafHeader* h = (PostingLeafHeader*) page;
+        h->rightSibPageNo = sib;
+        h->leftSibPageNo = leftNum;
+        if (from == to) {
+            return true;
+        }
+        int firstRun = all.runOf(from);
+        int numRuns = all.runOf(to - 1) - firstRun + 1;
+        h->pageBase = pageBase;
+        h->pageBytes = pageBytes;
+        h->slotBytes = slotBytes;
+        h->numKeys = to - from;
+        h->numGroups = numRuns;
+        memcpy(data(page), &all.keys[firstRun], numRuns * sizeof(T));
+        for (int g = 0; g < numRuns; g++) {
+            setRunEnd(page, g, std::min(all.ends[firstRun + g], to) - from);
+        }
+        char* r = rids(page);
+        for (int i = from; i < to; i++, r += pageBytes + slotBytes) {
+            writeRid(h, r, all.rids[i]);
+        }
+        return true;
+    }
+};
+
+// -----------------------------------------------------------------------------
+// PayloadLeaf
+// -----------------------------------------------------------------------------
+/**
+ * Leaf operations over the PayloadLeafHeader layout of covering indexes, with the
+ * same interface as PlainLeaf. The key and rid columns work like those of a plain
+ * leaf, and a third column holds the included attributes of each entry, moved
+ * along with its key and rid. The columns are sized from the payload width the
+ * index records in the header of every leaf it creates.
+ * A leaf is underfull below half its capacity.
+ */
+template <class T>
+struct PayloadLeaf {
+    /**
+     * Most entries a leaf holds, at the narrowest payload of one byte.
+     */
+    static const int MAXENTRIES = (PAYLOADLEAFDATA - sizeof(RecordId)) / (sizeof(T) + sizeof(RecordId) + 1);
+
+    static int size(const Page* page) {
+        return header(page)->numKeys;
+    }
+
+    static PageId rightSib(const Page* page) {
+        return header(page)->rightSibPageNo;
+    }
+
+    static void setRightSib(Page* page, const PageId pageNo) {
+        ((PayloadLeafHeader*) page)->rightSibPageNo = pageNo;
+    }
+
+    static PageId leftSib(const Page* page) {
+        return header(page)->leftSibPageNo;
+    }
+
+    static void setLeftSib(Page* page, const PageId pageNo) {
+        ((PayloadLeafHeader*) page)->leftSibPageNo = pageNo;
+    }
+
+    static const T& key(const Page* page, const int i) {
+        return keys(page)[i];
+    }
+
+    static const RecordId& rid(const Page* page, const int i) {
+        return rids(page)[i];
+    }
+
+    static void copyRids(const Page* page, const int from, const int n, RecordId* out) {
+        memcpy(out, &rids(page)[from], n * sizeof(RecordId));
+    }
+
+    /**
+     * Copies the included attributes of entries [from, from + n) to out, one after the other.
+     */
+    static void copyPayloads(const Page* page, const int from, const int n, char* out) {
+        int p = header(page)->payloadBytes;
+        memcpy(out, payloads(page) + from * p, n * p);
+    }
+
+    static int lowerBound(const Page* page, const T& key) {
+        return badgerdb::lowerBound(keys(page), size(page), key);
+    }
+
+    static int upperBound(const Page* page, const T& key) {
+        return badgerdb::upperBound(keys(page), size(page), key);
+    }
+
+    static bool hasRoom(const Page* page) {
+        return size(page) < capacity(page);
+    }
+
+    /**
+     * Binary searches for the place of the entry and shifts the larger entries
+     * over by one in each column. Duplicates keep their insertion order.
+     */
+    static bool insert(Page* page, const T& key, const RecordId& rid, const char* payload) {
+        int n = size(page);
+        if (n == capacity(page)) {
+            return false;
+        }
+        int i = badgerdb::upperBound(keys(page), n, key);
+        move(page, i + 1, page, i, n - i);
+        put(page, i, key, rid, payload);
+        return true;
+    }
+
+    static bool append(Page* page, const T& key, const RecordId& rid, const char* payload) {
+        int n = size(page);
+        if (n == capacity(page)) {
+            return false;
+        }
+        put(page, n, key, rid, payload);
+        return true;
+    }
+
+    static void erase(Page* page, const int i) {
+        int n = size(page);
+        move(page, i, page, i + 1, n - i - 1);
+        ((PayloadLeafHeader*) page)->numKeys = n - 1;
+    }
+
+    static void split(Page* old, Page* fresh, const int at) {
+        PayloadLeafHeader* left = (PayloadLeafHeader*) old;
+        PayloadLeafHeader* right = (PayloadLeafHeader*) fresh;
+        right->payloadBytes = left->payloadBytes;
+        right->capacity = left->capacity;
+        move(fresh, 0, old, at, left->numKeys - at);
+        right->numKeys = left->numKeys - at;
+        left->numKeys = at;
+    }
+
+    /**
+     * Merges while the two leaves hold fewer entries than two half full ones.
+     */
+    static bool merge(Page* leftPage, Page* rightPage) {
+        PayloadLeafHeader* left = (PayloadLeafHeader*) leftPage;
+        PayloadLeafHeader* right = (PayloadLeafHeader*) rightPage;
+        int l = left->numKeys;
+        int r = right->numKeys;
+        if (l + r >= 2 * (left->capacity / 2)) {
+            return false;
+        }
+        move(leftPage, l, rightPage, 0, r);
+        left->numKeys = l + r;
+        left->rightSibPageNo = right->rightSibPageNo;
+        return true;
+    }
+
+    static bool redistribute(Page* leftPage, Page* rightPage) {
+        PayloadLeafHeader* left = (PayloadLeafHeader*) leftPage;
+        PayloadLeafHeader* right = (PayloadLeafHeader*) rightPage;
+        int l = left->numKeys;
+        int r = right->numKeys;
+        int newLeft = (l + r) / 2;
+        if (l > newLeft) {
+            // Move the tail of the left leaf to the front of the right one.
+            int k = l - newLeft;
+            move(rightPage, k, rightPage, 0, r);
+            move(rightPage, 0, leftPage, newLeft, k);
+        } else {
+            // Move the head of the right leaf to the end of the left one.
+            int k = newLeft - l;
+            move(leftPage, l, rightPage, 0, k);
+            move(rightPage, 0, rightPage, k, r - k);
+        }
+        left->numKeys = newLeft;
+        right->numKeys = l + r - newLeft;
+        return true;
+    }
+
+    static bool underfull(const Page* page) {
+        return size(page) < capacity(page) / 2;
+    }
+
+    static bool safeToRemove(const Page* page) {
+        return size(page) > capacity(page) / 2;
+    }
+
+    static bool filled(const Page* page, const double fillFactor) {
+        return size(page) >= std::max(1, (int) (capacity(page) * fillFactor));
+    }
+
+ private:
+    static const PayloadLeafHeader* header(const Page* page) {
+        return (const PayloadLeafHeader*) page;
+    }
+
+    /**
+     * Number of entries the columns are laid out for. Worked out from the payload
+     * width when the first entry goes into a fresh leaf.
+     */
+    static int capacity(const Page* page) {
+        const PayloadLeafHeader* h = header(page);
+        if (h->capacity == 0) {
+            // Leave room to align the rid column after keys of odd sizes.
+            int cap = (PAYLOADLEAFDATA - sizeof(RecordId)) / (sizeof(T) + sizeof(RecordId) + h->payloadBytes);
+            ((PayloadLeafHeader*) page)->capacity = cap;
+        }
+        return h->capacity;
+    }
+
+    static T* keys(const Page* page) {
+        return (T*) ((char*) page + sizeof(PayloadLeafHeader));
+    }
+
+    static RecordId* rids(const Page* page) {
+        int keyBytes = header(page)->capacity * sizeof(T);
+        keyBytes = (keyBytes + sizeof(RecordId) - 1) / sizeof(RecordId) * sizeof(RecordId);
+        return (RecordId*) ((char*) keys(page) + keyBytes);
+    }
+
+    static char* payloads(const Page* page) {
+        return (char*) (rids(page) + header(page)->capacity);
+    }
+
+    static void put(Page* page, const int i, const T& key, const RecordId& rid, const char* payload) {
+        int p = header(page)->payloadBytes;
+        keys(page)[i] = key;
+        rids(page)[i] = rid;
+        memcpy(payloads(page) + i * p, payload, p);
+        ((PayloadLeafHeader*) page)->numKeys++;
+    }
+
+    /**
+     * Moves n entries from position src of one leaf to position dst of another, or
+     * of the same leaf, in all three columns.
+     */
+    static void move(Page* to, const int dst, const Page* from, const int src, const int n) {
+        int p = header(from)->payloadBytes;
+        memmove(&keys(to)[dst], &keys(from)[src], n * sizeof(T));
+        memmove(&rids(to)[dst], &rids(from)[src], n * sizeof(RecordId));
+        memmove(payloads(to) + dst * p, payloads(from) + src * p, n * p);
+    }
+};
+
+// -----------------------------------------------------------------------------
+// StringLeaf
+// -----------------------------------------------------------------------------
+/**
+ * Leaf operations over the StringLeafHeader layout of VarStringKey keys, with the
+ * same interface as PlainLeaf. An entry is added or removed in place, moving the
+ * later slots and closing up the rests of the keys; only a key that does not start
+ * with the prefix of the leaf has it rebuilt around a shorter one. Splits and
+ * merges rebuild both leaves with the longest prefix each allows. Entries are never
+ * moved between leaves to even them out, as the parent may lack the bytes for the
+ * new separator.
+ * A leaf is underfull below a third of its bytes.
+ */
+struct StringLeaf {
+    /**
+     * Most entries a leaf holds, all of the same key.
+     */
+    static const int MAXENTRIES = STRINGLEAFDATA / sizeof(StringLeafSlot);
+
+    static const int SLOTBYTES = sizeof(StringLeafSlot);
+
+    static int size(const Page* page) {
+        return header(page)->numKeys;
+    }
+
+    static PageId rightSib(const Page* page) {
+        return header(page)->rightSibPageNo;
+    }
+
+    static void setRightSib(Page* page, const PageId pageNo) {
+        ((StringLeafHeader*) page)->rightSibPageNo = pageNo;
+    }
+
+    static PageId leftSib(const Page* page) {
+        return header(page)->leftSibPageNo;
+    }
+
+    static void setLeftSib(Page* page, const PageId pageNo) {
+        ((StringLeafHeader*) page)->leftSibPageNo = pageNo;
+    }
+
+    static VarStringKey key(const Page* page, const int i) {
+        return storedString(data(page), STRINGLEAFDATA, header(page)->prefixLength, slots(page)[i].key);
+    }
+
+    static const RecordId& rid(const Page* page, const int i) {
+        return slots(page)[i].rid;
+    }
+
+    static void copyRids(const Page* page, const int from, const int n, RecordId* out) {
+        const StringLeafSlot* s = slots(page) + from;
+        for (int i = 0; i < n; i++) {
+            out[i] = s[i].rid;
+        }
+    }
+
+    static void copyPayloads(const Page* page, const int from, const int n, char* out) {
+    }
+
+    static int lowerBound(const Page* page, const VarStringKey& key) {
+        return search(page, key, false);
+    }
+
+    static int upperBound(const Page* page, const VarStringKey& key) {
+        return search(page, key, true);
+    }
+
+    /**
+     * Leaves room for a key of MAXSTRINGKEY bytes that shares none of the prefix.
+     */
+    static bool hasRoom(const Page* page) {
+        const StringLeafHeader* h = header(page);
+        return usedBytes(page) + h->numKeys * h->prefixLength + SLOTBYTES + MAXSTRINGKEY <= STRINGLEAFDATA;
+    }
+
+    /**
+     * Puts the entry after any duplicates of its key. The first key of an empty leaf
+     * becomes its prefix.
+     */
+    static bool insert(Page* page, const VarStringKey& key, const RecordId& rid, const char* payload) {
+        StringLeafHeader* h = (StringLeafHeader*) page;
+        int n = h->numKeys;
+        char* d = data(page);
+        if (n == 0) {
+            memcpy(d + STRINGLEAFDATA - key.length, key.data, key.length);
+            h->prefixLength = key.length;
+            h->heapBytes = key.length;
+        } else if (sharedBytes(key.data, key.length, d + STRINGLEAFDATA - h->prefixLength, h->prefixLength)
+                   < h->prefixLength) {
+            // Rebuild the leaf around the prefix the new key still shares.
+            std::vector<VarStringKey> keys;
+            std::vector<RecordId> rids;
+            decode(page, keys, rids);
+            int i = upperBound(page, key);
+            keys.insert(keys.begin() + i, key);
+            rids.insert(rids.begin() + i, rid);
+            if (stringBytes(&keys[0], n + 1, SLOTBYTES) > STRINGLEAFDATA) {
+                return false;
+            }
+            encode(page, &keys[0], &rids[0], n + 1);
+            return true;
+        }
+        int length = key.length - h->prefixLength;
+        if (usedBytes(page) + SLOTBYTES + length > STRINGLEAFDATA) {
+            return false;
+        }
+        int i = upperBound(page, key);
+        StringLeafSlot* s = slots(page);
+        memmove(&s[i + 1], &s[i], (n - i) * sizeof(StringLeafSlot));
+        int offset = STRINGLEAFDATA - h->heapBytes - length;
+        memcpy(d + offset, key.data + h->prefixLength, length);
+        s[i].rid = rid;
+        s[i].key.offset = (unsigned short) offset;
+        s[i].key.length = (unsigned short) length;
+        h->heapBytes += length;
+        h->numKeys = n + 1;
+        return true;
+    }
+
+    static bool append(Page* page, const VarStringKey& key, const RecordId& rid, const char* payload) {
+        return insert(page, key, rid, payload);
+    }
+
+    /**
+     * Removes the entry and moves the rests stored below its own up over it. Empty
+     * rests at the start of the removed one move along, as they mark the same place.
+     */
+    static void erase(Page* page, const int i) {
+        StringLeafHeader* h = (StringLeafHeader*) page;
+        StringLeafSlot* s = slots(page);
+        int n = h->numKeys - 1;
+        StringSlot gone = s[i].key;
+        memmove(&s[i], &s[i + 1], (n - i) * sizeof(StringLeafSlot));
+        if (gone.length > 0) {
+            char* d = data(page);
+            int bottom = STRINGLEAFDATA - h->heapBytes;
+            memmove(d + bottom + gone.length, d + bottom, gone.offset - bottom);
+            for (int j = 0; j < n; j++) {
+                if (s[j].key.offset + s[j].key.length <= gone.offset) {
+                    s[j].key.offset += gone.length;
+                }
+            }
+        }
+        h->numKeys = n;
+        h->heapBytes -= gone.length;
+        if (n == 0) {
+            h->prefixLength = 0;
+            h->heapBytes = 0;
+        }
+    }
+
+    static void split(Page* old, Page* fresh, const int at) {
+        std::vector<VarStringKey> keys;
+        std::vector<RecordId> rids;
+        decode(old, keys, rids);
+        int n = (int) keys.size();
+        encode(fresh, &keys[at], &rids[at], n - at);
+        encode(old, &keys[0], &rids[0], at);
+    }
+
+    /**
+     * Merges when the entries of both leaves fit in one.
+     */
+    static bool merge(Page* leftPage, Page* rightPage) {
+        std::vector<VarStringKey> keys;
+        std::vector<RecordId> rids;
+        decode(leftPage, keys, rids);
+        decode(rightPage, keys, rids);
+        int n = (int) keys.size();
+        if (n > 0 && stringBytes(&keys[0], n, SLOTBYTES) > STRINGLEAFDATA) {
+            return false;
+        }
+        encode(leftPage, keys.data(), rids.data(), n);
+        setRightSib(leftPage, rightSib(rightPage));
+        return true;
+    }
+
+    static bool redistribute(Page* leftPage, Page* rightPage) {
+        return false;
+    }
+
+    static bool underfull(const Page* page) {
+        return usedBytes(page) < STRINGLEAFDATA / 3;
+    }
+
+    static bool safeToRemove(const Page* page) {
+        return usedBytes(page) - SLOTBYTES - MAXSTRINGKEY >= STRINGLEAFDATA / 3;
+    }
+
+    static bool filled(const Page* page, const double fillFactor) {
+        return usedBytes(page) >= STRINGLEAFDATA * fillFactor;
+    }
+
+ private:
+    static const StringLeafHeader* header(const Page* page) {
+        return (const StringLeafHeader*) page;
+    }
+
+    static char* data(const Page* page) {
+        return (char*) page + sizeof(StringLeafHeader);
+    }
+
+    static StringLeafSlot* slots(const Page* page) {
+        return (StringLeafSlot*) data(page);
+    }
+
+    static int usedBytes(const Page* page) {
+        return header(page)->numKeys * SLOTBYTES + header(page)->heapBytes;
+    }
+
+    static int search(const Page* page, const VarStringKey& key, const bool upper) {
+        return searchStrings(data(page), STRINGLEAFDATA, header(page)->prefixLength,
+                             (const char*) &slots(page)->key, SLOTBYTES, size(page), key, upper);
+    }
+
+    static void decode(const Page* page, std::vector<VarStringKey>& keys, std::vector<RecordId>& rids) {
+        for (int i = 0; i < size(page); i++) {
+            keys.push_back(key(page, i));
+            rids.push_back(rid(page, i));
+        }
+    }
+
+    /**
+     * Rebuilds a leaf from n entries, keeping its links.
+     */
+    static void encode(Page* page, const VarStringKey* keys, const RecordId* rids, const int n) {
+        StringLeafHeader* h = (StringLeafHeader*) page;
+        StringLeafSlot* s = slots(page);
+        h->numKeys = (unsigned short) n;
+        writeStrings(data(page), STRINGLEAFDATA, (char*) &s->key, SLOTBYTES, keys, n,
+                     h->prefixLength, h->heapBytes);
+        for (int i = 0; i < n; i++) {
+            s[i].rid = rids[i];
+        }
+    }
+};
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::dispatch
+// -----------------------------------------------------------------------------
+/**
+ * Picks the key type and leaf layout for a call. Covering indexes always use
+ * payload leaves. Otherwise INTEGER indexes may use any of the other three
+ * layouts, variable-length STRING keys always use string leaves, and the other
+ * key types use plain or posting list leaves.
+ * @param op    The call, with the arguments it passes on to a typed helper.
+ */
+template <class Op>
+typename Op::Result BTreeIndex::dispatch(Op& op) {
+    switch (keyType) {
+    case INTEGER_KEY:
+        if (payloadBytes > 0) {
+            return op.template run<int, PayloadLeaf<int> >();
+        }
+        if (postingLeaves) {
+            return op.template run<int, PostingLeaf<int> >();
+        }
+        if (packedLeaves) {
+            return op.template run<int, PackedIntLeaf>();
+        }
+        return op.template run<int, PlainLeaf<int> >();
+    case DOUBLE_KEY:
+        return dispatchLayout<double>(op);
+    case STRING_KEY:
+        return dispatchLayout<StringKey>(op);
+    case VAR_STRING_KEY:
+        return op.template run<VarStringKey, StringLeaf>();
+    case INT_PAIR_KEY:
+        return dispatchLayout<IntPairKey>(op);
+    case INT_DOUBLE_KEY:
+        return dispatchLayout<IntDoubleKey>(op);
+    default:
+        return dispatchLayout<CompositeKey>(op);
+    }
+}
+
+template <class T, class Op>
+typename Op::Result BTreeIndex::dispatchLayout(Op& op) {
+    if (payloadBytes > 0) {
+        return op.template run<T, PayloadLeaf<T> >();
+    }
+    if (postingLeaves) {
+        return op.template run<T, PostingLeaf<T> >();
+    }
+    return op.template run<T, PlainLeaf<T> >();
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::loadKey / boundKey
+// -----------------------------------------------------------------------------
+/**
+ * Composite keys are read from the record at the offsets of their attributes;
+ * single attribute keys straight from the pointer.
+ */
+template <class T>
+T BTreeIndex::loadKey(const void* ptr) {
+    return KeyTraits<T>::load(ptr, keyAttributes, numKeyAttributes);
+}
+
+template <>
+int BTreeIndex::loadKey<int>(const void* ptr) { return KeyTraits<int>::load(ptr); }
+
+template <>
+double BTreeIndex::loadKey<double>(const void* ptr) { return KeyTraits<double>::load(ptr); }
+
+template <>
+StringKey BTreeIndex::loadKey<StringKey>(const void* ptr) { return KeyTraits<StringKey>::load(ptr); }
+
+template <>
+VarStringKey BTreeIndex::loadKey<VarStringKey>(const void* ptr) {
+    return KeyTraits<VarStringKey>::load(ptr, stringKeyLength);
+}
+
+template <class T>
+const void BTreeIndex::boundKey(T& key, const int numColumns, const bool high) {
+    KeyTraits<T>::bound(key, keyAttributes, numKeyAttributes, numColumns, high);
+}
+
+template <>
+const void BTreeIndex::boundKey<int>(int& key, const int numColumns, const bool high) {}
+
+template <>
+const void BTreeIndex::boundKey<double>(double& key, const int numColumns, const bool high) {}
+
+template <>
+const void BTreeIndex::boundKey<StringKey>(StringKey& key, const int numColumns, const bool high) {}
+
+template <>
+const void BTreeIndex::boundKey<VarStringKey>(VarStringKey& key, const int numColumns, const bool high) {}
+
+// -----------------------------------------------------------------------------
+// Dispatched calls
+// -----------------------------------------------------------------------------
+/**
+ * Sets the leaf and non-leaf occupancies, which depend on the width of the key
+ * type and on the leaf layout.
+ */
+struct BTreeIndex::OccupancyOp {
+    typedef void Result;
+    BTreeIndex* index;
+
+    template <class T, class L>
+    void run() {
+        index->leafOccupancy = L::MAXENTRIES;
+        // A message buffer takes the node past its first BUFFERFANOUT children, as long as
+        // the payloads leave room for a buffer that fills more slowly than the children.
+        index->bufferCapacity = NodeBuffer<T>::capacity(BUFFERFANOUT - 1, index->payloadBytes);
+        if (index->bufferedInserts && index->bufferCapacity >= BUFFERFANOUT) {
+            index->nodeOccupancy = BUFFERFANOUT - 1;
+            return;
+        }
+        index->bufferedInserts = false;
+        if (index->countedNodes) {
+            // The keys share the key array with a count for each child, after padding
+            // of at most 8 bytes.
+            index->nodeOccupancy = (int) ((NodeSize<T>::NONLEAF * sizeof(T) - 2 * sizeof(long)) / (sizeof(T) + sizeof(long)));
+            return;
+        }
+        // A search directory takes the tail of the key array.
+        index->nodeOccupancy = NodeSize<T>::NONLEAF - (index->nodeDirectories ? DIRECTORYSIZE : 0);
+    }
+};
+
+struct BTreeIndex::BulkLoadOp {
+    typedef void Result;
+    BTreeIndex* index;
+    const std::string& relationName;
+    const IndexOptions& options;
+
+    template <class T, class L>
+    void run() {
+        index->bulkLoad<T, L>(relationName, options);
+    }
+};
+
+struct BTreeIndex::InsertOp {
+    typedef void Result;
+    BTreeIndex* index;
+    const void* key;
+    RecordId rid;
+    const char* payload;
+
+    template <class T, class L>
+    void run() {
+        T k = index->loadKey<T>(key);
+        index->addToFilter(k);
+        if (index->bufferedInserts) {
+            index->bufferInsert<T, L>(k, rid, payload);
+        } else {
+            index->insertTyped<T, L>(k, rid, payload);
+        }
+        index->numEntries++;
+        index->growFilter<T, L>();
+    }
+};
+
+struct BTreeIndex::DeleteOp {
+    typedef bool Result;
+    BTreeIndex* index;
+    const void* key;
+    RecordId rid;
+
+    template <class T, class L>
+    bool run() {
+        T k = index->loadKey<T>(key);
+        if (!index->mayContain(k)) {
+            return false;
+        }
+        index->flushRange<T, L>(k, k);
+        if (!index->deleteTyped<T, L>(k, rid)) {
+            return false;
+        }
+        index->numEntries--;
+        return true;
+    }
+};
+
+struct BTreeIndex::LookupOp {
+    typedef int Result;
+    BTreeIndex* index;
+    const void* key;
+    std::vector<RecordId>* outRids;
+
+    template <class T, class L>
+    int run() {
+        T k = index->loadKey<T>(key);
+        if (!index->mayContain(k)) {
+            return 0;
+        }
+        index->flushRange<T, L>(k, k);
+        return index->lookupTyped<T, L>(k, outRids);
+    }
+};
+
+/**
+ * Reads the bounds of a scan and, for a prefix scan, widens them over the
+ * attributes they leave out: a GTE or LT bound to the smallest value of each,
+ * so that it sits before every key with the same prefix, and a GT or LTE bound
+ * to the largest, so that it sits after them.
+ */
+struct BTreeIndex::StartScanOp {
+    typedef void Result;
+    IndexScanCursor& cursor;
+    const void* lowVal;
+    const void* highVal;
+    int numColumns;
+
+    template <class T, class L>
+    void run() {
+        BTreeIndex* index = cursor.index;
+        T low = index->loadKey<T>(lowVal);
+        T high = index->loadKey<T>(highVal);
+        index->boundKey<T>(low, numColumns, cursor.lowOp == GT);
+        index->boundKey<T>(high, numColumns, cursor.highOp == LTE);
+        index->flushRange<T, L>(low, high);
+        index->startScanTyped<T, L>(cursor, low, high);
+    }
+};
+
+struct BTreeIndex::ScanNextOp {
+    typedef void Result;
+    IndexScanCursor& cursor;
+    RecordId& outRid;
+    char* outPayload;
+
+    template <class T, class L>
+    void run() {
+        if (cursor.descending) {
+            cursor.index->scanPrevTyped<T, L>(cursor, outRid, outPayload);
+        } else {
+            cursor.index->scanNextTyped<T, L>(cursor, outRid, outPayload);
+        }
+    }
+};
+
+struct BTreeIndex::ScanNextBatchOp {
+    typedef int Result;
+    IndexScanCursor& cursor;
+    RecordId* outRids;
+    char* outPayloads;
+    int maxRids;
+
+    template <class T, class L>
+    int run() {
+        if (cursor.descending) {
+            return cursor.index->scanPrevBatchTyped<T, L>(cursor, outRids, outPayloads, maxRids);
+        }
+        return cursor.index->scanNextBatchTyped<T, L>(cursor, outRids, outPayloads, maxRids);
+    }
+};
+
+struct BTreeIndex::ParallelScanOp {
+    typedef long Result;
+    BTreeIndex* index;
+    const void* lowVal;
+    Operator lowOp;
+    const void* highVal;
+    Operator highOp;
+    int numWorkers;
+    const ScanPartConsumer& consumer;
+
+    template <class T, class L>
+    long run() {
+        T low = index->loadKey<T>(lowVal);
+        T high = index->loadKey<T>(highVal);
+        index->flushRange<T, L>(low, high);
+        return index->parallelScanTyped<T, L>(low, lowOp, high, highOp, numWorkers, consumer);
+    }
+};
+
+struct BTreeIndex::StatisticsOp {
+    typedef void Result;
+    BTreeIndex* index;
+    IndexStats& stats;
+
+    template <class T, class L>
+    void run() {
+        index->flushAll<T, L>();
+        index->statisticsTyped<T, L>(stats);
+    }
+};
+
+struct BTreeIndex::RefreshStatisticsOp {
+    typedef void Result;
+    BTreeIndex* index;
+
+    template <class T, class L>
+    void run() {
+        index->flushAll<T, L>();
+        index->refreshStatisticsTyped<T, L>();
+    }
+};
+
+/**
+ * Ranges are estimated on key positions. Only a range over a single key is told
+ * apart by comparing the keys themselves.
+ */
+struct BTreeIndex::EstimateRangeOp {
+    typedef long Result;
+    BTreeIndex* index;
+    const void* lowVal;
+    Operator lowOp;
+    const void* highVal;
+    Operator highOp;
+
+    template <class T, class L>
+    long run() {
+        T low = index->loadKey<T>(lowVal);
+        T high = index->loadKey<T>(highVal);
+        int cmp = KeyTraits<T>::compare(low, high);
+        if (cmp > 0) {
+            throw BadScanrangeException();
+        }
+        double lowPos = keyPosition(low);
+        double highPos = cmp == 0 ? lowPos : std::max(lowPos, keyPosition(high));
+        return index->estimatePositions(lowPos, lowOp == GTE, highPos, highOp == LTE);
+    }
+};
+
+/**
+ * The entries of a range are those below its high end less those below its low
+ * end, which only depends on the leaves the range covers.
+ */
+struct BTreeIndex::CountRangeOp {
+    typedef long Result;
+    BTreeIndex* index;
+    const void* lowVal;
+    Operator lowOp;
+    const void* highVal;
+    Operator highOp;
+
+    template <class T, class L>
+    long run() {
+        T low = index->loadKey<T>(lowVal);
+        T high = index->loadKey<T>(highVal);
+        int cmp = KeyTraits<T>::compare(low, high);
+        if (cmp > 0) {
+            throw BadScanrangeException();
+        }
+        // A single key with a strict bound is an empty range; the ranks of its two ends
+        // would cross over the duplicates of the key.
+        if (cmp == 0 && (lowOp == GT || highOp == LT)) {
+            return 0;
+        }
+        index->flushRange<T, L>(low, high);
+        return index->rankTyped<T, L>(high, highOp == LTE) - index->rankTyped<T, L>(low, lowOp == GT);
+    }
+};
+
+struct BTreeIndex::RankOp {
+    typedef long Result;
+    BTreeIndex* index;
+    const void* key;
+
+    template <class T, class L>
+    long run() {
+        index->flushAll<T, L>();
+        return index->rankTyped<T, L>(index->loadKey<T>(key), false);
+    }
+};
+
+struct BTreeIndex::SelectOp {
+    typedef bool Result;
+    BTreeIndex* index;
+    long position;
+    RecordId& outRid;
+
+    template <class T, class L>
+    bool run() {
+        index->flushAll<T, L>();
+        return index->selectTyped<T, L>(position, outRid);
+    }
+};
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::extractPayload
+// -----------------------------------------------------------------------------
+/**
+ * Copies the included attributes of a record one after the other.
+ * @param record    The record, or null for a payload of zeros.
+ * @param out       Buffer for payloadBytes bytes.
+ */
+const void BTreeIndex::extractPayload(const char* record, char* out) {
+    if (record == nullptr) {
+        memset(out, 0, payloadBytes);
+        return;
+    }
+    for (int a = 0; a < numIncluded; a++) {
+        memcpy(out, record + included[a].byteOffset, included[a].length);
+        out += included[a].length;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::clearLeaf
+// -----------------------------------------------------------------------------
+/**
+ * A zeroed page is an empty leaf of every layout; the leaves of a covering index
+ * also need to know how wide a payload is before the first entry goes in.
+ * @param page  The page to clear.
+ */
+const void BTreeIndex::clearLeaf(Page* page) {
+    memset((void*) page, 0, Page::SIZE);
+    if (payloadBytes > 0) {
+        ((PayloadLeafHeader*) page)->payloadBytes = payloadBytes;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::openIndex
+// -----------------------------------------------------------------------------
+/**
+ * Opens the index file if it exists, checking that it was built over the same
+ * attributes and taking the leaf layout it was built with. Otherwise creates the
+ * file with a header and an empty root leaf and loads the relation into it.
+ * @param relationName  Name of the base relation.
+ * @param indexName     Name of the index file.
+ * @param options       Whether to bulk load a new index, and how full to pack it.
+ * @throws BadIndexInfoException    If the file was built over other attributes, or
+ *                                  the included attributes do not fit a payload.
+ */
+const void BTreeIndex::openIndex(const std::string & relationName, const std::string & indexName,
+                                 const IndexOptions & options) {
+    // Node latches are only needed when several threads share the index.
+    // Read-ahead threads latch the leaves they read like concurrent scans do.
+    latches = options.concurrent || options.readAheadLeaves > 0 ? new LatchTable() : nullptr;
+    readAheadLeaves = options.readAheadLeaves;
+    prefetching = nullptr;
+    prefetchStop = false;
+    // The rightmost leaf is found by the first insert that reaches it.
+    appendOptimized = options.appendOptimized;
+    appendFill = std::min(1.0, std::max(0.5, options.fillFactor));
+    appendLeafNum = 0;
+    // Covering indexes carry up to MAXINCLUDED attributes in MAXPAYLOAD bytes.
+    if (options.includeAttributes.size() > (size_t) MAXINCLUDED) {
+        throw BadIndexInfoException(indexName);
+    }
+    numIncluded = (int) options.includeAttributes.size();
+    payloadBytes = 0;
+    for (int a = 0; a < numIncluded; a++) {
+        included[a] = options.includeAttributes[a];
+        if (included[a].length <= 0) {
+            throw BadIndexInfoException(indexName);
+        }
+        payloadBytes += included[a].length;
+    }
+    if (payloadBytes > MAXPAYLOAD) {
+        throw BadIndexInfoException(indexName);
+    }
+    // Variable-length keys take up to MAXSTRINGKEY bytes of a STRING attribute, in a
+    // leaf layout of their own.
+    if (options.stringKeyLength < 0 || options.stringKeyLength > MAXSTRINGKEY) {
+        throw BadIndexInfoException(indexName);
+    }
+    stringKeyLength = keyType == STRING_KEY ? options.stringKeyLength : 0;
+    if (stringKeyLength > 0) {
+        keyType = VAR_STRING_KEY;
+        numIncluded = 0;
+        payloadBytes = 0;
+    }
+    postingLeaves = options.postingLists && payloadBytes == 0 && keyType != VAR_STRING_KEY;
+    packedLeaves = options.packLeaves && !postingLeaves && payloadBytes == 0 && keyType == INTEGER_KEY;
+    bufferedInserts = options.bufferInserts && !options.concurrent && keyType != VAR_STRING_KEY;
+    countedNodes = options.countedNodes && !options.concurrent && !bufferedInserts && keyType != VAR_STRING_KEY;
+    nodeDirectories = options.nodeDirectories && keyType == INTEGER_KEY && !bufferedInserts && !countedNodes;
+    nodeCache = options.cacheInnerNodes ? new NodeCache(bufMgr->getNumBufs() / 4) : nullptr;
+    filter = nullptr;
+    filterGrows = !options.concurrent;
+    filterPageNum = 0;
+    savedFilterBlocks = 0;
+    savedFilterKeys = 0;
+    // A new file starts as a single empty leaf, with no histogram yet.
+    numEntries = 0;
+    numLeaves = 1;
+    histogramEntries = 0;
+    histogramPageNum = 0;
+    histogramChanged = false;
+
+    // Global initializations of the node and leaf occupancies. The slot counts
+    // depend on the width of the key type and the leaf layout.
+    OccupancyOp occupancy = { this };
+    dispatch(occupancy);
+
+    // Try to see if the file already exists. If it does, then update the
+    // B-Tree's metaInfo.
+    try
+    {
+        file = new BlobFile(indexName, false);
+        Page *header;
+        headerPageNum = file->getFirstPageNo();
+        bufMgr->readPage(file, headerPageNum, header);
+        IndexMetaInfo* metaInfo = (IndexMetaInfo*) header;
+        // Make sure the file was built over the same attributes.
+        bool sameKey = metaInfo->numKeyAttributes == numKeyAttributes;
+        for (int a = 0; sameKey && a < numKeyAttributes; a++) {
+            sameKey = metaInfo->keyAttributes[a].byteOffset == keyAttributes[a].byteOffset
+                      && metaInfo->keyAttributes[a].type == keyAttributes[a].type;
+        }
+        if (strncmp(metaInfo->relationName, relationName.c_str(), sizeof(metaInfo->relationName) - 1) != 0
+            || metaInfo->attrByteOffset != attrByteOffset
+            || metaInfo->attrType != attributeType
+            || !sameKey
+            || ((metaInfo->bufferedInserts || metaInfo->countedNodes) && options.concurrent)) {
+            // Drop the header from the buffer pool, which would otherwise keep a
+            // frame for a file object that no longer exists.
+            bufMgr->unPinPage(file, headerPageNum, false);
+            bufMgr->flushFile(file);
+            delete file;
+            delete latches;
+            delete nodeCache;
+            throw BadIndexInfoException(indexName);
+        }
+        // Update the rootPageNum to reflect the information stored in the file.
+        rootPageNum = metaInfo->rootPageNo;
+        // The leaf layout and included attributes are the ones the file was built with.
+        numIncluded = metaInfo->numIncluded;
+        payloadBytes = 0;
+        for (int a = 0; a < numIncluded; a++) {
+            included[a] = metaInfo->included[a];
+            payloadBytes += included[a].length;
+        }
+        packedLeaves = metaInfo->packedLeaves;
+        postingLeaves = metaInfo->postingLists;
+        nodeDirectories = metaInfo->nodeDirectories;
+        bufferedInserts = metaInfo->bufferedInserts;
+        countedNodes = metaInfo->countedNodes;
+        stringKeyLength = metaInfo->stringKeyLength;
+        if (keyType == STRING_KEY || keyType == VAR_STRING_KEY) {
+            keyType = stringKeyLength > 0 ? VAR_STRING_KEY : STRING_KEY;
+        }
+        dispatch(occupancy);
+        // The first root is always allocated right after the header page.
+        firstRootNum = headerPageNum + 1;
+        loadFilter(metaInfo);
+        loadStatistics(metaInfo);
+        bufMgr->unPinPage(file, headerPageNum, false);
+    }
+    // If the file was not found (or nonexistent), we open a new one and allocate a new
+    // header and root page.
+    catch(FileNotFoundException e)
+    {
+        file = new BlobFile(indexName, true);
+        // allocate root and header page
+        Page* header;
+        Page* root;
+        bufMgr->allocPage(file, headerPageNum, header);
+        bufMgr->allocPage(file, rootPageNum, root);
+        memset((void*) header, 0, Page::SIZE);
+        clearLeaf(root);
+
+        // Update global var firstRootNum to keep track of the original root
+        // page value and update its sibling.
+        firstRootNum = rootPageNum;
+        // The cleared page is an empty leaf of any key type.
+
+        // Update meta information for the newly created file.
+        IndexMetaInfo* metaInfo = (IndexMetaInfo*) header;
+        strncpy((char*)(&(metaInfo->relationName)), relationName.c_str(), sizeof(metaInfo->relationName) - 1);
+        metaInfo->attrByteOffset = attrByteOffset;
+        metaInfo->attrType = attributeType;
+        metaInfo->rootPageNo = rootPageNum;
+        metaInfo->packedLeaves = packedLeaves;
+        metaInfo->postingLists = postingLeaves;
+        metaInfo->nodeDirectories = nodeDirectories;
+        metaInfo->bufferedInserts = bufferedInserts;
+        metaInfo->countedNodes = countedNodes;
+        metaInfo->stringKeyLength = stringKeyLength;
+        metaInfo->numKeyAttributes = numKeyAttributes;
+        std::copy(keyAttributes, keyAttributes + numKeyAttributes, metaInfo->keyAttributes);
+        metaInfo->numIncluded = numIncluded;
+        std::copy(included, included + numIncluded, metaInfo->included);
+        if (options.bloomFilter) {
+            filter = new BloomFilter(BloomFilter::blocksFor(options.bloomFilterKeys));
+        }
+
+        // Unpin the header and root pages to free up space before the scan.
+        bufMgr->unPinPage(file, headerPageNum, true);
+        bufMgr->unPinPage(file, rootPageNum, true);
+
+        if (options.bulkLoad) {
+            // Sort the relation's entries and write the tree bottom up.
+            BulkLoadOp load = { this, relationName, options };
+            dispatch(load);
+            saveFilter();
+            releaseNodes();
+            bufMgr->flushFile(file);
+            return;
+        }
+
+        // Fill the newly created blobfile using filescan.
+        FileScan fileScan(relationName, bufMgr);
+        RecordId rid;
+        try
+        {
+            while(1)
+            {
+                fileScan.scanNext(rid);
+                std::string record = fileScan.getRecord();
+                insertEntry(record.c_str() + attrByteOffset, rid, record.c_str());
+            }
+        }
+        catch(EndOfFileException e)
+        {
+            // The histogram of a bulk load is built as the leaves are written; here
+            // it takes one more pass over them.
+            RefreshStatisticsOp refresh = { this };
+            dispatch(refresh);
+            // save Btree index file to disk
+            saveFilter();
+            releaseNodes();
+            bufMgr->flushFile(file);
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::insertEntry
+// -----------------------------------------------------------------------------
+/**
+ * This method inserts a new entry into the index by traversing through the tree
+ * to find a leaf to insert the RIDKeyPair <key,rid>. Most of the work is performed
+ * by helper methods that traverse and split the nodes if need be. The helpers are
+ * templated on the key type, so the attribute type is only looked at once here.
+ * @param key   Pointer to the integer/double/string we want to insert.
+ * @param rid   Corresponding record id of the tuple.
+ */
+const void BTreeIndex::insertEntry(const void *key, const RecordId rid) {
+    insertEntry(key, rid, nullptr);
+}
+
+/**
+ * Inserts an entry along with the included attributes of its record, which a
+ * covering index stores next to the rid. Other indexes ignore the record.
+ * @param key       Pointer to the key we want to insert.
+ * @param rid       Corresponding record id of the tuple.
+ * @param record    The tuple, or null to store a payload of zeros.
+ */
+const void BTreeIndex::insertEntry(const void *key, const RecordId rid, const void *record) {
+    char payload[MAXPAYLOAD];
+    if (payloadBytes > 0) {
+        extractPayload((const char*) record, payload);
+    }
+    InsertOp op = { this, key, rid, payloadBytes > 0 ? payload : nullptr };
+    dispatch(op);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::insertTyped
+// -----------------------------------------------------------------------------
+/**
+ * Builds the entry for key type T and descends from the root in a loop. The
+ * nodes a split can still reach are kept pinned on a fixed-size path stack,
+ * with the slot of the child taken in each. Whenever a node with room for one
+ * more entry is reached, everything above it is let go, since no split can get
+ * past it. If the leaf is full, it is split and the split is carried back up
+ * the stack as a PageKeyPair value until a node takes it without splitting, or
+ * the root splits. The entry then goes in on another pass from the root, into
+ * whichever half covers its key; a leaf layout that encodes rids more widely
+ * for some entries may need a second split before one fits.
+ * @param key       The key to insert.
+ * @param rid       Corresponding record id of the tuple.
+ * @param payload   Included attributes of the tuple, for payload leaves.
+ */
+template <class T, class L>
+const void BTreeIndex::insertTyped(const T& key, const RecordId rid, const char* payload) {
+    // Create the entry to add to the tree
+    RIDKeyPair<T> data;
+    data.set(rid, key);
+    // Ascending keys go straight to the rightmost leaf while it has room.
+    if (appendLeafNum != 0 && KeyTraits<T>::compare(key, appendMaxKey<T>()) >= 0
+        && appendToRightmostLeaf<T, L>(data, payload)) {
+        return;
+    }
+    // Most concurrent inserts land in a leaf with room and only latch that leaf exclusively.
+    if (latches != nullptr && !countedNodes && insertIntoSafeLeaf<T, L>(data, payload)) {
+        return;
+    }
+    // Otherwise latch exclusively from the root down, held alongside the pinned path.
+    // Counted nodes keep the whole path, since every count on it goes up by one.
+    LatchPath latchPath;
+    PageId pathNums[LatchPath::MAXDEPTH];
+    Page* pathPages[LatchPath::MAXDEPTH];
+    int pathSlots[LatchPath::MAXDEPTH];
+    while (true) {
+        if (latches != nullptr) {
+            rootLatch.lockExclusive();
+            latchPath.push(&rootLatch);
+        }
+        int depth = 0;
+        PageId currNum = rootPageNum;
+        bool isLeaf = currNum == firstRootNum;
+        while (true) {
+            Page* currPage;
+            latchPage(currNum, true);
+            readNode(currNum, currPage, isLeaf);
+            if (!countedNodes && hasRoom<T, L>(currPage, isLeaf)) {
+                latchPath.releaseAll();
+                for (int d = 0; d < depth; d++) {
+                    unpinNode(pathNums[d], false, false);
+                }
+                depth = 0;
+            }
+            if (latches != nullptr) {
+                latchPath.push(&latches->get(currNum));
+            }
+            pathNums[depth] = currNum;
+            pathPages[depth] = currPage;
+            depth++;
+            if (isLeaf) {
+                break;
+            }
+            // The child covering the key is the one after every key less than or equal to it.
+            NonLeafNode<T>* curr = (NonLeafNode<T>*) currPage;
+            int i = childUpperBound(curr, key);
+            pathSlots[depth - 1] = i;
+            currNum = curr->pageNoArray[i];
+            isLeaf = curr->level == 1;
+        }
+        int d = depth - 1;
+        Page* leaf = pathPages[d];
+        // If the leaf node has room, add the data. A packed or posting list leaf may take
+        // an entry that hasRoom could not promise room for, with its parents still on the path.
+        if (L::insert(leaf, data.key, data.rid, payload)) {
+            noteRightmostLeaf<T, L>(pathNums[d], leaf);
+            for (int p = 0; p < d; p++) {
+                if (keepsCounts<T>()) {
+                    childCounts((NonLeafNode<T>*) pathPages[p])[pathSlots[p]]++;
+                }
+                unpinNode(pathNums[p], false, countedNodes);
+            }
+            bufMgr->unPinPage(file, pathNums[d], true);
+            return;
+        }
+        PageKeyPair<T> entry;
+        leafSplit<T, L>(entry, leaf, pathNums[d], data.key);
+        // Hand the new separator to each parent on the path until one has room for it.
+        while (--d >= 0) {
+            NonLeafNode<T>* node = (NonLeafNode<T>*) pathPages[d];
+            if (Separators<T>::fits(node, entry.key, nodeOccupancy)) {
+                addToBranch(node, pathSlots[d], entry);
+                unpinNode(pathNums[d], false, true);
+                break;
+            }
+            branchSplit(entry, node, pathNums[d], pathSlots[d]);
+        }
+        // Nodes above the one that took the new entry are only still pinned when counted.
+        for (int p = 0; p < d; p++) {
+            unpinNode(pathNums[p], false, false);
+        }
+        latchPath.releaseAll();
+    }
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::bufferInsert
+// -----------------------------------------------------------------------------
+/**
+ * Messages are only ever added at the root, so a message never passes an older one
+ * with the same key on its way down, and entries with equal keys reach their leaves
+ * in the order they were inserted.
+ */
+template <class T, class L>
+const void BTreeIndex::bufferInsert(const T& key, const RecordId rid, const char* payload) {
+    while (true) {
+        PageId rootNum = rootPageNum;
+        if (rootNum == firstRootNum) {
+            insertTyped<T, L>(key, rid, payload);
+            return;
+        }
+        Page* root;
+        readNode(rootNum, root, false);
+        NodeBuffer<T> buffer((NonLeafNode<T>*) root, nodeOccupancy, payloadBytes);
+        if (buffer.size() < bufferCapacity) {
+            buffer.append(key, rid, payload);
+            unpinNode(rootNum, false, true);
+            return;
+        }
+        unpinNode(rootNum, false, false);
+        // The flush may split the root; the next pass starts from the new one.
+        flushBuffer<T, L>(rootNum);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::flushBuffer
+// -----------------------------------------------------------------------------
+/**
+ * The messages for a leaf are inserted from the root like unbuffered entries. The
+ * buffers above only hold newer messages, and the node itself may split along the
+ * way, so the batch is taken out of the node first and the node let go.
+ */
+template <class T, class L>
+const void BTreeIndex::flushBuffer(PageId nodeNum) {
+    while (true) {
+        Page* page;
+        readNode(nodeNum, page, false);
+        NonLeafNode<T>* node = (NonLeafNode<T>*) page;
+        NodeBuffer<T> buffer(node, nodeOccupancy, payloadBytes);
+        // Count the messages bound for each child, routed the way inserts descend.
+        int counts[BUFFERFANOUT] = { 0 };
+        for (int i = 0; i < buffer.size(); i++) {
+            counts[childUpperBound(node, buffer.key(i))]++;
+        }
+        int slot = (int) (std::max_element(counts, counts + node->numKeys + 1) - counts);
+        PageId childNum = node->pageNoArray[slot];
+        Page* child = nullptr;
+        if (node->level != 1) {
+            readNode(childNum, child, false);
+            if (NodeBuffer<T>((NonLeafNode<T>*) child, nodeOccupancy, payloadBytes).size() + counts[slot] > bufferCapacity) {
+                // Make room in the child, which may split it and this node, and count again.
+                unpinNode(childNum, false, false);
+                unpinNode(nodeNum, false, false);
+                flushBuffer<T, L>(childNum);
+                continue;
+            }
+        }
+        MessageBatch<T> batch;
+        buffer.take([&](const T& k) { return childUpperBound(node, k) == slot; }, batch);
+        if (child != nullptr) {
+            NodeBuffer<T>((NonLeafNode<T>*) child, nodeOccupancy, payloadBytes).append(batch);
+            unpinNode(childNum, false, true);
+            unpinNode(nodeNum, false, true);
+            return;
+        }
+        unpinNode(nodeNum, false, true);
+        for (int i = 0; i < batch.size(); i++) {
+            insertTyped<T, L>(batch.keys[i], batch.rids[i], payloadBytes > 0 ? &batch.payloads[(size_t) i * payloadBytes] : nullptr);
+        }
+        return;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::flushRange
+// -----------------------------------------------------------------------------
+/**
+ * The messages are taken out of every buffer the range reaches before any of
+ * them is inserted, since the inserts may split the nodes they came from.
+ */
+template <class T, class L>
+const void BTreeIndex::flushRange(const T& lowVal, const T& highVal) {
+    if (!bufferedInserts || rootPageNum == firstRootNum) {
+        return;
+    }
+    std::vector<MessageBatch<T> > byDepth;
+    takeRange<T>(rootPageNum, 0, lowVal, highVal, byDepth);
+    insertMessages<T, L>(byDepth);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::flushAll
+// -----------------------------------------------------------------------------
+template <class T, class L>
+const void BTreeIndex::flushAll() {
+    if (!bufferedInserts || rootPageNum == firstRootNum) {
+        return;
+    }
+    std::vector<MessageBatch<T> > byDepth;
+    takeAll<T>(rootPageNum, 0, byDepth);
+    insertMessages<T, L>(byDepth);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::takeAll
+// -----------------------------------------------------------------------------
+template <class T>
+const void BTreeIndex::takeAll(PageId nodeNum, int depth, std::vector<MessageBatch<T> >& byDepth) {
+    Page* page;
+    readNode(nodeNum, page, false);
+    NonLeafNode<T>* node = (NonLeafNode<T>*) page;
+    if ((int) byDepth.size() <= depth) {
+        byDepth.resize(depth + 1);
+    }
+    int taken = NodeBuffer<T>(node, nodeOccupancy, payloadBytes).take([](const T& k) { return true; }, byDepth[depth]);
+    if (node->level != 1) {
+        for (int i = 0; i <= node->numKeys; i++) {
+            takeAll<T>(node->pageNoArray[i], depth + 1, byDepth);
+        }
+    }
+    unpinNode(nodeNum, false, taken > 0);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::insertMessages
+// -----------------------------------------------------------------------------
+/**
+ * A deeper message is older than any with the same key above it, so the deepest
+ * buffers go first.
+ */
+template <class T, class L>
+const void BTreeIndex::insertMessages(const std::vector<MessageBatch<T> >& byDepth) {
+    for (int d = (int) byDepth.size() - 1; d >= 0; d--) {
+        const MessageBatch<T>& batch = byDepth[d];
+        for (int i = 0; i < batch.size(); i++) {
+            insertTyped<T, L>(batch.keys[i], batch.rids[i], payloadBytes > 0 ? &batch.payloads[(size_t) i * payloadBytes] : nullptr);
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::takeRange
+// -----------------------------------------------------------------------------
+/**
+ * Visits the children from the leftmost one that can hold lowVal to the one that
+ * covers highVal, like a delete does for a single key.
+ */
+template <class T>
+const void BTreeIndex::takeRange(PageId nodeNum, int depth, const T& lowVal, const T& highVal,
+                                 std::vector<MessageBatch<T> >& byDepth) {
+    Page* page;
+    readNode(nodeNum, page, false);
+    NonLeafNode<T>* node = (NonLeafNode<T>*) page;
+    if ((int) byDepth.size() <= depth) {
+        byDepth.resize(depth + 1);
+    }
+    NodeBuffer<T> buffer(node, nodeOccupancy, payloadBytes);
+    int taken = buffer.take([&](const T& k) {
+        return KeyTraits<T>::compare(k, lowVal) >= 0 && KeyTraits<T>::compare(k, highVal) <= 0;
+    }, byDepth[depth]);
+    if (node->level != 1) {
+        int last = childUpperBound(node, highVal);
+        for (int i = childLowerBound(node, lowVal); i <= last; i++) {
+            takeRange<T>(node->pageNoArray[i], depth + 1, lowVal, highVal, byDepth);
+        }
+    }
+    unpinNode(nodeNum, false, taken > 0);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::mayContain / addToFilter
+// -----------------------------------------------------------------------------
+template <class T>
+const bool BTreeIndex::mayContain(const T& key) {
+    return filter == nullptr || filter->mayContain(KeyTraits<T>::hash(key));
+}
+
+template <class T>
+const void BTreeIndex::addToFilter(const T& key) {
+    if (filter != nullptr) {
+        filter->add(KeyTraits<T>::hash(key));
+    }
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::growFilter
+// -----------------------------------------------------------------------------
+/**
+ * Doubling the filter each time keeps the cost of the rebuilds, one pass over
+ * the tree each, at a constant per insert.
+ */
+template <class T, class L>
+const void BTreeIndex::growFilter() {
+    if (filter == nullptr || !filterGrows || filter->count() <= filter->capacity()) {
+        return;
+    }
+    long keys = filter->count();
+    delete filter;
+    filter = new BloomFilter(BloomFilter::blocksFor(2 * keys));
+    filterSubtree<T, L>(rootPageNum, rootPageNum == firstRootNum);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::filterSubtree
+// -----------------------------------------------------------------------------
+/**
+ * Walks the subtree depth first, so that only one node per level is pinned.
+ */
+template <class T, class L>
+const void BTreeIndex::filterSubtree(PageId pageNo, bool isLeaf) {
+    Page* page;
+    readNode(pageNo, page, isLeaf);
+    if (isLeaf) {
+        for (int i = 0; i < L::size(page); i++) {
+            addToFilter(T(L::key(page, i)));
+        }
+        unpinNode(pageNo, true, false);
+        return;
+    }
+    NonLeafNode<T>* node = (NonLeafNode<T>*) page;
+    if (bufferedInserts) {
+        NodeBuffer<T> buffer(node, nodeOccupancy, payloadBytes);
+        for (int i = 0; i < buffer.size(); i++) {
+            addToFilter(buffer.key(i));
+        }
+    }
+    for (int i = 0; i <= node->numKeys; i++) {
+        filterSubtree<T, L>(node->pageNoArray[i], node->level == 1);
+    }
+    unpinNode(pageNo, false, false);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::loadFilter
+// -----------------------------------------------------------------------------
+/**
+ * The filter pages are read in the order they link to each other.
+ * @param metaInfo  The meta page.
+ */
+const void BTreeIndex::loadFilter(const IndexMetaInfo* metaInfo) {
+    if (metaInfo->bloomBlocks == 0) {
+        return;
+    }
+    filter = new BloomFilter(metaInfo->bloomBlocks);
+    filter->setCount(metaInfo->bloomKeys);
+    filterPageNum = metaInfo->bloomPageNo;
+    savedFilterBlocks = metaInfo->bloomBlocks;
+    savedFilterKeys = metaInfo->bloomKeys;
+    PageId pageNo = filterPageNum;
+    for (long w = 0; w < filter->numWords(); w += BloomFilterPage::WORDS) {
+        Page* page;
+        bufMgr->readPage(file, pageNo, page);
+        BloomFilterPage* words = (BloomFilterPage*) page;
+        for (long i = w; i < filter->numWords() && i < w + BloomFilterPage::WORDS; i++) {
+            filter->setWord(i, words->words[i - w]);
+        }
+        PageId nextNo = words->nextPageNo;
+        bufMgr->unPinPage(file, pageNo, false);
+        pageNo = nextNo;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::saveFilter
+// -----------------------------------------------------------------------------
+/**
+ * A filter only ever grows, so the pages it was written to before are reused
+ * and more are linked on at the end of the chain.
+ */
+const void BTreeIndex::saveFilter() {
+    if (filter == nullptr || (filterPageNum != 0 && filter->blocks() == savedFilterBlocks
+                              && filter->count() == savedFilterKeys)) {
+        return;
+    }
+    PageId pageNo = filterPageNum;
+    PageId prevNo = 0;
+    Page* prev = nullptr;
+    for (long w = 0; w < filter->numWords(); w += BloomFilterPage::WORDS) {
+        Page* page;
+        if (pageNo == 0) {
+            bufMgr->allocPage(file, pageNo, page);
+            memset((void*) page, 0, Page::SIZE);
+            if (prev == nullptr) {
+                filterPageNum = pageNo;
+            } else {
+                ((BloomFilterPage*) prev)->nextPageNo = pageNo;
+            }
+        } else {
+            bufMgr->readPage(file, pageNo, page);
+        }
+        if (prev != nullptr) {
+            bufMgr->unPinPage(file, prevNo, true);
+        }
+        BloomFilterPage* words = (BloomFilterPage*) page;
+        for (long i = w; i < filter->numWords() && i < w + BloomFilterPage::WORDS; i++) {
+            words->words[i - w] = filter->word(i);
+        }
+        prev = page;
+        prevNo = pageNo;
+        pageNo = words->nextPageNo;
+    }
+    bufMgr->unPinPage(file, prevNo, true);
+
+    Page* header;
+    bufMgr->readPage(file, headerPageNum, header);
+    IndexMetaInfo* metaInfo = (IndexMetaInfo*) header;
+    metaInfo->bloomBlocks = filter->blocks();
+    metaInfo->bloomKeys = filter->count();
+    metaInfo->bloomPageNo = filterPageNum;
+    bufMgr->unPinPage(file, headerPageNum, true);
+    savedFilterBlocks = filter->blocks();
+    savedFilterKeys = filter->count();
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::insertIntoSafeLeaf
+// -----------------------------------------------------------------------------
+/**
+ * Optimistic half of a concurrent insert. Descends with shared latches, holding a
+ * parent only until the child is latched, and latches the leaf exclusively. If the
+ * leaf is full nothing is changed and the caller retries with exclusive latches.
+ * @param data    The entry to be inserted.
+ * @param payload Included attributes of the entry, for payload leaves.
+ * @return        True if the entry was added.
+ */
+template <class T, class L>
+const bool BTreeIndex::insertIntoSafeLeaf(const RIDKeyPair<T>& data, const char* payload) {
+    rootLatch.lockShared();
+    PageId currNum = rootPageNum;
+    bool isLeaf = currNum == firstRootNum;
+    latchPage(currNum, isLeaf);
+    rootLatch.unlock();
+    Page* currPage;
+    readNode(currNum, currPage, isLeaf);
+    while (!isLeaf) {
+        NonLeafNode<T>* curr = (NonLeafNode<T>*) currPage;
+        PageId nextNum = curr->pageNoArray[childUpperBound(curr, data.key)];
+        isLeaf = curr->level == 1;
+        latchPage(nextNum, isLeaf);
+        unpinNode(currNum, false, false);
+        unlatchPage(currNum);
+        currNum = nextNum;
+        readNode(currNum, currPage, isLeaf);
+    }
+    bool added = L::insert(currPage, data.key, data.rid, payload);
+    bufMgr->unPinPage(file, currNum, added);
+    unlatchPage(currNum);
+    return added;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::appendToRightmostLeaf
+// -----------------------------------------------------------------------------
+/**
+ * Append fast path. The caller has checked the key against the largest key of the
+ * rightmost leaf, so every key of the tree is at most the new one and it belongs at
+ * the end of that leaf. A full leaf is left to the regular insert, which splits it,
+ * and so is a leaf that has gained a right sibling.
+ * @param data    The entry to be inserted.
+ * @param payload Included attributes of the entry, for payload leaves.
+ * @return        True if the entry was added.
+ */
+template <class T, class L>
+const bool BTreeIndex::appendToRightmostLeaf(const RIDKeyPair<T>& data, const char* payload) {
+    Page* page;
+    bufMgr->readPage(file, appendLeafNum, page);
+    if (L::rightSib(page) != 0) {
+        bufMgr->unPinPage(file, appendLeafNum, false);
+        appendLeafNum = 0;
+        return false;
+    }
+    bool added = L::append(page, data.key, data.rid, payload);
+    if (added) {
+        appendMaxKey<T>() = data.key;
+    }
+    bufMgr->unPinPage(file, appendLeafNum, added);
+    return added;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::noteRightmostLeaf
+// -----------------------------------------------------------------------------
+/**
+ * Caches the rightmost leaf for the append fast path. Concurrent indexes never do,
+ * since the leaf could be split or freed by another thread between inserts, and
+ * neither do counted ones, since an append would skip the counts above the leaf.
+ * @param leafNum   Page number of the leaf.
+ * @param leaf      The pinned leaf.
+ */
+template <class T, class L>
+const void BTreeIndex::noteRightmostLeaf(PageId leafNum, Page* leaf) {
+    if (appendOptimized && latches == nullptr && !countedNodes && L::rightSib(leaf) == 0 && L::size(leaf) > 0) {
+        appendLeafNum = leafNum;
+        appendMaxKey<T>() = L::key(leaf, L::size(leaf) - 1);
+    }
+}
+
+template <>
+int& BTreeIndex::appendMaxKey<int>() { return appendMaxInt; }
+
+template <>
+double& BTreeIndex::appendMaxKey<double>() { return appendMaxDouble; }
+
+template <>
+StringKey& BTreeIndex::appendMaxKey<StringKey>() { return appendMaxString; }
+
+template <>
+IntPairKey& BTreeIndex::appendMaxKey<IntPairKey>() { return appendMaxIntPair; }
+
+template <>
+IntDoubleKey& BTreeIndex::appendMaxKey<IntDoubleKey>() { return appendMaxIntDouble; }
+
+template <>
+CompositeKey& BTreeIndex::appendMaxKey<CompositeKey>() { return appendMaxComposite; }
+
+template <>
+VarStringKey& BTreeIndex::appendMaxKey<VarStringKey>() { return appendMaxVarString; }
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::hasRoom
+// -----------------------------------------------------------------------------
+/**
+ * Tells whether a node can take one more entry without splitting. A split below
+ * such a node stops at it, so an insert need not hold anything above it.
+ * @param page      The node.
+ * @param isLeaf    Whether the node is a leaf.
+ */
+template <class T, class L>
+const bool BTreeIndex::hasRoom(Page* page, bool isLeaf) {
+    if (isLeaf) {
+        return L::hasRoom(page);
+    }
+    return Separators<T>::hasRoom((NonLeafNode<T>*) page, nodeOccupancy);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::latchPage / unlatchPage
+// -----------------------------------------------------------------------------
+/**
+ * Latches or unlatches a node. Both do nothing unless the index is concurrent.
+ * @param pageNo        Page number of the node.
+ * @param exclusive     Whether to latch for writing.
+ */
+const void BTreeIndex::latchPage(PageId pageNo, bool exclusive) {
+    if (latches == nullptr) {
+        return;
+    }
+    if (exclusive) {
+        latches->get(pageNo).lockExclusive();
+    } else {
+        latches->get(pageNo).lockShared();
+    }
+}
+
+const void BTreeIndex::unlatchPage(PageId pageNo) {
+    if (latches != nullptr) {
+        latches->get(pageNo).unlock();
+    }
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::readNode / unpinNode
+// -----------------------------------------------------------------------------
+/**
+ * A non-leaf missing from the cache is read through the buffer manager and the
+ * pin is handed to the cache. If another thread cached it first, that pin keeps
+ * the frame in place and this one is let go right away.
+ */
+const void BTreeIndex::readNode(PageId pageNo, Page*& page, bool isLeaf) {
+    if (nodeCache != nullptr && !isLeaf) {
+        page = nodeCache->get(pageNo);
+        if (page != nullptr) {
+            return;
+        }
+        bufMgr->readPage(file, pageNo, page);
+        if (!nodeCache->add(pageNo, page) && nodeCache->get(pageNo) != nullptr) {
+            bufMgr->unPinPage(file, pageNo, false);
+        }
+        return;
+    }
+    bufMgr->readPage(file, pageNo, page);
+}
+
+/**
+ * A cached node stays pinned; a change to it is only noted, and handed to the
+ * buffer manager when the node is released.
+ */
+const void BTreeIndex::unpinNode(PageId pageNo, bool isLeaf, bool dirty) {
+    if (nodeCache != nullptr && !isLeaf && nodeCache->get(pageNo) != nullptr) {
+        if (dirty) {
+            nodeCache->markDirty(pageNo);
+        }
+        return;
+    }
+    bufMgr->unPinPage(file, pageNo, dirty);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::dropNode
+// -----------------------------------------------------------------------------
+/**
+ * Disposing of a page clears its frame whatever its pins, so the pin of the
+ * cache is simply forgotten.
+ */
+const void BTreeIndex::dropNode(PageId pageNo) {
+    bool dirty;
+    if (nodeCache != nullptr) {
+        nodeCache->remove(pageNo, dirty);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::releaseNodes
+// -----------------------------------------------------------------------------
+/**
+ * Called before the file is flushed, which needs every page unpinned, while no
+ * other thread uses the index.
+ */
+const void BTreeIndex::releaseNodes() {
+    if (nodeCache == nullptr) {
+        return;
+    }
+    PageId end = nodeCache->limit();
+    for (PageId pageNo = 0; pageNo < end; pageNo++) {
+        bool dirty;
+        if (nodeCache->remove(pageNo, dirty)) {
+            bufMgr->unPinPage(file, pageNo, dirty);
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+// SortedRuns
+// -----------------------------------------------------------------------------
+/**
+ * Sorted (key, rid) pairs for the bulk load. Pairs are collected in a memory buffer;
+ * whenever it fills up it is sorted and spilled to a run file. Reading merges the
+ * run files and the sorted remainder of the buffer. E is RIDKeyPair<T>, or
+ * CoveredPair<T> when the leaves carry a payload.
+ */
+template <class E>
+class SortedRuns {
+ public:
+    /**
+     * @param prefix        Prefix for the names of the run files.
+     * @param bufferPairs   Number of pairs sorted in memory at a time.
+     */
+    SortedRuns(const std::string& prefix, size_t bufferPairs)
+        : prefix(prefix), bufferPairs(bufferPairs), count(0), memNext(0) {
+        buffer.reserve(bufferPairs);
+    }
+
+    ~SortedRuns() {
+        for (size_t i = 0; i < runs.size(); i++) {
+            delete runs[i];
+            std::remove(runName(i).c_str());
+        }
+    }
+
+    /**
+     * Adds a pair, spilling the buffer as a sorted run once it is full.
+     */
+    void add(const E& pair) {
+        buffer.push_back(pair);
+        count++;
+        if (buffer.size() == bufferPairs) {
+            spill();
+        }
+    }
+
+    /**
+     * Sorts what is left in memory and sets up the merge. Call once, after the last add.
+     */
+    void finish() {
+        std::sort(buffer.begin(), buffer.end());
+        // Each run gets an equal share of the buffer for reading back.
+        readPairs = std::max<size_t>(1, bufferPairs / (runs.size() + 1));
+        runBuffers.resize(runs.size());
+        runNext.assign(runs.size(), 0);
+        for (size_t i = 0; i < runs.size(); i++) {
+            runs[i]->seekg(0);
+            refill(i);
+            if (runNext[i] < runBuffers[i].size()) {
+                heap.push(HeapEntry(runBuffers[i][0], i));
+            }
+        }
+        if (memNext < buffer.size()) {
+            heap.push(HeapEntry(buffer[0], runs.size()));
+        }
+    }
+
+    /**
+     * Total number of pairs added.
+     */
+    long size() const {
+        return count;
+    }
+
+    /**
+     * Number of runs that were spilled to disk.
+     */
+    size_t numRuns() const {
+        return runs.size();
+    }
+
+    /**
+     * Returns the next pair in sorted order.
+     * @return  False once all pairs have been returned.
+     */
+    bool next(E& out) {
+        if (heap.empty()) {
+            return false;
+        }
+        HeapEntry top = heap.top();
+        heap.pop();
+        out = top.pair;
+        size_t source = top.source;
+        if (source == runs.size()) {
+            if (++memNext < buffer.size()) {
+                heap.push(HeapEntry(buffer[memNext], source));
+            }
+        } else {
+            if (++runNext[source] == runBuffers[source].size()) {
+                refill(source);
+            }
+            if (runNext[source] < runBuffers[source].size()) {
+                heap.push(HeapEntry(runBuffers[source][runNext[source]], source));
+            }
+        }
+        return true;
+    }
+
+ private:
+    /**
+     * Head of one sorted source in the merge. Ordered so the priority queue pops the smallest pair.
+     */
+    struct HeapEntry {
+        E pair;
+        size_t source;
+        HeapEntry(const E& p, size_t s) : pair(p), source(s) {}
+        bool operator<(const HeapEntry& rhs) const {
+            return rhs.pair < pair;
+        }
+    };
+
+    std::string runName(size_t run) const {
+        std::ostringstream name;
+        name << prefix << ".run" << run;
+        return name.str();
+    }
+
+    void spill() {
+        std::sort(buffer.begin(), buffer.end());
+        std::fstream* run = new std::fstream(runName(runs.size()).c_str(),
+            std::fstream::in | std::fstream::out | std::fstream::binary | std::fstream::trunc);
+        run->write((const char*) &buffer[0], buffer.size() * sizeof(E));
+        runs.push_back(run);
+        buffer.clear();
+    }
+
+    void refill(size_t run) {
+        runBuffers[run].resize(readPairs);
+        runs[run]->read((char*) &runBuffers[run][0], readPairs * sizeof(E));
+        runBuffers[run].resize(runs[run]->gcount() / sizeof(E));
+        runNext[run] = 0;
+    }
+
+    std::string prefix;
+    size_t bufferPairs;
+    size_t readPairs;
+    long count;
+    std::vector<E > buffer;
+    size_t memNext;
+    std::vector<std::fstream*> runs;
+    std::vector<std::vector<E > > runBuffers;
+    std::vector<size_t> runNext;
+    std::priority_queue<HeapEntry> heap;
+};
+
+// -----------------------------------------------------------------------------
+// CoveredPair
+// -----------------------------------------------------------------------------
+/**
+ * A (key, rid) pair with the included attributes of its record, sorted for the
+ * bulk load of a covering index.
+ */
+template <class T>
+struct CoveredPair : public RIDKeyPair<T> {
+    char payload[MAXPAYLOAD];
+};
+
+/**
+ * Entry type the bulk load sorts for leaf layout L.
+ */
+template <class T, class L>
+struct SortEntry {
+    typedef RIDKeyPair<T> Type;
+};
+
+template <class T>
+struct SortEntry<T, PayloadLeaf<T> > {
+    typedef CoveredPair<T> Type;
+};
+
+/**
+ * Payload of a sorted entry, null for a bare pair.
+ */
+template <class T>
+static char* payloadOf(RIDKeyPair<T>& pair) {
+    return nullptr;
+}
+
+template <class T>
+static char* payloadOf(CoveredPair<T>& pair) {
+    return pair.payload;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::bulkLoad
+// -----------------------------------------------------------------------------
+/**
+ * Builds the whole tree from the base relation without going through insertEntry.
+ * Every page is written once, left to right within a level, and only the page
+ * being filled is pinned.
+ * @param relationName    Name of the base relation.
+ * @param options         Fill factor and sort buffer size.
+ */
+template <class T, class L>
+const void BTreeIndex::bulkLoad(const std::string & relationName, const IndexOptions & options)
+{
+    // Extract and sort the (key, rid) pairs, with their payloads for a covering index.
+    typedef typename SortEntry<T, L>::Type Entry;
+    size_t bufferPairs = std::max(1, options.sortBufferPages) * Page::SIZE / sizeof(Entry);
+    SortedRuns<Entry> pairs(file->filename(), bufferPairs);
+    {
+        FileScan fileScan(relationName, bufMgr);
+        RecordId rid;
+        try
+        {
+            while(1)
+            {
+                fileScan.scanNext(rid);
+                std::string record = fileScan.getRecord();
+                Entry pair;
+                pair.set(rid, loadKey<T>(record.c_str() + attrByteOffset));
+                char* payload = payloadOf(pair);
+                if (payload != nullptr) {
+                    extractPayload(record.c_str(), payload);
+                }
+                pairs.add(pair);
+            }
+        }
+        catch(const EndOfFileException& e)
+        {
+        }
+    }
+    pairs.finish();
+    if (filter != nullptr) {
+        delete filter;
+        filter = new BloomFilter(BloomFilter::blocksFor(std::max(options.bloomFilterKeys, (long) pairs.size())));
+    }
+
+    // Number of entries per leaf and keys per non-leaf at the requested fill factor.
+    double fillFactor = std::min(1.0, std::max(0.0, options.fillFactor));
+    int leafFill = std::max(1, (int) (leafOccupancy * fillFactor));
+    int nodeFill = std::max(2, (int) (nodeOccupancy * fillFactor));
+
+    // Spread the entries evenly over the leaves so the last one is not left nearly empty.
+    // Packed leaves may fill up in bytes before they reach leafFill entries; the leaves
+    // still to come are then counted again from what the last one took.
+    long remaining = pairs.size();
+    long leavesLeft = std::max(1L, (remaining + leafFill - 1) / leafFill);
+    // First key and page of every node on the level being built.
+    std::vector<PageKeyPair<T> > level;
+    level.reserve(leavesLeft);
+
+    // The empty root leaf becomes the leftmost leaf.
+    PageId leafNum = rootPageNum;
+    Page* leafPage;
+    bufMgr->readPage(file, leafNum, leafPage);
+    Entry pair;
+    bool pending = false;
+    // The pairs come in key order, as an equi-depth histogram is built.
+    HistogramBuilder builder(remaining);
+    T lastKey = T();
+    while (true) {
+        long entries = (remaining + leavesLeft - 1) / leavesLeft;
+        long added = 0;
+        T keyBefore = lastKey;
+        while (added < entries && (added == 0 || !L::filled(leafPage, fillFactor))) {
+            if (!pending) {
+                pairs.next(pair);
+                pending = true;
+            }
+            if (!L::append(leafPage, pair.key, pair.rid, payloadOf(pair))) {
+                break;
+            }
+            addToFilter(pair.key);
+            builder.add(keyPosition(pair.key), builder.buckets.empty() || KeyTraits<T>::compare(pair.key, lastKey) != 0);
+            lastKey = pair.key;
+            pending = false;
+            added++;
+        }
+        remaining -= added;
+        PageKeyPair<T> entry;
+        T firstKey = added > 0 ? T(L::key(leafPage, 0)) : T();
+        entry.set(leafNum, level.empty() ? firstKey : separatorBetween(keyBefore, firstKey));
+        entry.count = added;
+        level.push_back(entry);
+        if (remaining == 0) {
+            break;
+        }
+        leavesLeft = std::max(leavesLeft - 1, (remaining + added - 1) / added);
+        // Link in the next leaf before letting go of this one.
+        PageId nextNum;
+        Page* nextPage;
+        bufMgr->allocPage(file, nextNum, nextPage);
+        clearLeaf(nextPage);
+        L::setRightSib(leafPage, nextNum);
+        L::setLeftSib(nextPage, leafNum);
+        bufMgr->unPinPage(file, leafNum, true);
+        leafNum = nextNum;
+        leafPage = nextPage;
+    }
+    bufMgr->unPinPage(file, leafNum, true);
+    numEntries = (long) pairs.size();
+    numLeaves = (long) level.size();
+    builder.finish();
+    {
+        std::lock_guard<std::mutex> guard(histogramLock);
+        histogram.swap(builder.buckets);
+        histogramEntries = numEntries;
+        histogramChanged = true;
+    }
+
+    // Build the non-leaf levels bottom up until a single node is left.
+    int nodeLevel = 1;
+    while (level.size() > 1) {
+        size_t children = level.size();
+        size_t nodesLeft = (children + nodeFill) / (nodeFill + 1);
+        std::vector<PageKeyPair<T> > parents;
+        parents.reserve(nodesLeft);
+        std::vector<T> keys;
+        size_t next = 0;
+        while (next < children) {
+            // Spread the children evenly over the nodes left. Variable-length keys may
+            // fill a node in bytes first; the nodes still to come are then counted again.
+            size_t left = children - next;
+            size_t nodeChildren = (left + nodesLeft - 1) / nodesLeft;
+            keys.clear();
+            for (size_t c = 1; c < nodeChildren; c++) {
+                keys.push_back(level[next + c].key);
+            }
+            while (nodeChildren > 2 && (!Separators<T>::fitsKeys(keys.data(), (int) keys.size(), fillFactor)
+                                        || left - nodeChildren == 1)) {
+                // Never leave a single child for the last node.
+                nodeChildren--;
+                keys.pop_back();
+            }
+            PageId nodeNum;
+            Page* nodePage;
+            bufMgr->allocPage(file, nodeNum, nodePage);
+            memset((void*) nodePage, 0, Page::SIZE);
+            NonLeafNode<T>* node = (NonLeafNode<T>*) nodePage;
+            node->level = nodeLevel;
+            node->pageNoArray[0] = level[next].pageNo;
+            for (size_t c = 1; c < nodeChildren; c++) {
+                node->pageNoArray[c] = level[next + c].pageNo;
+            }
+            Separators<T>::assign(node, keys.data(), (int) keys.size());
+            indexNode(node);
+            PageKeyPair<T> entry;
+            entry.set(nodeNum, level[next].key);
+            entry.count = 0;
+            for (size_t c = 0; c < nodeChildren; c++) {
+                if (keepsCounts<T>()) {
+                    childCounts(node)[c] = level[next + c].count;
+                }
+                entry.count += level[next + c].count;
+            }
+            parents.push_back(entry);
+            next += nodeChildren;
+            bufMgr->unPinPage(file, nodeNum, true);
+            nodesLeft = std::max(nodesLeft - 1, (children - next + nodeChildren - 1) / nodeChildren);
+        }
+        level.swap(parents);
+        nodeLevel = 0;
+    }
+
+    // Record the new root in the meta page.
+    if (level[0].pageNo != rootPageNum) {
+        Page* header;
+        bufMgr->readPage(file, headerPageNum, header);
+        IndexMetaInfo* metaInfo = (IndexMetaInfo*) header;
+        metaInfo->rootPageNo = level[0].pageNo;
+        rootPageNum = level[0].pageNo;
+        bufMgr->unPinPage(file, headerPageNum, true);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::addToBranch
+// -----------------------------------------------------------------------------
+/**
+ * This method enters a new data node right after the child it was split from,
+ * shifting the later keys and pages over by one. Searching for the key instead
+ * could place it after other children whose separator equals it, out of step
+ * with the leaf chain.
+ * @param branch    The branch to be added to.
+ * @param slot      Slot of the child that was split.
+ * @param data      The data to add to said branch node.
+ */
+template <class T>
+const void BTreeIndex::addToBranch(NonLeafNode<T>* branch, int slot, const PageKeyPair<T>& data) {
+    int n = branch->numKeys;
+    int i = slot;
+    // Shift the pages after i + 1 to make room.
+    memmove(&branch->pageNoArray[i+2], &branch->pageNoArray[i+1], (n - i) * sizeof(PageId));
+    // Update branch arrays with the new data
+    Separators<T>::insert(branch, i, data.key);
+    branch->pageNoArray[i+1] = data.pageNo;
+    if (keepsCounts<T>()) {
+        // The new node took its entries from the child it was split from.
+        long* counts = childCounts(branch);
+        memmove(&counts[i+2], &counts[i+1], (n - i) * sizeof(long));
+        counts[i] -= data.count;
+        counts[i+1] = data.count;
+    }
+    indexNode(branch);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::newRoot
+// -----------------------------------------------------------------------------
+/**
+ * This method updates the root of the B-Tree. In this case, the root needs to be split
+ * and entries pushed up the tree.
+ * @param firstNode     This is the page number of the first entry of the root.
+ * @param child         This is the entry that needs to be propogated upwards
+ *                      after the split occurs.
+ * @param firstCount    Number of entries under the first node, for counted nodes.
+ */
+template <class T>
+const void BTreeIndex::newRoot(PageId firstNode, const PageKeyPair<T>& child, long firstCount) {
+    // New root with metadata updates
+    Page* newRoot;
+    PageId newNum;
+//    cout << "newRoot(): Allocating space for a new root page." << endl;
+    bufMgr->allocPage(file, newNum, newRoot);
+//    cout << "newRoot(): Space allocated for new root page." << endl;
+    memset((void*) newRoot, 0, Page::SIZE);
+    NonLeafNode<T>* newPage = (NonLeafNode<T>*) newRoot;    // New page allocated for root.
+    if (firstRootNum == rootPageNum) {
+        newPage->level = 1;     // If the root is a leaf
+    } else {
+        newPage->level = 0;
+    }
+    // Update the root page metadata to reflect changes.
+    Separators<T>::insert(newPage, 0, child.key);
+    newPage->pageNoArray[0] = firstNode;
+    newPage->pageNoArray[1] = child.pageNo;
+    if (keepsCounts<T>()) {
+        childCounts(newPage)[0] = firstCount;
+        childCounts(newPage)[1] = child.count;
+    }
+    indexNode(newPage);
+    // Update the header page
+    Page* newMetaInfo;
+//    cout << "newRoot(): Reading in page." << endl;
+    bufMgr->readPage(file, headerPageNum, newMetaInfo);
+//    cout << "newRoot(): Page read successful." << endl;
+    IndexMetaInfo* metaInfo = (IndexMetaInfo*) newMetaInfo;
+    metaInfo->rootPageNo = newNum;
+    rootPageNum = newNum;       // Update the global root page variable.
+    // Free pages from buffer so data overflow doesn't occur.
+    bufMgr->unPinPage(file, headerPageNum, true);
+    bufMgr->unPinPage(file, newNum, true);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::branchSplit
+// -----------------------------------------------------------------------------
+/**
+ * This method splits the branch so that the child entry can be entered into the tree.
+ * First, a new branch page is allocated memory, then the upper half of the keys and
+ * pages are moved over from the old branch node to the new one. The middle key of the
+ * old keys plus the child entry is pushed up.
+ * @param child     The entry that will need to be entered after the splitting occurs.
+ *                  Replaced by the entry for the new node, to be added to the parent.
+ * @param old       The node that will be split in this function.
+ * @param oldNum    PageId that was used to index the node to be split.
+ * @param slot      Slot of the child of old that was split.
+ */
+template <class T>
+const void BTreeIndex::branchSplit(PageKeyPair<T>& child, NonLeafNode<T>* old,
+                                   PageId oldNum, int slot) {
+    PageKeyPair<T> entry = child;   // The entry being added to this level.
+    Page* newBranch;
+    PageId newNum;
+    bufMgr->allocPage(file, newNum, newBranch);
+    memset((void*) newBranch, 0, Page::SIZE);
+    NonLeafNode<T>* node = (NonLeafNode<T>*) newBranch;
+    node->level = old->level;
+    int n = old->numKeys;
+    int pos = slot;
+    // Position of the pushed up key among all n + 1 keys.
+    int middle = Separators<T>::splitPoint(old, pos, entry.key);
+    // An append into the last child leaves most of the keys behind, as they will stay.
+    if (appendOptimized && pos == n) {
+        middle = std::max(middle, std::min(n - 1, (int) (n * appendFill)));
+    }
+    if (pos == middle) {
+        // The new key itself is pushed up; its page starts the new node.
+        child.set(newNum, entry.key);
+        Separators<T>::insertRange(node, 0, old, middle, n - middle);
+        node->pageNoArray[0] = entry.pageNo;
+        memcpy(&node->pageNoArray[1], &old->pageNoArray[middle+1], node->numKeys * sizeof(PageId));
+        if (keepsCounts<T>()) {
+            childCounts(node)[0] = entry.count;
+            memcpy(&childCounts(node)[1], &childCounts(old)[middle+1], node->numKeys * sizeof(long));
+            childCounts(old)[middle] -= entry.count;
+        }
+        Separators<T>::erase(old, middle, n - middle);
+    } else {
+        // An existing key is pushed up, the new entry goes to the side it belongs to.
+        int split = pos < middle ? middle - 1 : middle;
+        child.set(newNum, Separators<T>::key(old, split));
+        Separators<T>::insertRange(node, 0, old, split + 1, n - split - 1);
+        memcpy(&node->pageNoArray[0], &old->pageNoArray[split+1], (node->numKeys + 1) * sizeof(PageId));
+        if (keepsCounts<T>()) {
+            memcpy(&childCounts(node)[0], &childCounts(old)[split+1], (node->numKeys + 1) * sizeof(long));
+        }
+        Separators<T>::erase(old, split, n - split);
+        if (pos < middle) {
+            addToBranch(old, pos, entry);
+        } else {
+            addToBranch(node, pos - split - 1, entry);
+        }
+    }
+    indexNode(old);
+    indexNode(node);
+    if (bufferedInserts) {
+        // Messages that now descend through the new node go with it.
+        MessageBatch<T> moved;
+        NodeBuffer<T>(old, nodeOccupancy, payloadBytes).take([&](const T& k) {
+            return KeyTraits<T>::compare(k, child.key) >= 0;
+        }, moved);
+        NodeBuffer<T>(node, nodeOccupancy, payloadBytes).append(moved);
+    }
+    long oldCount = 0;
+    if (keepsCounts<T>()) {
+        oldCount = subtreeCount(old);
+        child.count = subtreeCount(node);
+    }
+    // Unpin the unused pages
+    unpinNode(oldNum, false, true);
+    bufMgr->unPinPage(file, newNum, true);
+
+    if (rootPageNum == oldNum) {
+        newRoot(oldNum, child, oldCount);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::leafSplit
+// -----------------------------------------------------------------------------
+/**
+ * This method splits a full leaf so that an entry with the given key can be added
+ * into the tree. First, a new leaf node is allocated memory, then the upper part
+ * of the old leaf's entries is moved over to the new one. Sibling pointers are
+ * properly changed. The entry itself is left to the caller, since how much room a
+ * leaf has for it depends on the layout. If need be, update the root.
+ * @param child     Set to the entry for the new leaf, to be added to the parent.
+ * @param old       The old leaf node to be split.
+ * @param oldNum    The page number of the old leaf node to be split.
+ * @param key       Key of the entry that did not fit, which picks the split point.
+ */
+template <class T, class L>
+const void BTreeIndex::leafSplit(PageKeyPair<T>& child, Page* old, PageId oldNum, const T& key) {
+    Page* newLeaf;      // Initialize a new leaf node for the split
+    PageId newNum;      // Initialize a new leaf page ID for the split
+//    cout << "leafSplit(): allocating new page" << endl;
+    bufMgr->allocPage(file, newNum, newLeaf);
+    numLeaves++;
+//    cout << "leafSplit(): new page allocated" << endl;
+    clearLeaf(newLeaf);
+    int n = L::size(old);
+    int split = n/2;    // Keep track of where to copy data from
+    if (appendOptimized && L::rightSib(old) == 0
+        && KeyTraits<T>::compare(key, L::key(old, n-1)) >= 0) {
+        // Appending past the end of the rightmost leaf, which later keys will follow.
+        // The new leaf starts with the last entry, so the key is not below its first.
+        split = std::max(split, std::min(n - 1, (int) (n * appendFill)));
+    } else if (n%2 == 1 && L::upperBound(old, key) > split) {
+        // If the key goes in the upper half, leave the extra entry in the old leaf.
+        split++;
+    }
+    // Move the upper half of the entries over to the new leaf
+    L::split(old, newLeaf, split);
+    // Make sure siblings are properly changed, in both directions
+    PageId rightNum = L::rightSib(old);
+    L::setRightSib(newLeaf, rightNum);
+    L::setLeftSib(newLeaf, oldNum);
+    L::setRightSib(old, newNum);
+    if (rightNum != 0) {
+        setLeftLink<L>(rightNum, newNum);
+    }
+    // The new leaf goes into the parent under its first key, or as much of it as tells
+    // it from the last key of the old leaf.
+    child.set(newNum, separatorBetween(L::key(old, L::size(old) - 1), L::key(newLeaf, 0)));
+    child.count = L::size(newLeaf);
+    long oldCount = L::size(old);
+    // The old leaf is no longer the rightmost one, nor above the new separator.
+    if (oldNum == appendLeafNum) {
+        appendLeafNum = 0;
+    }
+
+    // Free up the buffer
+    bufMgr->unPinPage(file, oldNum, true);
+    bufMgr->unPinPage(file, newNum, true);
+
+    // If the leaf that was split was the root, update the root.
+    if (oldNum == rootPageNum) {
+        newRoot(oldNum, child, oldCount);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::setLeftLink
+// -----------------------------------------------------------------------------
+/**
+ * Repoints the left sibling link of a leaf. The leaf is to the right of every
+ * leaf the caller holds, so latching it keeps to the left to right order.
+ * @param leafNum   Page number of the leaf to change.
+ * @param leftNum   Page number of its new left sibling.
+ */
+template <class L>
+const void BTreeIndex::setLeftLink(PageId leafNum, PageId leftNum) {
+    Page* leaf;
+    latchPage(leafNum, true);
+    bufMgr->readPage(file, leafNum, leaf);
+    L::setLeftSib(leaf, leftNum);
+    bufMgr->unPinPage(file, leafNum, true);
+    unlatchPage(leafNum);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::deleteEntry
+// -----------------------------------------------------------------------------
+/**
+ * This method deletes the entry <key,rid> from the index. As with insertEntry the
+ * attribute type is only looked at here and the work is done by typed helpers.
+ * @param key   Pointer to the integer/double/string of the entry.
+ * @param rid   Record id the entry points to.
+ * @return      True if the entry was found and removed.
+ */
+const bool BTreeIndex::deleteEntry(const void *key, const RecordId rid) {
+    DeleteOp op = { this, key, rid };
+    return dispatch(op);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::deleteTyped
+// -----------------------------------------------------------------------------
+/**
+ * Removes the entry starting at the root. If merges below leave the root with a
+ * single child, that child becomes the root and the old root page is freed. The
+ * leftmost leaf always survives a merge, so a tree that shrinks back to one leaf
+ * has firstRootNum as its root again.
+ * @param key   The key of the entry.
+ * @param rid   Record id of the entry.
+ * @return      True if the entry was found and removed.
+ */
+template <class T, class L>
+const bool BTreeIndex::deleteTyped(const T& key, const RecordId rid) {
+    bool removed;
+    // Most concurrent deletes leave their leaf at least half full and only latch it exclusively.
+    if (latches != nullptr && !countedNodes && deleteFromSafeLeaf<T, L>(key, rid, removed)) {
+        return removed;
+    }
+    // Otherwise latch exclusively from the root down and keep every latch, since a merge
+    // can reach the root and duplicates can lead the search into several children.
+    if (latches != nullptr) {
+        rootLatch.lockExclusive();
+    }
+    PageId rootNum = rootPageNum;
+    Page* root;
+    latchPage(rootNum, true);
+    bufMgr->readPage(file, rootNum, root);
+    bool rootIsLeaf = rootNum == firstRootNum;
+    removed = removeEntry<T, L>(root, rootIsLeaf, key, rid);
+    MessageBatch<T> pending;
+    if (!rootIsLeaf && ((NonLeafNode<T>*) root)->numKeys == 0) {
+        // The last two children of the root were merged. Messages left in the buffer of
+        // the root are added again once its child has taken over.
+        if (bufferedInserts) {
+            NodeBuffer<T>((NonLeafNode<T>*) root, nodeOccupancy, payloadBytes).take([](const T& k) { return true; }, pending);
+        }
+        rootPageNum = ((NonLeafNode<T>*) root)->pageNoArray[0];
+        Page* header;
+        bufMgr->readPage(file, headerPageNum, header);
+        ((IndexMetaInfo*) header)->rootPageNo = rootPageNum;
+        bufMgr->unPinPage(file, headerPageNum, true);
+        dropNode(rootNum);
+        bufMgr->disposePage(file, rootNum);
+    } else {
+        bufMgr->unPinPage(file, rootNum, removed);
+    }
+    unlatchPage(rootNum);
+    if (latches != nullptr) {
+        rootLatch.unlock();
+    }
+    for (int i = 0; i < pending.size(); i++) {
+        bufferInsert<T, L>(pending.keys[i], pending.rids[i], payloadBytes > 0 ? &pending.payloads[(size_t) i * payloadBytes] : nullptr);
+    }
+    return removed;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::deleteFromSafeLeaf
+// -----------------------------------------------------------------------------
+/**
+ * Optimistic half of a concurrent delete. Descends with shared latches to the
+ * leftmost leaf that can hold the key and latches it exclusively. The delete is
+ * finished here if the leaf stays at least half full, and either holds the entry
+ * or ends before the keys equal to key do.
+ * @param key       The key of the entry.
+ * @param rid       Record id of the entry.
+ * @param removed   Set to whether the entry was removed.
+ * @return          True if the delete is finished.
+ */
+template <class T, class L>
+const bool BTreeIndex::deleteFromSafeLeaf(const T& key, const RecordId rid, bool& removed) {
+    rootLatch.lockShared();
+    PageId currNum = rootPageNum;
+    bool isLeaf = currNum == firstRootNum;
+    bool isRoot = isLeaf;
+    latchPage(currNum, isLeaf);
+    rootLatch.unlock();
+    Page* currPage;
+    readNode(currNum, currPage, isLeaf);
+    while (!isLeaf) {
+        NonLeafNode<T>* curr = (NonLeafNode<T>*) currPage;
+        PageId nextNum = curr->pageNoArray[childLowerBound(curr, key)];
+        isLeaf = curr->level == 1;
+        latchPage(nextNum, isLeaf);
+        unpinNode(currNum, false, false);
+        unlatchPage(currNum);
+        currNum = nextNum;
+        readNode(currNum, currPage, isLeaf);
+    }
+    bool finished = isRoot || L::safeToRemove(currPage);
+    removed = false;
+    if (finished) {
+        removed = removeFromLeaf<T, L>(currPage, key, rid);
+        // Keys equal to key may go on in the right sibling.
+        int n = L::size(currPage);
+        if (!removed && L::rightSib(currPage) != 0
+            && (n == 0 || KeyTraits<T>::compare(L::key(currPage, n - 1), key) <= 0)) {
+            finished = false;
+        }
+    }
+    bufMgr->unPinPage(file, currNum, removed);
+    unlatchPage(currNum);
+    return finished;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::removeEntry
+// -----------------------------------------------------------------------------
+/**
+ * Removes the entry from the subtree under a node. In a non-leaf every child from
+ * the leftmost one that can hold the key to the one that covers it is searched in
+ * turn, since duplicates of a key can span several leaves. The child the entry
+ * came out of is rebalanced before returning.
+ * @param currPage  The node, pinned and latched exclusively.
+ * @param isLeaf    Whether the node is a leaf.
+ * @param key       The key of the entry.
+ * @param rid       Record id of the entry.
+ * @return          True if the entry was found and removed.
+ */
+template <class T, class L>
+const bool BTreeIndex::removeEntry(Page* currPage, bool isLeaf, const T& key, const RecordId rid) {
+    if (isLeaf) {
+        return removeFromLeaf<T, L>(currPage, key, rid);
+    }
+    NonLeafNode<T>* curr = (NonLeafNode<T>*) currPage;
+    bool childIsLeaf = curr->level == 1;
+    int last = childUpperBound(curr, key);
+    for (int i = childLowerBound(curr, key); i <= last; i++) {
+        PageId childNum = curr->pageNoArray[i];
+        Page* child;
+        latchPage(childNum, true);
+        bufMgr->readPage(file, childNum, child);
+        if (removeEntry<T, L>(child, childIsLeaf, key, rid)) {
+            if (keepsCounts<T>()) {
+                childCounts(curr)[i]--;
+            }
+            rebalance<T, L>(curr, i, child, childIsLeaf);
+            return true;
+        }
+        bufMgr->unPinPage(file, childNum, false);
+        unlatchPage(childNum);
+    }
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::removeFromLeaf
+// -----------------------------------------------------------------------------
+/**
+ * Searches the entries of a leaf with the given key for the given rid and removes
+ * it, shifting the later entries over.
+ * @param leaf  The leaf.
+ * @param key   The key of the entry.
+ * @param rid   Record id of the entry.
+ * @return      True if the leaf held the entry.
+ */
+template <class T, class L>
+const bool BTreeIndex::removeFromLeaf(Page* leaf, const T& key, const RecordId rid) {
+    int end = L::upperBound(leaf, key);
+    for (int i = L::lowerBound(leaf, key); i < end; i++) {
+        if (L::rid(leaf, i) == rid) {
+            L::erase(leaf, i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::rebalance
+// -----------------------------------------------------------------------------
+/**
+ * A non-leaf is underfull with fewer than half its slots in use, or a third of its
+ * bytes for variable-length keys, and a leaf as its layout decides. An underfull child is paired with its left sibling, or its right
+ * one if it is the first child. Two leaves are merged if their entries fit in one,
+ * and two non-leaves if the sibling cannot spare keys: the right node goes into the
+ * left one, its page is freed and the parent loses the separator between them.
+ * The leaf after the right one is linked back to the left one.
+ * Otherwise the two split their entries evenly and the separator in the parent is
+ * updated. For non-leaves the separator comes down from the parent and the new one
+ * goes up. Non-leaves of variable-length keys only merge, when the keys fit in one.
+ * @param parent        The parent, pinned and latched exclusively.
+ * @param childIdx      Slot of the child in the parent.
+ * @param childPage     The child, pinned and latched exclusively.
+ * @param isLeaf        Whether the child is a leaf.
+ */
+template <class T, class L>
+const void BTreeIndex::rebalance(NonLeafNode<T>* parent, int childIdx, Page* childPage, bool isLeaf) {
+    PageId childNum = parent->pageNoArray[childIdx];
+    int minKeys = nodeOccupancy / 2;
+    bool underfull = isLeaf ? L::underfull(childPage)
+                            : Separators<T>::underfull((NonLeafNode<T>*) childPage, nodeOccupancy);
+    if (!underfull || parent->numKeys == 0) {
+        bufMgr->unPinPage(file, childNum, true);
+        unlatchPage(childNum);
+        return;
+    }
+    // Pin and latch the sibling; the child already is.
+    int leftIdx = childIdx > 0 ? childIdx - 1 : childIdx;
+    PageId leftNum = parent->pageNoArray[leftIdx];
+    PageId rightNum = parent->pageNoArray[leftIdx + 1];
+    PageId siblingNum = leftNum == childNum ? rightNum : leftNum;
+    Page* siblingPage;
+    latchPage(siblingNum, true);
+    bufMgr->readPage(file, siblingNum, siblingPage);
+    // A cursor that copied either leaf may be about to follow its link. Checked with
+    // both leaves latched, so a cursor opened from here on sees the result instead.
+    if (isLeaf && openCursors.load() > 0) {
+        bufMgr->unPinPage(file, siblingNum, false);
+        unlatchPage(siblingNum);
+        bufMgr->unPinPage(file, childNum, true);
+        unlatchPage(childNum);
+        return;
+    }
+    Page* leftPage = leftNum == childNum ? childPage : siblingPage;
+    Page* rightPage = leftNum == childNum ? siblingPage : childPage;
+    bool merge;
+    if (isLeaf) {
+        // Leaves merge when the entries fit in one, else they even out if they can.
+        merge = L::merge(leftPage, rightPage);
+        if (merge && L::rightSib(leftPage) != 0) {
+            setLeftLink<L>(L::rightSib(leftPage), leftNum);
+        }
+        if (!merge && L::redistribute(leftPage, rightPage)) {
+            Separators<T>::set(parent, leftIdx, L::key(rightPage, 0));
+        }
+    } else {
+        NonLeafNode<T>* left = (NonLeafNode<T>*) leftPage;
+        NonLeafNode<T>* right = (NonLeafNode<T>*) rightPage;
+        int l = left->numKeys;
+        int r = right->numKeys;
+        int newLeft = (l + r) / 2;
+        merge = (siblingNum == leftNum ? l : r) <= minKeys;
+        bool even = !merge;
+        if (Separators<T>::VARIABLE) {
+            merge = Separators<T>::fitsMerged(left, Separators<T>::key(parent, leftIdx), right, nodeOccupancy);
+            even = false;
+        }
+        NodeBuffer<T> leftBuffer(left, nodeOccupancy, payloadBytes);
+        NodeBuffer<T> rightBuffer(right, nodeOccupancy, payloadBytes);
+        if (bufferedInserts) {
+            // Message buffers must hold the messages that end up in them, or the nodes
+            // are left as they are.
+            if (merge && leftBuffer.size() + rightBuffer.size() > bufferCapacity) {
+                merge = false;
+                even = newLeft != l;
+            }
+            if (even) {
+                const T& sep = l > newLeft ? Separators<T>::key(left, newLeft)
+                                           : Separators<T>::key(right, newLeft - l - 1);
+                int toLeft = 0;
+                for (int i = 0; i < leftBuffer.size(); i++) {
+                    toLeft += KeyTraits<T>::compare(leftBuffer.key(i), sep) < 0;
+                }
+                for (int i = 0; i < rightBuffer.size(); i++) {
+                    toLeft += KeyTraits<T>::compare(rightBuffer.key(i), sep) < 0;
+                }
+                int toRight = leftBuffer.size() + rightBuffer.size() - toLeft;
+                even = toLeft <= bufferCapacity && toRight <= bufferCapacity;
+            }
+        }
+        if (merge) {
+            Separators<T>::insert(left, l, Separators<T>::key(parent, leftIdx));
+            Separators<T>::insertRange(left, l + 1, right, 0, r);
+            memcpy(&left->pageNoArray[l+1], &right->pageNoArray[0], (r + 1) * sizeof(PageId));
+            if (keepsCounts<T>()) {
+                memcpy(&childCounts(left)[l+1], &childCounts(right)[0], (r + 1) * sizeof(long));
+            }
+            if (bufferedInserts) {
+                MessageBatch<T> moved;
+                rightBuffer.take([](const T& k) { return true; }, moved);
+                leftBuffer.append(moved);
+            }
+        } else if (even) {
+            if (l > newLeft) {
+                // Rotate the last keys and pages of the left node through the parent.
+                int k = l - newLeft;
+                memmove(&right->pageNoArray[k], &right->pageNoArray[0], (r + 1) * sizeof(PageId));
+                Separators<T>::insert(right, 0, Separators<T>::key(parent, leftIdx));
+                Separators<T>::insertRange(right, 0, left, newLeft + 1, k - 1);
+                memcpy(&right->pageNoArray[0], &left->pageNoArray[newLeft+1], k * sizeof(PageId));
+                if (keepsCounts<T>()) {
+                    memmove(&childCounts(right)[k], &childCounts(right)[0], (r + 1) * sizeof(long));
+                    memcpy(&childCounts(right)[0], &childCounts(left)[newLeft+1], k * sizeof(long));
+                }
+                Separators<T>::set(parent, leftIdx, Separators<T>::key(left, newLeft));
+                Separators<T>::erase(left, newLeft, k);
+            } else {
+                // Rotate the first keys and pages of the right node through the parent.
+                int k = newLeft - l;
+                Separators<T>::insert(left, l, Separators<T>::key(parent, leftIdx));
+                Separators<T>::insertRange(left, l + 1, right, 0, k - 1);
+                memcpy(&left->pageNoArray[l+1], &right->pageNoArray[0], k * sizeof(PageId));
+                Separators<T>::set(parent, leftIdx, Separators<T>::key(right, k - 1));
+                Separators<T>::erase(right, 0, k);
+                memmove(&right->pageNoArray[0], &right->pageNoArray[k], (r - k + 1) * sizeof(PageId));
+                if (keepsCounts<T>()) {
+                    memcpy(&childCounts(left)[l+1], &childCounts(right)[0], k * sizeof(long));
+                    memmove(&childCounts(right)[0], &childCounts(right)[k], (r - k + 1) * sizeof(long));
+                }
+            }
+            indexNode(right);
+            if (bufferedInserts) {
+                // Split the messages of both nodes again at the new separator.
+                MessageBatch<T> all;
+                leftBuffer.take([](const T& k) { return true; }, all);
+                rightBuffer.take([](const T& k) { return true; }, all);
+                for (int i = 0; i < all.size(); i++) {
+                    NodeBuffer<T>& to = KeyTraits<T>::compare(all.keys[i], Separators<T>::key(parent, leftIdx)) < 0 ? leftBuffer : rightBuffer;
+                    to.append(all.keys[i], all.rids[i], payloadBytes > 0 ? &all.payloads[(size_t) i * payloadBytes] : nullptr);
+                }
+            }
+        }
+        indexNode(left);
+    }
+    if (keepsCounts<T>()) {
+        // The two children now hold the entries they were given.
+        long* counts = childCounts(parent);
+        counts[leftIdx] = isLeaf ? L::size(leftPage) : subtreeCount((NonLeafNode<T>*) leftPage);
+        counts[leftIdx + 1] = merge ? 0 : isLeaf ? L::size(rightPage) : subtreeCount((NonLeafNode<T>*) rightPage);
+    }
+    bufMgr->unPinPage(file, leftNum, true);
+    unlatchPage(leftNum);
+    if (merge) {
+        // Drop the separator and the right node from the parent and free its page.
+        int n = parent->numKeys;
+        Separators<T>::erase(parent, leftIdx, 1);
+        memmove(&parent->pageNoArray[leftIdx+1], &parent->pageNoArray[leftIdx+2], (n - leftIdx - 1) * sizeof(PageId));
+        if (keepsCounts<T>()) {
+            memmove(&childCounts(parent)[leftIdx+1], &childCounts(parent)[leftIdx+2], (n - leftIdx - 1) * sizeof(long));
+        }
+        dropNode(rightNum);
+        bufMgr->disposePage(file, rightNum);
+        if (isLeaf) {
+            numLeaves--;
+        }
+        if (rightNum == appendLeafNum) {
+            appendLeafNum = 0;
+        }
+    } else {
+        bufMgr->unPinPage(file, rightNum, true);
+    }
+    unlatchPage(rightNum);
+    // The separator of the two children changed or went away.
+    indexNode(parent);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::lookup
+// -----------------------------------------------------------------------------
+/**
+ * Collects the record ids of every entry with the given key.
+ * @param key       Pointer to the integer/double/string to look up.
+ * @param outRids   Cleared, then filled with the matching record ids.
+ * @return          Number of matching entries.
+ */
+const int BTreeIndex::lookup(const void* key, std::vector<RecordId>& outRids)
+{
+    outRids.clear();
+    LookupOp op = { this, key, &outRids };
+    return dispatch(op);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::contains
+// -----------------------------------------------------------------------------
+/**
+ * Tells whether any entry has the given key.
+ * @param key       Pointer to the integer/double/string to look for.
+ * @return          True if the key is in the index.
+ */
+const bool BTreeIndex::contains(const void* key)
+{
+    LookupOp op = { this, key, nullptr };
+    return dispatch(op) > 0;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::lookupTyped
+// -----------------------------------------------------------------------------
+/**
+ * Descends like startScanTyped to the leftmost leaf that may hold the key and
+ * binary searches it for the first and last match. The record ids of the matches
+ * are copied straight from the pinned leaf. Only when they run to the end of the
+ * leaf, or the leaf ends below the key, does the lookup go on to the right sibling. It then counts itself as an open cursor
+ * until done, so that no delete frees the sibling between reading the link and
+ * latching it.
+ * @param key       The key to look up.
+ * @param outRids   Receives the matching record ids, or null to stop at the first.
+ * @return          Number of matches found.
+ */
+template <class T, class L>
+const int BTreeIndex::lookupTyped(const T& key, std::vector<RecordId>* outRids)
+{
+    if (latches != nullptr) {
+        rootLatch.lockShared();
+    }
+    PageId currNum = rootPageNum;
+    bool isLeaf = currNum == firstRootNum;
+    latchPage(currNum, false);
+    if (latches != nullptr) {
+        rootLatch.unlock();
+    }
+    Page* currPage;
+    readNode(currNum, currPage, isLeaf);
+    while (!isLeaf) {
+        NonLeafNode<T>* curr = (NonLeafNode<T>*) currPage;
+        PageId nextNum = curr->pageNoArray[childLowerBound(curr, key)];
+        isLeaf = curr->level == 1;
+        latchPage(nextNum, false);
+        unpinNode(currNum, false, false);
+        unlatchPage(currNum);
+        currNum = nextNum;
+        readNode(currNum, currPage, isLeaf);
+    }
+    int count = 0;
+    bool counted = false;
+    while (true) {
+        int n = L::size(currPage);
+        int i = L::lowerBound(currPage, key);
+        int end = i < n && KeyTraits<T>::compare(L::key(currPage, i), key) == 0
+            ? L::upperBound(currPage, key) : i;
+        if (end > i && outRids == nullptr) {
+            count = 1;
+        } else if (end > i) {
+            count += end - i;
+            size_t first = outRids->size();
+            outRids->resize(first + end - i);
+            L::copyRids(currPage, i, end - i, &(*outRids)[first]);
+        }
+        PageId nextNum = L::rightSib(currPage);
+        // Matches may go on in the right sibling if they run to the end of this leaf,
+        // unless one match is all contains needs.
+        bool more = end == n && nextNum != 0 && (outRids != nullptr || count == 0);
+        if (more && !counted) {
+            openCursors++;
+            counted = true;
+        }
+        bufMgr->unPinPage(file, currNum, false);
+        unlatchPage(currNum);
+        if (!more) {
+            break;
+        }
+        currNum = nextNum;
+        latchPage(currNum, false);
+        bufMgr->readPage(file, currNum, currPage);
+    }
+    if (counted) {
+        openCursors--;
+    }
+    return count;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::startScan
+// -----------------------------------------------------------------------------
+/**
+ * Starts a scan on the built-in cursor.
+ * @param lowValParm    The low value to be tested.
+ * @param lowOpParm     Operation used in testing the low range. (GT and GTE)
+ * @param highValParm   The high value to be tested.
+ * @param highOpParm    Operation used in testing the high range. (LT and LTE)
+ * @param order         Whether the scan runs up or down the range.
+ */
+const void BTreeIndex::startScan(const void* lowValParm,
+				                 const Operator lowOpParm,
+				                 const void* highValParm,
+				                 const Operator highOpParm,
+				                 const ScanOrder order)
+{
+    scanCursor.startScan(lowValParm, lowOpParm, highValParm, highOpParm, order);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::startPrefixScan
+// -----------------------------------------------------------------------------
+/**
+ * Starts a prefix scan on the built-in cursor.
+ * @param lowValParm    The low value to be tested.
+ * @param lowOpParm     Operation used in testing the low range. (GT and GTE)
+ * @param highValParm   The high value to be tested.
+ * @param highOpParm    Operation used in testing the high range. (LT and LTE)
+ * @param numColumns    Number of leading key attributes the values give.
+ * @param order         Whether the scan runs up or down the range.
+ */
+const void BTreeIndex::startPrefixScan(const void* lowValParm,
+				                       const Operator lowOpParm,
+				                       const void* highValParm,
+				                       const Operator highOpParm,
+				                       const int numColumns,
+				                       const ScanOrder order)
+{
+    scanCursor.startPrefixScan(lowValParm, lowOpParm, highValParm, highOpParm, numColumns, order);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::scanNext
+// -----------------------------------------------------------------------------
+/**
+ * Advances the built-in cursor.
+ * @param outRid    Record id of the next entry that matches the scan filter
+ *                  set in startScan.
+ */
+const void BTreeIndex::scanNext(RecordId& outRid)
+{
+    scanCursor.scanNext(outRid);
+}
+
+/**
+ * Advances the built-in cursor, copying out the included attributes of the entry.
+ * @param outRid        Record id of the next entry that matches the scan filter.
+ * @param outPayload    Buffer for payloadSize() bytes.
+ */
+const void BTreeIndex::scanNext(RecordId& outRid, void* outPayload)
+{
+    scanCursor.scanNext(outRid, outPayload);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::scanNextBatch
+// -----------------------------------------------------------------------------
+/**
+ * Advances the built-in cursor by up to maxRids entries.
+ * @param outRids   Buffer for at least maxRids record ids.
+ * @param maxRids   Most record ids to return.
+ * @return          Number of record ids returned, 0 once the scan is complete.
+ */
+const int BTreeIndex::scanNextBatch(RecordId* outRids, const int maxRids)
+{
+    return scanCursor.scanNextBatch(outRids, maxRids);
+}
+
+/**
+ * Advances the built-in cursor by up to maxRids entries along with their payloads.
+ * @param outRids       Buffer for at least maxRids record ids.
+ * @param outPayloads   Buffer for maxRids payloads of payloadSize() bytes.
+ * @param maxRids       Most record ids to return.
+ * @return              Number of entries returned, 0 once the scan is complete.
+ */
+const int BTreeIndex::scanNextBatch(RecordId* outRids, void* outPayloads, const int maxRids)
+{
+    return scanCursor.scanNextBatch(outRids, outPayloads, maxRids);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::payloadSize
+// -----------------------------------------------------------------------------
+/**
+ * @return  Bytes of included attributes stored with each entry, 0 unless covering.
+ */
+const int BTreeIndex::payloadSize() const
+{
+    return payloadBytes;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::endScan
+// -----------------------------------------------------------------------------
+/**
+ * Ends the scan of the built-in cursor.
+ */
+const void BTreeIndex::endScan()
+{
+    scanCursor.endScan();
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::parallelScan
+// -----------------------------------------------------------------------------
+/**
+ * Checks the operators and runs the typed parallel scan for the key type of the
+ * index.
+ * @param lowVal        The low value to be tested.
+ * @param lowOp         Operation used in testing the low range. (GT and GTE)
+ * @param highVal       The high value to be tested.
+ * @param highOp        Operation used in testing the high range. (LT and LTE)
+ * @param numWorkers    Most threads to scan with.
+ * @param consumer      Receives the entries of each part.
+ * @return              Number of entries scanned.
+ * @throws BadOpCodesException      If the opcodes sent in are invalid, error.
+ */
+const long BTreeIndex::parallelScan(const void* lowVal, const Operator lowOp, const void* highVal,
+                                    const Operator highOp, const int numWorkers,
+                                    const ScanPartConsumer& consumer)
+{
+    if (lowOp == LT || lowOp == LTE || highOp == GT || highOp == GTE) {
+        throw BadOpcodesException();
+    }
+    ParallelScanOp op = { this, lowVal, lowOp, highVal, highOp, std::max(1, numWorkers), consumer };
+    return dispatch(op);
+}
+
+/**
+ * Collects the record ids of each part in a vector of its own, then puts the
+ * parts together in order.
+ * @param lowVal        The low value to be tested.
+ * @param lowOp         Operation used in testing the low range. (GT and GTE)
+ * @param highVal       The high value to be tested.
+ * @param highOp        Operation used in testing the high range. (LT and LTE)
+ * @param numWorkers    Most threads to scan with.
+ * @param outRids       Receives the record ids in index order.
+ * @return              Number of entries scanned.
+ */
+const long BTreeIndex::parallelScan(const void* lowVal, const Operator lowOp, const void* highVal,
+                                    const Operator highOp, const int numWorkers,
+                                    std::vector<RecordId>& outRids)
+{
+    std::vector<std::vector<RecordId> > parts(std::max(1, numWorkers));
+    long count = parallelScan(lowVal, lowOp, highVal, highOp, numWorkers,
+        [&parts](const int part, const RecordId* rids, const void* payloads, const int n) {
+            parts[part].insert(parts[part].end(), rids, rids + n);
+        });
+    outRids.clear();
+    outRids.reserve(count);
+    for (size_t p = 0; p < parts.size(); p++) {
+        outRids.insert(outRids.end(), parts[p].begin(), parts[p].end());
+    }
+    return count;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::statistics
+// -----------------------------------------------------------------------------
+/**
+ * Returns the counts kept by inserts and deletes, the histogram, and what one
+ * descent to each end of the tree finds.
+ * @return  The statistics.
+ */
+const IndexStats BTreeIndex::statistics()
+{
+    IndexStats stats;
+    StatisticsOp op = { this, stats };
+    dispatch(op);
+    return stats;
+}
+
+template <class T, class L>
+const void BTreeIndex::statisticsTyped(IndexStats& stats) {
+    stats.entries = numEntries;
+    stats.leaves = numLeaves;
+    stats.fillFactor = stats.entries / ((double) std::max(1L, stats.leaves) * leafOccupancy);
+    T key;
+    stats.minKey = edgeKey<T, L>(false, key, stats.height) ? keyPosition(key) : 0;
+    stats.maxKey = edgeKey<T, L>(true, key, stats.height) ? keyPosition(key) : 0;
+    std::lock_guard<std::mutex> guard(histogramLock);
+    stats.histogram = histogram;
+    stats.histogramEntries = histogramEntries;
+    long distinct = 0;
+    for (size_t b = 0; b < histogram.size(); b++) {
+        distinct += histogram[b].distinctKeys;
+    }
+    stats.distinctKeys = histogramEntries > 0 ? (double) distinct * stats.entries / histogramEntries : 0;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::edgeKey
+// -----------------------------------------------------------------------------
+/**
+ * Descends along the first or last child of every node. The leaves are then
+ * read like lookupTyped reads them, counting as an open cursor while it moves
+ * on to a sibling.
+ */
+template <class T, class L>
+const bool BTreeIndex::edgeKey(const bool last, T& key, int& height) {
+    if (latches != nullptr) {
+        rootLatch.lockShared();
+    }
+    PageId currNum = rootPageNum;
+    bool isLeaf = currNum == firstRootNum;
+    latchPage(currNum, false);
+    if (latches != nullptr) {
+        rootLatch.unlock();
+    }
+    height = 1;
+    Page* currPage;
+    readNode(currNum, currPage, isLeaf);
+    while (!isLeaf) {
+        NonLeafNode<T>* curr = (NonLeafNode<T>*) currPage;
+        PageId nextNum = curr->pageNoArray[last ? curr->numKeys : 0];
+        isLeaf = curr->level == 1;
+        latchPage(nextNum, false);
+        unpinNode(currNum, false, false);
+        unlatchPage(currNum);
+        currNum = nextNum;
+        readNode(currNum, currPage, isLeaf);
+        height++;
+    }
+    openCursors++;
+    while (true) {
+        int n = L::size(currPage);
+        if (n > 0) {
+            key = L::key(currPage, last ? n - 1 : 0);
+        }
+        PageId nextNum = n > 0 ? 0 : last ? L::leftSib(currPage) : L::rightSib(currPage);
+        bufMgr->unPinPage(file, currNum, false);
+        unlatchPage(currNum);
+        if (nextNum == 0) {
+            openCursors--;
+            return n > 0;
+        }
+        currNum = nextNum;
+        latchPage(currNum, false);
+        bufMgr->readPage(file, currNum, currPage);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::refreshStatistics
+// -----------------------------------------------------------------------------
+const void BTreeIndex::refreshStatistics()
+{
+    RefreshStatisticsOp op = { this };
+    dispatch(op);
+}
+
+/**
+ * The histogram is built for as many entries as the index counts, which only
+ * sets the share of each bucket; the entries and leaves found replace the counts.
+ * Leaves are read one at a time like a scan reads them.
+ */
+template <class T, class L>
+const void BTreeIndex::refreshStatisticsTyped() {
+    int height;
+    T key;
+    edgeKey<T, L>(false, key, height);
+    if (latches != nullptr) {
+        rootLatch.lockShared();
+    }
+    PageId currNum = rootPageNum;
+    bool isLeaf = currNum == firstRootNum;
+    latchPage(currNum, false);
+    if (latches != nullptr) {
+        rootLatch.unlock();
+    }
+    Page* currPage;
+    readNode(currNum, currPage, isLeaf);
+    while (!isLeaf) {
+        NonLeafNode<T>* curr = (NonLeafNode<T>*) currPage;
+        PageId nextNum = curr->pageNoArray[0];
+        isLeaf = curr->level == 1;
+        latchPage(nextNum, false);
+        unpinNode(currNum, false, false);
+        unlatchPage(currNum);
+        currNum = nextNum;
+        readNode(currNum, currPage, isLeaf);
+    }
+    HistogramBuilder builder(numEntries);
+    long entries = 0;
+    long leaves = 0;
+    openCursors++;
+    while (true) {
+        int n = L::size(currPage);
+        for (int i = 0; i < n; i++) {
+            T next = L::key(currPage, i);
+            builder.add(keyPosition(next), entries == 0 || KeyTraits<T>::compare(next, key) != 0);
+            key = next;
+            entries++;
+        }
+        leaves++;
+        PageId nextNum = L::rightSib(currPage);
+        bufMgr->unPinPage(file, currNum, false);
+        unlatchPage(currNum);
+        if (nextNum == 0) {
+            break;
+        }
+        currNum = nextNum;
+        latchPage(currNum, false);
+        bufMgr->readPage(file, currNum, currPage);
+    }
+    openCursors--;
+    builder.finish();
+    numEntries = entries;
+    numLeaves = leaves;
+    std::lock_guard<std::mutex> guard(histogramLock);
+    histogram.swap(builder.buckets);
+    histogramEntries = entries;
+    histogramChanged = true;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::estimateRange
+// -----------------------------------------------------------------------------
+/**
+ * Estimates the entries in a range without reading a page.
+ * @param lowVal    The low value to be tested.
+ * @param lowOp     Operation used in testing the low range. (GT and GTE)
+ * @param highVal   The high value to be tested.
+ * @param highOp    Operation used in testing the high range. (LT and LTE)
+ * @return          Estimated number of entries in the range.
+ */
+const long BTreeIndex::estimateRange(const void* lowVal, const Operator lowOp, const void* highVal,
+                                     const Operator highOp)
+{
+    if (lowOp == LT || lowOp == LTE || highOp == GT || highOp == GTE) {
+        throw BadOpcodesException();
+    }
+    EstimateRangeOp op = { this, lowVal, lowOp, highVal, highOp };
+    return dispatch(op);
+}
+
+/**
+ * Entries are taken to be spread evenly over the key range of their bucket, and
+ * a bucket whose keys are all the same holds them at a single point. An inclusive
+ * bound adds the entries per key of the bucket it falls in.
+ */
+const long BTreeIndex::estimatePositions(const double lowPos, const bool lowInclusive,
+                                         const double highPos, const bool highInclusive) {
+    std::lock_guard<std::mutex> guard(histogramLock);
+    if (histogramEntries == 0) {
+        return 0;
+    }
+    double estimate = 0;
+    for (size_t b = 0; b < histogram.size(); b++) {
+        const HistogramBucket& bucket = histogram[b];
+        if (bucket.upperBound == bucket.lowerBound) {
+            estimate += lowPos < bucket.lowerBound && bucket.lowerBound < highPos ? bucket.entries : 0;
+        } else {
+            double from = std::max(lowPos, bucket.lowerBound);
+            double to = std::min(highPos, bucket.upperBound);
+            estimate += to > from ? bucket.entries * (to - from) / (bucket.upperBound - bucket.lowerBound) : 0;
+        }
+        double perKey = (double) bucket.entries / bucket.distinctKeys;
+        if (lowInclusive && bucket.lowerBound <= lowPos && lowPos <= bucket.upperBound) {
+            estimate += perKey;
+        }
+        if (highInclusive && highPos != lowPos && bucket.lowerBound <= highPos && highPos <= bucket.upperBound) {
+            estimate += perKey;
+        }
+    }
+    // The histogram is as of when it was built; the entries are counted as they change.
+    long entries = numEntries;
+    estimate *= (double) entries / histogramEntries;
+    return std::min(entries, (long) (estimate + 0.5));
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::loadStatistics
+// -----------------------------------------------------------------------------
+const void BTreeIndex::loadStatistics(const IndexMetaInfo* metaInfo) {
+    numEntries = metaInfo->numEntries;
+    numLeaves = metaInfo->numLeaves;
+    histogramPageNum = metaInfo->histogramPageNo;
+    if (histogramPageNum == 0) {
+        return;
+    }
+    Page* page;
+    bufMgr->readPage(file, histogramPageNum, page);
+    HistogramPage* stored = (HistogramPage*) page;
+    histogram.assign(stored->buckets, stored->buckets + stored->numBuckets);
+    histogramEntries = stored->entries;
+    bufMgr->unPinPage(file, histogramPageNum, false);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::saveStatistics
+// -----------------------------------------------------------------------------
+const void BTreeIndex::saveStatistics() {
+    if (histogramChanged) {
+        Page* page;
+        if (histogramPageNum == 0) {
+            bufMgr->allocPage(file, histogramPageNum, page);
+        } else {
+            bufMgr->readPage(file, histogramPageNum, page);
+        }
+        memset((void*) page, 0, Page::SIZE);
+        HistogramPage* stored = (HistogramPage*) page;
+        stored->entries = histogramEntries;
+        stored->numBuckets = (int) histogram.size();
+        std::copy(histogram.begin(), histogram.end(), stored->buckets);
+        bufMgr->unPinPage(file, histogramPageNum, true);
+        histogramChanged = false;
+    }
+    Page* header;
+    bufMgr->readPage(file, headerPageNum, header);
+    IndexMetaInfo* metaInfo = (IndexMetaInfo*) header;
+    metaInfo->numEntries = numEntries;
+    metaInfo->numLeaves = numLeaves;
+    metaInfo->histogramPageNo = histogramPageNum;
+    bufMgr->unPinPage(file, headerPageNum, true);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::countRange
+// -----------------------------------------------------------------------------
+const long BTreeIndex::countRange(const void* lowVal, const Operator lowOp, const void* highVal,
+                                  const Operator highOp)
+{
+    if (lowOp == LT || lowOp == LTE || highOp == GT || highOp == GTE) {
+        throw BadOpcodesException();
+    }
+    CountRangeOp op = { this, lowVal, lowOp, highVal, highOp };
+    return dispatch(op);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::rank
+// -----------------------------------------------------------------------------
+const long BTreeIndex::rank(const void* key)
+{
+    RankOp op = { this, key };
+    return dispatch(op);
+}
+
+/**
+ * A non-leaf adds the counts of the children before the one the key descends
+ * to, the leftmost one that can hold it, or for an inclusive rank the one that
+ * covers it. Without counts every leaf before the key is read in full, counting
+ * as an open cursor while it moves on to a sibling.
+ */
+template <class T, class L>
+const long BTreeIndex::rankTyped(const T& key, const bool inclusive) {
+    if (latches != nullptr) {
+        rootLatch.lockShared();
+    }
+    PageId currNum = rootPageNum;
+    bool isLeaf = currNum == firstRootNum;
+    latchPage(currNum, false);
+    if (latches != nullptr) {
+        rootLatch.unlock();
+    }
+    long rank = 0;
+    Page* currPage;
+    readNode(currNum, currPage, isLeaf);
+    while (!isLeaf) {
+        NonLeafNode<T>* curr = (NonLeafNode<T>*) currPage;
+        int i = 0;
+        if (keepsCounts<T>()) {
+            i = inclusive ? childUpperBound(curr, key) : childLowerBound(curr, key);
+            rank += std::accumulate(childCounts(curr), childCounts(curr) + i, 0L);
+        }
+        PageId nextNum = curr->pageNoArray[i];
+        isLeaf = curr->level == 1;
+        latchPage(nextNum, false);
+        unpinNode(currNum, false, false);
+        unlatchPage(currNum);
+        currNum = nextNum;
+        readNode(currNum, currPage, isLeaf);
+    }
+    openCursors++;
+    while (true) {
+        int n = L::size(currPage);
+        int below = inclusive ? L::upperBound(currPage, key) : L::lowerBound(currPage, key);
+        rank += below;
+        PageId nextNum = below == n && !countedNodes ? L::rightSib(currPage) : 0;
+        bufMgr->unPinPage(file, currNum, false);
+        unlatchPage(currNum);
+        if (nextNum == 0) {
+            break;
+        }
+        currNum = nextNum;
+        latchPage(currNum, false);
+        bufMgr->readPage(file, currNum, currPage);
+    }
+    openCursors--;
+    return rank;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::select
+// -----------------------------------------------------------------------------
+const bool BTreeIndex::select(const long position, RecordId& outRid)
+{
+    if (position < 0) {
+        return false;
+    }
+    SelectOp op = { this, position, outRid };
+    return dispatch(op);
+}
+
+/**
+ * A non-leaf skips the children whose counts add up to no more than what is
+ * left of the position. Without counts the leaves are skipped one at a time.
+ */
+template <class T, class L>
+const bool BTreeIndex::selectTyped(const long position, RecordId& outRid) {
+    if (latches != nullptr) {
+        rootLatch.lockShared();
+    }
+    PageId currNum = rootPageNum;
+    bool isLeaf = currNum == firstRootNum;
+    latchPage(currNum, false);
+    if (latches != nullptr) {
+        rootLatch.unlock();
+    }
+    long rest = position;
+    Page* currPage;
+    readNode(currNum, currPage, isLeaf);
+    while (!isLeaf) {
+        NonLeafNode<T>* curr = (NonLeafNode<T>*) currPage;
+        int i = 0;
+        if (keepsCounts<T>()) {
+            const long* counts = childCounts(curr);
+            while (i < curr->numKeys && rest >= counts[i]) {
+                rest -= counts[i];
+                i++;
+            }
+        }
+        PageId nextNum = curr->pageNoArray[i];
+        isLeaf = curr->level == 1;
+        latchPage(nextNum, false);
+        unpinNode(currNum, false, false);
+        unlatchPage(currNum);
+        currNum = nextNum;
+        readNode(currNum, currPage, isLeaf);
+    }
+    openCursors++;
+    while (true) {
+        int n = L::size(currPage);
+        bool found = rest < n;
+        if (found) {
+            outRid = L::rid(currPage, (int) rest);
+        }
+        rest -= n;
+        PageId nextNum = found || countedNodes ? 0 : L::rightSib(currPage);
+        bufMgr->unPinPage(file, currNum, false);
+        unlatchPage(currNum);
+        if (nextNum == 0) {
+            openCursors--;
+            return found;
+        }
+        currNum = nextNum;
+        latchPage(currNum, false);
+        bufMgr->readPage(file, currNum, currPage);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// IndexScanCursor::IndexScanCursor -- Constructor
+// -----------------------------------------------------------------------------
+/**
+ * Creates an idle cursor over an index.
+ * @param index     The index to scan.
+ */
+IndexScanCursor::IndexScanCursor(BTreeIndex* index)
+    : index(index), scanExecuting(false), nextEntry(0), currentPageNum(0), runEnd(0),
+      runStart(0), lastRun(true), descending(false), readingAhead(false), readAheadNum(0),
+      leavesReadAhead(0), leavesCopied(0)
+{
+}
+
+// -----------------------------------------------------------------------------
+// IndexScanCursor::~IndexScanCursor -- destructor
+// -----------------------------------------------------------------------------
+/**
+ * The cursor holds no pages between calls, so it only has to stop its read-ahead
+ * and stop counting as open.
+ */
+IndexScanCursor::~IndexScanCursor()
+{
+    stopReadAhead();
+    if (scanExecuting) {
+        index->openCursors--;
+    }
+    scanExecuting = false;
+}
+
+// -----------------------------------------------------------------------------
+// IndexScanCursor::scanLowVal / scanHighVal
+// -----------------------------------------------------------------------------
+/**
+ * Typed access to the bounds of the running scan.
+ */
+template <>
+int& IndexScanCursor::scanLowVal<int>() { return lowValInt; }
+
+template <>
+int& IndexScanCursor::scanHighVal<int>() { return highValInt; }
+
+template <>
+double& IndexScanCursor::scanLowVal<double>() { return lowValDouble; }
+
+template <>
+double& IndexScanCursor::scanHighVal<double>() { return highValDouble; }
+
+template <>
+StringKey& IndexScanCursor::scanLowVal<StringKey>() { return lowValString; }
+
+template <>
+StringKey& IndexScanCursor::scanHighVal<StringKey>() { return highValString; }
+
+template <>
+IntPairKey& IndexScanCursor::scanLowVal<IntPairKey>() { return lowValIntPair; }
+
+template <>
+IntPairKey& IndexScanCursor::scanHighVal<IntPairKey>() { return highValIntPair; }
+
+template <>
+IntDoubleKey& IndexScanCursor::scanLowVal<IntDoubleKey>() { return lowValIntDouble; }
+
+template <>
+IntDoubleKey& IndexScanCursor::scanHighVal<IntDoubleKey>() { return highValIntDouble; }
+
+template <>
+CompositeKey& IndexScanCursor::scanLowVal<CompositeKey>() { return lowValComposite; }
+
+template <>
+CompositeKey& IndexScanCursor::scanHighVal<CompositeKey>() { return highValComposite; }
+
+template <>
+VarStringKey& IndexScanCursor::scanLowVal<VarStringKey>() { return lowValVarString; }
+
+template <>
+VarStringKey& IndexScanCursor::scanHighVal<VarStringKey>() { return highValVarString; }
+
+// -----------------------------------------------------------------------------
+// IndexScanCursor::startScan
+// -----------------------------------------------------------------------------
+/**
+ * This method scans through the index for values indicated by the search
+ * criteria. It is a prefix scan over every attribute of the key.
+ * @param lowValParm    The low value to be tested.
+ * @param lowOpParm     Operation used in testing the low range. (GT and GTE)
+ * @param highValParm   The high value to be tested.
+ * @param highOpParm    Operation used in testing the high range. (LT and LTE)
+ * @param order         Whether the scan runs up or down the range.
+ * @throws BadScanrangeException    If the values passed in are invalid according
+ *                                  to the tests here, error.
+ * @throws BadOpCodesException      If the opcodes sent in are invalid, error.
+ * @throws NoSuchKeyException       If the search does not yield any values, error.
+ */
+const void IndexScanCursor::startScan(const void* lowValParm,
+				                      const Operator lowOpParm,
+				                      const void* highValParm,
+				                      const Operator highOpParm,
+				                      const ScanOrder order)
+{
+    startPrefixScan(lowValParm, lowOpParm, highValParm, highOpParm, std::max(1, index->numKeyAttributes), order);
+}
+
+// -----------------------------------------------------------------------------
+// IndexScanCursor::startPrefixScan
+// -----------------------------------------------------------------------------
+/**
+ * First, if a scan is already executing, it is ended. Once that is done, the
+ * operators and the number of columns are checked and the typed scan is started
+ * for the key type of the index.
+ * @param lowValParm    The low value to be tested.
+ * @param lowOpParm     Operation used in testing the low range. (GT and GTE)
+ * @param highValParm   The high value to be tested.
+ * @param highOpParm    Operation used in testing the high range. (LT and LTE)
+ * @param numColumns    Number of leading key attributes the values give.
+ * @param order         Whether the scan runs up or down the range.
+ * @throws BadScanrangeException    If the values passed in are invalid according
+ *                                  to the tests here, or numColumns is out of range.
+ * @throws BadOpCodesException      If the opcodes sent in are invalid, error.
+ * @throws NoSuchKeyException       If the search does not yield any values, error.
+ */
+const void IndexScanCursor::startPrefixScan(const void* lowValParm,
+				                            const Operator lowOpParm,
+				                            const void* highValParm,
+				                            const Operator highOpParm,
+				                            const int numColumns,
+				                            const ScanOrder order)
+{
+    // End the previous scan before starting a new one
+    if (scanExecuting == true) {
+        endScan();
+    }
+    lowOp = lowOpParm;
+    highOp = highOpParm;
+    descending = order == DESCENDING;
+    // Incorrect parameters, throw an exception
+    if (lowOpParm == LT || lowOpParm == LTE || highOpParm == GT || highOpParm == GTE) {
+        throw BadOpcodesException();
+    }
+    if (numColumns < 1 || numColumns > std::max(1, index->numKeyAttributes)) {
+        throw BadScanrangeException();
+    }
+    // Count the cursor as open before it copies its first leaf, so that no delete
+    // merges leaves under it from then on.
+    index->openCursors++;
+    try
+    {
+        BTreeIndex::StartScanOp op = { *this, lowValParm, highValParm, numColumns };
+        index->dispatch(op);
+    }
+    catch(...)
+    {
+        index->openCursors--;
+        throw;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// IndexScanCursor::scanNext
+// -----------------------------------------------------------------------------
+/**
+ * This method retrieves the record id of the next tuple matching the scan criteria.
+ * If the page has been scanned, move onto its sibling (if one exists).
+ * @param outRid    Record id of the next entry that matches the scan filter
+ *                  set in startScan.
+ * @throws IndexScanCompletedException  If there are no more records to go through,
+ *                                      then this exception is thrown.
+ * @throws ScanNotInitializedException  If a scan is not currently in progress, error.
+ */
+const void IndexScanCursor::scanNext(RecordId& outRid)
+{
+    scanNext(outRid, nullptr);
+}
+
+/**
+ * Like scanNext(outRid), and also copies the included attributes of a covering
+ * index into outPayload, so the query can be answered without the record.
+ * @param outRid        Record id of the next entry that matches the scan filter.
+ * @param outPayload    Buffer for payloadSize() bytes, or null.
+ */
+const void IndexScanCursor::scanNext(RecordId& outRid, void* outPayload)
+{
+    // Check to see if the scanning variable has been set. If not, throw an error.
+    if (scanExecuting == false) {
+        throw ScanNotInitializedException();
+    }
+    BTreeIndex::ScanNextOp op = { *this, outRid, (char*) outPayload };
+    index->dispatch(op);
+}
+
+// -----------------------------------------------------------------------------
+// IndexScanCursor::scanNextBatch
+// -----------------------------------------------------------------------------
+/**
+ * This method copies the record ids of the next entries matching the scan criteria
+ * into the caller's buffer, moving on to sibling leaves as needed.
+ * @param outRids   Buffer for at least maxRids record ids.
+ * @param maxRids   Most record ids to return.
+ * @return          Number of record ids returned, 0 once the scan is complete.
+ * @throws ScanNotInitializedException  If a scan is not currently in progress, error.
+ */
+const int IndexScanCursor::scanNextBatch(RecordId* outRids, const int maxRids)
+{
+    return scanNextBatch(outRids, nullptr, maxRids);
+}
+
+/**
+ * Like scanNextBatch(outRids, maxRids), and also copies the payload of each entry
+ * returned, one after the other, into outPayloads.
+ * @param outRids       Buffer for at least maxRids record ids.
+ * @param outPayloads   Buffer for maxRids payloads of payloadSize() bytes, or null.
+ * @param maxRids       Most record ids to return.
+ * @return              Number of entries returned, 0 once the scan is complete.
+ */
+const int IndexScanCursor::scanNextBatch(RecordId* outRids, void* outPayloads, const int maxRids)
+{
+    if (scanExecuting == false) {
+        throw ScanNotInitializedException();
+    }
+    BTreeIndex::ScanNextBatchOp op = { *this, outRids, (char*) outPayloads, maxRids };
+    return index->dispatch(op);
+}
+
+// -----------------------------------------------------------------------------
+// IndexScanCursor::endScan
+// -----------------------------------------------------------------------------
+/**
+ * This method sets the scan variable to false so scanning halts. The leaf copy
+ * is simply dropped; no page is pinned between calls.
+ */
+const void IndexScanCursor::endScan()
+{
+    // Throw an error if endScan() has been called when a scan is not in progress.
+    if (scanExecuting == false) {
+        throw ScanNotInitializedException();
+    }
+    // The prefetch thread follows sibling links, so it is done with the cursor
+    // before the cursor stops counting as open.
+    stopReadAhead();
+    // End the scan by setting the variable to false.
+    scanExecuting = false;
+    index->openCursors--;
+}
+
+// -----------------------------------------------------------------------------
+// IndexScanCursor::stopReadAhead
+// -----------------------------------------------------------------------------
+/**
+ * Once out of the queue the cursor is not picked again, but a leaf the prefetch
+ * thread already started reading for it still refers to it.
+ */
+const void IndexScanCursor::stopReadAhead()
+{
+    if (!readingAhead) {
+        return;
+    }
+    std::unique_lock<std::mutex> guard(index->prefetchLock);
+    std::vector<IndexScanCursor*>& queue = index->prefetchQueue;
+    queue.erase(std::find(queue.begin(), queue.end(), this));
+    while (index->prefetching == this) {
+        index->prefetchDone.wait(guard);
+    }
+    readingAhead = false;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::startScanTyped
+// -----------------------------------------------------------------------------
+/**
+ * The scan initializes at the root and binary searches each level for the leftmost
+ * child that can hold the low value. In the leaf, the first entry past the low bound
+ * is found the same way; if the leaf has no such entry the scan moves on to the
+ * right sibling. A descending scan mirrors this from the high value: it takes the
+ * rightmost child that can hold keys below the high bound, and moves on to the
+ * left sibling while the leaf has none.
+ * @param cursor    The cursor to position.
+ * @param lowVal    The low value of the range.
+ * @param highVal   The high value of the range.
+ * @throws BadScanrangeException    If lowVal is greater than highVal.
+ * @throws NoSuchKeyException       If the search does not yield any values, error.
+ */
+template <class T, class L>
+const void BTreeIndex::startScanTyped(IndexScanCursor& cursor, const T& lowVal, const T& highVal)
+{
+    // Incorrect parameters, throw an exception
+    if (KeyTraits<T>::compare(lowVal, highVal) > 0) {
+        throw BadScanrangeException();
+    }
+    cursor.scanLowVal<T>() = lowVal;
+    cursor.scanHighVal<T>() = highVal;
+    // Read the root into the buffer. In concurrent mode each node is latched shared
+    // before its parent is let go.
+    if (latches != nullptr) {
+        rootLatch.lockShared();
+    }
+    PageId currNum = rootPageNum;
+    bool rootIsLeaf = firstRootNum == currNum;
+    latchPage(currNum, false);
+    if (latches != nullptr) {
+        rootLatch.unlock();
+    }
+    Page* currPage;
+//    cout << "StartScan(): reading in page" << endl;
+    readNode(currNum, currPage, rootIsLeaf);
+//    cout << "StartScan(): page read successfully" << endl;
+    // If the current rootPage is not the first initialized rootpage, the root is
+    // a non-leaf and we descend until we reach the level above the leaves.
+    if (!rootIsLeaf) {
+        int found = 0;
+        while (found == 0) {
+            NonLeafNode<T>* curr = (NonLeafNode<T>*) currPage;
+            // Children of this node are leaves
+            if (curr->level == 1) {
+                found = 1;
+            }
+            // Leftmost child that may hold keys equal to lowVal, or for a descending scan
+            // the rightmost one that may hold keys below the high bound.
+            int i;
+            if (!cursor.descending) {
+                i = childLowerBound(curr, lowVal);
+            } else if (cursor.highOp == LT) {
+                i = childLowerBound(curr, highVal);
+            } else {
+                i = childUpperBound(curr, highVal);
+            }
+            PageId nextId = curr->pageNoArray[i];
+            // Free buffer
+            latchPage(nextId, false);
+            unpinNode(currNum, false, false);
+            unlatchPage(currNum);
+            currNum = nextId;
+            readNode(currNum, currPage, found == 1);
+        }
+    }
+    copyLeaf(cursor, currNum, currPage);
+    const Page* curr = &cursor.currentPageData;
+    int i;
+    if (cursor.descending) {
+        // Find the last entry below the high bound, moving left while the leaf has none.
+        while (true) {
+            if (cursor.highOp == LT) {
+                i = L::lowerBound(curr, highVal) - 1;
+            } else {
+                i = L::upperBound(curr, highVal) - 1;
+            }
+            if (i >= 0) {
+                break;
+            }
+            if (L::leftSib(curr) == 0) {
+                throw NoSuchKeyFoundException();
+            }
+            copyLeftSib<T, L>(cursor);
+        }
+        if (keyOpCodes<T>(lowVal, cursor.lowOp, highVal, cursor.highOp, L::key(curr, i)) == 0) {
+            throw NoSuchKeyFoundException();
+        }
+        cursor.scanExecuting = true;
+        cursor.nextEntry = i;
+        findRunStart<T, L>(cursor);
+        if (readAheadLeaves > 0 && !cursor.lastRun) {
+            startReadAhead<T, L>(cursor, L::leftSib(curr));
+        }
+        return;
+    }
+    // Find the first entry past the low bound, moving right while the leaf has none.
+    while (true) {
+        if (cursor.lowOp == GT) {
+            i = L::upperBound(curr, lowVal);
+        } else {
+            i = L::lowerBound(curr, lowVal);
+        }
+        if (i < L::size(curr)) {
+            break;
+        }
+        // If there is no next leaf, error.
+        if (L::rightSib(curr) == 0) {
+            throw NoSuchKeyFoundException();
+        }
+        // Check the next page
+        currNum = L::rightSib(curr);
+        latchPage(currNum, false);
+        bufMgr->readPage(file, currNum, currPage);
+        copyLeaf(cursor, currNum, currPage);
+    }
+    // The first candidate must also satisfy the high bound.
+    if (keyOpCodes<T>(lowVal, cursor.lowOp, highVal, cursor.highOp, L::key(curr, i)) == 0) {
+        throw NoSuchKeyFoundException();
+    }
+    // Set scan to true
+    cursor.scanExecuting = true;
+    // Next entry indexed at i
+    cursor.nextEntry = i;
+    findRunEnd<T, L>(cursor);
+    // Read ahead if the range goes on past this leaf.
+    if (readAheadLeaves > 0 && !cursor.lastRun) {
+        startReadAhead<T, L>(cursor, L::rightSib(curr));
+    }
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::startReadAhead
+// -----------------------------------------------------------------------------
+/**
+ * The prefetch thread is started here rather than with the index, so that it is
+ * only ever started for the key type and leaf layout the index has.
+ * @param cursor    The cursor to read ahead for.
+ * @param firstNum  Page number of the leaf after the one the scan started on.
+ */
+template <class T, class L>
+const void BTreeIndex::startReadAhead(IndexScanCursor& cursor, PageId firstNum)
+{
+    std::lock_guard<std::mutex> guard(prefetchLock);
+    if (!prefetchThread.joinable()) {
+        prefetchThread = std::thread(&BTreeIndex::prefetchLeaves<T, L>, this);
+    }
+    cursor.leavesCopied = 0;
+    cursor.leavesReadAhead = 0;
+    cursor.readAheadNum = firstNum;
+    cursor.readingAhead = true;
+    prefetchQueue.push_back(&cursor);
+    prefetchWake.notify_one();
+}
 
-        // Name the index file accordingly.
-        std::ostringstream idxStr;
-        idxStr << relationName << "." << attrByteOffset;
-        outIndexName = idxStr.str();
+// -----------------------------------------------------------------------------
+// BTreeIndex::prefetchLeaves
+// -----------------------------------------------------------------------------
+/**
+ * Each leaf is latched shared and pinned only while its sibling and last key in the
+ * direction of the scan are read, and no leaf is freed while a cursor is open, so
+ * the links followed stay valid. A left link that went stale in a split only makes
+ * it read a leaf early. The queue lock is let go during the read, so cursors can
+ * join, move on and leave meanwhile; a cursor leaving waits for a leaf being read
+ * for it.
+ */
+template <class T, class L>
+const void BTreeIndex::prefetchLeaves()
+{
+    std::unique_lock<std::mutex> guard(prefetchLock);
+    size_t next = 0;
+    while (!prefetchStop) {
+        // Pick the first cursor from where the last one served left off that has a
+        // leaf left to read and is not far enough ahead.
+        IndexScanCursor* cursor = nullptr;
+        for (size_t i = 0; i < prefetchQueue.size() && cursor == nullptr; i++) {
+            IndexScanCursor* candidate = prefetchQueue[(next + i) % prefetchQueue.size()];
+            if (candidate->readAheadNum != 0
+                && candidate->leavesReadAhead < candidate->leavesCopied.load() + readAheadLeaves) {
+                cursor = candidate;
+                next = next + i + 1;
+            }
+        }
+        if (cursor == nullptr) {
+            prefetchWake.wait(guard);
+            continue;
+        }
+        const T lowVal = cursor->scanLowVal<T>();
+        const T highVal = cursor->scanHighVal<T>();
+        const bool descending = cursor->descending;
+        PageId currNum = cursor->readAheadNum;
+        prefetching = cursor;
+        guard.unlock();
 
-        // Try to see if the file already exists. If it does, then update the
-        // B-Tree's metaInfo.
+        PageId nextNum = 0;
+        Page* currPage;
+        latchPage(currNum, false);
         try
         {
-            file = new BlobFile(outIndexName, false);
-            Page *header;
-            headerPageNum = file->getFirstPageNo();
-//            cout << "Reading the page" << endl;
-            bufMgr->readPage(file, headerPageNum, header);
-//             cout << "Page read successfully" << endl;
-            IndexMetaInfo* metaInfo = (IndexMetaInfo*) header;
-            // Update the rootPageNum to reflect the information stored in the file.
-            rootPageNum = metaInfo->rootPageNo;
-            bufMgr->unPinPage(file, headerPageNum, false);
+            bufMgr->readPage(file, currNum, currPage);
+            int n = L::size(currPage);
+            if (descending) {
+                bool rangeEnds = n > 0 && KeyTraits<T>::compare(L::key(currPage, 0), lowVal) <= 0;
+                nextNum = rangeEnds ? 0 : L::leftSib(currPage);
+            } else {
+                bool rangeEnds = n > 0 && KeyTraits<T>::compare(L::key(currPage, n - 1), highVal) >= 0;
+                nextNum = rangeEnds ? 0 : L::rightSib(currPage);
+            }
+            bufMgr->unPinPage(file, currNum, false);
         }
-        // If the file was not found (or nonexistent), we open a new one and allocate a new
-        // header and root page.
-        catch(FileNotFoundException e)
+        catch(...)
         {
-            file = new BlobFile(outIndexName, true);
-            // Check to see if the blobfile was successfully created.
-//            if (file != nullptr) {
-//                cout << "Successful file allocation" << endl;
-//            }
-            // allocate root and header page
-            Page* header;
-            Page* root;
-//            cout << "Allocating space for header and root pages" << endl;
-            bufMgr->allocPage(file, headerPageNum, header);
-            bufMgr->allocPage(file, rootPageNum, root);
-//            cout << "Space successfully allocated" << endl;
-
-            // Update global var firstRootNum to keep track of the original root
-            // page value and update its sibling.
-            firstRootNum = rootPageNum;
-            LeafNodeInt* rootUpdate = (LeafNodeInt*) root;
-            rootUpdate->rightSibPageNo = 0;
-
-            // Update meta information for the newly created file.
-            IndexMetaInfo* metaInfo = (IndexMetaInfo*) header;
-            strncpy((char*)(&(metaInfo->relationName)), relationName.c_str(), relationName.length());
-            // Make sure copy was successful.
-//            cout << relationName.c_str() << endl;
-//            cout << metaInfo->relationName << endl;
-            metaInfo->attrByteOffset = attrByteOffset;
-            metaInfo->attrType = attrType;
-            metaInfo->rootPageNo = rootPageNum;
-
-            // Unpin the header and root pages to free up space before the scan.
-            bufMgr->unPinPage(file, headerPageNum, true);
-            bufMgr->unPinPage(file, rootPageNum, true);
-
-            // Fill the newly created blobfile using filescan.
-            FileScan fileScan(relationName, bufMgr);
-            RecordId rid;
-            try
-            {
-                while(1)
-                {
-                    fileScan.scanNext(rid);
-                    std::string record = fileScan.getRecord();
-                    insertEntry(record.c_str() + attrByteOffset, rid);
-                }
-            }
-            catch(EndOfFileException e)
-            {
-                // save Btree index file to disk
-                bufMgr->flushFile(file);
-            }
+            // Out of buffer frames; the cursor reads the rest of its leaves itself.
         }
-}
+        unlatchPage(currNum);
 
+        guard.lock();
+        cursor->readAheadNum = nextNum;
+        cursor->leavesReadAhead++;
+        prefetching = nullptr;
+        prefetchDone.notify_all();
+    }
+}
 
 // -----------------------------------------------------------------------------
-// BTreeIndex::~BTreeIndex -- destructor
+// BTreeIndex::copyLeaf
 // -----------------------------------------------------------------------------
 /**
- * This destructor method flushes the B-Tree index file and unpins any pages
- * associated with it. It also sets the global scanning variable to false so
- * other methods don't try to keep populating a blobfile that doesn't exist.
+ * Copies a leaf into the cursor, then unlatches and unpins it. The cursor follows
+ * the right sibling link of its copy, so if the leaf splits afterwards the entries
+ * that move to the new leaf are not seen twice.
+ * @param cursor    The cursor to position on the leaf.
+ * @param leafNum   Page number of the leaf.
+ * @param leaf      The pinned leaf.
  */
-BTreeIndex::~BTreeIndex()
+const void BTreeIndex::copyLeaf(IndexScanCursor& cursor, PageId leafNum, Page* leaf)
 {
-    // Flush the file, deconstruct the file, free the file object.
-    bufMgr->flushFile(file);
-    delete file;
-    file = nullptr;
-//    cout << file->getFirstPageNo() << endl;
-    // End the scan after everything has been freed up
-    scanExecuting = false;
+    memcpy((void*) &cursor.currentPageData, (void*) leaf, Page::SIZE);
+    cursor.currentPageNum = leafNum;
+    bufMgr->unPinPage(file, leafNum, false);
+    unlatchPage(leafNum);
 }
 
 // -----------------------------------------------------------------------------
-// BTreeIndex::insertEntry
+// BTreeIndex::findRunEnd
 // -----------------------------------------------------------------------------
 /**
- * This method inserts a new entry into the index by traversing through the tree
- * to find a leaf to insert the RIDKeyPair <key,rid>. Most of the work is performed
- * by helper methods so that recursive calls can be used to traverse and split the
- * nodes if need be.
- * @param key   Pointer to the integer we want to insert.
- * @param rid   Corresponding record id of the tuple.
+ * Binary searches the cursor's leaf copy for the first key past the high bound.
+ * Every entry from the cursor's position up to it is in range, so the scan only
+ * compares keys once per leaf.
+ * @param cursor    The cursor positioned on a leaf.
  */
-const void BTreeIndex::insertEntry(const void *key, const RecordId rid) {
-    // Create the entry to add to the tree
-    RIDKeyPair<int> data;
-    data.set(rid, *((int*) key));
-    Page* root;
-//    cout << "InsertEntry(): Reading page" << endl;
-    bufMgr->readPage(file, rootPageNum, root);
-//    cout << "InsertEntry(): Page read" << endl;
-    // Create the PageKeyPair object to add to the tree if a split is required.
-    PageKeyPair<int>* child = nullptr;
-    // Check to see if the root has changed since the B-Tree initialization.
-    if (rootPageNum != firstRootNum) {
-        findSpace(root, rootPageNum, data, 0, child);
+template <class T, class L>
+const void BTreeIndex::findRunEnd(IndexScanCursor& cursor)
+{
+    const Page* curr = &cursor.currentPageData;
+    if (cursor.highOp == LT) {
+        cursor.runEnd = L::lowerBound(curr, cursor.scanHighVal<T>());
     } else {
-        findSpace(root, rootPageNum, data, 1, child);
+        cursor.runEnd = L::upperBound(curr, cursor.scanHighVal<T>());
     }
+    cursor.lastRun = cursor.runEnd < L::size(curr) || L::rightSib(curr) == 0;
 }
 
 // -----------------------------------------------------------------------------
-// BTreeIndex::findSpace
+// BTreeIndex::findRunStart
 // -----------------------------------------------------------------------------
 /**
- * This method attempts to find space in the file to insert values by utilizing
- * recursive calls to search through the nodes in the tree.
- * @param curr      The current page being searched through.
- * @param currNum   The pageid of the current page being searched through.
- * @param data      The entry to be inserted into the tree.
- * @param level     The value indicating whether or not a node is a branch or a leaf.
- * @param child     Placeholder for an entry that needs to be propogated up the
- *                  tree. Only utilized when splitting a node.
+ * Binary searches the cursor's leaf copy for the first key past the low bound,
+ * the mirror of findRunEnd for descending scans.
+ * @param cursor    The cursor positioned on a leaf.
  */
-const void BTreeIndex::findSpace(Page* currPage, PageId currNum, RIDKeyPair<int> data,
-                                 int level, PageKeyPair<int>* &child) {
-    // If the current node is a leaf, then add the entry
-    if (level == 1) {
-        LeafNodeInt *leaf = (LeafNodeInt *) currPage;
-        // If the leaf node has room, add the data.
-        if (leaf->ridArray[leafOccupancy - 1].page_number == 0) {
-            addToLeaf(leaf, data);
-            bufMgr->unPinPage(file, currNum, true);
-            child = nullptr;
-        } else {
-            leafSplit(child, leaf, currNum, data);
-        }
-    // Else, propogate down to the right place to insert the node
+template <class T, class L>
+const void BTreeIndex::findRunStart(IndexScanCursor& cursor)
+{
+    const Page* curr = &cursor.currentPageData;
+    if (cursor.lowOp == GT) {
+        cursor.runStart = L::upperBound(curr, cursor.scanLowVal<T>());
     } else {
-        NonLeafNodeInt *curr = (NonLeafNodeInt *)currPage;
-        Page *next;
-        // Find the right location in the current branch node to insert the key.
-        int i = nodeOccupancy;
-        // While the pages are uninitialized..
-        while(i >= 0 && (curr->pageNoArray[i] == 0))
-        {
-            i--;
-        }
-        // While the key is less than the keys already inserted..
-        while(i > 0 && (curr->keyArray[i-1] > data.key))
-        {
-            i--;
-        }
-        // The next node to check
-        PageId nextNum = curr->pageNoArray[i];
-//        cout << "FindSpace(): Reading page." << endl;
-        bufMgr->readPage(file, nextNum, next);
-//        cout << "FindSpace(): Read successful." << endl;
-        // If the current node is not a leaf node
-        if (curr->level != 1) {
-            findSpace(next, nextNum, data, 0, child);
-        // If the current node is a leaf node
-        } else {
-            findSpace(next, nextNum, data, 1, child);
-        }
-        // If the child is non-null, add the entry to a branch node.
-        if (child != nullptr) {
-            // Check to see if we can insert the key into this node.
-            if (curr->pageNoArray[nodeOccupancy] == 0) {
-                addToBranch(curr, child);
-                // Free the pointer after adding the data.
-                child = nullptr;
-                bufMgr->unPinPage(file, currNum, true);
-            // Split is required because of full node.
-            } else {
-                branchSplit(child, curr, currNum);
-            }
-        // Free the page because the data has been added.
-        } else {
-            bufMgr->unPinPage(file, currNum, false);
-        }
+        cursor.runStart = L::lowerBound(curr, cursor.scanLowVal<T>());
     }
+    cursor.lastRun = cursor.runStart > 0 || L::leftSib(curr) == 0;
 }
 
 // -----------------------------------------------------------------------------
-// BTreeIndex::addToBranch
+// BTreeIndex::nextLeaf
 // -----------------------------------------------------------------------------
 /**
- * This method iterates through a branch node structure and finds the right place
- * to enter a new data node.
- * @param branch    The branch to be added to.
- * @param data      The data to add to said branch node.
+ * Copies the right sibling of the cursor's leaf into the cursor and positions it
+ * on the first entry.
+ * @param cursor    The cursor, which must not be on its last run.
  */
-const void BTreeIndex::addToBranch(NonLeafNodeInt* branch, PageKeyPair<int>* data) {
-    int i = nodeOccupancy;  // Index used for iteration through the page number and key arrays.
-    // Go through all of the empty spots in the branch.
-    while ((branch->pageNoArray[i] == 0) && i >= 0) {
-        i--;
-    }
-    // If not at index 0, go ahead and find the right place to insert the data entry,
-    // shifting the other items in the array if needed.
-    while ((data->key < branch->keyArray[i-1]) && i > 0) {
-        branch->pageNoArray[i+1] = branch->pageNoArray[i];
-        branch->keyArray[i] = branch->keyArray[i-1];
-        i--;
-    }
-    // Update branch arrays with the new data
-    branch->pageNoArray[i+1] = data->pageNo;
-    branch->keyArray[i] = data->key;
+template <class T, class L>
+const void BTreeIndex::nextLeaf(IndexScanCursor& cursor)
+{
+    PageId nextId = L::rightSib(&cursor.currentPageData);
+    Page* next;
+    latchPage(nextId, false);
+//            cout << "scanNext(): Reading in page." << endl;
+    bufMgr->readPage(file, nextId, next);
+//            cout << "scanNext(): Page read successfully." << endl;
+    copyLeaf(cursor, nextId, next);
+    cursor.nextEntry = 0;
+    findRunEnd<T, L>(cursor);
+    leafCopied(cursor);
 }
 
 // -----------------------------------------------------------------------------
-// BTreeIndex::addToLeaf
+// BTreeIndex::copyLeftSib
 // -----------------------------------------------------------------------------
 /**
- * This method iterates through a leaf node structure and finds the right place to
- * insert the data read from the file.
- * @param leaf      The leaf node to be added to.
- * @param data      The data to add to said leaf node.
+ * Copies the leaf before the cursor's leaf into the cursor. Splits only add
+ * leaves to the right of the leaf they split, and no leaf is freed while the
+ * cursor is open, so the leaf now right before the cursor's is found from the
+ * stale left link by following right links.
+ * @param cursor    The cursor, positioned on a leaf with a left sibling.
  */
-const void BTreeIndex::addToLeaf(LeafNodeInt* leaf, RIDKeyPair<int> data) {
-    // Check to see if the leaf page is empty
-    if (leaf->ridArray[0].page_number != 0) {
-        int i = leafOccupancy - 1;
-        // While the pages are uninitialized..
-        while(i >= 0 && (leaf->ridArray[i].page_number == 0)) {
-            i--;
-        }
-        // While the key is less than the keys already inserted..
-        while(i >= 0 && (leaf->keyArray[i] > data.key)) {
-            leaf->keyArray[i+1] = leaf->keyArray[i];
-            leaf->ridArray[i+1] = leaf->ridArray[i];
-            i--;
-        }
-        // insert entry
-        leaf->keyArray[i+1] = data.key;
-        leaf->ridArray[i+1] = data.rid;
-    } else {
-        leaf->keyArray[0] = data.key;
-        leaf->ridArray[0] = data.rid;
+template <class T, class L>
+const void BTreeIndex::copyLeftSib(IndexScanCursor& cursor)
+{
+    PageId currId = cursor.currentPageNum;
+    PageId prevId = L::leftSib(&cursor.currentPageData);
+    Page* prev;
+    latchPage(prevId, false);
+    bufMgr->readPage(file, prevId, prev);
+    while (L::rightSib(prev) != currId && L::rightSib(prev) != 0) {
+        PageId nextId = L::rightSib(prev);
+        bufMgr->unPinPage(file, prevId, false);
+        unlatchPage(prevId);
+        prevId = nextId;
+        latchPage(prevId, false);
+        bufMgr->readPage(file, prevId, prev);
     }
+    copyLeaf(cursor, prevId, prev);
 }
 
 // -----------------------------------------------------------------------------
-// BTreeIndex::newRoot
+// BTreeIndex::prevLeaf
 // -----------------------------------------------------------------------------
 /**
- * This method updates the root of the B-Tree. In this case, the root needs to be split
- * and entries pushed up the tree.
- * @param firstNode     This is the page number of the first entry of the root.
- * @param child         This is the entry that needs to be propogated upwards
- *                      after the split occurs.
+ * Copies the left sibling of the cursor's leaf into the cursor and positions it
+ * on the last entry.
+ * @param cursor    The cursor, which must not be on its last run.
  */
-const void BTreeIndex::newRoot(PageId firstNode, PageKeyPair<int>* child) {
-    // New root with metadata updates
-    Page* newRoot;
-    PageId newNum;
-//    cout << "newRoot(): Allocating space for a new root page." << endl;
-    bufMgr->allocPage(file, newNum, newRoot);
-//    cout << "newRoot(): Space allocated for new root page." << endl;
-    NonLeafNodeInt* newPage = (NonLeafNodeInt*) newRoot;    // New page allocated for root.
-    if (firstRootNum == rootPageNum) {
-        newPage->level = 1;     // If the root is a leaf
-    } else {
-        newPage->level = 0;
-    }
-    // Update the root page metadata to reflect changes.
-    newPage->keyArray[0] = child->key;
-    newPage->pageNoArray[0] = firstNode;
-    newPage->pageNoArray[1] = child->pageNo;
-    // Update the header page
-    Page* newMetaInfo;
-//    cout << "newRoot(): Reading in page." << endl;
-    bufMgr->readPage(file, headerPageNum, newMetaInfo);
-//    cout << "newRoot(): Page read successful." << endl;
-    IndexMetaInfo* metaInfo = (IndexMetaInfo*) newMetaInfo;
-    metaInfo->rootPageNo = newNum;
-    rootPageNum = newNum;       // Update the global root page variable.
-    // Free pages from buffer so data overflow doesn't occur.
-    bufMgr->unPinPage(file, headerPageNum, true);
-    bufMgr->unPinPage(file, newNum, true);
+template <class T, class L>
+const void BTreeIndex::prevLeaf(IndexScanCursor& cursor)
+{
+    copyLeftSib<T, L>(cursor);
+    cursor.nextEntry = L::size(&cursor.currentPageData) - 1;
+    findRunStart<T, L>(cursor);
+    leafCopied(cursor);
 }
 
 // -----------------------------------------------------------------------------
-// BTreeIndex::branchSplit
+// BTreeIndex::leafCopied
 // -----------------------------------------------------------------------------
 /**
- * This method splits the branch so that the child entry can be entered into the tree.
- * First, a new branch page is allocated memory, then half the array is copied over from
- * the old branch node to the new one. Changes are made to the array to reflect this
- * split.
- * @param child     The entry that will need to be entered after the splitting occurs.
- * @param old       The node that will be split in this function.
- * @param oldNum    PageId that was used to index the node to be split.
+ * Wakes the read-ahead thread once half of the leaves it read ahead are used up,
+ * rather than on every leaf.
+ * @param cursor    The cursor that moved to another leaf.
  */
-const void BTreeIndex::branchSplit(PageKeyPair<int>* &child, NonLeafNodeInt* old,
-                                   PageId oldNum) {
-    Page* newBranch;
-    PageId newNum;
-    PageKeyPair<int> newEntry;  // Keeps track of the entry to be added.
-    bufMgr->allocPage(file, newNum, newBranch);
-    NonLeafNodeInt* node = (NonLeafNodeInt*) newBranch;
-    int split = nodeOccupancy/2;  // Indexes the midpoint of the array to be split at.
-//    cout << "Number of nodes: " << split << endl;
-    int index = split;      // Used to index the current position being propogated.
-    // Even value with 0-based array requires index correction if key
-    // lies in the former half of the array.
-    if (child->key < old->keyArray[split] && nodeOccupancy%2 == 0) {
-        index = split - 1;
-    }
-    newEntry.set(newNum, old->keyArray[index]);
-    split = index + 1;
-    // Copy over half of the node to the new node to reflect split
-    for (int i = split; i < nodeOccupancy; i++) {
-        // Update the page number arrays
-        node->pageNoArray[i-split] = old->pageNoArray[i+1];
-        old->pageNoArray[i+1] = (PageId) 0;
-        // Update the key arrays
-        node->keyArray[i-split] = old->keyArray[i];
-        old->keyArray[i+1] = 0;
-    }
-    // Make sure to change information of the entry being propogated upwards.
-    node->level = old->level;
-    old->pageNoArray[index] = (PageId) 0;
-    old->keyArray[index] = 0;
-
-    // Determine where to put the new data entry.
-    if (child->key < node->keyArray[0]) {
-        addToBranch(old, child);
-    } else {
-        addToBranch(node, child);
+const void BTreeIndex::leafCopied(IndexScanCursor& cursor)
+{
+    if (cursor.readingAhead) {
+        int copied = ++cursor.leavesCopied;
+        if (copied % std::max(1, readAheadLeaves / 2) == 0) {
+            {
+                std::lock_guard<std::mutex> guard(prefetchLock);
+            }
+            prefetchWake.notify_one();
+        }
     }
-    // Unpin the unused pages
-    bufMgr->unPinPage(file, oldNum, true);
-    bufMgr->unPinPage(file, newNum, true);
+}
 
-    child = &newEntry;
-    if (rootPageNum == oldNum) {
-        newRoot(oldNum, child);
+// -----------------------------------------------------------------------------
+// BTreeIndex::scanNextTyped
+// -----------------------------------------------------------------------------
+/**
+ * Reads the next entry of the cursor's leaf as key type T, moving to the right
+ * sibling once the leaf's run is exhausted.
+ * @param cursor        The cursor to advance.
+ * @param outRid        Record id of the next entry that matches the scan filter.
+ * @param outPayload    Buffer for the payload of the entry, or null.
+ * @throws IndexScanCompletedException  If there are no more records to go through.
+ */
+template <class T, class L>
+const void BTreeIndex::scanNextTyped(IndexScanCursor& cursor, RecordId& outRid, char* outPayload)
+{
+    // Move on to the next leaf that has entries once this one is used up.
+    while (cursor.nextEntry >= cursor.runEnd) {
+        // If the range ended in this leaf or there is no next leaf, scan is complete.
+        if (cursor.lastRun) {
+            throw IndexScanCompletedException();
+        }
+        nextLeaf<T, L>(cursor);
+    }
+    outRid = L::rid(&cursor.currentPageData, cursor.nextEntry);
+    if (outPayload != nullptr) {
+        L::copyPayloads(&cursor.currentPageData, cursor.nextEntry, 1, outPayload);
     }
+    cursor.nextEntry++;
+}
 
+// -----------------------------------------------------------------------------
+// BTreeIndex::scanNextBatchTyped
+// -----------------------------------------------------------------------------
+/**
+ * Copies the rest of the current run, then the runs of the following leaves,
+ * until the buffer is full or the range ends.
+ * @param cursor        The cursor to advance.
+ * @param outRids       Buffer for at least maxRids record ids.
+ * @param outPayloads   Buffer for maxRids payloads, or null.
+ * @param maxRids       Most record ids to return.
+ * @return              Number of record ids returned, 0 at the end of the scan.
+ */
+template <class T, class L>
+const int BTreeIndex::scanNextBatchTyped(IndexScanCursor& cursor, RecordId* outRids,
+                                         char* outPayloads, const int maxRids)
+{
+    int count = 0;
+    while (count < maxRids) {
+        if (cursor.nextEntry >= cursor.runEnd) {
+            if (cursor.lastRun) {
+                break;
+            }
+            nextLeaf<T, L>(cursor);
+            continue;
+        }
+        int n = std::min(cursor.runEnd - cursor.nextEntry, maxRids - count);
+        L::copyRids(&cursor.currentPageData, cursor.nextEntry, n, &outRids[count]);
+        if (outPayloads != nullptr) {
+            L::copyPayloads(&cursor.currentPageData, cursor.nextEntry, n,
+                            outPayloads + (size_t) count * payloadBytes);
+        }
+        cursor.nextEntry += n;
+        count += n;
+    }
+    return count;
 }
 
 // -----------------------------------------------------------------------------
-// BTreeIndex::leafSplit
+// BTreeIndex::scanPrevTyped
 // -----------------------------------------------------------------------------
 /**
- * This method splits a leaf so that the child entry can be added into the tree.
- * First, a new leaf node is allocated memory, then half of the old leaf's array
- * is copied over to the new one. Sibling pointers are properly changed and the
- * new data to be entered is added to the correct leaf node. If need be, update
- * the root.
- * @param child     The data that needs to be propogated upwards in the tree.
- * @param old       The old leaf node to be split.
- * @param oldNum    The page number of the old leaf node to be split.
- * @param data      The data entry to be added to the tree.
+ * Reads the next entry of a descending scan, moving to the left sibling once the
+ * leaf's run is exhausted.
+ * @param cursor        The cursor to advance.
+ * @param outRid        Record id of the next entry that matches the scan filter.
+ * @param outPayload    Buffer for the payload of the entry, or null.
+ * @throws IndexScanCompletedException  If there are no more records to go through.
  */
-const void BTreeIndex::leafSplit(PageKeyPair<int>* &child, LeafNodeInt* old, PageId oldNum,
-                                 RIDKeyPair<int> data) {
-    Page* newLeaf;      // Initialize a new leaf node for the split
-    PageId newNum;      // Initialize a new leaf page ID for the split
-//    cout << "leafSplit(): allocating new page" << endl;
-    bufMgr->allocPage(file, newNum, newLeaf);
-//    cout << "leafSplit(): new page allocated" << endl;
-    LeafNodeInt* leafNode = (LeafNodeInt*) newLeaf;
-    int split = leafOccupancy/2;    // Keep track of where to copy data from
-    // If the key is greater than the value at the split, then increment.
-    if (data.key > old->keyArray[split] && leafOccupancy%2 == 1) {
-        split++;
+template <class T, class L>
+const void BTreeIndex::scanPrevTyped(IndexScanCursor& cursor, RecordId& outRid, char* outPayload)
+{
+    while (cursor.nextEntry < cursor.runStart) {
+        if (cursor.lastRun) {
+            throw IndexScanCompletedException();
+        }
+        prevLeaf<T, L>(cursor);
     }
-    // Propogate through and update the arrays after the split
-    for (int i = split; i < leafOccupancy; i++) {
-        // RID array updates
-        leafNode->ridArray[i-split] = old->ridArray[i];
-        old->ridArray[i].page_number = 0;
-        // Key array updates
-        leafNode->keyArray[i-split] = old->keyArray[i];
-        old->keyArray[i] = 0;
-    }
-    // Make sure siblings are properly changed
-    leafNode->rightSibPageNo = old->rightSibPageNo;
-    old->rightSibPageNo = newNum;
-    // Add to the old leaf node if they key is less than the middle value.
-    if (data.key < old->keyArray[split-1]) {
-//      cout << "LeafSplit(): adding to old node" << endl;
-        addToLeaf(old, data);
-    // Else, add it to the newly created leaf node
-    } else {
-//      cout << "LeafSplit(): adding to new node" << endl;
-        addToLeaf(leafNode, data);
+    outRid = L::rid(&cursor.currentPageData, cursor.nextEntry);
+    if (outPayload != nullptr) {
+        L::copyPayloads(&cursor.currentPageData, cursor.nextEntry, 1, outPayload);
     }
-    PageKeyPair<int> newPair;
-    newPair.set(newNum, leafNode->keyArray[0]);
-//    cout << newPair.pageNo << " " << newPair.key << endl;
-    // Update the child pointer with the new data.
-    child = &newPair;
-
-    // Free up the buffer
-    bufMgr->unPinPage(file, oldNum, true);
-    bufMgr->unPinPage(file, newNum, true);
+    cursor.nextEntry--;
+}
 
-    // If the leaf that was split was the root, update the root.
-    if (oldNum == rootPageNum) {
-        newRoot(oldNum, child);
+// -----------------------------------------------------------------------------
+// BTreeIndex::scanPrevBatchTyped
+// -----------------------------------------------------------------------------
+/**
+ * Copies the current run of a descending scan, then the runs of the leaves to
+ * its left, until the buffer is full or the range ends. Each piece of a run is
+ * copied in index order and then reversed in place.
+ * @param cursor        The cursor to advance.
+ * @param outRids       Buffer for at least maxRids record ids.
+ * @param outPayloads   Buffer for maxRids payloads, or null.
+ * @param maxRids       Most record ids to return.
+ * @return              Number of record ids returned, 0 at the end of the scan.
+ */
+template <class T, class L>
+const int BTreeIndex::scanPrevBatchTyped(IndexScanCursor& cursor, RecordId* outRids,
+                                         char* outPayloads, const int maxRids)
+{
+    int count = 0;
+    while (count < maxRids) {
+        if (cursor.nextEntry < cursor.runStart) {
+            if (cursor.lastRun) {
+                break;
+            }
+            prevLeaf<T, L>(cursor);
+            continue;
+        }
+        int n = std::min(cursor.nextEntry - cursor.runStart + 1, maxRids - count);
+        int from = cursor.nextEntry - n + 1;
+        L::copyRids(&cursor.currentPageData, from, n, &outRids[count]);
+        std::reverse(&outRids[count], &outRids[count + n]);
+        if (outPayloads != nullptr) {
+            char* out = outPayloads + (size_t) count * payloadBytes;
+            L::copyPayloads(&cursor.currentPageData, from, n, out);
+            char swap[MAXPAYLOAD];
+            for (int a = 0, b = n - 1; a < b; a++, b--) {
+                memcpy(swap, out + a * payloadBytes, payloadBytes);
+                memcpy(out + a * payloadBytes, out + b * payloadBytes, payloadBytes);
+                memcpy(out + b * payloadBytes, swap, payloadBytes);
+            }
+        }
+        cursor.nextEntry -= n;
+        count += n;
     }
+    return count;
 }
 
 // -----------------------------------------------------------------------------
-// BTreeIndex::startScan
+// BTreeIndex::parallelScanTyped
 // -----------------------------------------------------------------------------
 /**
- * This method scans through the index for values indicated by the search
- * criteria. First, if a scan is already executing, it is ended. Once that
- * is done, the scan initializes at the root and searches through the tree
- * for values that match the search criteria. If the search criteria is valid
- * across multiple pages, then the current page is switched out for another,
- * and that new page is scanned through.
- * @param lowValParm    The low value to be tested.
- * @param lowOpParm     Operation used in testing the low range. (GT and GTE)
- * @param highValParm   The high value to be tested.
- * @param highOpParm    Operation used in testing the high range. (LT and LTE)
- * @throws BadScanrangeException    If the values passed in are invalid according
- *                                  to the tests here, error.
- * @throws BadOpCodesException      If the opcodes sent in are invalid, error.
- * @throws NoSuchKeyException       If the search does not yield any values, error.
+ * Splits the range at separator keys: the first part runs from the low bound up
+ * to the first separator, each following part from its separator (inclusive) up
+ * to the next, and the last part on to the high bound. The parts are ranges of
+ * keys, so duplicates of a separator all fall into the part it starts, whichever
+ * leaves they are in, and a concurrent split or insert cannot make two parts
+ * return the same entry.
+ * @param lowVal        The low value of the range.
+ * @param lowOp         Operation used in testing the low range. (GT and GTE)
+ * @param highVal       The high value of the range.
+ * @param highOp        Operation used in testing the high range. (LT and LTE)
+ * @param numWorkers    Most parts to split the range into.
+ * @param consumer      Receives the entries of each part.
+ * @return              Number of entries scanned.
+ * @throws BadScanrangeException    If lowVal is greater than highVal.
  */
-const void BTreeIndex::startScan(const void* lowValParm,
-				                 const Operator lowOpParm,
-				                 const void* highValParm,
-				                 const Operator highOpParm)
+template <class T, class L>
+const long BTreeIndex::parallelScanTyped(const T& lowVal, const Operator lowOp, const T& highVal,
+                                         const Operator highOp, const int numWorkers,
+                                         const ScanPartConsumer& consumer)
 {
-    // End the previous scan before starting a new one
-    if (scanExecuting == true) {
-        endScan();
-    }
-    // Cast void* parameter to int* and dereference
-    lowValInt = *((int*)lowValParm);
-    lowOp = lowOpParm;
-    highValInt = *((int*)highValParm);
-    highOp = highOpParm;
-    // Checking to see that the pointers are properly dereferenced
-//    cout << "LowValInt = " << lowValInt << endl << "HighValInt = " << highValInt << endl;
-    // Incorrect parameters, throw an exception
-    if (lowValInt > highValInt) {
+    if (KeyTraits<T>::compare(lowVal, highVal) > 0) {
         throw BadScanrangeException();
     }
-    if (lowOpParm == LT || lowOpParm == LTE || highOpParm == GT || highOpParm == GTE) {
-//        cout << "LowOpParm = " << lowOpParm << endl << "HighOpParm = " << highOpParm << endl;
-        throw BadOpcodesException();
+    // Count as an open cursor while the non-leaves are read, so that no delete frees
+    // a node between reading its page number and reading the node.
+    std::vector<T> seps;
+    openCursors++;
+    try
+    {
+        splitRange<T>(lowVal, highVal, numWorkers, seps);
     }
-    // Read the root into the buffer
-    currentPageNum = rootPageNum;
-//    cout << "StartScan(): reading in page" << endl;
-    // Read the root into the buffer
-    bufMgr->readPage(file, currentPageNum, currentPageData);
-//    cout << "StartScan(): page read successfully" << endl;
-    // Check to see if the root is a leaf
-    // If not, find the correct place to put the data
-    int found = 0;
-    // If the current rootPage is not the first initialized rootpage,
-    // find the correct page to put the data into.
-    if (!(firstRootNum == rootPageNum)) {
-        NonLeafNodeInt* curr;
-        while (found == 0) {
-            curr = (NonLeafNodeInt*) currentPageData;
-            // Current node is a leaf
-            if (curr->level == 1) {
-                found = 1;
-            }
-            PageId nextId;      // keeps track of the next page value
-            int i = nodeOccupancy;      // indexing the amount of nodes
-            // While the pages are uninitialized..
-            while ((curr->pageNoArray[i] == 0) && i >= 0) {
-                i--;
+    catch(...)
+    {
+        openCursors--;
+        throw;
+    }
+    openCursors--;
+
+    int parts = (int) seps.size() + 1;
+    std::vector<long> counts(parts, 0);
+    std::vector<std::exception_ptr> errors(parts);
+    std::vector<std::thread> workers;
+    for (int p = 0; p < parts; p++) {
+        workers.push_back(std::thread([&, p]() {
+            try
+            {
+                counts[p] = scanPart<T, L>(p, p == 0 ? lowVal : seps[p - 1], p == 0 ? lowOp : GTE,
+                                           p == parts - 1 ? highVal : seps[p], p == parts - 1 ? highOp : LT,
+                                           consumer);
             }
-            // While the keys are greater than the lowValInt..
-            while ((curr->keyArray[i-1] >= lowValInt) && i > 0) {
-                i--;
+            catch(...)
+            {
+                errors[p] = std::current_exception();
             }
-            // Set the next page id to the correct index found above
-            nextId = curr->pageNoArray[i];
-            // Free buffer
-            bufMgr->unPinPage(file, currentPageNum, false);
-            currentPageNum = nextId;
-            // Free buffer
-            bufMgr->readPage(file, currentPageNum, currentPageData);
-            // Check value of currentPageNum
-//            cout << currentPageNum << endl;
+        }));
+    }
+    long count = 0;
+    for (int p = 0; p < parts; p++) {
+        workers[p].join();
+        count += counts[p];
+    }
+    for (int p = 0; p < parts; p++) {
+        if (errors[p]) {
+            std::rethrow_exception(errors[p]);
         }
-        found = 0;
     }
-    // After the leaf to insert the data is found, propogate through and find the
-    // correct place to index the data.
-    while (found == 0) {
-        // Cast the current page to a leaf node and iterate through
-        LeafNodeInt* curr = (LeafNodeInt*) currentPageData;
-        int i = 0;
-        int insertOK = 0;
-        while (i < leafOccupancy && insertOK == 0) {
-            // Check to see if the next page has not been set and that the
-            // arry is not full
-            if (curr->ridArray[i+1].page_number == 0 && i < leafOccupancy - 1) {
-                insertOK = 1;
-            }
-            int key = curr->keyArray[i];
-            // Check to see if the correct leaf is found
-            if (keyOpCodes(lowValInt, lowOp, highValInt, highOp, key) == 1) {
-                found = 1;
-                // Set scan to true
-                scanExecuting = true;
-                // Next entry indexed at i
-                nextEntry = i;
-                break;
-            }
-            if (insertOK == 1 || i == leafOccupancy - 1) {
-                bufMgr->unPinPage(file, currentPageNum, false);
-                // If the next entry has not been allocated, error.
-                if (curr->rightSibPageNo == 0) {
-                    throw NoSuchKeyFoundException();
+    return count;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::splitRange
+// -----------------------------------------------------------------------------
+/**
+ * Reads the non-leaves over the range a level at a time from the root down. Each
+ * level gives the keys that separate the children over the range; once a level
+ * gives parts - 1 of them, or it is the level above the leaves, the separators are
+ * picked from it. A level that gives fewer has fewer than parts nodes under it
+ * over the range, so no level reads more than parts nodes. Each node is latched
+ * shared only while it is read; the separators are only used as bounds, so a node
+ * that splits meanwhile merely makes the parts less even.
+ * @param lowVal    The low value of the range.
+ * @param highVal   The high value of the range.
+ * @param parts     Most parts wanted.
+ * @param seps      Receives the separators.
+ */
+template <class T>
+const void BTreeIndex::splitRange(const T& lowVal, const T& highVal, const int parts, std::vector<T>& seps)
+{
+    if (latches != nullptr) {
+        rootLatch.lockShared();
+    }
+    PageId rootNum = rootPageNum;
+    bool rootIsLeaf = firstRootNum == rootNum;
+    if (latches != nullptr) {
+        rootLatch.unlock();
+    }
+    if (parts < 2 || rootIsLeaf) {
+        return;
+    }
+    std::vector<PageId> nodes(1, rootNum);
+    std::vector<T> found;
+    while (true) {
+        std::vector<PageId> children;
+        int level = 0;
+        found.clear();
+        for (size_t n = 0; n < nodes.size(); n++) {
+            Page* page;
+            latchPage(nodes[n], false);
+            readNode(nodes[n], page, false);
+            NonLeafNode<T>* node = (NonLeafNode<T>*) page;
+            // Children that may hold keys of the range, and the keys between them.
+            int first = childLowerBound(node, lowVal);
+            int last = childUpperBound(node, highVal);
+            for (int i = first; i <= last; i++) {
+                children.push_back(node->pageNoArray[i]);
+                if (i == last) {
+                    continue;
+                }
+                const T& separator = Separators<T>::key(node, i);
+                if (KeyTraits<T>::compare(separator, lowVal) > 0
+                        && KeyTraits<T>::compare(separator, highVal) < 0
+                        && (found.empty() || KeyTraits<T>::compare(separator, found.back()) > 0)) {
+                    found.push_back(separator);
                 }
-                // Check the next page
-                currentPageNum = curr->rightSibPageNo;
-//                cout << "StartScan(): reading page" << endl;
-                bufMgr->readPage(file, currentPageNum, currentPageData);
-//                cout << "StartScan(): read successful" << endl;
             }
-            i++;
+            level = node->level;
+            unpinNode(nodes[n], false, false);
+            unlatchPage(nodes[n]);
+        }
+        if ((int) found.size() >= parts - 1 || level == 1) {
+            break;
         }
+        nodes.swap(children);
+    }
+    // The separators cut the range into found.size() + 1 pieces; take every
+    // (found.size() + 1) / parts th cut.
+    int cuts = std::min((int) found.size(), parts - 1);
+    for (int c = 1; c <= cuts; c++) {
+        seps.push_back(found[(size_t) c * (found.size() + 1) / (cuts + 1) - 1]);
     }
 }
 
 // -----------------------------------------------------------------------------
-// BTreeIndex::scanNext
+// BTreeIndex::scanPart
 // -----------------------------------------------------------------------------
 /**
- * This method retrieves the record id of the next tuple matching the scan criteria.
- * If the page has been scanned, move onto its sibling (if one exists).
- * @param outRid    Record id of the next entry that matches the scan filter
- *                  set in startScan.
- * @throws IndexScanCompletedException  If there are no more records to go through,
- *                                      then this exception is thrown.
- * @throws ScanNotInitializedException  If a scan is not currently in progress, error.
+ * Starts a cursor on the part like IndexScanCursor::startScan, and hands the
+ * entries to the consumer PARTBATCH at a time. A part with no entries is not an
+ * error. The cursor ends its scan as it goes out of scope, also when the
+ * consumer throws.
+ * @param part      Number of the part.
+ * @param lowVal    The low value of the part.
+ * @param lowOp     Operation used in testing the low range. (GT and GTE)
+ * @param highVal   The high value of the part.
+ * @param highOp    Operation used in testing the high range. (LT and LTE)
+ * @param consumer  Receives the entries.
+ * @return          Number of entries scanned.
  */
-const void BTreeIndex::scanNext(RecordId& outRid)
+template <class T, class L>
+const long BTreeIndex::scanPart(const int part, const T& lowVal, const Operator lowOp, const T& highVal,
+                                const Operator highOp, const ScanPartConsumer& consumer)
 {
-    // Check to see if the global scanning variable has been set. If not, throw an
-    // error.
-    if (scanExecuting == false) {
-        throw ScanNotInitializedException();
+    IndexScanCursor cursor(this);
+    cursor.lowOp = lowOp;
+    cursor.highOp = highOp;
+    openCursors++;
+    try
+    {
+        startScanTyped<T, L>(cursor, lowVal, highVal);
     }
-    LeafNodeInt* curr = (LeafNodeInt*) currentPageData;
-    // Check to see if the page is valid, then read through the page
-    if (nextEntry == leafOccupancy || curr->ridArray[nextEntry].page_number == 0) {
-        bufMgr->unPinPage(file, currentPageNum, false);
-        // Next leaf is non-null
-        if (curr->rightSibPageNo != 0) {
-            currentPageNum = curr->rightSibPageNo;
-//            cout << "scanNext(): Reading in page." << endl;
-            bufMgr->readPage(file, currentPageNum, currentPageData);
-//            cout << "scanNext(): Page read successfully." << endl;
-            curr = (LeafNodeInt*) currentPageData;
-            nextEntry = 0;
-        // Else, if the node is null (no next node), scan is complete.
-        } else {
-            throw IndexScanCompletedException();
-        }
+    catch(const NoSuchKeyFoundException&)
+    {
+        openCursors--;
+        return 0;
     }
-    // Initialize the key to the next entry in the array
-    int key = curr->keyArray[nextEntry];
-    // See if the entry is valid. If so, increment.
-    if (keyOpCodes(lowValInt, lowOp, highValInt, highOp, key) == 1) {
-        outRid = curr->ridArray[nextEntry];
-        nextEntry++;
-    // Invalid entry, then index scan has been completed.
-    } else {
-        throw IndexScanCompletedException();
+    catch(...)
+    {
+        openCursors--;
+        throw;
     }
+    std::vector<RecordId> rids(PARTBATCH);
+    std::vector<char> payloads((size_t) PARTBATCH * payloadBytes);
+    char* outPayloads = payloadBytes > 0 ? &payloads[0] : nullptr;
+    long count = 0;
+    int n;
+    while ((n = scanNextBatchTyped<T, L>(cursor, &rids[0], outPayloads, PARTBATCH)) > 0) {
+        consumer(part, &rids[0], outPayloads, n);
+        count += n;
+    }
+    cursor.endScan();
+    return count;
 }
 
 // -----------------------------------------------------------------------------
@@ -661,30 +5986,33 @@ const void BTreeIndex::scanNext(RecordId& outRid)
  * @param highOp    Operation used in testing the high range. (LT and LTE)
  * @param key       The key to check the operations against.
  * @return          Returns 1 if the key lies within the parameters of lowOp
- *                  and highOp, else 1.
+ *                  and highOp, else 0.
  */
-const int BTreeIndex::keyOpCodes(int lowVal, const Operator lowOp, int highVal,
-                                const Operator highOp, int key) {
+template <class T>
+const int BTreeIndex::keyOpCodes(const T& lowVal, const Operator lowOp, const T& highVal,
+                                const Operator highOp, const T& key) {
+    int lowCmp = KeyTraits<T>::compare(key, lowVal);
+    int highCmp = KeyTraits<T>::compare(key, highVal);
     if(lowOp == GT && highOp == LT) {
-        if (key < highVal && key > lowVal) {
+        if (highCmp < 0 && lowCmp > 0) {
             return 1;
         } else {
             return 0;
         }
     } else if(lowOp == GTE && highOp == LT) {
-        if(key < highVal && key >= lowVal) {
+        if(highCmp < 0 && lowCmp >= 0) {
             return 1;
         } else {
             return 0;
         }
     } else if(lowOp == GT && highOp == LTE) {
-        if (key <= highVal && key > lowVal) {
+        if (highCmp <= 0 && lowCmp > 0) {
             return 1;
         } else {
             return 0;
         }
     } else {
-        if(key <= highVal && key >= lowVal) {
+        if(highCmp <= 0 && lowCmp >= 0) {
             return 1;
         } else {
             return 0;
@@ -692,27 +6020,4 @@ const int BTreeIndex::keyOpCodes(int lowVal, const Operator lowOp, int highVal,
     }
 }
 
-// -----------------------------------------------------------------------------
-// BTreeIndex::endScan
-// -----------------------------------------------------------------------------
-/**
- * This method sets the global scan variable to false so scanning halts, then
- * proceeds to unpin the current page from the buffer pool and sets currentPageNum
- * and nextEntry to non-positive numbers so that they are not falsely added to the
- * tree.
- */
-const void BTreeIndex::endScan()
-{
-    // Throw an error if endScan() has been called when a scan is not in progress.
-    if (scanExecuting == false) {
-        throw ScanNotInitializedException();
-    }
-    // End the scan by setting global var to null.
-    scanExecuting = false;
-    // Free the current page from the buffer pool and set the variable to null.
-    bufMgr->unPinPage(file, currentPageNum, false);
-    // Free the currentPageData pointer.
-    currentPageData = nullptr;
 }
-
-}
\ No newline at end of file
@@ -7,15 +7,27 @@
 
 #pragma once
 
+#include <atomic>
+#include <climits>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <mutex>
 #include <string>
 #include "string.h"
 #include <sstream>
+#include <thread>
+#include <vector>
 
 #include "types.h"
 #include "page.h"
 #include "file.h"
 #include "buffer.h"
+#include "latch.h"
+#include "node_cache.h"
+#include "bloom_filter.h"
 
 namespace badgerdb
 {
@@ -41,18 +53,495 @@ enum Operator
 	GT		/* Greater Than */
 };
 
+/**
+ * @brief Order in which a scan returns the entries of its range. Passed to BTreeIndex::startScan() method.
+ */
+enum ScanOrder
+{
+	ASCENDING,	/* From the low end of the range up */
+	DESCENDING	/* From the high end of the range down */
+};
+
+
+/**
+ * @brief Number of bytes of a STRING attribute that are used as the key.
+ */
+const  int STRINGSIZE = 10;
+
+/**
+ * @brief Fixed-width key for STRING attributes. Holds the first STRINGSIZE bytes of the
+ * attribute, zero padded when the attribute string is shorter.
+ */
+struct StringKey{
+  /**
+   * Key bytes. Not necessarily null terminated.
+   */
+	char data[ STRINGSIZE ];
+};
+
+/**
+ * @brief Per key type operations. Each key type the index supports gets its own specialization
+ * so that comparisons and key extraction compile to type specific code.
+ */
+template <class T>
+struct KeyTraits;
+
+/**
+ * @brief Key operations for INTEGER keys.
+ */
+template <>
+struct KeyTraits<int>{
+	static const Datatype TYPE = INTEGER;
+
+  /**
+   * Returns a negative value, zero or a positive value if a is less than, equal to or greater than b.
+   */
+	static int compare( const int& a, const int& b )
+	{
+		return ( a > b ) - ( a < b );
+	}
+
+  /**
+   * Reads a key from a record attribute or a user supplied key pointer.
+   */
+	static int load( const void* ptr )
+	{
+		int key;
+		memcpy( &key, ptr, sizeof( int ) );
+		return key;
+	}
+
+  /**
+   * Hash for the Bloom filter of IndexOptions::bloomFilter. Keys that compare equal hash
+   * the same.
+   */
+	static uint64_t hash( const int& key )
+	{
+		return hashWord( (uint32_t) key );
+	}
+};
+
+/**
+ * @brief Key operations for DOUBLE keys.
+ */
+template <>
+struct KeyTraits<double>{
+	static const Datatype TYPE = DOUBLE;
+
+	static int compare( const double& a, const double& b )
+	{
+		return ( a > b ) - ( a < b );
+	}
+
+	static double load( const void* ptr )
+	{
+		double key;
+		memcpy( &key, ptr, sizeof( double ) );
+		return key;
+	}
+
+	static uint64_t hash( const double& key )
+	{
+		// -0.0 compares equal to 0.0, so it hashes as 0.0.
+		double value = key == 0 ? 0 : key;
+		uint64_t bits;
+		memcpy( &bits, &value, sizeof( double ) );
+		return hashWord( bits );
+	}
+};
+
+/**
+ * @brief Key operations for STRING keys. Keys compare bytewise over at most STRINGSIZE bytes.
+ */
+template <>
+struct KeyTraits<StringKey>{
+	static const Datatype TYPE = STRING;
+
+	static int compare( const StringKey& a, const StringKey& b )
+	{
+		return strncmp( a.data, b.data, STRINGSIZE );
+	}
+
+	static StringKey load( const void* ptr )
+	{
+		StringKey key;
+		size_t length = strnlen( (const char*) ptr, STRINGSIZE );
+		memcpy( key.data, ptr, length );
+		memset( key.data + length, 0, STRINGSIZE - length );
+		return key;
+	}
+
+	static uint64_t hash( const StringKey& key )
+	{
+		return hashBytes( key.data, strnlen( key.data, STRINGSIZE ) );
+	}
+};
+
+/**
+ * @brief Most bytes of a STRING key of an index built with IndexOptions::stringKeyLength.
+ */
+const  int MAXSTRINGKEY = 255;
+
+/**
+ * @brief Variable-length key for STRING attributes, of an index built with
+ * IndexOptions::stringKeyLength: the attribute up to its first null byte, or up to that
+ * many bytes. Nodes store only the bytes in use.
+ */
+struct VarStringKey{
+  /**
+   * Number of bytes of data in use.
+   */
+	unsigned char length;
+
+  /**
+   * Key bytes. Only the first length bytes are meaningful.
+   */
+	char data[ MAXSTRINGKEY ];
+};
+
+/**
+ * @brief Key operations for variable-length STRING keys. Keys compare bytewise, and a key
+ * sorts before the longer keys it is a prefix of. The index loads them, since it knows
+ * how many bytes of the attribute to take.
+ */
+template <>
+struct KeyTraits<VarStringKey>{
+	static const Datatype TYPE = STRING;
+
+	static int compare( const VarStringKey& a, const VarStringKey& b )
+	{
+		return compareBytes( a.data, a.length, b.data, b.length );
+	}
+
+	static VarStringKey load( const void* ptr, const int maxLength )
+	{
+		VarStringKey key = VarStringKey();
+		key.length = (unsigned char) strnlen( (const char*) ptr, maxLength );
+		memcpy( key.data, ptr, key.length );
+		return key;
+	}
+
+	static uint64_t hash( const VarStringKey& key )
+	{
+		return hashBytes( key.data, key.length );
+	}
+
+  /**
+   * Compares two runs of bytes the way keys made of them compare.
+   */
+	static int compareBytes( const char* a, const int aLength, const char* b, const int bLength )
+	{
+		int c = memcmp( a, b, aLength < bLength ? aLength : bLength );
+		return c != 0 ? c : aLength - bLength;
+	}
+};
+
+/**
+ * @brief One attribute of a composite key: where it is in the record and its type.
+ */
+struct KeyAttribute{
+  /**
+   * Offset of the attribute inside the record.
+   */
+	int byteOffset;
+
+  /**
+   * Type of the attribute.
+   */
+	Datatype type;
+};
+
+/**
+ * @brief Most attributes a composite key can have.
+ */
+const  int MAXKEYATTRIBUTES = 4;
+
+/**
+ * @brief Number of bytes an attribute of the given type takes in a CompositeKey.
+ */
+inline int keyAttributeSize( const Datatype type )
+{
+	return type == INTEGER ? sizeof( int ) : type == DOUBLE ? sizeof( double ) : STRINGSIZE;
+}
+
+/**
+ * @brief Key of a composite index on two INTEGER attributes.
+ */
+struct IntPairKey{
+	int first;
+	int second;
+};
+
+/**
+ * @brief Key operations for (INTEGER, INTEGER) keys. Keys compare by first and then by
+ * second attribute.
+ *
+ * Composite keys are read from a whole record, or a user supplied buffer laid out like
+ * one, at the offsets of their attributes. bound() is what makes prefix scans work: it
+ * sets the attributes past the given leading ones to their smallest or largest value.
+ */
+template <>
+struct KeyTraits<IntPairKey>{
+	static int compare( const IntPairKey& a, const IntPairKey& b )
+	{
+		if( a.first != b.first )
+			return a.first < b.first ? -1 : 1;
+		return ( a.second > b.second ) - ( a.second < b.second );
+	}
+
+	static IntPairKey load( const void* record, const KeyAttribute* attrs, const int numAttrs )
+	{
+		IntPairKey key;
+		memcpy( &key.first, (const char*) record + attrs[0].byteOffset, sizeof( int ) );
+		memcpy( &key.second, (const char*) record + attrs[1].byteOffset, sizeof( int ) );
+		return key;
+	}
+
+	static void bound( IntPairKey& key, const KeyAttribute* attrs, const int numAttrs,
+	                   const int columns, const bool high )
+	{
+		if( columns < 2 )
+			key.second = high ? INT_MAX : INT_MIN;
+	}
+
+	static uint64_t hash( const IntPairKey& key )
+	{
+		return hashWord( (uint64_t) (uint32_t) key.first << 32 | (uint32_t) key.second );
+	}
+};
+
+/**
+ * @brief Key of a composite index on an INTEGER and then a DOUBLE attribute. Packed into
+ * 12 bytes, since padding would take a quarter of every key and break the slot counts
+ * of NodeSize, which assume none.
+ */
+#pragma pack( push, 4 )
+struct IntDoubleKey{
+	int first;
+	double second;
+};
+#pragma pack( pop )
+
+/**
+ * @brief Key operations for (INTEGER, DOUBLE) keys, in the same way as IntPairKey.
+ */
+template <>
+struct KeyTraits<IntDoubleKey>{
+	static int compare( const IntDoubleKey& a, const IntDoubleKey& b )
+	{
+		if( a.first != b.first )
+			return a.first < b.first ? -1 : 1;
+		return ( a.second > b.second ) - ( a.second < b.second );
+	}
+
+	static IntDoubleKey load( const void* record, const KeyAttribute* attrs, const int numAttrs )
+	{
+		// Zero the padding too, since keys are written to the index file as they are.
+		IntDoubleKey key = IntDoubleKey();
+		memcpy( &key.first, (const char*) record + attrs[0].byteOffset, sizeof( int ) );
+		memcpy( &key.second, (const char*) record + attrs[1].byteOffset, sizeof( double ) );
+		return key;
+	}
+
+	static void bound( IntDoubleKey& key, const KeyAttribute* attrs, const int numAttrs,
+	                   const int columns, const bool high )
+	{
+		if( columns < 2 )
+			key.second = high ? std::numeric_limits<double>::infinity() : -std::numeric_limits<double>::infinity();
+	}
+
+	static uint64_t hash( const IntDoubleKey& key )
+	{
+		return hashWord( KeyTraits<double>::hash( key.second ) ^ (uint32_t) key.first );
+	}
+};
+
+/**
+ * @brief Number of bytes of a CompositeKey. The attributes of a composite key of any
+ * other combination of types must fit in it.
+ */
+const  int COMPOSITESIZE = 24;
+
+/**
+ * @brief Key of a composite index on any other list of attributes. The attributes are
+ * stored one after the other in a form that sorts bytewise: INTEGER and DOUBLE values
+ * big endian with their sign bits flipped so that negative values come first, and
+ * STRING values as their first STRINGSIZE bytes. The rest of the key is zero.
+ */
+struct CompositeKey{
+	unsigned char data[ COMPOSITESIZE ];
+};
+
+/**
+ * @brief Key operations for CompositeKey. Keys compare with a single memcmp.
+ */
+template <>
+struct KeyTraits<CompositeKey>{
+	static int compare( const CompositeKey& a, const CompositeKey& b )
+	{
+		return memcmp( a.data, b.data, COMPOSITESIZE );
+	}
+
+	static CompositeKey load( const void* record, const KeyAttribute* attrs, const int numAttrs )
+	{
+		CompositeKey key = CompositeKey();
+		unsigned char* out = key.data;
+		for( int a = 0; a < numAttrs; a++ )
+		{
+			const char* in = (const char*) record + attrs[a].byteOffset;
+			if( attrs[a].type == INTEGER )
+			{
+				int value;
+				memcpy( &value, in, sizeof( int ) );
+				putBigEndian( out, (uint32_t) value ^ 0x80000000u, sizeof( int ) );
+			}
+			else if( attrs[a].type == DOUBLE )
+			{
+				double value;
+				memcpy( &value, in, sizeof( double ) );
+				// -0.0 compares equal to 0.0, so it is stored as 0.0.
+				if( value == 0 )
+					value = 0;
+				uint64_t bits;
+				memcpy( &bits, &value, sizeof( double ) );
+				putBigEndian( out, bits >> 63 ? ~bits : bits | ( 1ULL << 63 ), sizeof( double ) );
+			}
+			else
+			{
+				strncpy( (char*) out, in, STRINGSIZE );
+			}
+			out += keyAttributeSize( attrs[a].type );
+		}
+		return key;
+	}
+
+	static void bound( CompositeKey& key, const KeyAttribute* attrs, const int numAttrs,
+	                   const int columns, const bool high )
+	{
+		int from = 0;
+		for( int a = 0; a < columns && a < numAttrs; a++ )
+			from += keyAttributeSize( attrs[a].type );
+		memset( key.data + from, high ? 0xFF : 0, COMPOSITESIZE - from );
+	}
+
+	static uint64_t hash( const CompositeKey& key )
+	{
+		return hashBytes( key.data, COMPOSITESIZE );
+	}
+
+ private:
+	static void putBigEndian( unsigned char* out, uint64_t value, const int bytes )
+	{
+		for( int b = bytes - 1; b >= 0; b-- )
+		{
+			out[b] = (unsigned char) value;
+			value >>= 8;
+		}
+	}
+};
+
+/**
+ * @brief An attribute stored in the leaves of a covering index next to each rid, so that
+ * scans can return it without reading the record. Any range of bytes of the record.
+ */
+struct IncludedAttribute{
+  /**
+   * Offset of the attribute inside the record.
+   */
+	int byteOffset;
+
+  /**
+   * Number of bytes of the attribute.
+   */
+	int length;
+};
+
+/**
+ * @brief Most attributes a covering index can include.
+ */
+const  int MAXINCLUDED = 4;
+
+/**
+ * @brief Most bytes the included attributes of an entry can take together.
+ */
+const  int MAXPAYLOAD = 64;
+
+/**
+ * @brief Key type an index stores, picked from the types of the attributes it is built on.
+ */
+enum KeyType
+{
+	INTEGER_KEY,
+	DOUBLE_KEY,
+	STRING_KEY,
+	INT_PAIR_KEY,	/* (INTEGER, INTEGER), as IntPairKey */
+	INT_DOUBLE_KEY,	/* (INTEGER, DOUBLE), as IntDoubleKey */
+	COMPOSITE_KEY,	/* Any other list of attributes, as CompositeKey */
+	VAR_STRING_KEY	/* STRING with IndexOptions::stringKeyLength, as VarStringKey */
+};
+
+/**
+ * @brief Number of key slots in B+Tree nodes for key type T, computed at compile time.
+ */
+template <class T>
+struct NodeSize{
+  /**
+   * Number of key slots in a leaf.
+   */
+	//                                     numKeys          sibling ptrs                key         rid
+	static const int LEAF = ( Page::SIZE - sizeof( int ) - 2 * sizeof( PageId ) ) / ( sizeof( T ) + sizeof( RecordId ) );
+
+  /**
+   * Number of key slots in a non-leaf.
+   */
+	//                                     level, numKeys     extra pageNo              key       pageNo
+	static const int NONLEAF = ( Page::SIZE - 2 * sizeof( int ) - sizeof( PageId ) ) / ( sizeof( T ) + sizeof( PageId ) );
+};
+
+/**
+ * @brief Most keys of a non-leaf node of VarStringKey keys. Long separators leave room
+ * for fewer.
+ */
+const  int STRINGFANOUT = 400;
+
+/**
+ * @brief VarStringKey nodes are slotted and hold as many keys as their bytes allow, up to
+ * STRINGFANOUT in a non-leaf. Their leaves use the StringLeafHeader layout.
+ */
+template <>
+struct NodeSize<VarStringKey>{
+	static const int NONLEAF = STRINGFANOUT;
+};
 
 /**
  * @brief Number of key slots in B+Tree leaf for INTEGER key.
  */
-//                                                  sibling ptr             key               rid
-const  int INTARRAYLEAFSIZE = ( Page::SIZE - sizeof( PageId ) ) / ( sizeof( int ) + sizeof( RecordId ) );
+const  int INTARRAYLEAFSIZE = NodeSize<int>::LEAF;
 
 /**
  * @brief Number of key slots in B+Tree non-leaf for INTEGER key.
  */
-//                                                     level     extra pageNo                  key       pageNo
-const  int INTARRAYNONLEAFSIZE = ( Page::SIZE - sizeof( int ) - sizeof( PageId ) ) / ( sizeof( int ) + sizeof( PageId ) );
+const  int INTARRAYNONLEAFSIZE = NodeSize<int>::NONLEAF;
+
+/**
+ * @brief Number of key slots in B+Tree leaf for DOUBLE key.
+ */
+const  int DOUBLEARRAYLEAFSIZE = NodeSize<double>::LEAF;
+
+/**
+ * @brief Number of key slots in B+Tree non-leaf for DOUBLE key.
+ */
+const  int DOUBLEARRAYNONLEAFSIZE = NodeSize<double>::NONLEAF;
+
+/**
+ * @brief Number of key slots in B+Tree leaf for STRING key.
+ */
+const  int STRINGARRAYLEAFSIZE = NodeSize<StringKey>::LEAF;
+
+/**
+ * @brief Number of key slots in B+Tree non-leaf for STRING key.
+ */
+const  int STRINGARRAYNONLEAFSIZE = NodeSize<StringKey>::NONLEAF;
 
 /**
  * @brief Structure to store a key-rid pair. It is used to pass the pair to functions that
@@ -79,6 +568,10 @@ class PageKeyPair{
 public:
 	PageId pageNo;
 	T key;
+	/**
+	 * Number of entries under the page, for the counted nodes of IndexOptions::countedNodes.
+	 */
+	long count;
 	void set( int p, T k)
 	{
 		pageNo = p;
@@ -89,17 +582,50 @@ public:
 /**
  * @brief Overloaded operator to compare the key values of two rid-key pairs
  * and if they are the same compares to see if the first pair has
- * a smaller rid.pageNo value.
+ * a smaller rid, by page number and then slot number.
 */
 template <class T>
 bool operator<( const RIDKeyPair<T>& r1, const RIDKeyPair<T>& r2 )
 {
-	if( r1.key != r2.key )
-		return r1.key < r2.key;
-	else
+	int cmp = KeyTraits<T>::compare( r1.key, r2.key );
+	if( cmp != 0 )
+		return cmp < 0;
+	else if( r1.rid.page_number != r2.rid.page_number )
 		return r1.rid.page_number < r2.rid.page_number;
+	else
+		return r1.rid.slot_number < r2.rid.slot_number;
 }
 
+/**
+ * @brief Most buckets of the histogram of an index.
+ */
+const int HISTOGRAMBUCKETS = 100;
+
+/**
+ * @brief One bucket of the equi-depth histogram of an index. Buckets hold about the same
+ * number of entries, and all the entries of a key fall in the same bucket. Keys are given
+ * as positions, doubles in key order: the value of an INTEGER or DOUBLE key, both
+ * attributes of an (INTEGER, INTEGER) key, the leading attribute of an (INTEGER, DOUBLE)
+ * key, and the first eight bytes of STRING and other composite keys.
+ */
+struct HistogramBucket{
+  /**
+   * Positions of the smallest and largest key in the bucket.
+   */
+	double lowerBound;
+	double upperBound;
+
+  /**
+   * Number of entries in the bucket.
+   */
+	long entries;
+
+  /**
+   * Number of distinct keys in the bucket.
+   */
+	long distinctKeys;
+};
+
 /**
  * @brief The meta page, which holds metadata for Index file, is always first page of the btree index file and is cast
  * to the following structure to store or retrieve information from it.
@@ -110,191 +636,1975 @@ bool operator<( const RIDKeyPair<T>& r1, const RIDKeyPair<T>& r2 )
 */
 struct IndexMetaInfo{
   /**
-   * Name of base relation.
+   * Name of base relation.
+   */
+	char relationName[20];
+
+  /**
+   * Offset of attribute, over which index is built, inside the record stored in pages.
+   */
+	int attrByteOffset;
+
+  /**
+   * Type of the attribute over which index is built.
+   */
+	Datatype attrType;
+
+  /**
+   * Page number of root page of the B+ Tree inside the file index file.
+   */
+	PageId rootPageNo;
+
+  /**
+   * Whether the leaves use the packed INTEGER layout of IndexOptions::packLeaves.
+   */
+	bool packedLeaves;
+
+  /**
+   * Whether the leaves use the posting list layout of IndexOptions::postingLists.
+   */
+	bool postingLists;
+
+  /**
+   * Number of attributes of a composite key, 0 for an index on a single attribute.
+   */
+	int numKeyAttributes;
+
+  /**
+   * Attributes of a composite key, in key order.
+   */
+	KeyAttribute keyAttributes[ MAXKEYATTRIBUTES ];
+
+  /**
+   * Number of attributes stored with each entry, 0 unless the index is covering.
+   */
+	int numIncluded;
+
+  /**
+   * Attributes stored with each entry, in the order their bytes follow one another.
+   */
+	IncludedAttribute included[ MAXINCLUDED ];
+
+  /**
+   * Whether the non-leaf nodes carry the search directory of IndexOptions::nodeDirectories.
+   */
+	bool nodeDirectories;
+
+  /**
+   * Whether the non-leaf nodes carry the message buffers of IndexOptions::bufferInserts.
+   */
+	bool bufferedInserts;
+
+  /**
+   * Whether the non-leaf nodes carry the subtree counts of IndexOptions::countedNodes.
+   */
+	bool countedNodes;
+
+  /**
+   * Most bytes of a STRING key of IndexOptions::stringKeyLength, 0 for the fixed
+   * STRINGSIZE byte keys.
+   */
+	int stringKeyLength;
+
+  /**
+   * Number of blocks of the Bloom filter of IndexOptions::bloomFilter, 0 if the index
+   * has none.
+   */
+	long bloomBlocks;
+
+  /**
+   * Number of keys added to the Bloom filter.
+   */
+	long bloomKeys;
+
+  /**
+   * First page of the Bloom filter. Each page links to the next.
+   */
+	PageId bloomPageNo;
+
+  /**
+   * Number of entries in the index.
+   */
+	long numEntries;
+
+  /**
+   * Number of leaves in the index.
+   */
+	long numLeaves;
+
+  /**
+   * Page of the histogram, 0 if it was never written.
+   */
+	PageId histogramPageNo;
+};
+
+/**
+ * @brief Page of an index file that holds its histogram.
+ */
+struct HistogramPage{
+  /**
+   * Number of entries the histogram was built from.
+   */
+	long entries;
+
+  /**
+   * Number of buckets in use.
+   */
+	int numBuckets;
+
+	HistogramBucket buckets[ HISTOGRAMBUCKETS ];
+};
+
+/*
+Each node is a page, so once we read the page in we just cast the pointer to the page to this struct and use it to access the parts
+These structures basically are the format in which the information is stored in the pages for the index file depending on what kind of
+node they are. The level memeber of each non leaf structure seen below is set to 1 if the nodes
+at this level are just above the leaf nodes. Otherwise set to 0.
+*/
+
+/**
+ * @brief Structure for all non-leaf nodes, templated on the key type.
+*/
+template <class T>
+struct NonLeafNode{
+  /**
+   * Level of the node in the tree.
+   */
+	int level;
+
+  /**
+   * Number of keys in use. The node has numKeys + 1 children.
+   */
+	int numKeys;
+
+  /**
+   * Stores keys.
+   */
+	T keyArray[ NodeSize<T>::NONLEAF ];
+
+  /**
+   * Stores page numbers of child pages which themselves are other non-leaf/leaf nodes in the tree.
+   */
+	PageId pageNoArray[ NodeSize<T>::NONLEAF + 1 ];
+};
+
+/**
+ * @brief Where the stored part of a key of a VarStringKey node starts in the data of the
+ * node, and how many bytes it has.
+ */
+struct StringSlot{
+	unsigned short offset;
+	unsigned short length;
+};
+
+/**
+ * @brief Bytes of a VarStringKey non-leaf available to its keys.
+ */
+const int STRINGNODEDATA = Page::SIZE - 2 * sizeof( int ) - ( STRINGFANOUT + 1 ) * sizeof( PageId )
+                           - 3 * sizeof( unsigned short );
+
+/**
+ * @brief Non-leaf node of VarStringKey keys, slotted like a Page. The bytes every key of the
+ * node starts with are stored once, at the end of data, and each key only by the rest of
+ * it: a StringSlot for each key, in key order from the front of data, points at its rest,
+ * and the rests fill data from the prefix backwards. Keys are added by appending their
+ * rests below the others, and removed by dropping their slots; the rests left behind are
+ * only reclaimed when the node runs out of free bytes. The keys are suffix truncated
+ * separators, as short as tells the children apart. A zeroed page is an empty node.
+ */
+template <>
+struct NonLeafNode<VarStringKey>{
+  /**
+   * Level of the node in the tree.
+   */
+	int level;
+
+  /**
+   * Number of keys in use. The node has numKeys + 1 children.
+   */
+	int numKeys;
+
+  /**
+   * Page numbers of the children.
+   */
+	PageId pageNoArray[ STRINGFANOUT + 1 ];
+
+  /**
+   * Number of bytes every key of the node starts with.
+   */
+	unsigned short prefixLength;
+
+  /**
+   * Bytes at the end of data taken by the prefix and the rests of the keys.
+   */
+	unsigned short heapBytes;
+
+  /**
+   * Bytes of heapBytes left behind by keys removed or replaced.
+   */
+	unsigned short deadBytes;
+
+	char data[ STRINGNODEDATA ];
+};
+
+
+/**
+ * @brief Structure for all leaf nodes, templated on the key type.
+*/
+template <class T>
+struct LeafNode{
+  /**
+   * Number of keys (and rids) in use.
+   */
+	int numKeys;
+
+  /**
+   * Stores keys.
+   */
+	T keyArray[ NodeSize<T>::LEAF ];
+
+  /**
+   * Stores RecordIds.
+   */
+	RecordId ridArray[ NodeSize<T>::LEAF ];
+
+  /**
+   * Page number of the leaf on the right side.
+	 * This linking of leaves allows to easily move from one leaf to the next leaf during index scan.
+   */
+	PageId rightSibPageNo;
+
+  /**
+   * Page number of the leaf on the left side, which descending scans move to.
+   */
+	PageId leftSibPageNo;
+};
+
+/**
+ * @brief Structure for all non-leaf nodes when the key is of INTEGER type.
+*/
+typedef NonLeafNode<int> NonLeafNodeInt;
+
+/**
+ * @brief Structure for all leaf nodes when the key is of INTEGER type.
+*/
+typedef LeafNode<int> LeafNodeInt;
+
+/**
+ * @brief Structure for all non-leaf nodes when the key is of DOUBLE type.
+*/
+typedef NonLeafNode<double> NonLeafNodeDouble;
+
+/**
+ * @brief Structure for all leaf nodes when the key is of DOUBLE type.
+*/
+typedef LeafNode<double> LeafNodeDouble;
+
+/**
+ * @brief Structure for all non-leaf nodes when the key is of STRING type.
+*/
+typedef NonLeafNode<StringKey> NonLeafNodeString;
+
+/**
+ * @brief Structure for all leaf nodes when the key is of STRING type.
+*/
+typedef LeafNode<StringKey> LeafNodeString;
+
+static_assert( sizeof( NonLeafNodeInt ) <= Page::SIZE && sizeof( LeafNodeInt ) <= Page::SIZE,
+               "INTEGER nodes must fit in a page" );
+static_assert( sizeof( NonLeafNodeDouble ) <= Page::SIZE && sizeof( LeafNodeDouble ) <= Page::SIZE,
+               "DOUBLE nodes must fit in a page" );
+static_assert( sizeof( NonLeafNodeString ) <= Page::SIZE && sizeof( LeafNodeString ) <= Page::SIZE,
+               "STRING nodes must fit in a page" );
+static_assert( sizeof( NonLeafNode<IntPairKey> ) <= Page::SIZE && sizeof( LeafNode<IntPairKey> ) <= Page::SIZE,
+               "(INTEGER, INTEGER) nodes must fit in a page" );
+static_assert( sizeof( NonLeafNode<IntDoubleKey> ) <= Page::SIZE && sizeof( LeafNode<IntDoubleKey> ) <= Page::SIZE,
+               "(INTEGER, DOUBLE) nodes must fit in a page" );
+static_assert( sizeof( NonLeafNode<CompositeKey> ) <= Page::SIZE && sizeof( LeafNode<CompositeKey> ) <= Page::SIZE,
+               "composite key nodes must fit in a page" );
+static_assert( sizeof( NonLeafNode<VarStringKey> ) <= Page::SIZE,
+               "variable-length STRING nodes must fit in a page" );
+
+/**
+ * @brief Header of a posting list leaf, the layout of IndexOptions::postingLists. Each
+ * distinct key of the leaf is stored once, with the rids of its entries in a sorted run.
+ *
+ * The keys follow the header as an array, and the rids follow the keys, each one stored
+ * as a page number offset from pageBase in 2 bytes, or in full, and a slot number in 1
+ * byte while below 256, or 2. The end of the run of each key, counted in entries, is a
+ * 16 bit number stored from the end of the page backwards. A zeroed page is an empty leaf.
+ */
+struct PostingLeafHeader{
+  /**
+   * Page number of the leaf on the right side.
+   */
+	PageId rightSibPageNo;
+
+  /**
+   * Page number of the leaf on the left side.
+   */
+	PageId leftSibPageNo;
+
+  /**
+   * Page number that a stored 2 byte page number of 0 stands for. Unused with 4 byte ones.
+   */
+	PageId pageBase;
+
+  /**
+   * Number of entries, that is rids, in use.
+   */
+	unsigned short numKeys;
+
+  /**
+   * Number of distinct keys in use.
+   */
+	unsigned short numGroups;
+
+  /**
+   * Bytes per rid page number, 2 or 4. 0 until the first entry is added.
+   */
+	unsigned char pageBytes;
+
+  /**
+   * Bytes per rid slot number, 1 or 2.
+   */
+	unsigned char slotBytes;
+
+  /**
+   * Unused. Makes the header 24 bytes, so that the DOUBLE keys after it are aligned.
+   */
+	unsigned char padding[ 6 ];
+};
+
+/**
+ * @brief Bytes of a posting list leaf available to keys, rids and run ends.
+ */
+const int POSTINGLEAFDATA = Page::SIZE - sizeof( PostingLeafHeader );
+
+/**
+ * @brief Header of a leaf of a covering index, whose entries carry the bytes of the
+ * included attributes. Keys, rids and payloads follow in three columns, each laid out
+ * for capacity entries. A zeroed page with payloadBytes set is an empty leaf.
+ */
+struct PayloadLeafHeader{
+  /**
+   * Page number of the leaf on the right side.
+   */
+	PageId rightSibPageNo;
+
+  /**
+   * Page number of the leaf on the left side.
+   */
+	PageId leftSibPageNo;
+
+  /**
+   * Number of entries in use.
+   */
+	int numKeys;
+
+  /**
+   * Bytes of included attributes per entry.
+   */
+	int payloadBytes;
+
+  /**
+   * Number of entries the columns are laid out for. 0 until the first entry is added.
+   */
+	int capacity;
+};
+
+/**
+ * @brief Bytes of a covering index leaf available to keys, rids and payloads.
+ */
+const int PAYLOADLEAFDATA = Page::SIZE - sizeof( PayloadLeafHeader );
+
+/**
+ * @brief Header of a leaf of VarStringKey keys, slotted like NonLeafNode<VarStringKey>: a
+ * StringLeafSlot for each entry, in key order from the front of the leaf's data, and the
+ * prefix every key of the leaf starts with at the end, with the rests of the keys below
+ * it. A zeroed page is an empty leaf.
+ */
+struct StringLeafHeader{
+  /**
+   * Page number of the leaf on the right side.
+   */
+	PageId rightSibPageNo;
+
+  /**
+   * Page number of the leaf on the left side.
+   */
+	PageId leftSibPageNo;
+
+  /**
+   * Number of entries in use.
+   */
+	unsigned short numKeys;
+
+  /**
+   * Number of bytes every key of the leaf starts with.
+   */
+	unsigned short prefixLength;
+
+  /**
+   * Bytes at the end of the page taken by the prefix and the rests of the keys.
+   */
+	unsigned short heapBytes;
+};
+
+/**
+ * @brief Entry of a VarStringKey leaf: its rid and where the rest of its key is stored.
+ */
+struct StringLeafSlot{
+	RecordId rid;
+	StringSlot key;
+};
+
+/**
+ * @brief Bytes of a VarStringKey leaf available to slots and keys.
+ */
+const int STRINGLEAFDATA = Page::SIZE - sizeof( StringLeafHeader );
+
+
+class BTreeIndex;
+
+/**
+ * @brief Inserts taken out of the message buffers of a write optimized index. Defined in
+ * node_buffer.h.
+ */
+template <class T>
+struct MessageBatch;
+
+/**
+ * @brief Receives the entries of one part of a BTreeIndex::parallelScan, a batch at a time.
+ * Called with the number of the part, the record ids of the batch, their included
+ * attributes one after the other for a covering index (null otherwise), and the number of
+ * entries in the batch.
+ */
+typedef std::function<void(const int part, const RecordId* rids, const void* payloads, const int n)> ScanPartConsumer;
+
+/**
+ * @brief Statistics of a BTreeIndex, for a planner to choose between an index scan and a
+ * FileScan. See BTreeIndex::statistics.
+ */
+struct IndexStats{
+  /**
+   * Number of entries in the index.
+   */
+	long entries;
+
+  /**
+   * Number of distinct keys, estimated from the histogram. Exact right after the
+   * histogram was built; later inserts and deletes are taken to keep the share of
+   * distinct keys among the entries.
+   */
+	double distinctKeys;
+
+  /**
+   * Positions of the smallest and largest key, as in HistogramBucket. 0 for an empty index.
+   */
+	double minKey;
+	double maxKey;
+
+  /**
+   * Number of levels of the tree, 1 while the root is a leaf.
+   */
+	int height;
+
+  /**
+   * Number of leaves.
+   */
+	long leaves;
+
+  /**
+   * Entries per leaf over the most a leaf holds.
+   */
+	double fillFactor;
+
+  /**
+   * Number of entries the histogram was built from.
+   */
+	long histogramEntries;
+
+  /**
+   * Buckets of the histogram, in key order.
+   */
+	std::vector<HistogramBucket> histogram;
+};
+
+/**
+ * @brief Options that control how a BTreeIndex builds a new index file.
+*/
+struct IndexOptions{
+  /**
+   * Build a new index by sorting the (key, rid) pairs of the relation and writing leaves
+   * left to right, instead of inserting every record through insertEntry. Off by default.
+   */
+	bool bulkLoad;
+
+  /**
+   * Fraction of the slots of each leaf and non-leaf that the bulk load fills. Leaving room
+   * lets later inserts go in without splitting right away.
+   */
+	double fillFactor;
+
+  /**
+   * Number of pages worth of (key, rid) pairs the bulk load sorts in memory. Relations
+   * with more pairs are sorted as runs spilled to disk and merged.
+   */
+	int sortBufferPages;
+
+  /**
+   * Latch nodes so that several threads can insert and scan at the same time. Costs a
+   * latch per node visited, so it is off for single threaded use.
+   */
+	bool concurrent;
+
+  /**
+   * Tune inserts for keys that mostly arrive in ascending order, like timestamps and
+   * sequence numbers. Keys not below the largest key of the rightmost leaf go straight to
+   * that leaf without a descent, and a full rightmost leaf or non-leaf split by such a key
+   * keeps the fill factor of its entries instead of half. The shortcut is only taken by
+   * single threaded indexes; concurrent ones still get the skewed splits.
+   */
+	bool appendOptimized;
+
+  /**
+   * Number of leaves a scan reads into the buffer pool ahead of the leaf it is on, from a
+   * thread the scans of the index share, so that crossing to the next leaf rarely waits for
+   * the disk. 0 turns read-ahead off. The read-ahead thread latches the leaves it reads, so
+   * a positive depth latches nodes as if the index were concurrent.
+   */
+	int readAheadLeaves;
+
+  /**
+   * Store the leaves of an INTEGER index packed: keys as 16 bit offsets from a base key
+   * and rid page and slot numbers in as few bytes as the leaf needs, when its entries
+   * allow. Dense keys with clustered rids fit about twice as many entries per leaf.
+   * Ignored for other key types, and for an existing file, which keeps its own layout.
+   */
+	bool packLeaves;
+
+  /**
+   * Store each distinct key of a leaf once, followed by the rids of all its entries, sorted
+   * and in as few bytes as the leaf needs. Meant for attributes with few distinct values,
+   * like status codes or region ids, whose leaves shrink several times over. The entries
+   * of a key that fill more than a leaf go on in the next leaves, as duplicates always do.
+   * Works for every key type and takes precedence over packLeaves. Ignored for an existing
+   * file, which keeps its own layout.
+   */
+	bool postingLists;
+
+  /**
+   * Attributes to store in the leaves next to each rid, making the index covering: the
+   * scanNext and scanNextBatch overloads with a payload buffer return them, so a query
+   * that needs only the key and these attributes never reads the relation. Each entry
+   * grows by their total length, at most MAXPAYLOAD bytes. A covering index always uses
+   * plain leaves, so packLeaves and postingLists are ignored. Ignored for an existing
+   * file, which keeps the attributes it was built with.
+   */
+	std::vector<IncludedAttribute> includeAttributes;
+
+  /**
+   * Keep non-leaf nodes pinned in the buffer pool once a descent has read them, so that
+   * inserts, deletes, lookups and scans only call the buffer manager for the leaf. Each
+   * cached non-leaf holds a buffer frame for as long as the index is open, about one frame
+   * for every few hundred leaves. At most a quarter of the frames are held this way;
+   * non-leaves read once they are taken are pinned and unpinned like leaves.
+   */
+	bool cacheInnerNodes;
+
+  /**
+   * Give each non-leaf node of an INTEGER index a search directory, the last key of every
+   * block of DIRECTORYBLOCK keys, kept in the tail of the key array. Routing through a
+   * node then reads the directory and one block of keys, three or four cache lines,
+   * instead of the cache lines a search over the whole key array touches. Each node holds
+   * DIRECTORYSIZE fewer keys. Ignored for other key types, and for an existing file, which
+   * keeps its own layout.
+   */
+	bool nodeDirectories;
+
+  /**
+   * Write optimized mode. Non-leaf nodes keep BUFFERFANOUT children and use the rest of
+   * their page as a buffer of pending inserts. An insert only adds a message to the
+   * buffer of the root; a full buffer passes the messages bound for its fullest child on
+   * in one batch, into the child's buffer or, above the leaves, into the leaf. Random
+   * inserts then read and write each leaf once for many entries instead of once each,
+   * which pays off once the index no longer fits in the buffer pool. Lookups, scans and
+   * deletes first pass the pending messages of their key range down to the leaves, so
+   * they see every entry. Ignored for concurrent indexes, for payloads too wide to leave
+   * a useful buffer, and for an existing file, which keeps its own layout. Takes
+   * precedence over nodeDirectories.
+   */
+	bool bufferInserts;
+
+  /**
+   * Keep a blocked Bloom filter of the keys, so that a lookup, contains or deleteEntry
+   * for a key that is not in the index returns without reading a page, except for about
+   * one key in a hundred. The filter takes BloomFilter::BITSPERKEY bits per key, is held
+   * in memory while the index is open and is written to pages of the index file when it
+   * is closed. Deleted keys stay in the filter. Ignored for an existing file, which keeps
+   * the filter it was built with, if any.
+   */
+	bool bloomFilter;
+
+  /**
+   * Number of keys to size the Bloom filter for. A bulk load sizes it for the relation if
+   * that is larger. An index that is not concurrent rebuilds the filter twice as large
+   * from its entries once more keys were added than it was sized for; a concurrent one
+   * keeps its size and lets the false positives grow.
+   */
+	long bloomFilterKeys;
+
+  /**
+   * Keep next to each child of a non-leaf node the number of entries in its subtree, in
+   * the tail of the key array. Inserts and deletes update the counts along their path and
+   * splits and merges move them with the children, so countRange, rank and select read
+   * one node per level instead of every leaf of the range. Each node holds about a third
+   * as many keys. Ignored for concurrent indexes and buffered ones, and for an existing
+   * file, which keeps its own layout. Takes precedence over nodeDirectories.
+   */
+	bool countedNodes;
+
+  /**
+   * Index a STRING attribute by up to this many bytes, at most MAXSTRINGKEY, instead of
+   * its first STRINGSIZE bytes. Keys end at the first null byte and take only the bytes
+   * they have. Leaves and non-leaves are slotted: each stores the prefix its keys share
+   * once and the rest of each key after a slot, and the non-leaves hold suffix truncated
+   * separators, the shortest prefix of a key that still sorts after the entries to its
+   * left. Meant for URLs, paths and identifiers, whose leading bytes are mostly alike.
+   * 0 keeps the fixed-width keys. Ignored for other attribute types, and for an existing
+   * file, which keeps its own keys. The layout is its own, so packLeaves, postingLists,
+   * includeAttributes, nodeDirectories, bufferInserts and countedNodes are ignored with it.
+   */
+	int stringKeyLength;
+
+	IndexOptions()
+		: bulkLoad( false ), fillFactor( 0.9 ), sortBufferPages( 1024 ), concurrent( false ),
+		  appendOptimized( false ), readAheadLeaves( 0 ), packLeaves( false ), postingLists( false ),
+		  cacheInnerNodes( false ), nodeDirectories( false ), bufferInserts( false ), bloomFilter( false ),
+		  bloomFilterKeys( 0 ), countedNodes( false ), stringKeyLength( 0 )
+	{
+	}
+};
+
+
+/**
+ * @brief A range scan over a BTreeIndex. Any number of cursors can be open over one index
+ * at once, each with its own range and position.
+ *
+ * A cursor works from a private copy of the leaf it is positioned on. The leaf is pinned
+ * (and latched, for a concurrent index) only while it is copied, so an open cursor holds
+ * nothing that other cursors or inserts wait for, and one thread may interleave several
+ * cursors and inserts. Entries inserted into the part of the range the cursor has already
+ * copied are not returned.
+ *
+ * A cursor must be destroyed before the index it scans.
+*/
+class IndexScanCursor {
+
+	friend class BTreeIndex;
+
+ private:
+
+  /**
+   * The index being scanned.
+   */
+	BTreeIndex	*index;
+
+  /**
+   * True if an index scan has been started.
+   */
+	bool		scanExecuting;
+
+  /**
+   * Index of next entry to be scanned in current leaf being scanned. Counts down in a
+   * descending scan.
+   */
+	int			nextEntry;
+
+  /**
+   * Page number of current page being scanned.
+   */
+	PageId	currentPageNum;
+
+  /**
+   * Copy of the leaf being scanned, taken when the scan reached it. Aligned for the
+   * DOUBLE keys of the leaf layouts, which a Page alone is not.
+   */
+	alignas( alignof( double ) ) Page		currentPageData;
+
+  /**
+   * One past the last entry of the copied leaf that lies below the high bound. Found once
+   * per leaf, so entries before it are returned without comparing keys.
+   */
+	int			runEnd;
+
+  /**
+   * First entry of the copied leaf that lies above the low bound. Only kept by descending
+   * scans, which return the entries from nextEntry down to it.
+   */
+	int			runStart;
+
+  /**
+   * True if the range ends in the copied leaf, or the leaf is the last one in the
+   * direction of the scan.
+   */
+	bool		lastRun;
+
+  /**
+   * True if the scan returns its range from the high end down.
+   */
+	bool		descending;
+
+  /**
+   * True while the cursor is in the read-ahead queue of its index. Only during a scan that
+   * spans more than one leaf of an index with IndexOptions::readAheadLeaves set.
+   */
+	bool		readingAhead;
+
+  /**
+   * Next leaf to read ahead for the cursor, 0 once there is none. Guarded by the
+   * prefetchLock of the index.
+   */
+	PageId		readAheadNum;
+
+  /**
+   * Number of leaves read ahead for the cursor since the scan started. Guarded by the
+   * prefetchLock of the index.
+   */
+	int			leavesReadAhead;
+
+  /**
+   * Number of leaves the cursor has moved to since the scan started.
+   */
+	std::atomic<int>	leavesCopied;
+
+  /**
+   * Takes the cursor out of the read-ahead queue of its index, waiting for a leaf being
+   * read for it, if it is in the queue.
+   */
+	const void stopReadAhead();
+
+  /**
+   * Low INTEGER value for scan.
+   */
+	int			lowValInt;
+
+  /**
+   * Low DOUBLE value for scan.
+   */
+	double	lowValDouble;
+
+  /**
+   * Low STRING value for scan.
+   */
+	StringKey	lowValString;
+
+  /**
+   * High INTEGER value for scan.
+   */
+	int			highValInt;
+
+  /**
+   * High DOUBLE value for scan.
+   */
+	double	highValDouble;
+
+  /**
+   * High STRING value for scan.
+   */
+	StringKey highValString;
+
+  /**
+   * Low value for scan of a variable-length STRING index.
+   */
+	VarStringKey	lowValVarString;
+
+  /**
+   * High value for scan of a variable-length STRING index.
+   */
+	VarStringKey	highValVarString;
+
+  /**
+   * Low value for scan of an (INTEGER, INTEGER) index.
+   */
+	IntPairKey	lowValIntPair;
+
+  /**
+   * High value for scan of an (INTEGER, INTEGER) index.
+   */
+	IntPairKey	highValIntPair;
+
+  /**
+   * Low value for scan of an (INTEGER, DOUBLE) index.
+   */
+	IntDoubleKey	lowValIntDouble;
+
+  /**
+   * High value for scan of an (INTEGER, DOUBLE) index.
+   */
+	IntDoubleKey	highValIntDouble;
+
+  /**
+   * Low value for scan of any other composite index.
+   */
+	CompositeKey	lowValComposite;
+
+  /**
+   * High value for scan of any other composite index.
+   */
+	CompositeKey	highValComposite;
+
+  /**
+   * Low Operator. Can only be GT(>) or GTE(>=).
+   */
+	Operator	lowOp;
+
+  /**
+   * High Operator. Can only be LT(<) or LTE(<=).
+   */
+	Operator	highOp;
+
+  /**
+   * Low value of the running scan for key type T.
+   */
+    template <class T>
+    T& scanLowVal();
+
+  /**
+   * High value of the running scan for key type T.
+   */
+    template <class T>
+    T& scanHighVal();
+
+	IndexScanCursor(const IndexScanCursor&);
+	IndexScanCursor& operator=(const IndexScanCursor&);
+
+ public:
+
+  /**
+   * Creates a cursor over an index. No scan is running until startScan.
+   * @param index   The index to scan.
+   */
+	IndexScanCursor(BTreeIndex* index);
+
+  /**
+   * Ends the scan if one is running.
+   */
+	~IndexScanCursor();
+
+    /**
+       * Begin a filtered scan of the index.  For instance, if the method is called
+       * using ("a",GT,"d",LTE) then we should seek all entries with a value
+       * greater than "a" and less than or equal to "d".
+       * If this cursor is already scanning, that scan is ended here. A DESCENDING scan
+       * returns the same entries from the largest key down, so the first n entries it
+       * returns are the top n of the range.
+     * @param lowVal	Low value of range, pointer to integer / double / char string
+     * @param lowOp		Low operator (GT/GTE)
+     * @param highVal	High value of range, pointer to integer / double / char string
+     * @param highOp	High operator (LT/LTE)
+     * @param order		Whether to return the range from the low or the high end
+     * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+     * @throws  BadScanrangeException If lowVal > highval
+       * @throws  NoSuchKeyFoundException If there is no key in the B+ tree that satisfies the scan criteria.
+      **/
+	const void startScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp,
+	                     const ScanOrder order = ASCENDING);
+
+    /**
+	 * Begin a scan of a composite index bounded on its leading numColumns attributes only,
+	 * for instance all entries whose first attribute lies between two values. The other
+	 * attributes of lowVal and highVal are not read.
+     * @param lowVal		Low value of range, laid out like a record of the relation
+     * @param lowOp			Low operator (GT/GTE)
+     * @param highVal		High value of range, laid out like a record of the relation
+     * @param highOp		High operator (LT/LTE)
+     * @param numColumns	Number of leading key attributes the bounds give.
+     * @param order			Whether to return the range from the low or the high end
+     * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+     * @throws  BadScanrangeException If lowVal > highval, or numColumns is not between 1 and
+     * 					the number of key attributes
+	 * @throws  NoSuchKeyFoundException If there is no key in the B+ tree that satisfies the scan criteria.
+	**/
+	const void startPrefixScan(const void* lowVal, const Operator lowOp, const void* highVal,
+	                           const Operator highOp, const int numColumns, const ScanOrder order = ASCENDING);
+
+    /**
+	 * Fetch the record id of the next index entry that matches the scan.
+     * @param outRid	RecordId of next record found that satisfies the scan criteria returned in this
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	 * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
+	**/
+	const void scanNext(RecordId& outRid);
+
+    /**
+	 * Fetch the record id and the included attributes of the next index entry that
+	 * matches the scan of a covering index.
+     * @param outRid		RecordId of next record found that satisfies the scan criteria returned in this
+     * @param outPayload	Receives the included attributes of the entry, payloadSize() bytes.
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	 * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
+	**/
+	const void scanNext(RecordId& outRid, void* outPayload);
+
+    /**
+	 * Fetch the record ids of up to maxRids next index entries that match the scan. Whole
+	 * runs of a leaf are copied at once.
+     * @param outRids	Buffer for at least maxRids record ids.
+     * @param maxRids	Most record ids to return.
+     * @return			Number of record ids returned. Less than maxRids only at the end
+     * 					of the scan, and 0 once every entry has been returned.
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	**/
+	const int scanNextBatch(RecordId* outRids, const int maxRids);
+
+    /**
+	 * Fetch the record ids and included attributes of up to maxRids next index entries
+	 * that match the scan of a covering index.
+     * @param outRids		Buffer for at least maxRids record ids.
+     * @param outPayloads	Buffer for at least maxRids payloads of payloadSize() bytes,
+     * 						which are returned one after the other.
+     * @param maxRids		Most entries to return.
+     * @return				Number of entries returned, 0 once every entry has been returned.
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	**/
+	const int scanNextBatch(RecordId* outRids, void* outPayloads, const int maxRids);
+
+    /**
+	 * Terminate the current scan.
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	**/
+	const void endScan();
+};
+
+
+/**
+ * @brief BTreeIndex class. It implements a B+ Tree index on a single attribute of a
+ * relation, or on a composite key of several attributes compared in order. startScan, scanNext and endScan drive one built-in scan; open an
+ * IndexScanCursor for each further scan that should run at the same time.
+ *
+ * Built with IndexOptions::concurrent, threads may insert and scan at the same time.
+ * Nodes are latched top down with latch crabbing: readers hold at most a parent and a
+ * child in shared mode, and inserts first try with shared latches and an exclusive latch
+ * on the leaf only, falling back to exclusive latches from the root when the leaf is full.
+ * Deletes do the same, falling back when the leaf would drop below half full, and then
+ * hold the root latch until they are done.
+ *
+ * The typed helpers below take the key type T and a leaf layout L, one of the plain
+ * LeafNode layout, PackedIntLeaf, PostingLeaf, the PayloadLeafHeader layout of
+ * covering indexes and the StringLeafHeader layout of VarStringKey keys, and only reach
+ * the entries of a leaf through L.
+*/
+class BTreeIndex {
+
+	friend class IndexScanCursor;
+
+ private:
+
+  /**
+   * File object for the index file.
+   */
+	File		*file;
+
+  /**
+   * Buffer Manager Instance.
+   */
+	BufMgr	*bufMgr;
+
+  /**
+   * Page number of meta page.
+   */
+	PageId	headerPageNum;
+
+  /**
+   * page number of root page of B+ tree inside index file.
+   */
+	PageId	rootPageNum;
+
+  /**
+   * Datatype of attribute over which index is built.
+   */
+	Datatype	attributeType;
+
+  /**
+   * Offset of attribute, over which index is built, inside records. 0 for a composite
+   * index, whose keys are read from the whole record.
+   */
+	int 		attrByteOffset;
+
+  /**
+   * Key type of the index.
+   */
+	KeyType	keyType;
+
+  /**
+   * Most bytes of a variable-length STRING key, 0 unless the key type is VAR_STRING_KEY.
+   */
+	int			stringKeyLength;
+
+  /**
+   * Bytes of included attributes per entry, 0 unless the index is covering.
+   */
+	int			payloadBytes;
+
+  /**
+   * Number of attributes stored with each entry.
+   */
+	int			numIncluded;
+
+  /**
+   * Attributes stored with each entry.
+   */
+	IncludedAttribute	included[MAXINCLUDED];
+
+  /**
+   * Number of attributes of a composite key, 0 for an index on a single attribute.
+   */
+	int			numKeyAttributes;
+
+  /**
+   * Attributes of a composite key, in key order.
+   */
+	KeyAttribute	keyAttributes[MAXKEYATTRIBUTES];
+
+  /**
+   * Number of keys in leaf node, depending upon the type of key.
+   */
+	int			leafOccupancy;
+
+  /**
+   * Number of keys in non-leaf node, depending upon the type of key.
+   */
+	int			nodeOccupancy;
+
+
+  /**
+   * Used as an extra reference to the root page initialized with the BTree.
+   */
+	PageId firstRootNum;
+
+  /**
+   * Number of cursors with a scan running. A cursor follows the right sibling link of
+   * its leaf copy, so leaves are only merged or rebalanced while no cursor is open.
+   */
+	std::atomic<int>	openCursors;
+
+  /**
+   * Cursor behind startScan, scanNext and endScan.
+   */
+	IndexScanCursor	scanCursor;
+
+  /**
+   * Node latches. Null unless the index was opened with IndexOptions::concurrent.
+   */
+	LatchTable	*latches;
+
+  /**
+   * Non-leaf nodes kept pinned. Null unless the index was opened with
+   * IndexOptions::cacheInnerNodes.
+   */
+	NodeCache	*nodeCache;
+
+  /**
+   * Guards rootPageNum and the meta page while the root is read or replaced.
+   */
+	RWLatch		rootLatch;
+
+  /**
+   * Number of leaves scans read ahead, from IndexOptions::readAheadLeaves.
+   */
+	int			readAheadLeaves;
+
+  /**
+   * Thread reading leaves ahead of the cursors in prefetchQueue. Started by the first scan
+   * that reads ahead.
+   */
+	std::thread	prefetchThread;
+
+  /**
+   * Guards prefetchQueue, prefetching, prefetchStop and the read-ahead state of the cursors.
+   */
+	std::mutex	prefetchLock;
+
+  /**
+   * Wakes the prefetch thread when a cursor starts or moves on, or the index closes.
+   */
+	std::condition_variable	prefetchWake;
+
+  /**
+   * Signalled each time the prefetch thread is done with a leaf.
+   */
+	std::condition_variable	prefetchDone;
+
+  /**
+   * Cursors read ahead for, served in turn.
+   */
+	std::vector<IndexScanCursor*>	prefetchQueue;
+
+  /**
+   * Cursor the prefetch thread is reading a leaf for, if any.
+   */
+	IndexScanCursor*	prefetching;
+
+  /**
+   * Tells the prefetch thread to stop.
+   */
+	bool		prefetchStop;
+
+  /**
+   * Whether the leaves use the packed INTEGER layout, as recorded in the meta page.
+   */
+	bool		packedLeaves;
+
+  /**
+   * Whether the leaves use the posting list layout, as recorded in the meta page.
+   */
+	bool		postingLeaves;
+
+  /**
+   * Whether the non-leaf nodes carry search directories, as recorded in the meta page.
+   */
+	bool		nodeDirectories;
+
+  /**
+   * Whether the non-leaf nodes carry message buffers, as recorded in the meta page.
+   */
+	bool		bufferedInserts;
+
+  /**
+   * Most messages the buffer of a non-leaf holds, when they carry buffers.
+   */
+	int			bufferCapacity;
+
+  /**
+   * Whether the non-leaf nodes carry subtree counts, as recorded in the meta page.
+   */
+	bool		countedNodes;
+
+  /**
+   * Bloom filter of the keys. Null unless the index has one.
+   */
+	BloomFilter	*filter;
+
+  /**
+   * Whether the filter is rebuilt larger once it holds more keys than it was sized for.
+   * Only for indexes that are not concurrent.
+   */
+	bool		filterGrows;
+
+  /**
+   * First page of the filter in the index file, or 0 if it was never written.
+   */
+	PageId	filterPageNum;
+
+  /**
+   * Number of blocks and keys of the filter as last written, to skip writing it again
+   * when nothing was added.
+   */
+	long		savedFilterBlocks;
+	long		savedFilterKeys;
+
+  /**
+   * Number of entries, pending messages of a buffered index included.
+   */
+	std::atomic<long>	numEntries;
+
+  /**
+   * Number of leaves.
+   */
+	std::atomic<long>	numLeaves;
+
+  /**
+   * Histogram of the keys, empty until first built.
+   */
+	std::vector<HistogramBucket>	histogram;
+
+  /**
+   * Number of entries the histogram was built from.
+   */
+	long		histogramEntries;
+
+  /**
+   * Page of the histogram in the index file, or 0 if it was never written.
+   */
+	PageId	histogramPageNum;
+
+  /**
+   * Whether the histogram changed since it was last written.
+   */
+	bool		histogramChanged;
+
+  /**
+   * Guards the histogram while it is read or rebuilt.
+   */
+	std::mutex	histogramLock;
+
+  /**
+   * Whether the index was opened with IndexOptions::appendOptimized.
+   */
+	bool		appendOptimized;
+
+  /**
+   * Fraction of the entries a node keeps when an append splits it.
+   */
+	double	appendFill;
+
+  /**
+   * Page number of the rightmost leaf, or 0 if not known. Only kept by single threaded
+   * append optimized indexes.
+   */
+	PageId	appendLeafNum;
+
+  /**
+   * Largest INTEGER key of the rightmost leaf.
+   */
+	int			appendMaxInt;
+
+  /**
+   * Largest DOUBLE key of the rightmost leaf.
+   */
+	double	appendMaxDouble;
+
+  /**
+   * Largest STRING key of the rightmost leaf.
+   */
+	StringKey	appendMaxString;
+
+  /**
+   * Largest variable-length STRING key of the rightmost leaf.
+   */
+	VarStringKey	appendMaxVarString;
+
+  /**
+   * Largest (INTEGER, INTEGER) key of the rightmost leaf.
+   */
+	IntPairKey	appendMaxIntPair;
+
+  /**
+   * Largest (INTEGER, DOUBLE) key of the rightmost leaf.
+   */
+	IntDoubleKey	appendMaxIntDouble;
+
+  /**
+   * Largest composite key of any other kind of the rightmost leaf.
+   */
+	CompositeKey	appendMaxComposite;
+
+  /**
+   * Largest key of the rightmost leaf for key type T.
+   */
+    template <class T>
+    T& appendMaxKey();
+
+  /**
+   * Calls to the typed helpers, one for each entry point that reaches them, run through
+   * dispatch. Defined in btree.cpp.
+   */
+    struct OccupancyOp;
+    struct BulkLoadOp;
+    struct InsertOp;
+    struct DeleteOp;
+    struct LookupOp;
+    struct StartScanOp;
+    struct ScanNextOp;
+    struct ScanNextBatchOp;
+    struct ParallelScanOp;
+    struct StatisticsOp;
+    struct RefreshStatisticsOp;
+    struct EstimateRangeOp;
+    struct CountRangeOp;
+    struct RankOp;
+    struct SelectOp;
+
+  /**
+   * Runs op.run<T, L>() for the key type T and leaf layout L of the index and returns its
+   * result. The only place the key type and layout are looked at.
+   * @param op  The call to run.
+   */
+    template <class Op>
+    typename Op::Result dispatch(Op& op);
+
+  /**
+   * Runs op.run<T, L>() for key type T and the plain or posting list leaf layout.
+   * @param op  The call to run.
+   */
+    template <class T, class Op>
+    typename Op::Result dispatchLayout(Op& op);
+
+  /**
+   * Reads a key of type T from a user supplied key pointer, or from the attribute of a
+   * record for a single attribute index, and from the whole record for a composite one.
+   * @param ptr The key or record.
+   */
+    template <class T>
+    T loadKey(const void* ptr);
+
+  /**
+   * Sets the key attributes from the given column on to their smallest or largest value,
+   * to bound a prefix scan. Does nothing for a single attribute index.
+   * @param key         The bound.
+   * @param numColumns  Number of leading attributes the bound gives.
+   * @param high        Whether to set them to their largest value.
+   */
+    template <class T>
+    const void boundKey(T& key, const int numColumns, const bool high);
+
+  /**
+   * Copies the included attributes of a record into a payload buffer.
+   * @param record  The record, or null for a payload of zeros.
+   * @param out     Buffer for payloadBytes bytes.
+   */
+    const void extractPayload(const char* record, char* out);
+
+  /**
+   * Zeroes a page to make it an empty leaf, recording the payload width in it for a
+   * covering index.
+   * @param page    The page.
+   */
+    const void clearLeaf(Page* page);
+
+  /**
+   * Opens the index file, or creates it and loads the relation into it. Shared by the
+   * constructors once the key attributes are set.
+   * @param relationName    Name of the base relation.
+   * @param indexName       Name of the index file.
+   * @param options         How to build the index if the file does not exist yet.
+   * @throws  BadIndexInfoException If the file exists but was built over other attributes.
+   */
+    const void openIndex(const std::string & relationName, const std::string & indexName,
+                         const IndexOptions & options);
+
+  /**
+   * Adds an entry to the end of the rightmost leaf if its key is not below any key there.
+   * @param data    The entry to be inserted.
+   * @param payload Included attributes of the entry.
+   * @return        False, with nothing changed, if the leaf is not known or is full.
+   */
+    template <class T, class L>
+    const bool appendToRightmostLeaf(const RIDKeyPair<T>& data, const char* payload);
+
+  /**
+   * Remembers a leaf and its largest key if it is the rightmost leaf of an append
+   * optimized single threaded index.
+   * @param leafNum Page number of the leaf.
+   * @param leaf    The pinned leaf.
+   */
+    template <class T, class L>
+    const void noteRightmostLeaf(PageId leafNum, Page* leaf);
+
+  /**
+   * Concurrent insert into a leaf that has room, holding only shared latches above it.
+   * @param data    The entry to be inserted.
+   * @param payload Included attributes of the entry.
+   * @return        False, with nothing changed, if the leaf is full and may split.
+   */
+    template <class T, class L>
+    const bool insertIntoSafeLeaf(const RIDKeyPair<T>& data, const char* payload);
+
+  /**
+   * Typed delete. Removes the entry from its leaf and rebalances the nodes on the way back up.
+   * @param key     Key of the entry.
+   * @param rid     Record ID of the entry.
+   * @return        True if the entry was found and removed.
+   */
+    template <class T, class L>
+    const bool deleteTyped(const T& key, const RecordId rid);
+
+  /**
+   * Concurrent delete from a leaf that stays at least half full, holding only shared
+   * latches above it.
+   * @param key     Key of the entry.
+   * @param rid     Record ID of the entry.
+   * @param removed Set to whether the entry was found and removed.
+   * @return        False, with nothing changed, if the leaf may underflow or the entry
+   *                may be in a leaf further right.
+   */
+    template <class T, class L>
+    const bool deleteFromSafeLeaf(const T& key, const RecordId rid, bool& removed);
+
+  /**
+   * Removes an entry from the subtree under a node, rebalancing any child left less
+   * than half full. The node is pinned and, in concurrent mode, latched exclusively.
+   * @param currPage    The node.
+   * @param isLeaf      Whether the node is a leaf.
+   * @param key         Key of the entry.
+   * @param rid         Record ID of the entry.
+   * @return            True if the entry was found and removed.
+   */
+    template <class T, class L>
+    const bool removeEntry(Page* currPage, bool isLeaf, const T& key, const RecordId rid);
+
+  /**
+   * Removes an entry from a leaf.
+   * @param leaf    The leaf.
+   * @param key     Key of the entry.
+   * @param rid     Record ID of the entry.
+   * @return        True if the leaf held the entry.
+   */
+    template <class T, class L>
+    const bool removeFromLeaf(Page* leaf, const T& key, const RecordId rid);
+
+  /**
+   * Refills a child that fell below half full, by moving entries over from a sibling
+   * under the same parent or by merging the two and freeing the right one. Unpins and
+   * unlatches the child.
+   * @param parent      The parent, pinned and exclusively latched.
+   * @param childIdx    Slot of the child in the parent.
+   * @param childPage   The child, pinned and exclusively latched.
+   * @param isLeaf      Whether the child is a leaf.
+   */
+    template <class T, class L>
+    const void rebalance(NonLeafNode<T>* parent, int childIdx, Page* childPage, bool isLeaf);
+
+  /**
+   * Latches a node in shared or exclusive mode. Does nothing unless the index is concurrent.
+   * @param pageNo      Page number of the node.
+   * @param exclusive   Whether to latch for writing.
+   */
+    const void latchPage(PageId pageNo, bool exclusive);
+
+  /**
+   * Releases the latch taken by latchPage.
+   * @param pageNo      Page number of the node.
+   */
+    const void unlatchPage(PageId pageNo);
+
+  /**
+   * Reads a node like bufMgr->readPage, from the node cache for a non-leaf when the
+   * index keeps one. Must be paired with unpinNode.
+   * @param pageNo      Page number of the node.
+   * @param page        Set to the frame of the node.
+   * @param isLeaf      Whether the node is a leaf.
+   */
+    const void readNode(PageId pageNo, Page*& page, bool isLeaf);
+
+  /**
+   * Releases a node read by readNode.
+   * @param pageNo      Page number of the node.
+   * @param isLeaf      Whether the node is a leaf.
+   * @param dirty       Whether the node was changed.
+   */
+    const void unpinNode(PageId pageNo, bool isLeaf, bool dirty);
+
+  /**
+   * Takes a node about to be disposed of out of the node cache.
+   * @param pageNo      Page number of the node.
+   */
+    const void dropNode(PageId pageNo);
+
+  /**
+   * Unpins every cached node, writing back the changed ones on the next flush. The cache
+   * fills up again as descents read the nodes.
+   */
+    const void releaseNodes();
+
+  /**
+   * Tells whether a node can take one more entry without splitting.
+   * @param page    The node.
+   * @param isLeaf  Whether the node is a leaf.
+   */
+    template <class T, class L>
+    const bool hasRoom(Page* page, bool isLeaf);
+
+  /**
+   * Typed insert. Builds the <key,rid> pair for key type T and descends from the root in a
+   * loop, keeping the nodes a split can reach on a fixed-size path stack.
+   * @param key     Key to insert.
+   * @param rid     Record ID of the record whose entry is getting inserted.
+   * @param payload Included attributes of the entry.
+   */
+    template <class T, class L>
+    const void insertTyped(const T& key, const RecordId rid, const char* payload);
+
+  /**
+   * Buffered insert. Adds the entry as a message to the buffer of the root, flushing the
+   * root first while its buffer is full. Goes straight to the leaf while the root is one.
+   * @param key     Key to insert.
+   * @param rid     Record ID of the record whose entry is getting inserted.
+   * @param payload Included attributes of the entry.
+   */
+    template <class T, class L>
+    const void bufferInsert(const T& key, const RecordId rid, const char* payload);
+
+  /**
+   * Passes the messages of a non-leaf that are bound for its fullest child down one
+   * level, making room in its buffer. Into a non-leaf child they go as a batch, after
+   * flushing the child as often as it takes to make room; into a leaf they go as inserts,
+   * splitting nodes on the way back up as usual.
+   * @param nodeNum Page number of the non-leaf.
+   */
+    template <class T, class L>
+    const void flushBuffer(PageId nodeNum);
+
+  /**
+   * Passes every pending message with a key in [lowVal, highVal] down to the leaves,
+   * before a read or delete of the range.
+   * @param lowVal  Lowest key of the range.
+   * @param highVal Highest key of the range.
+   */
+    template <class T, class L>
+    const void flushRange(const T& lowVal, const T& highVal);
+
+  /**
+   * Takes the messages with a key in [lowVal, highVal] out of the buffers of a non-leaf
+   * and the non-leaves below it that cover part of the range.
+   * @param nodeNum Page number of the non-leaf.
+   * @param depth   Depth of the non-leaf, 0 for the root.
+   * @param lowVal  Lowest key of the range.
+   * @param highVal Highest key of the range.
+   * @param byDepth Receives the messages of the nodes at each depth, oldest first.
    */
-	char relationName[20];
+    template <class T>
+    const void takeRange(PageId nodeNum, int depth, const T& lowVal, const T& highVal,
+                         std::vector<MessageBatch<T> >& byDepth);
 
   /**
-   * Offset of attribute, over which index is built, inside the record stored in pages.
+   * Passes every pending message down to the leaves.
    */
-	int attrByteOffset;
+    template <class T, class L>
+    const void flushAll();
 
   /**
-   * Type of the attribute over which index is built.
+   * Takes every message out of the buffers of a non-leaf and the non-leaves below it.
+   * @param nodeNum Page number of the non-leaf.
+   * @param depth   Depth of the non-leaf, 0 for the root.
+   * @param byDepth Receives the messages of the nodes at each depth, oldest first.
    */
-	Datatype attrType;
+    template <class T>
+    const void takeAll(PageId nodeNum, int depth, std::vector<MessageBatch<T> >& byDepth);
 
   /**
-   * Page number of root page of the B+ Tree inside the file index file.
+   * Inserts messages taken out of the buffers into the leaves, from the deepest buffers up.
+   * @param byDepth The messages of the nodes at each depth, oldest first.
    */
-	PageId rootPageNo;
-};
+    template <class T, class L>
+    const void insertMessages(const std::vector<MessageBatch<T> >& byDepth);
 
-/*
-Each node is a page, so once we read the page in we just cast the pointer to the page to this struct and use it to access the parts
-These structures basically are the format in which the information is stored in the pages for the index file depending on what kind of
-node they are. The level memeber of each non leaf structure seen below is set to 1 if the nodes
-at this level are just above the leaf nodes. Otherwise set to 0.
-*/
+  /**
+   * Whether an entry with the key may be in the index: false only if the Bloom filter
+   * rules it out. True for an index without a filter.
+   * @param key     The key.
+   */
+    template <class T>
+    const bool mayContain(const T& key);
 
-/**
- * @brief Structure for all non-leaf nodes when the key is of INTEGER type.
-*/
-struct NonLeafNodeInt{
   /**
-   * Level of the node in the tree.
+   * Adds a key to the Bloom filter, if the index has one, before its entry is inserted.
+   * @param key     The key.
    */
-	int level;
+    template <class T>
+    const void addToFilter(const T& key);
 
   /**
-   * Stores keys.
+   * Rebuilds the Bloom filter, sized for twice the keys it holds, once it holds more than
+   * it was sized for. Only done by indexes that are not concurrent.
    */
-	int keyArray[ INTARRAYNONLEAFSIZE ];
+    template <class T, class L>
+    const void growFilter();
 
   /**
-   * Stores page numbers of child pages which themselves are other non-leaf/leaf nodes in the tree.
+   * Adds the keys of every entry of a subtree to the Bloom filter, along with the keys
+   * of the pending messages in its non-leaf nodes.
+   * @param pageNo  Page number of the root of the subtree.
+   * @param isLeaf  Whether it is a leaf.
    */
-	PageId pageNoArray[ INTARRAYNONLEAFSIZE + 1 ];
-};
+    template <class T, class L>
+    const void filterSubtree(PageId pageNo, bool isLeaf);
 
+  /**
+   * Typed statistics. Fills in the height and the smallest and largest key, which are
+   * found by descending to the leftmost and rightmost leaf.
+   * @param stats   The statistics.
+   */
+    template <class T, class L>
+    const void statisticsTyped(IndexStats& stats);
 
-/**
- * @brief Structure for all leaf nodes when the key is of INTEGER type.
-*/
-struct LeafNodeInt{
   /**
-   * Stores keys.
+   * Finds the smallest or largest key in the tree along with its height. Goes past leaves
+   * left empty while a scan was open.
+   * @param last    Whether to find the largest key.
+   * @param key     Set to the key.
+   * @param height  Set to the number of levels of the tree.
+   * @return        False if the index is empty.
    */
-	int keyArray[ INTARRAYLEAFSIZE ];
+    template <class T, class L>
+    const bool edgeKey(const bool last, T& key, int& height);
 
   /**
-   * Stores RecordIds.
+   * Rebuilds the histogram and recounts the entries and leaves in one pass over the
+   * leaves, from left to right.
    */
-	RecordId ridArray[ INTARRAYLEAFSIZE ];
+    template <class T, class L>
+    const void refreshStatisticsTyped();
 
   /**
-   * Page number of the leaf on the right side.
-	 * This linking of leaves allows to easily move from one leaf to the next leaf during index scan.
+   * Estimates the entries with keys between two positions from the histogram.
+   * @param lowPos        Position of the low bound.
+   * @param lowInclusive  Whether the low bound is in the range.
+   * @param highPos       Position of the high bound.
+   * @param highInclusive Whether the high bound is in the range.
+   * @return              Estimated number of entries.
    */
-	PageId rightSibPageNo;
-};
+    const long estimatePositions(const double lowPos, const bool lowInclusive, const double highPos,
+                                 const bool highInclusive);
 
+  /**
+   * Reads the counts and the histogram recorded in the meta page.
+   * @param metaInfo  The meta page.
+   */
+    const void loadStatistics(const IndexMetaInfo* metaInfo);
 
-/**
- * @brief BTreeIndex class. It implements a B+ Tree index on a single attribute of a
- * relation. This index supports only one scan at a time.
-*/
-class BTreeIndex {
+    /**
+     * Returns the number of entries with keys less than key, or not greater than key if
+     * inclusive is set. Counted nodes are added up on one descent; otherwise the leaves
+     * are read from the first one until the key is passed.
+     */
+    template <class T, class L>
+    const long rankTyped(const T& key, const bool inclusive);
 
- private:
+    /**
+     * Finds the entry at a position in key order, on one descent through counted nodes
+     * or by reading the leaves from the first one.
+     * @return          False if the index holds no more than position entries.
+     */
+    template <class T, class L>
+    const bool selectTyped(const long position, RecordId& outRid);
 
   /**
-   * File object for the index file.
+   * Records the counts in the meta page and writes the histogram to its page if it changed.
    */
-	File		*file;
+    const void saveStatistics();
 
   /**
-   * Buffer Manager Instance.
+   * Reads the Bloom filter recorded in the meta page from the index file.
+   * @param metaInfo  The meta page.
    */
-	BufMgr	*bufMgr;
+    const void loadFilter(const IndexMetaInfo* metaInfo);
 
   /**
-   * Page number of meta page.
+   * Writes the Bloom filter to its pages of the index file, allocating the pages it does
+   * not have yet, and records it in the meta page. Does nothing if nothing was added
+   * since the filter was last written.
    */
-	PageId	headerPageNum;
+    const void saveFilter();
 
   /**
-   * page number of root page of B+ tree inside index file.
+   * Builds the tree for key type T from the relation in one pass. The (key, rid) pairs are
+   * extracted with FileScan and sorted, spilling sorted runs to disk when they exceed the
+   * sort buffer. Leaves are then filled left to right up to the fill factor, starting at the
+   * empty root leaf, and the non-leaf levels are built bottom up from the first key of
+   * every node of the level below.
+   * @param relationName    Name of the base relation.
+   * @param options         Fill factor and sort buffer size.
    */
-	PageId	rootPageNum;
+    template <class T, class L>
+    const void bulkLoad(const std::string & relationName, const IndexOptions & options);
+
+    /**
+     * This method enters a new data node into a branch node structure, right
+     * after the child it was split from.
+     * @param branch    The branch to be added to.
+     * @param slot      Slot of the child that was split.
+     * @param data      The data to add to said branch node.
+     */
+    template <class T>
+    const void addToBranch(NonLeafNode<T>* branch, int slot, const PageKeyPair<T>& data);
+
+    /**
+     * Returns the slot of the first key of a non-leaf that is not less than key, through
+     * the node's search directory when the index keeps them.
+     * @param node      The non-leaf to search.
+     * @param key       The key to search for.
+     */
+    template <class T>
+    int childLowerBound(const NonLeafNode<T>* node, const T& key) const;
+
+    /**
+     * Returns the slot of the first key of a non-leaf that is greater than key, which is
+     * the slot of the child that covers key.
+     * @param node      The non-leaf to search.
+     * @param key       The key to search for.
+     */
+    template <class T>
+    int childUpperBound(const NonLeafNode<T>* node, const T& key) const;
+
+    /**
+     * Rebuilds the search directory of a non-leaf after its keys changed. Does nothing
+     * unless the index keeps directories.
+     * @param node      The non-leaf that changed.
+     */
+    template <class T>
+    const void indexNode(NonLeafNode<T>* node);
+
+    /**
+     * Returns the subtree counts of a non-leaf, one for each child, which follow the
+     * nodeOccupancy keys of the key array when the index keeps them.
+     * @param node      The non-leaf.
+     */
+    template <class T>
+    long* childCounts(NonLeafNode<T>* node) const;
+
+    /**
+     * Whether the non-leaves of T keep subtree counts. Always false for the slotted
+     * VarStringKey nodes, so the compiler drops the count updates for them.
+     */
+    template <class T>
+    bool keepsCounts() const;
+
+    /**
+     * Returns the number of entries under a non-leaf, the sum of its subtree counts.
+     * @param node      The non-leaf.
+     */
+    template <class T>
+    long subtreeCount(NonLeafNode<T>* node) const;
+
+
+    /**
+     * This method updates the root of the B-Tree. In this case, the root needs to be split
+     * and entries pushed up the tree.
+     * @param firstNode     This is the page number of the first entry of the root.
+     * @param child         This is the entry that needs to be propogated upwards
+     *                      after the split occurs.
+     * @param firstCount    Number of entries under the first node, for counted nodes.
+     */
+    template <class T>
+    const void newRoot(PageId firstNode, const PageKeyPair<T>& child, long firstCount);
+
+
+    /**
+     * This method splits the branch so that the child entry can be entered into the tree.
+     * First, a new branch page is allocated memory, then half the array is copied over from
+     * the old branch node to the new one. Changes are made to the array to reflect this
+     * split.
+     * @param child     The entry that will need to be entered after the splitting occurs.
+     *                  Replaced by the entry for the new node.
+     * @param old       The node that will be split in this function.
+     * @param oldNum    PageId that was used to index the node to be split.
+     * @param slot      Slot of the child of old that was split.
+     */
+    template <class T>
+    const void branchSplit(PageKeyPair<T>& child, NonLeafNode<T>* old,
+                           PageId oldNum, int slot);
+
+
+    /**
+     * This method splits a full leaf so that an entry with the given key can be added
+     * into the tree. First, a new leaf node is allocated memory, then the upper part
+     * of the old leaf's entries is moved over to the new one. Sibling pointers are
+     * properly changed. If need be, update the root.
+     * @param child     Set to the entry for the new leaf, to be propogated upwards in the tree.
+     * @param old       The old leaf node to be split.
+     * @param oldNum    The page number of the old leaf node to be split.
+     * @param key       Key of the entry that did not fit, which picks the split point.
+     */
+    template <class T, class L>
+    const void leafSplit(PageKeyPair<T>& child, Page* old, PageId oldNum, const T& key);
+
+    /**
+     * Points the left sibling link of a leaf at another leaf, latching the leaf for as
+     * long as it takes. Used once the leaf's old left neighbour was split or merged away.
+     * @param leafNum   Page number of the leaf to change.
+     * @param leftNum   Page number of its new left sibling.
+     */
+    template <class L>
+    const void setLeftLink(PageId leafNum, PageId leftNum);
 
   /**
-   * Datatype of attribute over which index is built.
+   * Typed lookup. Descends to the leftmost leaf that can hold the key and collects the
+   * matching entries, following the right sibling while they run to the end of a leaf.
+   * @param key     Key to look up.
+   * @param outRids Receives the record ids of the matches, or null to stop at the first.
+   * @return        Number of matches found.
    */
-	Datatype	attributeType;
+    template <class T, class L>
+    const int lookupTyped(const T& key, std::vector<RecordId>* outRids);
 
   /**
-   * Offset of attribute, over which index is built, inside records.
+   * Typed scan setup. Positions the scan on the first entry that satisfies the range.
+   * @param cursor    The cursor to position.
+   * @param lowVal    Low value of range.
+   * @param highVal   High value of range.
+   * @throws  BadScanrangeException If lowVal > highval
+   * @throws  NoSuchKeyFoundException If there is no key in the B+ tree that satisfies the scan criteria.
    */
-	int 		attrByteOffset;
+    template <class T, class L>
+    const void startScanTyped(IndexScanCursor& cursor, const T& lowVal, const T& highVal);
 
   /**
-   * Number of keys in leaf node, depending upon the type of key.
+   * Typed scanNext.
+   * @param cursor      The cursor to advance.
+   * @param outRid      RecordId of next record found that satisfies the scan criteria returned in this
+   * @param outPayload  Receives the included attributes of the entry, or null.
+   * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
    */
-	int			leafOccupancy;
+    template <class T, class L>
+    const void scanNextTyped(IndexScanCursor& cursor, RecordId& outRid, char* outPayload);
 
   /**
-   * Number of keys in non-leaf node, depending upon the type of key.
+   * Typed scanNextBatch.
+   * @param cursor      The cursor to advance.
+   * @param outRids     Buffer for at least maxRids record ids.
+   * @param outPayloads Buffer for the included attributes of at least maxRids entries, or null.
+   * @param maxRids     Most record ids to return.
+   * @return            Number of record ids returned, 0 at the end of the scan.
    */
-	int			nodeOccupancy;
+    template <class T, class L>
+    const int scanNextBatchTyped(IndexScanCursor& cursor, RecordId* outRids, char* outPayloads,
+                                 const int maxRids);
 
-
-	// MEMBERS SPECIFIC TO SCANNING
+  /**
+   * Typed scanNext of a descending scan.
+   * @param cursor      The cursor to advance.
+   * @param outRid      RecordId of next record found that satisfies the scan criteria returned in this
+   * @param outPayload  Receives the included attributes of the entry, or null.
+   * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
+   */
+    template <class T, class L>
+    const void scanPrevTyped(IndexScanCursor& cursor, RecordId& outRid, char* outPayload);
 
   /**
-   * True if an index scan has been started.
+   * Typed scanNextBatch of a descending scan. Entries come back from the largest key down.
+   * @param cursor      The cursor to advance.
+   * @param outRids     Buffer for at least maxRids record ids.
+   * @param outPayloads Buffer for the included attributes of at least maxRids entries, or null.
+   * @param maxRids     Most record ids to return.
+   * @return            Number of record ids returned, 0 at the end of the scan.
    */
-	bool		scanExecuting;
+    template <class T, class L>
+    const int scanPrevBatchTyped(IndexScanCursor& cursor, RecordId* outRids, char* outPayloads,
+                                 const int maxRids);
 
   /**
-   * Index of next entry to be scanned in current leaf being scanned.
+   * Finds where the range ends in the cursor's leaf copy, setting runEnd and lastRun.
+   * @param cursor  The cursor positioned on a leaf.
    */
-	int			nextEntry;
+    template <class T, class L>
+    const void findRunEnd(IndexScanCursor& cursor);
 
   /**
-   * Page number of current page being scanned.
+   * Typed parallel scan. Splits the range and runs scanPart for each part on a thread of
+   * its own.
+   * @param lowVal      The low value of the range.
+   * @param lowOp       Low operator (GT/GTE).
+   * @param highVal     The high value of the range.
+   * @param highOp      High operator (LT/LTE).
+   * @param numWorkers  Most parts to split the range into.
+   * @param consumer    Receives the entries of each part.
+   * @return            Number of entries scanned.
    */
-	PageId	currentPageNum;
+    template <class T, class L>
+    const long parallelScanTyped(const T& lowVal, const Operator lowOp, const T& highVal,
+                                 const Operator highOp, const int numWorkers,
+                                 const ScanPartConsumer& consumer);
 
   /**
-   * Current Page being scanned.
+   * Picks up to parts - 1 separator keys strictly between lowVal and highVal from the
+   * highest level of non-leaves whose nodes over the range hold that many, evenly spaced
+   * among them, so that the parts between them span about as many leaves each.
+   * @param lowVal  The low value of the range.
+   * @param highVal The high value of the range.
+   * @param parts   Most parts wanted.
+   * @param seps    Receives the separators in ascending order, none equal.
    */
-	Page		*currentPageData;
+    template <class T>
+    const void splitRange(const T& lowVal, const T& highVal, const int parts, std::vector<T>& seps);
 
   /**
-   * Low INTEGER value for scan.
+   * Scans one part of a parallel scan with a cursor of its own and passes its entries on.
+   * @param part        Number of the part.
+   * @param lowVal      The low value of the part.
+   * @param lowOp       Low operator (GT/GTE).
+   * @param highVal     The high value of the part.
+   * @param highOp      High operator (LT/LTE).
+   * @param consumer    Receives the entries.
+   * @return            Number of entries scanned.
    */
-	int			lowValInt;
+    template <class T, class L>
+    const long scanPart(const int part, const T& lowVal, const Operator lowOp, const T& highVal,
+                        const Operator highOp, const ScanPartConsumer& consumer);
 
   /**
-   * Low DOUBLE value for scan.
+   * Finds where the range starts in the cursor's leaf copy, setting runStart and lastRun
+   * for a descending scan.
+   * @param cursor  The cursor positioned on a leaf.
    */
-	double	lowValDouble;
+    template <class T, class L>
+    const void findRunStart(IndexScanCursor& cursor);
 
   /**
-   * Low STRING value for scan.
+   * Moves the cursor to the start of the right sibling of its leaf.
+   * @param cursor  The cursor, which must not be on its last run.
    */
-	std::string	lowValString;
+    template <class T, class L>
+    const void nextLeaf(IndexScanCursor& cursor);
 
   /**
-   * High INTEGER value for scan.
+   * Copies the left sibling of the cursor's leaf into the cursor. If that leaf has split
+   * since the cursor's copy was taken, its right sibling link is followed to the leaf
+   * that now comes right before the cursor's.
+   * @param cursor  The cursor, positioned on a leaf with a left sibling.
    */
-	int			highValInt;
+    template <class T, class L>
+    const void copyLeftSib(IndexScanCursor& cursor);
 
   /**
-   * High DOUBLE value for scan.
+   * Moves the cursor to the end of the left sibling of its leaf.
+   * @param cursor  The cursor, which must not be on its last run.
    */
-	double	highValDouble;
+    template <class T, class L>
+    const void prevLeaf(IndexScanCursor& cursor);
 
   /**
-   * High STRING value for scan.
+   * Wakes the prefetch thread for a cursor that has moved to another leaf, once half of
+   * the leaves read ahead for it are used up.
+   * @param cursor  The cursor.
    */
-	std::string highValString;
+    const void leafCopied(IndexScanCursor& cursor);
 
   /**
-   * Low Operator. Can only be GT(>) or GTE(>=).
+   * Puts a cursor in the read-ahead queue, starting the prefetch thread if it is not
+   * running yet.
+   * @param cursor    The cursor to read ahead for.
+   * @param firstNum  Page number of the leaf after the one the scan started on.
    */
-	Operator	lowOp;
+    template <class T, class L>
+    const void startReadAhead(IndexScanCursor& cursor, PageId firstNum);
 
   /**
-   * High Operator. Can only be LT(<) or LTE(<=).
+   * Body of the prefetch thread. Serves the cursors in the queue in turn, one leaf at a
+   * time, following the leaf chain of each in the direction of its scan. Each leaf is
+   * pinned just long enough to read it into the buffer pool and find its next sibling,
+   * and no cursor is read for more than readAheadLeaves leaves ahead. The chain of a
+   * cursor ends at the leaf that reaches the far bound of its scan, at the end of the
+   * leaves, or when the buffer pool has no frame left. Runs until prefetchStop is set.
    */
-	Operator	highOp;
+    template <class T, class L>
+    const void prefetchLeaves();
 
   /**
-   * Used as an extra reference to the root page initialized with the BTree.
+   * Copies a leaf into a cursor and lets go of it. The leaf must be pinned, and latched
+   * shared for a concurrent index.
+   * @param cursor  The cursor to position on the leaf.
+   * @param leafNum Page number of the leaf.
+   * @param leaf    The pinned leaf.
    */
-	PageId firstRootNum;
+    const void copyLeaf(IndexScanCursor& cursor, PageId leafNum, Page* leaf);
+
+    /**
+     * This method checks the key against the passed in operators to determine whether
+     * or not the key is valid.
+     * @param lowVal    The low value to be tested.
+     * @param lowOp     Operation used in testing the low range. (GT and GTE)
+     * @param highVal   The high value to be tested.
+     * @param highOp    Operation used in testing the high range. (LT and LTE)
+     * @param key       The key to check the operations against.
+     * @return          Returns 1 if the key lies within the parameters of lowOp
+     *                  and highOp, else 1.
+     */
+    template <class T>
+    const int keyOpCodes(const T& lowVal, const Operator lowOp, const T& highVal,
+                         const Operator highOp, const T& key);
 
 
  public:
@@ -302,17 +2612,39 @@ class BTreeIndex {
   /**
    * BTreeIndex Constructor.
 	 * Check to see if the corresponding index file exists. If so, open the file.
-	 * If not, create it and insert entries for every tuple in the base relation using FileScan class.
+	 * If not, create it and load entries for every tuple in the base relation using FileScan class,
+	 * either by bulk loading or by inserting them one at a time.
    *
    * @param relationName        Name of file.
    * @param outIndexName        Return the name of index file.
    * @param bufMgrIn						Buffer Manager Instance
    * @param attrByteOffset			Offset of attribute, over which index is to be built, in the record
    * @param attrType						Datatype of attribute over which index is built
-   * @throws  BadIndexInfoException     If the index file already exists for the corresponding attribute, but values in metapage(relationName, attribute byte offset, attribute type etc.) do not match with values received through constructor parameters.
+   * @param options							How to build the index if the file does not exist yet
+   * @throws  BadIndexInfoException     If the index file already exists for the corresponding attribute, but values in metapage(relationName, attribute byte offset, attribute type etc.) do not match with values received through constructor parameters, or options.stringKeyLength is negative or above MAXSTRINGKEY.
+   */
+	BTreeIndex(const std::string & relationName, std::string & outIndexName,
+						BufMgr *bufMgrIn,	const int attrByteOffset,	const Datatype attrType,
+						const IndexOptions & options = IndexOptions());
+
+  /**
+   * Composite key BTreeIndex Constructor. Builds or opens an index on several attributes
+   * of the relation, ordered by the first attribute, then the second, and so on.
+   * Keys passed to the index, to insertEntry, lookup and the scans alike, are laid out
+   * like records of the relation: each attribute at its offset.
+   * (INTEGER, INTEGER) and (INTEGER, DOUBLE) keys are compared field by field; other lists
+   * are stored as a CompositeKey and compared bytewise.
+   *
+   * @param relationName        Name of file.
+   * @param outIndexName        Return the name of index file.
+   * @param bufMgrIn						Buffer Manager Instance
+   * @param keyAttributes				Attributes of the key, in key order
+   * @param options							How to build the index if the file does not exist yet
+   * @throws  BadIndexInfoException     If there are fewer than 2 or more than MAXKEYATTRIBUTES attributes, they do not fit in a CompositeKey, or the index file already exists but was built over other attributes.
    */
 	BTreeIndex(const std::string & relationName, std::string & outIndexName,
-						BufMgr *bufMgrIn,	const int attrByteOffset,	const Datatype attrType);
+						BufMgr *bufMgrIn,	const std::vector<KeyAttribute> & keyAttributes,
+						const IndexOptions & options = IndexOptions());
 
 
   /**
@@ -326,7 +2658,7 @@ class BTreeIndex {
 
   /**
 	 * Insert a new entry using the pair <value,rid>.
-	 * Start from root to recursively find out the leaf to insert the entry in. The insertion may cause splitting of leaf node.
+	 * Start from root to find out the leaf to insert the entry in. The insertion may cause splitting of leaf node.
 	 * This splitting will require addition of new leaf page number entry into the parent non-leaf, which may in-turn get split.
 	 * This may continue all the way upto the root causing the root to get split. If root gets split, metapage needs to be changed accordingly.
 	 * Make sure to unpin pages as soon as you can.
@@ -335,122 +2667,226 @@ class BTreeIndex {
 	**/
 	const void insertEntry(const void* key, const RecordId rid);
 
-	 /**
-         * This method attempts to find space in the file to insert values by utilizing
-         * recursive calls to search through the nodes in the tree.
-         * @param curr      The current page being searched through.
-         * @param currNum   The pageid of the current page being searched through.
-         * @param data      The entry to be inserted into the tree.
-         * @param level     The value indicating whether or not a node is a branch or a leaf.
-         * @param child     Placeholder for an entry that needs to be propogated up the
-         *                  tree. Only utilized when splitting a node.
-     */
-    const void findSpace(Page* curr, PageId currNum, RIDKeyPair<int> data,
-                         int level, PageKeyPair<int>* &child);
-
-
-    /**
-     * This method iterates through a branch node structure and finds the right place
-     * to enter a new data node.
-     * @param branch    The branch to be added to.
-     * @param data      The data to add to said branch node.
-     */
-    const void addToBranch(NonLeafNodeInt* branch, PageKeyPair<int>* data);
-
-
-    /**
-     * This method iterates through a leaf node structure and finds the right place to
-     * insert the data read from the file.
-     * @param leaf      The leaf node to be added to.
-     * @param data      The data to add to said leaf node.
-     */
-    const void addToLeaf(LeafNodeInt* leaf, RIDKeyPair<int> data);
-
-    /**
-     * This method updates the root of the B-Tree. In this case, the root needs to be split
-     * and entries pushed up the tree.
-     * @param firstNode     This is the page number of the first entry of the root.
-     * @param child         This is the entry that needs to be propogated upwards
-     *                      after the split occurs.
-     */
-    const void newRoot(PageId firstNode, PageKeyPair<int>* child);
+  /**
+	 * Insert a new entry into a covering index, with the included attributes copied from the
+	 * record. insertEntry without a record stores zeros for them.
+   * @param key			Key to insert, pointer to integer/double/char string
+   * @param rid			Record ID of a record whose entry is getting inserted into the index.
+   * @param record	The record, which the included attributes are read from.
+	**/
+	const void insertEntry(const void* key, const RecordId rid, const void* record);
 
+  /**
+	 * Number of bytes of included attributes each entry carries, 0 unless the index is covering.
+	**/
+	const int payloadSize() const;
 
-    /**
-     * This method splits the branch so that the child entry can be entered into the tree.
-     * First, a new branch page is allocated memory, then half the array is copied over from
-     * the old branch node to the new one. Changes are made to the array to reflect this
-     * split.
-     * @param child     The entry that will need to be entered after the splitting occurs.
-     * @param old       The node that will be split in this function.
-     * @param oldNum    PageId that was used to index the node to be split.
-     */
-    const void branchSplit(PageKeyPair<int>* &child, NonLeafNodeInt* old,
-                           PageId oldNum);
+  /**
+	 * Delete the entry <key,rid>.
+	 * The entry is removed from its leaf. A leaf left less than half full takes entries from a sibling, or is merged with it
+	 * and the parent loses a key, which may leave the parent less than half full in turn. This may continue up to the root,
+	 * which is replaced by its only child once it has no keys left. Pages of merged nodes are given back to the index file.
+	 * While a scan is open, leaves are left as they are, however empty.
+   * @param key			Key of the entry, pointer to integer/double/char string
+   * @param rid			Record ID of the record whose entry is deleted.
+   * @return				True if the entry was found and removed.
+	**/
+	const bool deleteEntry(const void* key, const RecordId rid);
 
+  /**
+	 * Find all entries with the given key in one descent. Unlike an equality scan it sets up no scan
+	 * state and throws no exception when nothing matches.
+   * @param key			Key to look up, pointer to integer/double/char string
+   * @param outRids	Cleared, then filled with the record ids of the matching entries in index order.
+   * @return				Number of matching entries.
+	**/
+	const int lookup(const void* key, std::vector<RecordId>& outRids);
 
-    /**
-     * This method splits a leaf so that the child entry can be added into the tree.
-     * First, a new leaf node is allocated memory, then half of the old leaf's array
-     * is copied over to the new one. Sibling pointers are properly changed and the
-     * new data to be entered is added to the correct leaf node. If need be, update
-     * the root.
-     * @param child     The data that needs to be propogated upwards in the tree.
-     * @param old       The old leaf node to be split.
-     * @param oldNum    The page number of the old leaf node to be split.
-     * @param data      The data entry to be added to the tree.
-     */
-    const void leafSplit(PageKeyPair<int>* &child, LeafNodeInt* old, PageId oldNum,
-                         RIDKeyPair<int> data);
+  /**
+	 * Tell whether any entry has the given key. Stops at the first match.
+   * @param key			Key to look for, pointer to integer/double/char string
+   * @return				True if the index holds the key.
+	**/
+	const bool contains(const void* key);
 
     /**
        * Begin a filtered scan of the index.  For instance, if the method is called
        * using ("a",GT,"d",LTE) then we should seek all entries with a value
        * greater than "a" and less than or equal to "d".
        * If another scan is already executing, that needs to be ended here.
-       * Set up all the variables for scan. Start from root to find out the leaf page that contains the first RecordID
-       * that satisfies the scan parameters. Keep that page pinned in the buffer pool.
+       * Runs on the built-in cursor; see IndexScanCursor for scans that run side by side.
      * @param lowVal	Low value of range, pointer to integer / double / char string
      * @param lowOp		Low operator (GT/GTE)
      * @param highVal	High value of range, pointer to integer / double / char string
      * @param highOp	High operator (LT/LTE)
+     * @param order		Whether to return the range from the low or the high end
      * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
      * @throws  BadScanrangeException If lowVal > highval
        * @throws  NoSuchKeyFoundException If there is no key in the B+ tree that satisfies the scan criteria.
       **/
-	const void startScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
+	const void startScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp,
+	                     const ScanOrder order = ASCENDING);
+
+    /**
+	 * Begin a scan of a composite index bounded on its leading numColumns attributes only.
+	 * Runs on the built-in cursor; see IndexScanCursor::startPrefixScan.
+     * @param lowVal		Low value of range, laid out like a record of the relation
+     * @param lowOp			Low operator (GT/GTE)
+     * @param highVal		High value of range, laid out like a record of the relation
+     * @param highOp		High operator (LT/LTE)
+     * @param numColumns	Number of leading key attributes the bounds give.
+     * @param order			Whether to return the range from the low or the high end
+	**/
+	const void startPrefixScan(const void* lowVal, const Operator lowOp, const void* highVal,
+	                           const Operator highOp, const int numColumns, const ScanOrder order = ASCENDING);
 
 
     /**
 	 * Fetch the record id of the next index entry that matches the scan.
-	 * Return the next record from current page being scanned. If current page has been scanned to its entirety, move on to the right sibling of current page, if any exists, to start scanning that page. Make sure to unpin any pages that are no longer required.
+	 * Return the next record from current page being scanned. If current page has been scanned to its entirety, move on to the right sibling of current page, if any exists, to start scanning that page.
      * @param outRid	RecordId of next record found that satisfies the scan criteria returned in this
 	 * @throws ScanNotInitializedException If no scan has been initialized.
 	 * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
 	**/
 	const void scanNext(RecordId& outRid);  // returned record id
 
+    /**
+	 * Fetch the record id and included attributes of the next index entry that matches the
+	 * scan of the built-in cursor. See IndexScanCursor::scanNext.
+     * @param outRid		RecordId of next record found that satisfies the scan criteria returned in this
+     * @param outPayload	Receives the included attributes of the entry, payloadSize() bytes.
+	**/
+	const void scanNext(RecordId& outRid, void* outPayload);
+
 
     /**
-     * This method checks the key against the passed in operators to determine whether
-     * or not the key is valid.
-     * @param lowVal    The low value to be tested.
-     * @param lowOp     Operation used in testing the low range. (GT and GTE)
-     * @param highVal   The high value to be tested.
-     * @param highOp    Operation used in testing the high range. (LT and LTE)
-     * @param key       The key to check the operations against.
-     * @return          Returns 1 if the key lies within the parameters of lowOp
-     *                  and highOp, else 1.
-     */
-    const int keyOpCodes(int lowVal, const Operator lowOp, int highVal,
-                                     const Operator highOp, int key);
+	 * Fetch the record ids of up to maxRids next index entries that match the scan of the
+	 * built-in cursor. End of the scan is signalled by the return value, not an exception.
+     * @param outRids	Buffer for at least maxRids record ids.
+     * @param maxRids	Most record ids to return.
+     * @return			Number of record ids returned, 0 once the scan is complete.
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	**/
+	const int scanNextBatch(RecordId* outRids, const int maxRids);
+
+    /**
+	 * Fetch the record ids and included attributes of up to maxRids next index entries that
+	 * match the scan of the built-in cursor. See IndexScanCursor::scanNextBatch.
+     * @param outRids		Buffer for at least maxRids record ids.
+     * @param outPayloads	Buffer for at least maxRids payloads of payloadSize() bytes.
+     * @param maxRids		Most entries to return.
+     * @return				Number of entries returned, 0 once the scan is complete.
+	**/
+	const int scanNextBatch(RecordId* outRids, void* outPayloads, const int maxRids);
+
 
     /**
-	 * Terminate the current scan. Unpin any pinned pages. Reset scan specific variables.
+	 * Terminate the current scan. Reset scan specific variables.
 	 * @throws ScanNotInitializedException If no scan has been initialized.
 	**/
 	const void endScan();
 
+    /**
+	 * Scan a range with several threads at once. The range is split at separator keys of the
+	 * non-leaves into up to numWorkers parts that span about as many leaves each, and each
+	 * part is scanned in key order on a thread of its own with a cursor of its own. The
+	 * built-in cursor is left alone. Threads of a concurrent index may insert and delete
+	 * meanwhile, with what each cursor sees as for any other cursor.
+	 * Returns once every part has been scanned. The first exception a part throws, from the
+	 * scan or from the consumer, is thrown on from here once the others are done.
+     * @param lowVal		Low value of range, pointer to integer / double / char string
+     * @param lowOp			Low operator (GT/GTE)
+     * @param highVal		High value of range, pointer to integer / double / char string
+     * @param highOp		High operator (LT/LTE)
+     * @param numWorkers	Most threads to scan with. A range over few leaves gets fewer.
+     * @param consumer		Called from the scanning threads with the entries of each part,
+     * 						a batch at a time. Calls for one part come in key order, and calls
+     * 						for different parts at the same time; every key of part p is
+     * 						below every key of part p + 1.
+     * @return				Number of entries scanned, 0 if none lie in the range.
+     * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+     * @throws  BadScanrangeException If lowVal > highval
+	**/
+	const long parallelScan(const void* lowVal, const Operator lowOp, const void* highVal,
+	                        const Operator highOp, const int numWorkers, const ScanPartConsumer& consumer);
+
+    /**
+	 * Scan a range with several threads at once and collect the record ids in index order.
+	 * See parallelScan with a consumer.
+     * @param lowVal		Low value of range, pointer to integer / double / char string
+     * @param lowOp			Low operator (GT/GTE)
+     * @param highVal		High value of range, pointer to integer / double / char string
+     * @param highOp		High operator (LT/LTE)
+     * @param numWorkers	Most threads to scan with.
+     * @param outRids		Cleared, then filled with the record ids of the range in index order.
+     * @return				Number of entries scanned.
+	**/
+	const long parallelScan(const void* lowVal, const Operator lowOp, const void* highVal,
+	                        const Operator highOp, const int numWorkers, std::vector<RecordId>& outRids);
+
+    /**
+	 * Return the statistics of the index. The counts of entries and leaves are kept up to
+	 * date by every insert and delete; the histogram is as of the bulk load, the end of the
+	 * inserts that built the index, or the last refreshStatistics. A buffered index first
+	 * passes its pending messages down to the leaves.
+	 * @return				The statistics.
+	**/
+	const IndexStats statistics();
+
+    /**
+	 * Rebuild the histogram from the entries now in the index, reading every leaf once,
+	 * and recount the entries and leaves. Worth calling once the keys have changed much
+	 * since the histogram was built.
+	**/
+	const void refreshStatistics();
+
+    /**
+	 * Estimate the number of entries in a range from the histogram, without reading a
+	 * page. Buckets the range covers part of count for the share of their key positions
+	 * it covers, and a bound equal to a key adds the entries per key of its bucket. The
+	 * estimate is scaled by how much the index grew or shrank since the histogram was built.
+     * @param lowVal		Low value of range, pointer to integer / double / char string
+     * @param lowOp			Low operator (GT/GTE)
+     * @param highVal		High value of range, pointer to integer / double / char string
+     * @param highOp		High operator (LT/LTE)
+     * @return				Estimated number of entries in the range.
+     * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+     * @throws  BadScanrangeException If lowVal > highval
+	**/
+	const long estimateRange(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
+
+    /**
+	 * Count the entries in a range exactly. An index with IndexOptions::countedNodes reads
+	 * one node per level on the path to each end of the range, however many entries lie in
+	 * between; any other index reads the leaves up to the end of the range. A buffered
+	 * index first passes its pending messages down to the leaves.
+     * @param lowVal		Low value of range, pointer to integer / double / char string
+     * @param lowOp			Low operator (GT/GTE)
+     * @param highVal		High value of range, pointer to integer / double / char string
+     * @param highOp		High operator (LT/LTE)
+     * @return				Number of entries in the range.
+     * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+     * @throws  BadScanrangeException If lowVal > highval
+	**/
+	const long countRange(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
+
+    /**
+	 * Return the rank of a key: the number of entries with smaller keys, which is the
+	 * position in key order of the first entry with the key, if there is one.
+     * @param key			Pointer to integer / double / char string
+     * @return				Number of entries with keys less than key.
+	**/
+	const long rank(const void* key);
+
+    /**
+	 * Find the entry at a position in key order, counting from 0. Entries with equal keys
+	 * are in the order the index holds them.
+     * @param position		Position of the entry.
+     * @param outRid		Set to the record id of the entry.
+     * @return				False if position is negative or not less than the number of entries.
+	**/
+	const bool select(const long position, RecordId& outRid);
+
 };
 
 }
\ No newline at end of file
@@ -58,7 +58,7 @@ void BufMgr::allocBuf(FrameId & frame)
 {
   // perform first part of clock algorithm to search for 
   // open buffer frame
-  // Assumes non-concurrent access to buffer manager
+  // Called with bufLock held
   std::uint32_t numScanned = 0;
   bool found = 0;
 
@@ -119,41 +119,70 @@ void BufMgr::allocBuf(FrameId & frame)
 	
 void BufMgr::readPage(File* file, const PageId pageNo, Page*& page)
 {
+  std::unique_lock<std::mutex> guard(bufLock);
   // check to see if it is already in the buffer pool
   // std::cout << "readPage called on file.page " << file << "." << pageNo << endl;
   FrameId frameNo = 0;
-	try
-	{
-  	hashTable->lookup(file, pageNo, frameNo);
+  while (true)
+  {
+  	try
+  	{
+  		hashTable->lookup(file, pageNo, frameNo);
+  	}
+  	catch(HashNotFoundException e) //not in the buffer pool, must allocate a new page
+  	{
+  		break;
+  	}
+  	// Another call is reading the page in. Look again once it is done, since
+  	// the read may have failed and freed the frame.
+  	if (bufDescTable[frameNo].loading)
+  	{
+  		pageLoaded.wait(guard);
+  		continue;
+  	}
 
     // set the referenced bit
     bufDescTable[frameNo].refbit = true;
     bufDescTable[frameNo].pinCnt++;
     page = &bufPool[frameNo];
+    return;
   }
-  catch(HashNotFoundException e) //not in the buffer pool, must allocate a new page
-  {
-    // alloc a new frame
-    allocBuf(frameNo);
 
-    // read the page into the new frame
-    bufStats.diskreads++;
-    //status = file->readPage(pageNo, &bufPool[frameNo]);
-    bufPool[frameNo] = file->readPage(pageNo);
+  // alloc a new frame
+  allocBuf(frameNo);
 
-    // set up the entry properly
-    bufDescTable[frameNo].Set(file, pageNo);
-    page = &bufPool[frameNo];
+  // set up the entry properly and insert it in the hash table before the read, so
+  // that the pinned frame is not handed out again and the page is not read twice
+  bufDescTable[frameNo].Set(file, pageNo);
+  bufDescTable[frameNo].loading = true;
+  hashTable->insert(file, pageNo, frameNo);
+  bufStats.diskreads++;
 
-    // insert in the hash table
-    hashTable->insert(file, pageNo, frameNo);
+  // read the page into the new frame, letting other calls use the buffer pool meanwhile
+  guard.unlock();
+  try
+  {
+    bufPool[frameNo] = file->readPage(pageNo);
+  }
+  catch(...)
+  {
+    guard.lock();
+    hashTable->remove(file, pageNo);
+    bufDescTable[frameNo].Clear();
+    pageLoaded.notify_all();
+    throw;
   }
+  guard.lock();
+  bufDescTable[frameNo].loading = false;
+  pageLoaded.notify_all();
+  page = &bufPool[frameNo];
 }
 
 
 void BufMgr::unPinPage(File* file, const PageId pageNo, 
 			     const bool dirty) 
 {
+  std::lock_guard<std::mutex> guard(bufLock);
   // lookup in hashtable
   FrameId frameNo = 0;
   hashTable->lookup(file, pageNo, frameNo);
@@ -170,6 +199,7 @@ void BufMgr::unPinPage(File* file, const PageId pageNo,
 
 void BufMgr::flushFile(const File* file) 
 {
+  std::lock_guard<std::mutex> guard(bufLock);
   for (std::uint32_t i = 0; i < numBufs; i++)
 	{
   	BufDesc* tmpbuf = &(bufDescTable[i]);
@@ -195,6 +225,7 @@ void BufMgr::flushFile(const File* file)
 
 void BufMgr::disposePage(File* file, const PageId pageNo) 
 {
+  std::lock_guard<std::mutex> guard(bufLock);
 	//Deallocate from file altogether
   //See if it is in the buffer pool
   FrameId frameNo = 0;
@@ -212,6 +243,7 @@ void BufMgr::disposePage(File* file, const PageId pageNo)
 
 void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page) 
 {
+  std::lock_guard<std::mutex> guard(bufLock);
   FrameId frameNo;
 
   // alloc a new frame
@@ -231,6 +263,7 @@ void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page)
 
 void BufMgr::printSelf(void) 
 {
+  std::lock_guard<std::mutex> guard(bufLock);
   BufDesc* tmpbuf;
 	int validFrames = 0;
   
@@ -10,6 +10,8 @@
 #include "file.h"
 #include "bufHashTbl.h"
 #include <iostream>
+#include <mutex>
+#include <condition_variable>
 
 namespace badgerdb {
 
@@ -61,6 +63,11 @@ class BufDesc {
 	 */
   bool refbit;
 
+	/**
+   * True while readPage reads the page in from its file with the buffer pool unlocked
+	 */
+  bool loading;
+
 	/**
    * Initialize buffer frame for a new user
 	 */
@@ -72,6 +79,7 @@ class BufDesc {
     dirty = false;
     refbit = false;
 		valid = false;
+		loading = false;
   };
 
 	/**
@@ -89,6 +97,7 @@ class BufDesc {
     dirty = false;
     valid = true;
     refbit = true;
+    loading = false;
   }
 
   void Print()
@@ -157,6 +166,7 @@ struct BufStats
 
 /**
 * @brief The central class which manages the buffer pool including frame allocation and deallocation to pages in the file 
+* The public calls are serialized, so threads may share one buffer manager.
 */
 class BufMgr 
 {
@@ -187,6 +197,17 @@ class BufMgr
   BufStats bufStats;
 
 	/**
+   * Serializes the public calls. Held across the clock sweep and any file I/O they do,
+   * except the read of a page into a frame by readPage.
+	 */
+  std::mutex bufLock;
+
+	/**
+   * Signalled when readPage is done reading a page in, for the calls waiting on that page.
+	 */
+  std::condition_variable pageLoaded;
+
+	/**
 	 * Allocate a free frame.  
 	 *
 	 * @param frame   	Frame reference, frame ID of allocated frame returned via this variable
@@ -275,6 +296,14 @@ class BufMgr
 	 */
   void  printSelf();
 
+	/**
+   * Get the number of frames in the buffer pool
+	 */
+  std::uint32_t getNumBufs() const
+  {
+		return numBufs;
+  }
+
 	/**
    * Get buffer pool usage statistics
 	 */
@@ -0,0 +1,213 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/*
+ * Multi-threaded insert benchmark for a concurrent BTreeIndex. Builds an INTEGER index
+ * over an empty relation once per thread count, has the threads insert disjoint slices
+ * of a shuffled key set while one extra thread runs range scans, and prints the insert
+ * throughput against the single threaded, unlatched index.
+ *
+ * Build and run with:
+ *   $ make bench
+ *   $ ./src/concurrent_bench [keys] [max threads]
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "btree.h"
+#include "exceptions/file_not_found_exception.h"
+#include "exceptions/index_scan_completed_exception.h"
+#include "exceptions/no_such_key_found_exception.h"
+
+using namespace badgerdb;
+
+/**
+ * Relation the indexes are built over. It stays empty; all keys come from insertEntry.
+ */
+const std::string BENCHRELATION = "benchrel";
+
+/**
+ * Buffer frames. Enough to keep the whole index resident.
+ */
+const int BENCHBUFS = 16384;
+
+static void removeFile(const std::string& name)
+{
+	try
+	{
+		File::remove(name);
+	}
+	catch(const FileNotFoundException&)
+	{
+	}
+}
+
+// Inserts keys[begin, end) with the key as page number of its rid.
+static void insertSlice(BTreeIndex* index, const std::vector<int>* keys, size_t begin, size_t end)
+{
+	for (size_t i = begin; i < end; i++)
+	{
+		RecordId rid;
+		rid.page_number = (*keys)[i];
+		rid.slot_number = 1;
+		index->insertEntry(&(*keys)[i], rid);
+	}
+}
+
+// Runs range scans of about 1000 keys until told to stop.
+static void scanLoop(BTreeIndex* index, int numKeys, std::atomic<bool>* stop, long* scans)
+{
+	IndexScanCursor cursor(index);
+	while (!stop->load())
+	{
+		int low = random() % numKeys;
+		int high = low + 1000;
+		try
+		{
+			cursor.startScan(&low, GTE, &high, LT);
+			try
+			{
+				RecordId rid;
+				while (true)
+				{
+					cursor.scanNext(rid);
+				}
+			}
+			catch(const IndexScanCompletedException&)
+			{
+			}
+			cursor.endScan();
+		}
+		catch(const NoSuchKeyFoundException&)
+		{
+		}
+		(*scans)++;
+	}
+}
+
+// Counts the entries of the index with one full scan.
+static long countEntries(BTreeIndex* index)
+{
+	int low = -1;
+	int high = 1 << 30;
+	long count = 0;
+	try
+	{
+		index->startScan(&low, GT, &high, LT);
+		try
+		{
+			RecordId rid;
+			while (true)
+			{
+				index->scanNext(rid);
+				count++;
+			}
+		}
+		catch(const IndexScanCompletedException&)
+		{
+		}
+		index->endScan();
+	}
+	catch(const NoSuchKeyFoundException&)
+	{
+	}
+	return count;
+}
+
+// Builds a fresh index with the given number of insert threads and returns inserts per
+// second. A scanner thread runs alongside when withScanner is set.
+static double run(const std::vector<int>& keys, int threads, bool concurrent, bool withScanner,
+                  long& scans)
+{
+	BufMgr* bufMgr = new BufMgr(BENCHBUFS);
+	std::string indexName;
+	double rate;
+	{
+		IndexOptions options;
+		options.concurrent = concurrent;
+		BTreeIndex index(BENCHRELATION, indexName, bufMgr, 0, INTEGER, options);
+		std::atomic<bool> stop(false);
+		scans = 0;
+		std::thread scanner;
+		if (withScanner)
+		{
+			scanner = std::thread(scanLoop, &index, (int) keys.size(), &stop, &scans);
+		}
+
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		std::vector<std::thread> workers;
+		for (int t = 0; t < threads; t++)
+		{
+			size_t begin = keys.size() * t / threads;
+			size_t end = keys.size() * (t + 1) / threads;
+			workers.push_back(std::thread(insertSlice, &index, &keys, begin, end));
+		}
+		for (size_t t = 0; t < workers.size(); t++)
+		{
+			workers[t].join();
+		}
+		std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+		rate = keys.size() / elapsed.count();
+
+		if (withScanner)
+		{
+			stop.store(true);
+			scanner.join();
+		}
+		if (countEntries(&index) != (long) keys.size())
+		{
+			std::cout << "  index lost entries with " << threads << " threads" << std::endl;
+		}
+	}
+	removeFile(indexName);
+	delete bufMgr;
+	return rate;
+}
+
+int main(int argc, char** argv)
+{
+	int numKeys = argc > 1 ? atoi(argv[1]) : 1000000;
+	int maxThreads = argc > 2 ? atoi(argv[2]) : (int) std::thread::hardware_concurrency();
+	maxThreads = std::max(1, maxThreads);
+
+	removeFile(BENCHRELATION);
+	{
+		PageFile relation = PageFile::create(BENCHRELATION);
+	}
+	std::vector<int> keys(numKeys);
+	for (int i = 0; i < numKeys; i++)
+	{
+		keys[i] = i;
+	}
+	std::random_shuffle(keys.begin(), keys.end());
+
+	long scans;
+	double base = run(keys, 1, false, false, scans);
+	std::cout << numKeys << " random inserts" << std::endl;
+	std::cout << "  unlatched, 1 thread   " << base / 1e6 << " M inserts/s" << std::endl;
+	for (int threads = 1; threads <= maxThreads; threads *= 2)
+	{
+		double rate = run(keys, threads, true, false, scans);
+		std::cout << "  concurrent, " << threads << " threads  " << rate / 1e6 << " M inserts/s  ("
+		          << rate / base << "x)" << std::endl;
+		if (threads < maxThreads && threads * 2 > maxThreads)
+		{
+			threads = maxThreads / 2;
+		}
+	}
+	double rate = run(keys, maxThreads, true, true, scans);
+	std::cout << "  concurrent, " << maxThreads << " threads + scanner  " << rate / 1e6
+	          << " M inserts/s, " << scans << " scans" << std::endl;
+
+	removeFile(BENCHRELATION);
+	return 0;
+}
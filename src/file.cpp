@@ -13,6 +13,7 @@
 #include <string>
 #include <cstdio>
 #include <cassert>
+#include <cstring>
 
 #include "exceptions/file_exists_exception.h"
 #include "exceptions/file_not_found_exception.h"
@@ -24,6 +25,7 @@
 namespace badgerdb {
 
 File::StreamMap File::open_streams_;
+File::LockMap File::open_locks_;
 File::CountMap File::open_counts_;
 
 void File::remove(const std::string& filename) {
@@ -79,6 +81,7 @@ void File::openIfNeeded(const bool create_new) {
   if (open_counts_.find(filename_) != open_counts_.end()) {	//exists an entry already
     ++open_counts_[filename_];
     stream_ = open_streams_[filename_];
+    streamLock_ = open_locks_[filename_];
   } else {
     std::ios_base::openmode mode =
         std::fstream::in | std::fstream::out | std::fstream::binary;
@@ -98,6 +101,8 @@ void File::openIfNeeded(const bool create_new) {
     }
     stream_.reset(new std::fstream(filename_, mode));
     open_streams_[filename_] = stream_;
+    streamLock_.reset(new std::mutex());
+    open_locks_[filename_] = streamLock_;
     open_counts_[filename_] = 1;
   }
 }
@@ -107,22 +112,26 @@ void File::close() {
   	--open_counts_[filename_];
 
   stream_.reset();
+  streamLock_.reset();
 	assert(open_counts_[filename_] >= 0);
 
   if (open_counts_[filename_] == 0) {
     open_streams_.erase(filename_);
+    open_locks_.erase(filename_);
     open_counts_.erase(filename_);
   }
 }
 
 FileHeader File::readHeader() const {
   FileHeader header;
+  std::lock_guard<std::mutex> guard(*streamLock_);
   stream_->seekg(0 /* pos */, std::ios::beg);
   stream_->read(reinterpret_cast<char*>(&header), sizeof(FileHeader));
   return header;
 }
 
 void File::writeHeader(const FileHeader& header) {
+  std::lock_guard<std::mutex> guard(*streamLock_);
   stream_->seekp(0 /* pos */, std::ios::beg);
   stream_->write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
   stream_->flush();
@@ -247,6 +256,7 @@ Page PageFile::readPage(const PageId page_number) const {
 
 Page PageFile::readPage(const PageId page_number, const bool allow_free) const {
   Page page;
+  std::lock_guard<std::mutex> guard(*streamLock_);
   stream_->seekg(pagePosition(page_number), std::ios::beg);
   stream_->read(reinterpret_cast<char*>(&page.header_), sizeof(PageHeader));
   stream_->read(reinterpret_cast<char*>(&page.data_[0]), Page::DATA_SIZE);
@@ -315,6 +325,7 @@ FileIterator PageFile::end() {
 
 void PageFile::writePage(const PageId page_number, const PageHeader& header,
                      const Page& new_page) {
+  std::lock_guard<std::mutex> guard(*streamLock_);
   stream_->seekp(pagePosition(page_number), std::ios::beg);
   stream_->write(reinterpret_cast<const char*>(&header), sizeof(PageHeader));
   stream_->write(reinterpret_cast<const char*>(&new_page.data_[0]),
@@ -324,6 +335,7 @@ void PageFile::writePage(const PageId page_number, const PageHeader& header,
 
 PageHeader PageFile::readPageHeader(PageId page_number) const {
   PageHeader header;
+  std::lock_guard<std::mutex> guard(*streamLock_);
   stream_->seekg(pagePosition(page_number), std::ios::beg);
   stream_->read(reinterpret_cast<char*>(&header), sizeof(PageHeader));
   return header;
@@ -365,6 +377,17 @@ Page BlobFile::allocatePage(PageId &new_page_number) {
   FileHeader header = readHeader();
 	Page new_page;
 
+	// Reuse a deleted page if there is one. Its first bytes link to the next one.
+	if (header.num_free_pages > 0) {
+		new_page_number = header.first_free_page;
+		Page free_page = readPage(new_page_number);
+		memcpy(&header.first_free_page, reinterpret_cast<const char*>(&free_page), sizeof(PageId));
+		--header.num_free_pages;
+		writePage(new_page_number, new_page);
+		writeHeader(header);
+		return new_page;
+	}
+
 	new_page_number = header.num_pages;
 
 	if (header.first_used_page == Page::INVALID_NUMBER) {
@@ -381,20 +404,32 @@ Page BlobFile::allocatePage(PageId &new_page_number) {
 
 Page BlobFile::readPage(const PageId page_number) const {
 	Page page;
+	std::lock_guard<std::mutex> guard(*streamLock_);
 	stream_->seekg(pagePosition(page_number), std::ios::beg);
 	stream_->read(reinterpret_cast<char*>(&page), Page::SIZE);
 	return page;
 }
 
 void BlobFile::writePage(const PageId new_page_number, const Page& new_page) {
+	std::lock_guard<std::mutex> guard(*streamLock_);
 	stream_->seekp(pagePosition(new_page_number), std::ios::beg);
 	stream_->write(reinterpret_cast<const char*>(&new_page), Page::SIZE);
 	stream_->flush();
 }
 
-//delePage should not be called for a blob_file, not supported
+// Deleted pages are chained into a free list through their first bytes and handed
+// out again by allocatePage. Page numbers of the other pages do not change.
 void BlobFile::deletePage(const PageId page_number) {
-	throw InvalidPageException(page_number, filename_);
+  FileHeader header = readHeader();
+	if (page_number == 0 || page_number >= header.num_pages) {
+		throw InvalidPageException(page_number, filename_);
+	}
+	Page free_page;
+	memcpy(reinterpret_cast<char*>(&free_page), &header.first_free_page, sizeof(PageId));
+	writePage(page_number, free_page);
+	header.first_free_page = page_number;
+	++header.num_free_pages;
+	writeHeader(header);
 }
 
 }
@@ -11,6 +11,7 @@
 #include <string>
 #include <map>
 #include <memory>
+#include <mutex>
 
 #include "page.h"
 
@@ -211,6 +212,7 @@ class File {
   void writeHeader(const FileHeader& header);
 
   typedef std::map<std::string, std::shared_ptr<std::fstream> > StreamMap;
+  typedef std::map<std::string, std::shared_ptr<std::mutex> > LockMap;
   typedef std::map<std::string, int> CountMap;
 
   /**
@@ -218,6 +220,11 @@ class File {
    */
   static StreamMap open_streams_;
 
+  /**
+   * Locks of the streams for opened files.
+   */
+  static LockMap open_locks_;
+
   /**
    * Counts for opened files.
    */
@@ -233,6 +240,13 @@ class File {
    */
   std::shared_ptr<std::fstream> stream_;
 
+  /**
+   * Held across each seek and the read or write after it, since the buffer manager
+   * reads pages without a lock of its own and File objects for one file share
+   * their stream.
+   */
+  std::shared_ptr<std::mutex> streamLock_;
+
   friend class FileIterator;
 };
 
@@ -442,7 +456,8 @@ class BlobFile : public File {
   ~BlobFile();
 
   /**
-   * Allocates a new page in the file.
+   * Allocates a new page in the file, reusing the most recently deleted page
+   * if there is one.
    *
    * @return The new page.
    */
@@ -468,9 +483,11 @@ class BlobFile : public File {
   void writePage(const PageId page_number, const Page& new_page);
 
   /**
-   * Deletes a page from the file.
+   * Deletes a page from the file. The page goes on a free list kept in the
+   * file header and is handed out again by allocatePage.
    *
    * @param page_number   Number of page to delete.
+   * @throws  InvalidPageException  If the page is not a data page of the file.
    */
   void deletePage(const PageId page_number);
 };
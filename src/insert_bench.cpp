@@ -0,0 +1,110 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/*
+ * Random insert benchmark. Inserts keys in random order into an INTEGER index over an
+ * empty relation through a buffer pool of 100 frames, as the tests use, so that the
+ * leaves soon outgrow the pool. Times the plain index against the write optimized one
+ * of IndexOptions::bufferInserts, counting the pages each reads and writes, then times
+ * a full scan of each, which first passes the pending messages down to the leaves.
+ *
+ * Build and run with:
+ *   $ make bench
+ *   $ ./src/insert_bench [keys] [frames]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "btree.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+/**
+ * Relation the index is built over. It stays empty; all keys come from insertEntry.
+ */
+const std::string BENCHRELATION = "insertrel";
+
+static void removeFile(const std::string& name)
+{
+	try
+	{
+		File::remove(name);
+	}
+	catch(const FileNotFoundException&)
+	{
+	}
+}
+
+static void benchInserts(const char* label, const std::vector<int>& keys, const int frames, const bool buffered)
+{
+	BufMgr* bufMgr = new BufMgr(frames);
+	IndexOptions options;
+	options.bufferInserts = buffered;
+	std::string indexName;
+	{
+		BTreeIndex index(BENCHRELATION, indexName, bufMgr, 0, INTEGER, options);
+		bufMgr->clearBufStats();
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		for (size_t i = 0; i < keys.size(); i++)
+		{
+			RecordId rid;
+			rid.page_number = keys[i] / 50 + 1;
+			rid.slot_number = keys[i] % 50;
+			index.insertEntry(&keys[i], rid);
+		}
+		std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+		BufStats stats = bufMgr->getBufStats();
+		std::cout << label << std::endl;
+		std::cout << "  inserts       " << (long) (keys.size() / elapsed.count()) << " /s, "
+		          << (double) stats.diskreads / keys.size() << " reads and "
+		          << (double) stats.diskwrites / keys.size() << " writes per insert" << std::endl;
+
+		int low = -1;
+		int high = (int) keys.size();
+		std::vector<RecordId> batch(4096);
+		long count = 0;
+		start = std::chrono::high_resolution_clock::now();
+		index.startScan(&low, GT, &high, LT);
+		int n;
+		while ((n = index.scanNextBatch(&batch[0], (int) batch.size())) > 0)
+		{
+			count += n;
+		}
+		index.endScan();
+		elapsed = std::chrono::high_resolution_clock::now() - start;
+		std::cout << "  full scan     " << elapsed.count() * 1000 << " ms"
+		          << (count == (long) keys.size() ? "" : "  MISMATCH") << std::endl;
+	}
+	removeFile(indexName);
+	delete bufMgr;
+}
+
+int main(int argc, char** argv)
+{
+	int numKeys = argc > 1 ? atoi(argv[1]) : 1000000;
+	int frames = argc > 2 ? atoi(argv[2]) : 100;
+	std::vector<int> keys(numKeys);
+	for (int i = 0; i < numKeys; i++)
+	{
+		keys[i] = i;
+	}
+	std::random_shuffle(keys.begin(), keys.end());
+
+	removeFile(BENCHRELATION);
+	{
+		PageFile relation = PageFile::create(BENCHRELATION);
+	}
+	std::cout << numKeys << " keys in random order, " << frames << " buffer frames" << std::endl;
+	benchInserts("Plain", keys, frames, false);
+	benchInserts("Buffered inserts", keys, frames, true);
+	removeFile(BENCHRELATION);
+	return 0;
+}
@@ -0,0 +1,292 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <climits>
+#include "key_search.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define KEY_SEARCH_X86
+#endif
+
+namespace badgerdb
+{
+
+/**
+ * Counts the keys in keys[0, numKeys) that are less than key. On sorted keys this is
+ * the lower bound, and since every key is compared there is no data dependent branch.
+ */
+typedef int (*CountLessFn)(const int* keys, const int numKeys, const int key);
+
+static int countLessScalar(const int* keys, const int numKeys, const int key)
+{
+	int count = 0;
+	for (int i = 0; i < numKeys; i++)
+	{
+		count += keys[i] < key;
+	}
+	return count;
+}
+
+#ifdef KEY_SEARCH_X86
+
+__attribute__((target("sse4.2,popcnt")))
+static int countLessSse42(const int* keys, const int numKeys, const int key)
+{
+	const __m128i keyVec = _mm_set1_epi32(key);
+	int count = 0;
+	int i = 0;
+	for (; i + 16 <= numKeys; i += 16)
+	{
+		// key > keys[i] for 16 keys, four compares of four lanes each
+		__m128i lt0 = _mm_cmpgt_epi32(keyVec, _mm_loadu_si128((const __m128i*) (keys + i)));
+		__m128i lt1 = _mm_cmpgt_epi32(keyVec, _mm_loadu_si128((const __m128i*) (keys + i + 4)));
+		__m128i lt2 = _mm_cmpgt_epi32(keyVec, _mm_loadu_si128((const __m128i*) (keys + i + 8)));
+		__m128i lt3 = _mm_cmpgt_epi32(keyVec, _mm_loadu_si128((const __m128i*) (keys + i + 12)));
+		// Narrow the four masks down to one byte per key.
+		__m128i packed = _mm_packs_epi16(_mm_packs_epi32(lt0, lt1), _mm_packs_epi32(lt2, lt3));
+		count += _mm_popcnt_u32(_mm_movemask_epi8(packed));
+	}
+	for (; i + 4 <= numKeys; i += 4)
+	{
+		__m128i lt = _mm_cmpgt_epi32(keyVec, _mm_loadu_si128((const __m128i*) (keys + i)));
+		count += _mm_popcnt_u32(_mm_movemask_ps(_mm_castsi128_ps(lt)));
+	}
+	return count + countLessScalar(keys + i, numKeys - i, key);
+}
+
+__attribute__((target("avx2,popcnt")))
+static int countLessAvx2(const int* keys, const int numKeys, const int key)
+{
+	const __m256i keyVec = _mm256_set1_epi32(key);
+	int count = 0;
+	int i = 0;
+	for (; i + 16 <= numKeys; i += 16)
+	{
+		// Two compares of eight lanes each cover sixteen keys.
+		__m256i lt0 = _mm256_cmpgt_epi32(keyVec, _mm256_loadu_si256((const __m256i*) (keys + i)));
+		__m256i lt1 = _mm256_cmpgt_epi32(keyVec, _mm256_loadu_si256((const __m256i*) (keys + i + 8)));
+		count += _mm_popcnt_u32(_mm256_movemask_ps(_mm256_castsi256_ps(lt0)));
+		count += _mm_popcnt_u32(_mm256_movemask_ps(_mm256_castsi256_ps(lt1)));
+	}
+	for (; i + 8 <= numKeys; i += 8)
+	{
+		__m256i lt = _mm256_cmpgt_epi32(keyVec, _mm256_loadu_si256((const __m256i*) (keys + i)));
+		count += _mm_popcnt_u32(_mm256_movemask_ps(_mm256_castsi256_ps(lt)));
+	}
+	return count + countLessScalar(keys + i, numKeys - i, key);
+}
+
+#endif
+
+/**
+ * Counts the 16 bit keys in keys[0, numKeys) that are less than key.
+ */
+typedef int (*CountLessShortFn)(const short* keys, const int numKeys, const short key);
+
+static int countLessShortScalar(const short* keys, const int numKeys, const short key)
+{
+	int count = 0;
+	for (int i = 0; i < numKeys; i++)
+	{
+		count += keys[i] < key;
+	}
+	return count;
+}
+
+#ifdef KEY_SEARCH_X86
+
+__attribute__((target("sse4.2,popcnt")))
+static int countLessShortSse42(const short* keys, const int numKeys, const short key)
+{
+	const __m128i keyVec = _mm_set1_epi16(key);
+	int count = 0;
+	int i = 0;
+	for (; i + 16 <= numKeys; i += 16)
+	{
+		__m128i lt0 = _mm_cmpgt_epi16(keyVec, _mm_loadu_si128((const __m128i*) (keys + i)));
+		__m128i lt1 = _mm_cmpgt_epi16(keyVec, _mm_loadu_si128((const __m128i*) (keys + i + 8)));
+		count += _mm_popcnt_u32(_mm_movemask_epi8(_mm_packs_epi16(lt0, lt1)));
+	}
+	return count + countLessShortScalar(keys + i, numKeys - i, key);
+}
+
+__attribute__((target("avx2,popcnt")))
+static int countLessShortAvx2(const short* keys, const int numKeys, const short key)
+{
+	const __m256i keyVec = _mm256_set1_epi16(key);
+	int count = 0;
+	int i = 0;
+	for (; i + 16 <= numKeys; i += 16)
+	{
+		// Each lane that compares true sets two bits of the byte mask.
+		__m256i lt = _mm256_cmpgt_epi16(keyVec, _mm256_loadu_si256((const __m256i*) (keys + i)));
+		count += _mm_popcnt_u32(_mm256_movemask_epi8(lt)) / 2;
+	}
+	return count + countLessShortScalar(keys + i, numKeys - i, key);
+}
+
+#endif
+
+/**
+ * Returns the best kernel the CPU supports.
+ */
+static SearchKernel bestKernel()
+{
+#ifdef KEY_SEARCH_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"))
+	{
+		return AVX2_KERNEL;
+	}
+	if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt"))
+	{
+		return SSE42_KERNEL;
+	}
+#endif
+	return SCALAR_KERNEL;
+}
+
+static CountLessFn kernelFn(const SearchKernel kernel)
+{
+#ifdef KEY_SEARCH_X86
+	if (kernel == AVX2_KERNEL)
+	{
+		return countLessAvx2;
+	}
+	if (kernel == SSE42_KERNEL)
+	{
+		return countLessSse42;
+	}
+#endif
+	return countLessScalar;
+}
+
+static CountLessShortFn shortKernelFn(const SearchKernel kernel)
+{
+#ifdef KEY_SEARCH_X86
+	if (kernel == AVX2_KERNEL)
+	{
+		return countLessShortAvx2;
+	}
+	if (kernel == SSE42_KERNEL)
+	{
+		return countLessShortSse42;
+	}
+#endif
+	return countLessShortScalar;
+}
+
+/**
+ * Kernel currently in use and its count function. Resolved once, by static
+ * initialization when the program is loaded.
+ */
+static SearchKernel currentKernel = bestKernel();
+static CountLessFn countLess = kernelFn(currentKernel);
+static CountLessShortFn countLessShort = shortKernelFn(currentKernel);
+
+SearchKernel searchKernel()
+{
+	return currentKernel;
+}
+
+SearchKernel setSearchKernel(const SearchKernel kernel)
+{
+	SearchKernel best = bestKernel();
+	currentKernel = kernel > best ? best : kernel;
+	countLess = kernelFn(currentKernel);
+	countLessShort = shortKernelFn(currentKernel);
+	return currentKernel;
+}
+
+const char* searchKernelName(const SearchKernel kernel)
+{
+	switch (kernel)
+	{
+	case AVX2_KERNEL:
+		return "avx2";
+	case SSE42_KERNEL:
+		return "sse4.2";
+	default:
+		return "scalar";
+	}
+}
+
+int intLowerBound(const int* keys, const int numKeys, const int key)
+{
+	// Halve the range with a conditional move instead of a branch. Everything
+	// before base is less than key, everything from base + length on is not.
+	const int* base = keys;
+	int length = numKeys;
+	while (length > SEARCHWINDOW)
+	{
+		int half = length / 2;
+		base = (base[half - 1] < key) ? base + half : base;
+		length -= half;
+	}
+	return (int) (base - keys) + countLess(base, length, key);
+}
+
+int intUpperBound(const int* keys, const int numKeys, const int key)
+{
+	// The keys less than or equal to key are the keys less than key + 1.
+	if (key == INT_MAX)
+	{
+		return numKeys;
+	}
+	return intLowerBound(keys, numKeys, key + 1);
+}
+
+int shortLowerBound(const short* keys, const int numKeys, const short key)
+{
+	const short* base = keys;
+	int length = numKeys;
+	while (length > SEARCHWINDOW)
+	{
+		int half = length / 2;
+		base = (base[half - 1] < key) ? base + half : base;
+		length -= half;
+	}
+	return (int) (base - keys) + countLessShort(base, length, key);
+}
+
+int shortUpperBound(const short* keys, const int numKeys, const short key)
+{
+	if (key == SHRT_MAX)
+	{
+		return numKeys;
+	}
+	return shortLowerBound(keys, numKeys, key + 1);
+}
+
+void intBuildDirectory(const int* keys, const int numKeys, int* directory)
+{
+	for (int b = 0; b < numKeys / DIRECTORYBLOCK; b++)
+	{
+		directory[b] = keys[b * DIRECTORYBLOCK + DIRECTORYBLOCK - 1];
+	}
+}
+
+int intDirectoryLowerBound(const int* keys, const int numKeys, const int* directory, const int key)
+{
+	// Every block before the first one whose last key is not less than key holds only
+	// smaller keys, so the bound lies in that block, or in the partial block at the end.
+	int base = countLess(directory, numKeys / DIRECTORYBLOCK, key) * DIRECTORYBLOCK;
+	int length = numKeys - base < DIRECTORYBLOCK ? numKeys - base : DIRECTORYBLOCK;
+	return base + countLess(keys + base, length, key);
+}
+
+int intDirectoryUpperBound(const int* keys, const int numKeys, const int* directory, const int key)
+{
+	if (key == INT_MAX)
+	{
+		return numKeys;
+	}
+	return intDirectoryLowerBound(keys, numKeys, directory, key + 1);
+}
+
+}
@@ -0,0 +1,126 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+namespace badgerdb
+{
+
+/**
+ * @brief Search kernels available for INTEGER node searches.
+ */
+enum SearchKernel
+{
+	SCALAR_KERNEL = 0,	/* Portable C++ */
+	SSE42_KERNEL = 1,		/* 4 keys per compare */
+	AVX2_KERNEL = 2			/* 8 keys per compare */
+};
+
+/**
+ * @brief Number of keys below which the search stops halving the range and
+ * counts the remaining keys with the vector kernel.
+ */
+const int SEARCHWINDOW = 64;
+
+/**
+ * @brief Keys per block of a search directory. A directory holds the last key of each
+ * full block of a sorted key array, so a search counts the directory entries below the
+ * key, one or two cache lines, then the keys of a single block.
+ */
+const int DIRECTORYBLOCK = 32;
+
+/**
+ * @brief Most entries a search directory holds. It covers up to
+ * DIRECTORYBLOCK * (DIRECTORYSIZE + 1) - 1 keys.
+ */
+const int DIRECTORYSIZE = 32;
+
+/**
+ * Returns the kernel the searches currently dispatch to. It is picked from the CPU
+ * features by a static initializer, when the program is loaded.
+ */
+SearchKernel searchKernel();
+
+/**
+ * Forces the searches to use the given kernel, or the best supported one below it.
+ * Meant for benchmarks and tests.
+ * @param kernel	Requested kernel.
+ * @return				Kernel actually selected.
+ */
+SearchKernel setSearchKernel(const SearchKernel kernel);
+
+/**
+ * Returns a printable name for a kernel.
+ */
+const char* searchKernelName(const SearchKernel kernel);
+
+/**
+ * Returns the index of the first key in keys[0, numKeys) that is not less than key.
+ * The range is halved without branches down to SEARCHWINDOW keys, which are then
+ * compared all at once with the selected kernel.
+ * @param keys			Sorted keys.
+ * @param numKeys		Number of keys.
+ * @param key				Key to search for.
+ */
+int intLowerBound(const int* keys, const int numKeys, const int key);
+
+/**
+ * Returns the index of the first key in keys[0, numKeys) that is greater than key.
+ * @param keys			Sorted keys.
+ * @param numKeys		Number of keys.
+ * @param key				Key to search for.
+ */
+int intUpperBound(const int* keys, const int numKeys, const int key);
+
+/**
+ * Returns the index of the first key in keys[0, numKeys) that is not less than key,
+ * for 16 bit keys. Searched like intLowerBound, with twice the keys per compare.
+ * @param keys			Sorted keys.
+ * @param numKeys		Number of keys.
+ * @param key				Key to search for.
+ */
+int shortLowerBound(const short* keys, const int numKeys, const short key);
+
+/**
+ * Returns the index of the first key in keys[0, numKeys) that is greater than key,
+ * for 16 bit keys.
+ * @param keys			Sorted keys.
+ * @param numKeys		Number of keys.
+ * @param key				Key to search for.
+ */
+int shortUpperBound(const short* keys, const int numKeys, const short key);
+
+/**
+ * Fills in the search directory of a sorted key array: the last key of each full block
+ * of DIRECTORYBLOCK keys, numKeys / DIRECTORYBLOCK entries in all.
+ * @param keys			Sorted keys.
+ * @param numKeys		Number of keys.
+ * @param directory	Receives the directory.
+ */
+void intBuildDirectory(const int* keys, const int numKeys, int* directory);
+
+/**
+ * Returns the index of the first key in keys[0, numKeys) that is not less than key,
+ * using the search directory of the keys to count only one block of them.
+ * @param keys			Sorted keys.
+ * @param numKeys		Number of keys.
+ * @param directory	Directory built over the keys by intBuildDirectory.
+ * @param key				Key to search for.
+ */
+int intDirectoryLowerBound(const int* keys, const int numKeys, const int* directory, const int key);
+
+/**
+ * Returns the index of the first key in keys[0, numKeys) that is greater than key,
+ * using the search directory of the keys.
+ * @param keys			Sorted keys.
+ * @param numKeys		Number of keys.
+ * @param directory	Directory built over the keys by intBuildDirectory.
+ * @param key				Key to search for.
+ */
+int intDirectoryUpperBound(const int* keys, const int numKeys, const int* directory, const int key);
+
+}
@@ -0,0 +1,266 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/*
+ * Micro-benchmark for the in-node search of INTEGER B+Tree nodes. Times the linear
+ * scan the tree used originally, a plain binary search and the kernels in
+ * key_search.cpp over full leaf and non-leaf sized key arrays, and the non-leaf search
+ * through a search directory. Then times root to leaf descents of an in-memory tree of
+ * 10M keys, larger than the last level cache, with and without directories.
+ *
+ * Build and run with:
+ *   $ make bench
+ *   $ ./src/key_search_bench [treeKeys]
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "btree.h"
+#include "key_search.h"
+
+using namespace badgerdb;
+
+/**
+ * Number of nodes probed. Large enough that the key arrays do not all fit in cache.
+ */
+const int NUMNODES = 2048;
+
+/**
+ * Number of searches timed per method.
+ */
+const int NUMPROBES = 4000000;
+
+/**
+ * Default number of keys of the descent benchmark, 40 MB of leaf keys.
+ */
+const int TREEKEYS = 10000000;
+
+// Walks back from the last key while keys are greater than the probe, as the
+// original findSpace did.
+static int linearSearch(const int* keys, int numKeys, int key)
+{
+	int i = numKeys;
+	while (i > 0 && keys[i - 1] > key)
+	{
+		i--;
+	}
+	return i;
+}
+
+// Branching binary search, as used for DOUBLE and STRING keys.
+static int binarySearch(const int* keys, int numKeys, int key)
+{
+	int low = 0;
+	int high = numKeys;
+	while (low < high)
+	{
+		int mid = (low + high) / 2;
+		if (keys[mid] <= key)
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid;
+		}
+	}
+	return low;
+}
+
+static int kernelSearch(const int* keys, int numKeys, int key)
+{
+	return intUpperBound(keys, numKeys, key);
+}
+
+// The search directory of a node follows its keys, as in a non-leaf of an index built
+// with IndexOptions::nodeDirectories.
+static int directorySearch(const int* keys, int numKeys, int key)
+{
+	return intDirectoryUpperBound(keys, numKeys, keys + numKeys, key);
+}
+
+typedef int (*SearchFn)(const int*, int, int);
+
+static double timeSearch(SearchFn fn, const std::vector<int>& keys, int nodeSize, int stride,
+                         const std::vector<int>& nodes, const std::vector<int>& probes, long& checksum)
+{
+	checksum = 0;
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < NUMPROBES; i++)
+	{
+		checksum += fn(&keys[(size_t) nodes[i] * stride], nodeSize, probes[i]);
+	}
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::high_resolution_clock::now() - start;
+	return elapsed.count() / NUMPROBES;
+}
+
+static void printRow(const std::string& label, double ns, const char* unit, bool match)
+{
+	std::cout << "  " << label << std::string(label.length() < 18 ? 18 - label.length() : 1, ' ');
+	std::cout << ns << " ns/" << unit << (match ? "" : "  MISMATCH") << std::endl;
+}
+
+static void benchNodeSize(const char* label, int nodeSize, bool directories)
+{
+	// Each node holds sorted keys spread over a wide range, with some duplicates, followed
+	// by their search directory.
+	int stride = nodeSize + DIRECTORYSIZE;
+	std::vector<int> keys((size_t) NUMNODES * stride);
+	for (int n = 0; n < NUMNODES; n++)
+	{
+		int* node = &keys[(size_t) n * stride];
+		for (int i = 0; i < nodeSize; i++)
+		{
+			node[i] = (int) (random() % (nodeSize * 8)) - nodeSize;
+		}
+		std::sort(node, node + nodeSize);
+		intBuildDirectory(node, nodeSize, node + nodeSize);
+	}
+	std::vector<int> nodes(NUMPROBES);
+	std::vector<int> probes(NUMPROBES);
+	for (int i = 0; i < NUMPROBES; i++)
+	{
+		nodes[i] = random() % NUMNODES;
+		probes[i] = (int) (random() % (nodeSize * 10)) - 2 * nodeSize;
+	}
+
+	std::cout << label << " (" << nodeSize << " keys)" << std::endl;
+	long expected;
+	double ns = timeSearch(linearSearch, keys, nodeSize, stride, nodes, probes, expected);
+	printRow("linear", ns, "search", true);
+	long checksum;
+	ns = timeSearch(binarySearch, keys, nodeSize, stride, nodes, probes, checksum);
+	printRow("binary", ns, "search", checksum == expected);
+	for (int k = SCALAR_KERNEL; k <= AVX2_KERNEL; k++)
+	{
+		if (setSearchKernel((SearchKernel) k) != k)
+		{
+			std::cout << "  " << searchKernelName((SearchKernel) k) << " not supported by this CPU" << std::endl;
+			continue;
+		}
+		ns = timeSearch(kernelSearch, keys, nodeSize, stride, nodes, probes, checksum);
+		printRow(std::string("window+") + searchKernelName((SearchKernel) k), ns, "search", checksum == expected);
+		if (directories)
+		{
+			ns = timeSearch(directorySearch, keys, nodeSize, stride, nodes, probes, checksum);
+			printRow(std::string("directory+") + searchKernelName((SearchKernel) k), ns, "search", checksum == expected);
+		}
+	}
+	setSearchKernel(AVX2_KERNEL);
+}
+
+/**
+ * @brief Non-leaf levels of an in-memory tree over the leaves of benchDescent, bulk
+ * loaded full. Each node takes a page worth of ints: nodeKeys keys, then the search
+ * directory if the tree has them. The children of node n are nodes n * (nodeKeys + 1) on.
+ */
+struct DescentTree
+{
+	int nodeKeys;
+	bool directories;
+	std::vector<std::vector<int> > levels;
+	std::vector<std::vector<int> > numKeys;
+};
+
+static void buildDescentTree(DescentTree& tree, const std::vector<int>& leafFirstKeys)
+{
+	std::vector<int> firstKeys = leafFirstKeys;
+	int fanout = tree.nodeKeys + 1;
+	while (firstKeys.size() > 1)
+	{
+		size_t numNodes = (firstKeys.size() + fanout - 1) / fanout;
+		std::vector<int> level(numNodes * INTARRAYNONLEAFSIZE);
+		std::vector<int> counts(numNodes);
+		std::vector<int> parentKeys(numNodes);
+		for (size_t n = 0; n < numNodes; n++)
+		{
+			size_t first = n * fanout;
+			size_t last = std::min(first + fanout, firstKeys.size());
+			int* node = &level[n * INTARRAYNONLEAFSIZE];
+			std::copy(firstKeys.begin() + first + 1, firstKeys.begin() + last, node);
+			counts[n] = (int) (last - first - 1);
+			if (tree.directories)
+			{
+				intBuildDirectory(node, counts[n], node + tree.nodeKeys);
+			}
+			parentKeys[n] = firstKeys[first];
+		}
+		tree.levels.insert(tree.levels.begin(), level);
+		tree.numKeys.insert(tree.numKeys.begin(), counts);
+		firstKeys.swap(parentKeys);
+	}
+}
+
+static double timeDescent(const DescentTree& tree, const std::vector<int>& leaves, int numLeaves,
+                          int numKeys, const std::vector<int>& probes, long& checksum)
+{
+	checksum = 0;
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < NUMPROBES; i++)
+	{
+		int node = 0;
+		for (size_t l = 0; l < tree.levels.size(); l++)
+		{
+			const int* keys = &tree.levels[l][(size_t) node * INTARRAYNONLEAFSIZE];
+			int n = tree.numKeys[l][node];
+			int slot = tree.directories ? intDirectoryUpperBound(keys, n, keys + tree.nodeKeys, probes[i])
+			                            : intUpperBound(keys, n, probes[i]);
+			node = node * (tree.nodeKeys + 1) + slot;
+		}
+		int leafKeys = node == numLeaves - 1 ? numKeys - node * INTARRAYLEAFSIZE : INTARRAYLEAFSIZE;
+		checksum += (long) node * INTARRAYLEAFSIZE + intLowerBound(&leaves[(size_t) node * INTARRAYLEAFSIZE], leafKeys, probes[i]);
+	}
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::high_resolution_clock::now() - start;
+	return elapsed.count() / NUMPROBES;
+}
+
+static void benchDescent(int numKeys)
+{
+	// Full leaves of distinct keys spaced three apart, probed at random.
+	int numLeaves = (numKeys + INTARRAYLEAFSIZE - 1) / INTARRAYLEAFSIZE;
+	std::vector<int> leaves((size_t) numLeaves * INTARRAYLEAFSIZE);
+	for (int i = 0; i < numKeys; i++)
+	{
+		leaves[i] = 3 * i;
+	}
+	std::vector<int> leafFirstKeys(numLeaves);
+	for (int l = 0; l < numLeaves; l++)
+	{
+		leafFirstKeys[l] = leaves[(size_t) l * INTARRAYLEAFSIZE];
+	}
+	std::vector<int> probes(NUMPROBES);
+	for (int i = 0; i < NUMPROBES; i++)
+	{
+		probes[i] = (int) (random() % (3L * numKeys));
+	}
+
+	DescentTree plain = { INTARRAYNONLEAFSIZE, false };
+	DescentTree directory = { INTARRAYNONLEAFSIZE - DIRECTORYSIZE, true };
+	buildDescentTree(plain, leafFirstKeys);
+	buildDescentTree(directory, leafFirstKeys);
+	std::cout << "Descent (" << numKeys << " keys, " << numLeaves << " leaves, "
+	          << plain.levels.size() << " and " << directory.levels.size() << " non-leaf levels)" << std::endl;
+	long expected;
+	double ns = timeDescent(plain, leaves, numLeaves, numKeys, probes, expected);
+	printRow(std::string("window+") + searchKernelName(searchKernel()), ns, "descent", true);
+	long checksum;
+	ns = timeDescent(directory, leaves, numLeaves, numKeys, probes, checksum);
+	printRow(std::string("directory+") + searchKernelName(searchKernel()), ns, "descent", checksum == expected);
+}
+
+int main(int argc, char **argv)
+{
+	std::cout << "Selected kernel: " << searchKernelName(searchKernel()) << std::endl;
+	benchNodeSize("Non-leaf", INTARRAYNONLEAFSIZE, true);
+	benchNodeSize("Leaf", INTARRAYLEAFSIZE, false);
+	benchDescent(argc > 1 ? atoi(argv[1]) : TREEKEYS);
+	return 0;
+}
@@ -0,0 +1,187 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <pthread.h>
+#include "types.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Reader/writer latch guarding one B+ tree node. Waiting writers are preferred
+ * over new readers, so a stream of scans cannot starve an insert.
+ *
+ * @warning Not recursive. A thread must not latch a node it already holds.
+ */
+class RWLatch
+{
+ public:
+	RWLatch()
+	{
+		pthread_rwlockattr_t attr;
+		pthread_rwlockattr_init(&attr);
+#ifdef __GLIBC__
+		pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+		pthread_rwlock_init(&lock, &attr);
+		pthread_rwlockattr_destroy(&attr);
+	}
+
+	~RWLatch()
+	{
+		pthread_rwlock_destroy(&lock);
+	}
+
+  /**
+   * Takes the latch in shared mode, for reading the node.
+   */
+	void lockShared()
+	{
+		pthread_rwlock_rdlock(&lock);
+	}
+
+  /**
+   * Takes the latch in exclusive mode, for changing the node.
+   */
+	void lockExclusive()
+	{
+		pthread_rwlock_wrlock(&lock);
+	}
+
+  /**
+   * Releases the latch, in whichever mode it was taken.
+   */
+	void unlock()
+	{
+		pthread_rwlock_unlock(&lock);
+	}
+
+ private:
+	pthread_rwlock_t lock;
+
+	RWLatch(const RWLatch&);
+	RWLatch& operator=(const RWLatch&);
+};
+
+
+/**
+ * @brief Latches of all pages of one index file, indexed by page number. Page numbers
+ * of a BlobFile are dense, so latches are allocated in chunks the first time a page of
+ * the chunk is latched and live as long as the table. Lookups take no lock.
+ */
+class LatchTable
+{
+ public:
+  /**
+   * Number of latches allocated together.
+   */
+	static const PageId CHUNKSIZE = 4096;
+
+  /**
+   * Number of chunks. Together with CHUNKSIZE this bounds the pages of a concurrent index.
+   */
+	static const PageId MAXCHUNKS = 65536;
+
+	LatchTable()
+	{
+		for (PageId i = 0; i < MAXCHUNKS; i++)
+		{
+			chunks[i].store(nullptr, std::memory_order_relaxed);
+		}
+	}
+
+	~LatchTable()
+	{
+		for (PageId i = 0; i < MAXCHUNKS; i++)
+		{
+			delete [] chunks[i].load(std::memory_order_relaxed);
+		}
+	}
+
+  /**
+   * Returns the latch of a page.
+   * @param pageNo	Page number in the index file.
+   */
+	RWLatch& get(const PageId pageNo)
+	{
+		std::atomic<RWLatch*>& slot = chunks[(pageNo / CHUNKSIZE) % MAXCHUNKS];
+		RWLatch* chunk = slot.load(std::memory_order_acquire);
+		if (chunk == nullptr)
+		{
+			// Racing threads may both allocate; the loser frees its copy.
+			RWLatch* fresh = new RWLatch[CHUNKSIZE];
+			if (slot.compare_exchange_strong(chunk, fresh, std::memory_order_acq_rel))
+			{
+				chunk = fresh;
+			}
+			else
+			{
+				delete [] fresh;
+			}
+		}
+		return chunk[pageNo % CHUNKSIZE];
+	}
+
+ private:
+	std::atomic<RWLatch*> chunks[MAXCHUNKS];
+
+	LatchTable(const LatchTable&);
+	LatchTable& operator=(const LatchTable&);
+};
+
+
+/**
+ * @brief Exclusive latches an insert holds on the way down, from the root latch to the
+ * deepest node that may still split. Released together, or all at once as soon as a node
+ * is reached that has room for one more entry, since no split can then reach above it.
+ */
+class LatchPath
+{
+ public:
+  /**
+   * Deepest path that can be held. Far more than the height of any tree of 2^32 pages.
+   */
+	static const int MAXDEPTH = 32;
+
+	LatchPath()
+		: count(0)
+	{
+	}
+
+	~LatchPath()
+	{
+		releaseAll();
+	}
+
+  /**
+   * Records a latch the caller has just taken in exclusive mode.
+   */
+	void push(RWLatch* latch)
+	{
+		latches[count++] = latch;
+	}
+
+  /**
+   * Releases every latch held, deepest first.
+   */
+	void releaseAll()
+	{
+		while (count > 0)
+		{
+			latches[--count]->unlock();
+		}
+	}
+
+ private:
+	RWLatch* latches[MAXDEPTH];
+	int count;
+};
+
+}
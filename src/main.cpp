@@ -5,6 +5,10 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
+#include <fstream>
+#include <set>
+#include <thread>
 #include <vector>
 #include "btree.h"
 #include "page.h"
@@ -19,6 +23,7 @@
 #include "exceptions/bad_opcodes_exception.h"
 #include "exceptions/scan_not_initialized_exception.h"
 #include "exceptions/end_of_file_exception.h"
+#include "exceptions/bad_index_info_exception.h"
 
 #define checkPassFail(a, b) 																				\
 {																																		\
@@ -44,6 +49,7 @@ const std::string relationName = "relA";
 //If the relation size is changed then the second parameter 2 checkPassFail may need to be changed to number of record that are expected to be found during the scan, else tests will erroneously be reported to have failed.
 const int	relationSize = 5000;
 std::string intIndexName, doubleIndexName, stringIndexName;
+std::string pairIndexName, intDoubleIndexName, compositeIndexName;
 
 // This is the structure for tuples in the base relation
 
@@ -53,6 +59,15 @@ typedef struct tuple {
 	char s[64];
 } RECORD;
 
+// This is the structure for tuples in the relation of the composite key tests
+
+typedef struct pairTuple {
+	int i;
+	int j;
+	double d;
+	char s[48];
+} PAIRRECORD;
+
 PageFile* file1;
 RecordId rid;
 RECORD record1;
@@ -70,11 +85,47 @@ void createRelationForward();
 void createRelationBackward();
 void createRelationRandom();
 void createRangedRelationForward(int start, int end);
-void intTests();
-void negativeIntTests();
-void largeIntTests();
+void createRepeatingRelation(int value, int distinct);
+void createCompositeRelation(int value);
+void intTests(const IndexOptions & options);
+void doubleTests(const IndexOptions & options);
+void stringTests(const IndexOptions & options);
+void emptyTreeTests(const IndexOptions & options);
+void oneNodeTests(const IndexOptions & options);
+void negativeIntTests(const IndexOptions & options);
+void largeIntTests(const IndexOptions & options);
+void concurrentInsertTests();
+void cursorTests();
+void batchScanTests();
+void deleteTests();
+void lookupTests();
+void appendTests();
+void appendDuplicateTests();
+void readAheadTests();
+void packedLeafTests();
+void postingListTests();
+void compositeKeyTests();
+void coveringIndexTests();
+void descendingScanTests();
+void parallelScanTests();
+void innerNodeCacheTests();
+void nodeDirectoryTests();
+void bufferedInsertTests();
+void bloomFilterTests();
+void statisticsTests();
+void countedNodeTests();
+void varStringTests();
 int intScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp);
-void indexTests();
+int doubleScan(BTreeIndex *index, double lowVal, Operator lowOp, double highVal, Operator highOp);
+int stringScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp);
+int countScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp);
+int batchScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp, int batchSize);
+int prefixScan(BTreeIndex *index, const PAIRRECORD& lowVal, Operator lowOp, const PAIRRECORD& highVal, Operator highOp, int numColumns);
+int coveredScan(BTreeIndex *index, int lowVal, int highVal, int batchSize);
+int descendingScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp, int batchSize);
+int parallelScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp, int numWorkers);
+int urlScan(BTreeIndex *index, int lowVal, int highVal);
+void indexTests(const IndexOptions & options);
 void test1();
 void test2();
 void test3();
@@ -84,6 +135,33 @@ void test6();
 void test7();
 void test8();
 void test9();
+void test10();
+void test11();
+void test12();
+void test13();
+void test14();
+void test15();
+void test16();
+void test17();
+void test18();
+void test19();
+void test20();
+void test21();
+void test22();
+void test23();
+void test24();
+void test25();
+void test26();
+void test27();
+void test28();
+void test29();
+void test30();
+void test31();
+void test32();
+void test33();
+void test34();
+void test35();
+void test36();
 void errorTests();
 void deleteRelation();
 
@@ -157,6 +235,33 @@ int main(int argc, char **argv)
 	test7();
 	test8();
 	test9();
+	test10();
+	test11();
+	test12();
+	test13();
+	test14();
+	test15();
+	test16();
+	test17();
+	test18();
+	test19();
+	test20();
+	test21();
+	test22();
+	test23();
+	test24();
+	test25();
+	test26();
+	test27();
+	test28();
+	test29();
+	test30();
+	test31();
+	test32();
+	test33();
+	test34();
+	test35();
+	test36();
 	errorTests();
 
   return 1;
@@ -169,7 +274,8 @@ void test1()
 	std::cout << "---------------------" << std::endl;
 	std::cout << "createRelationForward" << std::endl;
 	createRelationForward();
-	indexTests();
+	IndexOptions options;
+	indexTests(options);
 	deleteRelation();
 }
 
@@ -180,7 +286,8 @@ void test2()
 	std::cout << "----------------------" << std::endl;
 	std::cout << "createRelationBackward" << std::endl;
 	createRelationBackward();
-	indexTests();
+	IndexOptions options;
+	indexTests(options);
 	deleteRelation();
 }
 
@@ -191,7 +298,8 @@ void test3()
 	std::cout << "--------------------" << std::endl;
 	std::cout << "createRelationRandom" << std::endl;
 	createRelationRandom();
-	indexTests();
+	IndexOptions options;
+	indexTests(options);
 	deleteRelation();
 }
 
@@ -201,7 +309,8 @@ void test4() {
     std::cout << "--------------------" << std::endl;
     std::cout << "negativeValueRelations" << std::endl;
     createRangedRelationForward(-3500, 3500);
-    negativeIntTests();
+    IndexOptions options;
+    negativeIntTests(options);
     try
     {
         File::remove(intIndexName);
@@ -217,7 +326,15 @@ void test5() {
     std::cout << "--------------------" << std::endl;
     std::cout << "emptyTreeTest" << std::endl;
     createForwardSizedRelation(0);
-    indexTests();
+    IndexOptions options;
+    emptyTreeTests(options);
+    try
+    {
+        File::remove(intIndexName);
+    }
+    catch(const FileNotFoundException& e)
+    {
+    }
     deleteRelation();
 }
 
@@ -225,8 +342,16 @@ void test6() {
     // This creates a test for a tree with one node
     std::cout << "--------------------" << std::endl;
     std::cout << "oneNodeTree" << std::endl;
-    createForwardSizedRelation(0);
-    indexTests();
+    createForwardSizedRelation(500);
+    IndexOptions options;
+    oneNodeTests(options);
+    try
+    {
+        File::remove(intIndexName);
+    }
+    catch(const FileNotFoundException& e)
+    {
+    }
     deleteRelation();
 }
 
@@ -235,7 +360,9 @@ void test7() {
     std::cout << "--------------------" << std::endl;
     std::cout << "largeInputTest1" << std::endl;
     createForwardSizedRelation(100000);
-    largeIntTests();
+    IndexOptions options;
+    options.bulkLoad = false;
+    largeIntTests(options);
     try
     {
         File::remove(intIndexName);
@@ -251,7 +378,9 @@ void test8() {
     std::cout << "--------------------" << std::endl;
     std::cout << "largeInputTest2" << std::endl;
     createRandomSizedRelation(100000);
-    largeIntTests();
+    IndexOptions options;
+    options.bulkLoad = false;
+    largeIntTests(options);
     try
     {
         File::remove(intIndexName);
@@ -267,169 +396,553 @@ void test9() {
     std::cout << "--------------------" << std::endl;
     std::cout << "largeInputTest3" << std::endl;
     createBackwardSizedRelation(100000);
-    largeIntTests();
+    IndexOptions options;
+    options.bulkLoad = false;
+    largeIntTests(options);
     try
     {
         File::remove(intIndexName);
     }
-    catch(FileNotFoundException e)
+    catch(const FileNotFoundException& e)
     {
     }
     deleteRelation();
 }
 
-// -----------------------------------------------------------------------------
-// createRelationForward
-// -----------------------------------------------------------------------------
-
-void createRelationForward()
-{
-	std::vector<RecordId> ridVec;
-  // destroy any old copies of relation file
-	try
-	{
-		File::remove(relationName);
-	}
-	catch(FileNotFoundException e)
-	{
-	}
-
-  file1 = new PageFile(relationName, true);
-
-  // initialize all of record1.s to keep purify happy
-  memset(record1.s, ' ', sizeof(record1.s));
-	PageId new_page_number;
-  Page new_page = file1->allocatePage(new_page_number);
-
-  // Insert a bunch of tuples into the relation.
-  for(int i = 0; i < relationSize; i++ )
-	{
-    sprintf(record1.s, "%05d string record", i);
-    record1.i = i;
-    record1.d = (double)i;
-    std::string new_data(reinterpret_cast<char*>(&record1), sizeof(record1));
-
-		while(1)
-		{
-			try
-			{
-    		new_page.insertRecord(new_data);
-				break;
-			}
-			catch(InsufficientSpaceException e)
-			{
-				file1->writePage(new_page_number, new_page);
-  			new_page = file1->allocatePage(new_page_number);
-			}
-		}
-  }
-
-	file1->writePage(new_page_number, new_page);
+void test10() {
+    // This creates a test for a large amount of integer relations bulk loaded from
+    // random order, with a sort buffer small enough to spill sorted runs to disk
+    std::cout << "--------------------" << std::endl;
+    std::cout << "bulkLoadTest" << std::endl;
+    createRandomSizedRelation(100000);
+    IndexOptions options;
+    options.bulkLoad = true;
+    options.fillFactor = 0.5;
+    options.sortBufferPages = 4;
+    largeIntTests(options);
+    try
+    {
+        File::remove(intIndexName);
+    }
+    catch(FileNotFoundException e)
+    {
+    }
+    deleteRelation();
 }
 
-// -----------------------------------------------------------------------------
-// createForwardSizedRelation
-// -----------------------------------------------------------------------------
-void createForwardSizedRelation(int value)
-{
-    std::vector<RecordId> ridVec;
-    // destroy any old copies of relation file
-    try {
-        File::remove(relationName);
+void test11() {
+    // This creates a test for several threads inserting into one concurrent index
+    // while other threads scan it
+    std::cout << "--------------------" << std::endl;
+    std::cout << "concurrentInsertTest" << std::endl;
+    createForwardSizedRelation(0);
+    concurrentInsertTests();
+    try
+    {
+        File::remove(intIndexName);
     }
-    catch(FileNotFoundException e){}
-
-    file1 = new PageFile(relationName, true);
+    catch(const FileNotFoundException& e)
+    {
+    }
+    deleteRelation();
+}
 
-    // initialize all of record1.s to keep purify happy
-    memset(record1.s, ' ', sizeof(record1.s));
-    PageId new_page_number;
-    Page new_page = file1->allocatePage(new_page_number);
+void test12() {
+    // This creates a test for several scans running side by side over one index
+    std::cout << "--------------------" << std::endl;
+    std::cout << "scanCursorTest" << std::endl;
+    createRelationForward();
+    cursorTests();
+    try
+    {
+        File::remove(intIndexName);
+    }
+    catch(const FileNotFoundException& e)
+    {
+    }
+    deleteRelation();
+}
 
-    // Insert a bunch of tuples into the relation.
-    for(int i = 0; i < value; i++ ) {
-        sprintf(record1.s, "%05d string record", i);
-        record1.i = i;
-        record1.d = (double)i;
-        std::string new_data(reinterpret_cast<char*>(&record1), sizeof(record1));
+void test13() {
+    // This creates a test for scans that fetch record ids in batches
+    std::cout << "--------------------" << std::endl;
+    std::cout << "batchScanTest" << std::endl;
+    createRandomSizedRelation(100000);
+    batchScanTests();
+    try
+    {
+        File::remove(intIndexName);
+    }
+    catch(const FileNotFoundException& e)
+    {
+    }
+    deleteRelation();
+}
 
-        while(1) {
-            try {
-                new_page.insertRecord(new_data);
-                break;
-            }
-            catch(InsufficientSpaceException e) {
-                file1->writePage(new_page_number, new_page);
-                new_page = file1->allocatePage(new_page_number);
-            }
-        }
+void test14() {
+    // This creates a test for deleting entries until the tree shrinks, and for the
+    // freed pages being reused
+    std::cout << "--------------------" << std::endl;
+    std::cout << "deleteTest" << std::endl;
+    createForwardSizedRelation(0);
+    deleteTests();
+    try
+    {
+        File::remove(intIndexName);
     }
+    catch(const FileNotFoundException& e)
+    {
+    }
+    deleteRelation();
+}
 
-    file1->writePage(new_page_number, new_page);
+void test15() {
+    // This creates a test for point lookups of single and duplicated keys
+    std::cout << "--------------------" << std::endl;
+    std::cout << "lookupTest" << std::endl;
+    createRelationForward();
+    lookupTests();
+    try
+    {
+        File::remove(intIndexName);
+        File::remove(stringIndexName);
+    }
+    catch(const FileNotFoundException& e)
+    {
+    }
+    deleteRelation();
 }
 
-// -----------------------------------------------------------------------------
-// createRangedRelationForward
-// -----------------------------------------------------------------------------
-void createRangedRelationForward(int start, int end)
-{
-    std::vector<RecordId> ridVec;
-    // destroy any old copies of relation file
+void test16() {
+    // This creates a test for appending ascending keys to an append optimized index, and
+    // for random keys with many duplicates inserted into one
+    std::cout << "--------------------" << std::endl;
+    std::cout << "appendTest" << std::endl;
+    createForwardSizedRelation(0);
+    appendTests();
     try
     {
-        File::remove(relationName);
+        File::remove(intIndexName);
     }
-    catch(FileNotFoundException e)
+    catch(const FileNotFoundException& e)
+    {
+    }
+    appendDuplicateTests();
+    try
+    {
+        File::remove(intIndexName);
+    }
+    catch(const FileNotFoundException& e)
     {
     }
+    deleteRelation();
+}
 
-    file1 = new PageFile(relationName, true);
+void test17() {
+    // This creates a test for range scans that read leaves ahead, over a buffer pool
+    // smaller than the index
+    std::cout << "--------------------" << std::endl;
+    std::cout << "readAheadTest" << std::endl;
+    createRandomSizedRelation(100000);
+    IndexOptions options;
+    options.bulkLoad = true;
+    options.fillFactor = 0.5;
+    options.readAheadLeaves = 8;
+    largeIntTests(options);
+    readAheadTests();
+    try
+    {
+        File::remove(intIndexName);
+    }
+    catch(const FileNotFoundException& e)
+    {
+    }
+    deleteRelation();
+}
 
-    // initialize all of record1.s to keep purify happy
-    memset(record1.s, ' ', sizeof(record1.s));
-    PageId new_page_number;
-    Page new_page = file1->allocatePage(new_page_number);
+void test18() {
+    // This creates a test for INTEGER indexes with packed leaves, bulk loaded and built
+    // by inserts
+    std::cout << "--------------------" << std::endl;
+    std::cout << "packedLeafTest" << std::endl;
+    createRandomSizedRelation(100000);
+    IndexOptions options;
+    options.bulkLoad = true;
+    options.packLeaves = true;
+    largeIntTests(options);
+    packedLeafTests();
+    try
+    {
+        File::remove(intIndexName);
+    }
+    catch(const FileNotFoundException& e)
+    {
+    }
+    deleteRelation();
+}
 
-    // Insert a bunch of tuples into the relation.
-    for(int i = start; i < end; i++ )
+void test19() {
+    // This creates a test for posting list leaves over an attribute with few distinct
+    // values, on all three key types
+    std::cout << "--------------------" << std::endl;
+    std::cout << "postingListTest" << std::endl;
+    createRepeatingRelation(100000, 10);
+    postingListTests();
+    try
     {
-        sprintf(record1.s, "%05d string record", i);
-        record1.i = i;
-        record1.d = (double)i;
-        std::string new_data(reinterpret_cast<char*>(&record1), sizeof(record1));
+        File::remove(intIndexName);
+    }
+    catch(const FileNotFoundException& e)
+    {
+    }
+    deleteRelation();
+}
 
-        while(1)
+void test20() {
+    // This creates a test for composite key indexes, on (INTEGER, INTEGER),
+    // (INTEGER, DOUBLE) and (INTEGER, STRING, DOUBLE) keys
+    std::cout << "--------------------" << std::endl;
+    std::cout << "compositeKeyTest" << std::endl;
+    createCompositeRelation(5000);
+    compositeKeyTests();
+    std::string names[] = { pairIndexName, intDoubleIndexName, compositeIndexName };
+    for (int n = 0; n < 3; n++)
+    {
+        try
+        {
+            File::remove(names[n]);
+        }
+        catch(const FileNotFoundException& e)
         {
-            try
-            {
-                new_page.insertRecord(new_data);
-                break;
-            }
-            catch(InsufficientSpaceException e)
-            {
-                file1->writePage(new_page_number, new_page);
-                new_page = file1->allocatePage(new_page_number);
-            }
         }
     }
+    deleteRelation();
+}
 
-    file1->writePage(new_page_number, new_page);
+void test21() {
+    // This creates a test for covering indexes that carry the d field and the start of
+    // the s field in their leaves, bulk loaded and built by inserts
+    std::cout << "--------------------" << std::endl;
+    std::cout << "coveringIndexTest" << std::endl;
+    createRandomSizedRelation(20000);
+    coveringIndexTests();
+    try
+    {
+        File::remove(intIndexName);
+    }
+    catch(const FileNotFoundException& e)
+    {
+    }
+    deleteRelation();
 }
 
-// -----------------------------------------------------------------------------
-// createRelationBackward
-// -----------------------------------------------------------------------------
+void test22() {
+    // This creates a test for descending scans over every leaf layout, with duplicate
+    // keys, and over leaves split and merged after the index was built
+    std::cout << "--------------------" << std::endl;
+    std::cout << "descendingScanTest" << std::endl;
+    createRepeatingRelation(40000, 4000);
+    descendingScanTests();
+    try
+    {
+        File::remove(intIndexName);
+    }
+    catch(const FileNotFoundException& e)
+    {
+    }
+    deleteRelation();
+}
 
-void createRelationBackward()
-{
-  // destroy any old copies of relation file
-	try
-	{
-		File::remove(relationName);
+void test23() {
+    // This creates a test for parallel range scans over every leaf layout, with duplicate
+    // keys on both sides of the separators, and under concurrent inserts
+    std::cout << "--------------------" << std::endl;
+    std::cout << "parallelScanTest" << std::endl;
+    createRepeatingRelation(40000, 4000);
+    parallelScanTests();
+    try
+    {
+        File::remove(intIndexName);
+    }
+    catch(const FileNotFoundException& e)
+    {
+    }
+    deleteRelation();
+}
+
+void test24() {
+    // This creates a test for indexes that keep their non-leaf nodes pinned, built by
+    // inserts, then split and merged up to the root
+    std::cout << "--------------------" << std::endl;
+    std::cout << "innerNodeCacheTest" << std::endl;
+    createRandomSizedRelation(100000);
+    IndexOptions options;
+    options.cacheInnerNodes = true;
+    options.bulkLoad = false;
+    largeIntTests(options);
+    try
+    {
+        File::remove(intIndexName);
+    }
+    catch(const FileNotFoundException& e)
+    {
+    }
+    innerNodeCacheTests();
+    try
+    {
+        File::remove(intIndexName);
+    }
+    catch(const FileNotFoundException& e)
+    {
+    }
+    deleteRelation();
+}
+
+void test25() {
+    // This creates a test for indexes whose non-leaf nodes carry search directories, bulk
+    // loaded, then built by inserts with long runs of duplicates, merged and reopened
+    std::cout << "--------------------" << std::endl;
+    std::cout << "nodeDirectoryTest" << std::endl;
+    createRandomSizedRelation(100000);
+    IndexOptions options;
+    options.bulkLoad = true;
+    options.nodeDirectories = true;
+    largeIntTests(options);
+    try
+    {
+        File::remove(intIndexName);
+    }
+    catch(const FileNotFoundException& e)
+    {
+    }
+    nodeDirectoryTests();
+    try
+    {
+        File::remove(intIndexName);
+    }
+    catch(const FileNotFoundException& e)
+    {
+    }
+    deleteRelation();
+}
+
+void test26() {
+    // This creates a test for write optimized indexes, built by inserts that wait in
+    // the message buffers of the non-leaf nodes, with reads, deletes and reopening
+    std::cout << "--------------------" << std::endl;
+    std::cout << "bufferedInsertTest" << std::endl;
+    createRandomSizedRelation(100000);
+    IndexOptions options;
+    options.bufferInserts = true;
+    options.bulkLoad = false;
+    largeIntTests(options);
+    try
+    {
+        File::remove(intIndexName);
+    }
+    catch(const FileNotFoundException& e)
+    {
+    }
+    bufferedInsertTests();
+    try
+    {
+        File::remove(intIndexName);
+    }
+    catch(const FileNotFoundException& e)
+    {
+    }
+    deleteRelation();
+}
+
+void test27() {
+    // This creates a test for indexes with a Bloom filter of their keys, bulk loaded and
+    // then grown by inserts, with lookups of present, absent and deleted keys
+    std::cout << "--------------------" << std::endl;
+    std::cout << "bloomFilterTest" << std::endl;
+    createRandomSizedRelation(100000);
+    IndexOptions options;
+    options.bulkLoad = true;
+    options.bloomFilter = true;
+    largeIntTests(options);
+    try
+    {
+        File::remove(intIndexName);
+    }
+    catch(const FileNotFoundException& e)
+    {
+    }
+    bloomFilterTests();
+    try
+    {
+        File::remove(intIndexName);
+    }
+    catch(const FileNotFoundException& e)
+    {
+    }
+    try
+    {
+        File::remove(stringIndexName);
+    }
+    catch(const FileNotFoundException& e)
+    {
+    }
+    deleteRelation();
+}
+
+void test28() {
+    // This creates a test for index statistics and range estimates, bulk loaded, grown by
+    // inserts with a frequent key, refreshed, reopened, and built with buffered inserts
+    std::cout << "--------------------" << std::endl;
+    std::cout << "statisticsTest" << std::endl;
+    createRandomSizedRelation(100000);
+    statisticsTests();
+    try
+    {
+        File::remove(intIndexName);
+    }
+    catch(const FileNotFoundException& e)
+    {
+    }
+    deleteRelation();
+}
+
+void test29() {
+    // This creates a test for exact range counts, ranks and selects over counted nodes,
+    // bulk loaded, grown past two non-leaf levels, shrunk back by deletes and reopened
+    std::cout << "--------------------" << std::endl;
+    std::cout << "countedNodeTest" << std::endl;
+    createRandomSizedRelation(100000);
+    countedNodeTests();
+    try
+    {
+        File::remove(intIndexName);
+    }
+    catch(const FileNotFoundException& e)
+    {
+    }
+    deleteRelation();
+}
+
+void test30() {
+    // This creates a test for variable-length string keys, bulk loaded, grown by long keys
+    // that share most of their bytes, shrunk by deletes and reopened
+    std::cout << "--------------------" << std::endl;
+    std::cout << "varStringTest" << std::endl;
+    createRandomSizedRelation(100000);
+    varStringTests();
+    try
+    {
+        File::remove(stringIndexName);
+    }
+    catch(const FileNotFoundException& e)
+    {
+    }
+    deleteRelation();
+}
+
+void test31() {
+    // The tests of test1, on indexes bulk loaded from the relation
+    std::cout << "--------------------" << std::endl;
+    std::cout << "bulkLoadRelationForward" << std::endl;
+    createRelationForward();
+    IndexOptions options;
+    options.bulkLoad = true;
+    indexTests(options);
+    deleteRelation();
+}
+
+void test32() {
+    // The tests of test2, on indexes bulk loaded from the relation
+    std::cout << "--------------------" << std::endl;
+    std::cout << "bulkLoadRelationBackward" << std::endl;
+    createRelationBackward();
+    IndexOptions options;
+    options.bulkLoad = true;
+    indexTests(options);
+    deleteRelation();
+}
+
+void test33() {
+    // The tests of test3, on indexes bulk loaded from the relation
+    std::cout << "--------------------" << std::endl;
+    std::cout << "bulkLoadRelationRandom" << std::endl;
+    createRelationRandom();
+    IndexOptions options;
+    options.bulkLoad = true;
+    indexTests(options);
+    deleteRelation();
+}
+
+void test34() {
+    // The tests of test4, on an index bulk loaded from the relation
+    std::cout << "--------------------" << std::endl;
+    std::cout << "bulkLoadNegativeValueRelations" << std::endl;
+    createRangedRelationForward(-3500, 3500);
+    IndexOptions options;
+    options.bulkLoad = true;
+    negativeIntTests(options);
+    try
+    {
+        File::remove(intIndexName);
+    }
+    catch(const FileNotFoundException& e)
+    {
+    }
+    deleteRelation();
+}
+
+void test35() {
+    // The tests of test5, on an index bulk loaded from an empty relation
+    std::cout << "--------------------" << std::endl;
+    std::cout << "bulkLoadEmptyTreeTest" << std::endl;
+    createForwardSizedRelation(0);
+    IndexOptions options;
+    options.bulkLoad = true;
+    emptyTreeTests(options);
+    try
+    {
+        File::remove(intIndexName);
+    }
+    catch(const FileNotFoundException& e)
+    {
+    }
+    deleteRelation();
+}
+
+void test36() {
+    // The tests of test6, on an index bulk loaded into a single node
+    std::cout << "--------------------" << std::endl;
+    std::cout << "bulkLoadOneNodeTree" << std::endl;
+    createForwardSizedRelation(500);
+    IndexOptions options;
+    options.bulkLoad = true;
+    oneNodeTests(options);
+    try
+    {
+        File::remove(intIndexName);
+    }
+    catch(const FileNotFoundException& e)
+    {
+    }
+    deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// createRelationForward
+// -----------------------------------------------------------------------------
+
+void createRelationForward()
+{
+	std::vector<RecordId> ridVec;
+  // destroy any old copies of relation file
+	try
+	{
+		File::remove(relationName);
 	}
 	catch(FileNotFoundException e)
 	{
 	}
+
   file1 = new PageFile(relationName, true);
 
   // initialize all of record1.s to keep purify happy
@@ -438,13 +951,12 @@ void createRelationBackward()
   Page new_page = file1->allocatePage(new_page_number);
 
   // Insert a bunch of tuples into the relation.
-  for(int i = relationSize - 1; i >= 0; i-- )
+  for(int i = 0; i < relationSize; i++ )
 	{
     sprintf(record1.s, "%05d string record", i);
     record1.i = i;
-    record1.d = i;
-
-    std::string new_data(reinterpret_cast<char*>(&record1), sizeof(RECORD));
+    record1.d = (double)i;
+    std::string new_data(reinterpret_cast<char*>(&record1), sizeof(record1));
 
 		while(1)
 		{
@@ -465,11 +977,52 @@ void createRelationBackward()
 }
 
 // -----------------------------------------------------------------------------
-// createBackwardSizedRelation
+// createForwardSizedRelation
 // -----------------------------------------------------------------------------
+void createForwardSizedRelation(int value)
+{
+    std::vector<RecordId> ridVec;
+    // destroy any old copies of relation file
+    try {
+        File::remove(relationName);
+    }
+    catch(FileNotFoundException e){}
 
-void createBackwardSizedRelation(int value)
+    file1 = new PageFile(relationName, true);
+
+    // initialize all of record1.s to keep purify happy
+    memset(record1.s, ' ', sizeof(record1.s));
+    PageId new_page_number;
+    Page new_page = file1->allocatePage(new_page_number);
+
+    // Insert a bunch of tuples into the relation.
+    for(int i = 0; i < value; i++ ) {
+        sprintf(record1.s, "%05d string record", i);
+        record1.i = i;
+        record1.d = (double)i;
+        std::string new_data(reinterpret_cast<char*>(&record1), sizeof(record1));
+
+        while(1) {
+            try {
+                new_page.insertRecord(new_data);
+                break;
+            }
+            catch(InsufficientSpaceException e) {
+                file1->writePage(new_page_number, new_page);
+                new_page = file1->allocatePage(new_page_number);
+            }
+        }
+    }
+
+    file1->writePage(new_page_number, new_page);
+}
+
+// -----------------------------------------------------------------------------
+// createRangedRelationForward
+// -----------------------------------------------------------------------------
+void createRangedRelationForward(int start, int end)
 {
+    std::vector<RecordId> ridVec;
     // destroy any old copies of relation file
     try
     {
@@ -478,6 +1031,7 @@ void createBackwardSizedRelation(int value)
     catch(FileNotFoundException e)
     {
     }
+
     file1 = new PageFile(relationName, true);
 
     // initialize all of record1.s to keep purify happy
@@ -486,13 +1040,12 @@ void createBackwardSizedRelation(int value)
     Page new_page = file1->allocatePage(new_page_number);
 
     // Insert a bunch of tuples into the relation.
-    for(int i = value - 1; i >= 0; i-- )
+    for(int i = start; i < end; i++ )
     {
         sprintf(record1.s, "%05d string record", i);
         record1.i = i;
-        record1.d = i;
-
-        std::string new_data(reinterpret_cast<char*>(&record1), sizeof(RECORD));
+        record1.d = (double)i;
+        std::string new_data(reinterpret_cast<char*>(&record1), sizeof(record1));
 
         while(1)
         {
@@ -513,10 +1066,10 @@ void createBackwardSizedRelation(int value)
 }
 
 // -----------------------------------------------------------------------------
-// createRelationRandom
+// createRelationBackward
 // -----------------------------------------------------------------------------
 
-void createRelationRandom()
+void createRelationBackward()
 {
   // destroy any old copies of relation file
 	try
@@ -533,22 +1086,118 @@ void createRelationRandom()
 	PageId new_page_number;
   Page new_page = file1->allocatePage(new_page_number);
 
-  // insert records in random order
+  // Insert a bunch of tuples into the relation.
+  for(int i = relationSize - 1; i >= 0; i-- )
+	{
+    sprintf(record1.s, "%05d string record", i);
+    record1.i = i;
+    record1.d = i;
 
-  std::vector<int> intvec(relationSize);
-  for( int i = 0; i < relationSize; i++ )
-  {
-    intvec[i] = i;
-  }
+    std::string new_data(reinterpret_cast<char*>(&record1), sizeof(RECORD));
 
-  long pos;
-  int val;
-	int i = 0;
-  while( i < relationSize )
-  {
-    pos = random() % (relationSize-i);
-    val = intvec[pos];
-    sprintf(record1.s, "%05d string record", val);
+		while(1)
+		{
+			try
+			{
+    		new_page.insertRecord(new_data);
+				break;
+			}
+			catch(InsufficientSpaceException e)
+			{
+				file1->writePage(new_page_number, new_page);
+  			new_page = file1->allocatePage(new_page_number);
+			}
+		}
+  }
+
+	file1->writePage(new_page_number, new_page);
+}
+
+// -----------------------------------------------------------------------------
+// createBackwardSizedRelation
+// -----------------------------------------------------------------------------
+
+void createBackwardSizedRelation(int value)
+{
+    // destroy any old copies of relation file
+    try
+    {
+        File::remove(relationName);
+    }
+    catch(FileNotFoundException e)
+    {
+    }
+    file1 = new PageFile(relationName, true);
+
+    // initialize all of record1.s to keep purify happy
+    memset(record1.s, ' ', sizeof(record1.s));
+    PageId new_page_number;
+    Page new_page = file1->allocatePage(new_page_number);
+
+    // Insert a bunch of tuples into the relation.
+    for(int i = value - 1; i >= 0; i-- )
+    {
+        sprintf(record1.s, "%05d string record", i);
+        record1.i = i;
+        record1.d = i;
+
+        std::string new_data(reinterpret_cast<char*>(&record1), sizeof(RECORD));
+
+        while(1)
+        {
+            try
+            {
+                new_page.insertRecord(new_data);
+                break;
+            }
+            catch(InsufficientSpaceException e)
+            {
+                file1->writePage(new_page_number, new_page);
+                new_page = file1->allocatePage(new_page_number);
+            }
+        }
+    }
+
+    file1->writePage(new_page_number, new_page);
+}
+
+// -----------------------------------------------------------------------------
+// createRelationRandom
+// -----------------------------------------------------------------------------
+
+void createRelationRandom()
+{
+  // destroy any old copies of relation file
+	try
+	{
+		File::remove(relationName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+  file1 = new PageFile(relationName, true);
+
+  // initialize all of record1.s to keep purify happy
+  memset(record1.s, ' ', sizeof(record1.s));
+	PageId new_page_number;
+  Page new_page = file1->allocatePage(new_page_number);
+
+  // insert records in random order
+
+  std::vector<int> intvec(relationSize);
+  for( int i = 0; i < relationSize; i++ )
+  {
+    intvec[i] = i;
+  }
+
+  long pos;
+  int val;
+	int i = 0;
+  while( i < relationSize )
+  {
+    pos = random() % (relationSize-i);
+    val = intvec[pos];
+    sprintf(record1.s, "%05d string record", val);
     record1.i = val;
     record1.d = val;
 
@@ -600,7 +1249,7 @@ void createRandomSizedRelation(int value)
 
     // insert records in random order
 
-    std::vector<int> intvec(relationSize);
+    std::vector<int> intvec(value);
     for( int i = 0; i < value; i++ )
     {
         intvec[i] = i;
@@ -633,8 +1282,8 @@ void createRandomSizedRelation(int value)
             }
         }
 
-        int temp = intvec[relationSize-1-i];
-        intvec[relationSize-1-i] = intvec[pos];
+        int temp = intvec[value-1-i];
+        intvec[value-1-i] = intvec[pos];
         intvec[pos] = temp;
         i++;
     }
@@ -642,80 +1291,2231 @@ void createRandomSizedRelation(int value)
     file1->writePage(new_page_number, new_page);
 }
 
+// -----------------------------------------------------------------------------
+// createRepeatingRelation
+// -----------------------------------------------------------------------------
+
+void createRepeatingRelation(int value, int distinct)
+{
+    // destroy any old copies of relation file
+    try
+    {
+        File::remove(relationName);
+    }
+    catch(const FileNotFoundException& e)
+    {
+    }
+    file1 = new PageFile(relationName, true);
+
+    // initialize all of record1.s to keep purify happy
+    memset(record1.s, ' ', sizeof(record1.s));
+    PageId new_page_number;
+    Page new_page = file1->allocatePage(new_page_number);
+
+    // insert records whose values cycle through 0 to distinct - 1
+    for( int i = 0; i < value; i++ )
+    {
+        int val = i % distinct;
+        sprintf(record1.s, "%05d string record", val);
+        record1.i = val;
+        record1.d = val;
+
+        std::string new_data(reinterpret_cast<char*>(&record1), sizeof(RECORD));
+
+        while(1)
+        {
+            try
+            {
+                new_page.insertRecord(new_data);
+                break;
+            }
+            catch(const InsufficientSpaceException& e)
+            {
+                file1->writePage(new_page_number, new_page);
+                new_page = file1->allocatePage(new_page_number);
+            }
+        }
+    }
+
+    file1->writePage(new_page_number, new_page);
+}
+
+// -----------------------------------------------------------------------------
+// createCompositeRelation
+// -----------------------------------------------------------------------------
+
+void createCompositeRelation(int value)
+{
+    // destroy any old copies of relation file
+    try
+    {
+        File::remove(relationName);
+    }
+    catch(const FileNotFoundException& e)
+    {
+    }
+    file1 = new PageFile(relationName, true);
+
+    PAIRRECORD record;
+    memset(record.s, ' ', sizeof(record.s));
+    PageId new_page_number;
+    Page new_page = file1->allocatePage(new_page_number);
+
+    // insert records in (i, j) order, 50 per value of i, with d and s spread
+    // over negative and positive values and 7 strings
+    for( int k = 0; k < value; k++ )
+    {
+        record.i = k / 50;
+        record.j = k % 50;
+        record.d = (k * 37) % 100 - 49.5;
+        sprintf(record.s, "%05d string record", k % 7);
+
+        std::string new_data(reinterpret_cast<char*>(&record), sizeof(PAIRRECORD));
+
+        while(1)
+        {
+            try
+            {
+                new_page.insertRecord(new_data);
+                break;
+            }
+            catch(const InsufficientSpaceException& e)
+            {
+                file1->writePage(new_page_number, new_page);
+                new_page = file1->allocatePage(new_page_number);
+            }
+        }
+    }
+
+    file1->writePage(new_page_number, new_page);
+}
+
 // -----------------------------------------------------------------------------
 // indexTests
 // -----------------------------------------------------------------------------
 
-void indexTests()
-{
-  if(testNum == 1)
-  {
-    intTests();
-		try
+void indexTests(const IndexOptions & options)
+{
+  if(testNum == 1)
+  {
+    intTests(options);
+		try
+		{
+			File::remove(intIndexName);
+		}
+  	catch(FileNotFoundException e)
+  	{
+  	}
+
+    doubleTests(options);
+		try
+		{
+			File::remove(doubleIndexName);
+		}
+  	catch(const FileNotFoundException& e)
+  	{
+  	}
+
+    stringTests(options);
+		try
+		{
+			File::remove(stringIndexName);
+		}
+  	catch(const FileNotFoundException& e)
+  	{
+  	}
+  }
+}
+
+// -----------------------------------------------------------------------------
+// intTests
+// -----------------------------------------------------------------------------
+
+void intTests(const IndexOptions & options)
+{
+  std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+
+	// run some tests
+	checkPassFail(intScan(&index,25,GT,40,LT), 14)
+	checkPassFail(intScan(&index,20,GTE,35,LTE), 16)
+	checkPassFail(intScan(&index,-3,GT,3,LT), 3)
+	checkPassFail(intScan(&index,996,GT,1001,LT), 4)
+	checkPassFail(intScan(&index,0,GT,1,LT), 0)
+	checkPassFail(intScan(&index,300,GT,400,LT), 99)
+	checkPassFail(intScan(&index,3000,GTE,4000,LT), 1000)
+}
+
+// -----------------------------------------------------------------------------
+// doubleTests
+// -----------------------------------------------------------------------------
+
+void doubleTests(const IndexOptions & options)
+{
+  std::cout << "Create a B+ Tree index on the double field" << std::endl;
+  BTreeIndex index(relationName, doubleIndexName, bufMgr, offsetof(tuple,d), DOUBLE, options);
+
+	// run some tests
+	checkPassFail(doubleScan(&index,25,GT,40,LT), 14)
+	checkPassFail(doubleScan(&index,20,GTE,35,LTE), 16)
+	checkPassFail(doubleScan(&index,-3,GT,3,LT), 3)
+	checkPassFail(doubleScan(&index,996,GT,1001,LT), 4)
+	checkPassFail(doubleScan(&index,0,GT,1,LT), 0)
+	checkPassFail(doubleScan(&index,300,GT,400,LT), 99)
+	checkPassFail(doubleScan(&index,3000,GTE,4000,LT), 1000)
+	checkPassFail(doubleScan(&index,2.5,GT,5.5,LT), 3)
+}
+
+// -----------------------------------------------------------------------------
+// stringTests
+// -----------------------------------------------------------------------------
+
+void stringTests(const IndexOptions & options)
+{
+  std::cout << "Create a B+ Tree index on the string field" << std::endl;
+  BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING, options);
+
+	// run some tests
+	checkPassFail(stringScan(&index,25,GT,40,LT), 14)
+	checkPassFail(stringScan(&index,20,GTE,35,LTE), 16)
+	checkPassFail(stringScan(&index,-3,GT,3,LT), 3)
+	checkPassFail(stringScan(&index,996,GT,1001,LT), 4)
+	checkPassFail(stringScan(&index,0,GT,1,LT), 0)
+	checkPassFail(stringScan(&index,300,GT,400,LT), 99)
+	checkPassFail(stringScan(&index,3000,GTE,4000,LT), 1000)
+}
+
+void emptyTreeTests(const IndexOptions & options)
+{
+    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+
+    // run some tests
+    checkPassFail(intScan(&index,25,GT,40,LT), 0)
+    checkPassFail(intScan(&index,-3,GT,3,LT), 0)
+    checkPassFail(intScan(&index,0,GTE,0,LTE), 0)
+}
+
+void oneNodeTests(const IndexOptions & options)
+{
+    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+
+    // run some tests
+    checkPassFail(intScan(&index,25,GT,40,LT), 14)
+    checkPassFail(intScan(&index,0,GTE,0,LTE), 1)
+    checkPassFail(intScan(&index,-3,GT,3,LT), 3)
+    checkPassFail(intScan(&index,450,GT,1000,LT), 49)
+    checkPassFail(intScan(&index,500,GTE,1000,LT), 0)
+}
+
+void negativeIntTests(const IndexOptions & options)
+{
+    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+
+    // run some tests
+    checkPassFail(intScan(&index,-500,GT,500,LT), 999)
+    checkPassFail(intScan(&index,20,GTE,35,LTE), 16)
+    checkPassFail(intScan(&index,-1500,GT,1500,LT), 2999)
+    checkPassFail(intScan(&index,-3,GT,3,LT), 5)
+    checkPassFail(intScan(&index,-1000,GT,1000,LT), 1999)
+    checkPassFail(intScan(&index,0,GT,1,LT), 0)
+    checkPassFail(intScan(&index,-2000,GT,2000,LT), 3999)
+    checkPassFail(intScan(&index,300,GT,400,LT), 99)
+    checkPassFail(intScan(&index,-2500,GT,2500,LT), 4999)
+    checkPassFail(intScan(&index,3000,GTE,4000,LT), 500)
+    checkPassFail(intScan(&index,-3500,GT,3500,LT), 6999)
+
+}
+
+void largeIntTests(const IndexOptions & options)
+{
+    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+
+    // run some tests
+    checkPassFail(intScan(&index,2500,GT,5000,LT), 2499)
+    checkPassFail(intScan(&index,20000,GTE,35000,LTE), 15001)
+    checkPassFail(intScan(&index,-3,GT,3,LT), 3)
+    checkPassFail(intScan(&index,996,GT,1001,LT), 4)
+    checkPassFail(intScan(&index,0,GT,1,LT), 0)
+    checkPassFail(intScan(&index,50000,GT,500001,LT), 49999)
+    checkPassFail(intScan(&index,82250,GTE,95750,LT), 13500)
+}
+
+void concurrentInsertTests()
+{
+    std::cout << "Create a concurrent B+ Tree index on the integer field" << std::endl;
+    IndexOptions options;
+    options.concurrent = true;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+
+    // Four threads insert the keys 0 to 99999 in random order. The rids are never read.
+    const int numKeys = 100000;
+    const int numThreads = 4;
+    std::vector<int> keys(numKeys);
+    for (int i = 0; i < numKeys; i++)
+    {
+        keys[i] = i;
+    }
+    for (int i = numKeys - 1; i > 0; i--)
+    {
+        std::swap(keys[i], keys[random() % (i + 1)]);
+    }
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; t++)
+    {
+        threads.push_back(std::thread([&index, &keys, t]() {
+            for (int i = t; i < numKeys; i += numThreads)
+            {
+                RecordId insertRid;
+                insertRid.page_number = keys[i] + 1;
+                insertRid.slot_number = 1;
+                index.insertEntry(&keys[i], insertRid);
+            }
+        }));
+    }
+    // Two more threads scan while the inserts run, each with its own cursor. Whatever
+    // they find must be in order.
+    const int numScanners = 2;
+    std::vector<int> outOfOrder(numScanners, 0);
+    for (int t = 0; t < numScanners; t++)
+    {
+        threads.push_back(std::thread([&index, &outOfOrder, t]() {
+            IndexScanCursor cursor(&index);
+            unsigned int seed = t;
+            for (int s = 0; s < 50; s++)
+            {
+                int lowVal = rand_r(&seed) % numKeys;
+                int highVal = lowVal + 2000;
+                try
+                {
+                    cursor.startScan(&lowVal, GTE, &highVal, LT);
+                    RecordId scanRid;
+                    PageId prev = 0;
+                    try
+                    {
+                        while (1)
+                        {
+                            cursor.scanNext(scanRid);
+                            if (scanRid.page_number < prev)
+                            {
+                                outOfOrder[t]++;
+                            }
+                            prev = scanRid.page_number;
+                        }
+                    }
+                    catch(const IndexScanCompletedException& e)
+                    {
+                    }
+                    cursor.endScan();
+                }
+                catch(const NoSuchKeyFoundException& e)
+                {
+                }
+            }
+        }));
+    }
+    for (size_t t = 0; t < threads.size(); t++)
+    {
+        threads[t].join();
+    }
+
+    // run some tests
+    checkPassFail(outOfOrder[0] + outOfOrder[1], 0)
+    checkPassFail(countScan(&index,2500,GT,5000,LT), 2499)
+    checkPassFail(countScan(&index,20000,GTE,35000,LTE), 15001)
+    checkPassFail(countScan(&index,-3,GT,3,LT), 3)
+    checkPassFail(countScan(&index,50000,GT,500001,LT), 49999)
+    checkPassFail(countScan(&index,-1,GT,numKeys,LT), numKeys)
+
+    // Two threads delete the odd keys, merging and freeing nodes, while two more look
+    // up the even keys. Every even key must still be found.
+    threads.clear();
+    for (int t = 0; t < 2; t++)
+    {
+        threads.push_back(std::thread([&index, &keys, t]() {
+            for (int i = t; i < numKeys; i += 2)
+            {
+                if (keys[i] % 2 == 1)
+                {
+                    RecordId deleteRid;
+                    deleteRid.page_number = keys[i] + 1;
+                    deleteRid.slot_number = 1;
+                    index.deleteEntry(&keys[i], deleteRid);
+                }
+            }
+        }));
+    }
+    std::vector<int> missing(2, 0);
+    for (int t = 0; t < 2; t++)
+    {
+        threads.push_back(std::thread([&index, &missing, t]() {
+            std::vector<RecordId> rids;
+            for (int round = 0; round < 5; round++)
+            {
+                for (int key = 2 * t; key < numKeys; key += 4)
+                {
+                    if (index.lookup(&key, rids) != 1 || rids[0].page_number != (PageId) (key + 1))
+                    {
+                        missing[t]++;
+                    }
+                }
+            }
+        }));
+    }
+    for (size_t t = 0; t < threads.size(); t++)
+    {
+        threads[t].join();
+    }
+    checkPassFail(missing[0] + missing[1], 0)
+    checkPassFail(countScan(&index,-1,GT,numKeys,LT), numKeys / 2)
+    checkPassFail(countScan(&index,2500,GT,5000,LT), 1249)
+}
+
+void cursorTests()
+{
+    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+
+    // Two cursors over overlapping ranges and the built-in scan, advanced in turn.
+    IndexScanCursor first(&index);
+    IndexScanCursor second(&index);
+    int lowFirst = 0, highFirst = 3000;
+    int lowSecond = 2000, highSecond = 5000;
+    int lowVal = 25, highVal = 40;
+    first.startScan(&lowFirst, GTE, &highFirst, LT);
+    second.startScan(&lowSecond, GTE, &highSecond, LT);
+    index.startScan(&lowVal, GT, &highVal, LT);
+
+    int firstCount = 0, secondCount = 0, builtInCount = 0;
+    bool firstDone = false, secondDone = false, builtInDone = false;
+    RecordId scanRid;
+    while (!firstDone || !secondDone || !builtInDone)
+    {
+        try
+        {
+            if (!firstDone)
+            {
+                first.scanNext(scanRid);
+                firstCount++;
+            }
+        }
+        catch(const IndexScanCompletedException& e)
+        {
+            firstDone = true;
+        }
+        try
+        {
+            if (!secondDone)
+            {
+                second.scanNext(scanRid);
+                secondCount++;
+            }
+        }
+        catch(const IndexScanCompletedException& e)
+        {
+            secondDone = true;
+        }
+        try
+        {
+            if (!builtInDone)
+            {
+                index.scanNext(scanRid);
+                builtInCount++;
+            }
+        }
+        catch(const IndexScanCompletedException& e)
+        {
+            builtInDone = true;
+        }
+    }
+    first.endScan();
+    index.endScan();
+
+    // run some tests
+    checkPassFail(firstCount, 3000)
+    checkPassFail(secondCount, 3000)
+    checkPassFail(builtInCount, 14)
+    // Restarting one cursor leaves the other where it was.
+    second.startScan(&lowVal, GTE, &highVal, LTE);
+    int restartCount = 0;
+    try
+    {
+        while (1)
+        {
+            second.scanNext(scanRid);
+            restartCount++;
+        }
+    }
+    catch(const IndexScanCompletedException& e)
+    {
+    }
+    checkPassFail(restartCount, 16)
+    // The other cursor was ended and can no longer be advanced.
+    try
+    {
+        first.scanNext(scanRid);
+        std::cout << "ScanNotInitialized Test 3 Failed." << std::endl;
+    }
+    catch(const ScanNotInitializedException& e)
+    {
+        std::cout << "ScanNotInitialized Test 3 Passed." << std::endl;
+    }
+}
+
+void batchScanTests()
+{
+    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+
+    // run some tests with batches smaller than, about as large as and larger than a leaf
+    checkPassFail(batchScan(&index,2500,GT,5000,LT,1), 2499)
+    checkPassFail(batchScan(&index,2500,GT,5000,LT,700), 2499)
+    checkPassFail(batchScan(&index,20000,GTE,35000,LTE,100), 15001)
+    checkPassFail(batchScan(&index,-3,GT,3,LT,4096), 3)
+    checkPassFail(batchScan(&index,0,GT,1,LT,16), 0)
+    checkPassFail(batchScan(&index,50000,GT,500001,LT,4096), 49999)
+    checkPassFail(batchScan(&index,-1,GT,100000,LT,100000), 100000)
+}
+
+void deleteTests()
+{
+    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+
+    // Insert the keys 0 to 99999 in random order, with the key as page number of the rid.
+    const int numKeys = 100000;
+    std::vector<int> keys(numKeys);
+    for (int i = 0; i < numKeys; i++)
+    {
+        keys[i] = i;
+    }
+    for (int i = numKeys - 1; i > 0; i--)
+    {
+        std::swap(keys[i], keys[random() % (i + 1)]);
+    }
+    RecordId keyRid;
+    keyRid.slot_number = 1;
+    for (int i = 0; i < numKeys; i++)
+    {
+        keyRid.page_number = keys[i] + 1;
+        index.insertEntry(&keys[i], keyRid);
+    }
+
+    // Delete 10000 to 59999 while a cursor is part way through. The cursor must still
+    // return every key that was never deleted.
+    IndexScanCursor cursor(&index);
+    int lowVal = -1, highVal = numKeys;
+    cursor.startScan(&lowVal, GT, &highVal, LT);
+    int deleted = 0;
+    for (int i = 0; i < numKeys; i++)
+    {
+        if (keys[i] >= 10000 && keys[i] < 60000)
+        {
+            keyRid.page_number = keys[i] + 1;
+            deleted += index.deleteEntry(&keys[i], keyRid);
+        }
+    }
+    int kept = 0;
+    try
+    {
+        RecordId scanRid;
+        while (1)
+        {
+            cursor.scanNext(scanRid);
+            int key = scanRid.page_number - 1;
+            kept += key < 10000 || key >= 60000;
+        }
+    }
+    catch(const IndexScanCompletedException& e)
+    {
+    }
+    cursor.endScan();
+    checkPassFail(deleted, 50000)
+    checkPassFail(kept, 50000)
+    checkPassFail(countScan(&index,-1,GT,numKeys,LT), 50000)
+
+    // Entries that are not in the index are not deleted.
+    int key = 20000;
+    keyRid.page_number = key + 1;
+    checkPassFail(index.deleteEntry(&key, keyRid), false)
+    key = 70000;
+    checkPassFail(index.deleteEntry(&key, keyRid), false)
+
+    // Delete all but the multiples of 1000, merging leaves as they empty.
+    for (int i = 0; i < numKeys; i++)
+    {
+        if ((keys[i] < 10000 || keys[i] >= 60000) && keys[i] % 1000 != 0)
+        {
+            keyRid.page_number = keys[i] + 1;
+            index.deleteEntry(&keys[i], keyRid);
+        }
+    }
+    checkPassFail(countScan(&index,-1,GT,numKeys,LT), 50)
+    checkPassFail(countScan(&index,9000,GTE,60000,LTE), 2)
+
+    // Inserting the middle half again fits in the freed pages.
+    std::ifstream before(intIndexName, std::ifstream::binary | std::ifstream::ate);
+    long sizeBefore = before.tellg();
+    for (int i = 0; i < numKeys; i++)
+    {
+        if (keys[i] >= 10000 && keys[i] < 60000)
+        {
+            keyRid.page_number = keys[i] + 1;
+            index.insertEntry(&keys[i], keyRid);
+        }
+    }
+    std::ifstream after(intIndexName, std::ifstream::binary | std::ifstream::ate);
+    checkPassFail((long) after.tellg(), sizeBefore)
+    checkPassFail(countScan(&index,-1,GT,numKeys,LT), 50050)
+    checkPassFail(countScan(&index,25000,GTE,35000,LT), 10000)
+
+    // Duplicates of one key span several leaves; each is deleted by its rid.
+    const int numDuplicates = 3000;
+    key = -5;
+    for (int j = 0; j < numDuplicates; j++)
+    {
+        keyRid.page_number = numKeys + j;
+        index.insertEntry(&key, keyRid);
+    }
+    deleted = 0;
+    for (int j = 0; j < 2000; j++)
+    {
+        keyRid.page_number = numKeys + (j * 7) % numDuplicates;
+        deleted += index.deleteEntry(&key, keyRid);
+    }
+    checkPassFail(deleted, 2000)
+    checkPassFail(countScan(&index,-6,GT,-4,LT), 1000)
+    for (int j = 0; j < numDuplicates; j++)
+    {
+        keyRid.page_number = numKeys + j;
+        index.deleteEntry(&key, keyRid);
+    }
+    checkPassFail(countScan(&index,-6,GT,-4,LT), 0)
+    checkPassFail(countScan(&index,-1,GT,numKeys,LT), 50050)
+}
+
+void lookupTests()
+{
+    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+    std::vector<RecordId> rids;
+
+    // Keys at both ends and in the middle are found, keys outside are not.
+    int key = 0;
+    checkPassFail(index.contains(&key), true)
+    key = relationSize - 1;
+    checkPassFail(index.contains(&key), true)
+    key = -1;
+    checkPassFail(index.contains(&key), false)
+    key = relationSize;
+    checkPassFail(index.contains(&key), false)
+    checkPassFail(index.lookup(&key, rids), 0)
+    checkPassFail((int) rids.size(), 0)
+
+    // The rid found is the one a scan finds.
+    key = 2500;
+    int lowVal = key, highVal = key;
+    RecordId scanRid;
+    index.startScan(&lowVal, GTE, &highVal, LTE);
+    index.scanNext(scanRid);
+    index.endScan();
+    checkPassFail(index.lookup(&key, rids), 1)
+    checkPassFail((rids[0] == scanRid), true)
+
+    // Duplicates spanning several leaves are all returned, in index order.
+    const int numDuplicates = 2000;
+    RecordId dupRid;
+    dupRid.slot_number = 1;
+    for (int j = 0; j < numDuplicates; j++)
+    {
+        dupRid.page_number = relationSize + j;
+        index.insertEntry(&key, dupRid);
+    }
+    checkPassFail(index.lookup(&key, rids), numDuplicates + 1)
+    checkPassFail((rids[0] == scanRid), true)
+    checkPassFail(rids[numDuplicates].page_number, (PageId) (relationSize + numDuplicates - 1))
+    key = 2501;
+    checkPassFail(index.lookup(&key, rids), 1)
+    key = 2499;
+    checkPassFail(index.contains(&key), true)
+
+    std::cout << "Create a B+ Tree index on the string field" << std::endl;
+    BTreeIndex stringIndex(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING);
+    char stringKey[100];
+    sprintf(stringKey, "%05d string record", 4321);
+    checkPassFail(stringIndex.lookup(stringKey, rids), 1)
+    sprintf(stringKey, "%05d string record", relationSize);
+    checkPassFail(stringIndex.contains(stringKey), false)
+}
+
+void appendTests()
+{
+    // Insert the keys 0 to 99999 in ascending order into a regular index and note its size.
+    const int numKeys = 100000;
+    RecordId keyRid;
+    keyRid.slot_number = 1;
+    long evenSize;
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+        for (int i = 0; i < numKeys; i++)
+        {
+            keyRid.page_number = i + 1;
+            index.insertEntry(&i, keyRid);
+        }
+        std::ifstream indexFile(intIndexName, std::ifstream::binary | std::ifstream::ate);
+        evenSize = indexFile.tellg();
+    }
+    File::remove(intIndexName);
+
+    std::cout << "Create an append optimized B+ Tree index on the integer field" << std::endl;
+    IndexOptions options;
+    options.appendOptimized = true;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+    for (int i = 0; i < numKeys; i++)
+    {
+        keyRid.page_number = i + 1;
+        index.insertEntry(&i, keyRid);
+    }
+    // Leaves split 90/10 instead of in half, so far fewer pages are used.
+    std::ifstream indexFile(intIndexName, std::ifstream::binary | std::ifstream::ate);
+    long appendSize = indexFile.tellg();
+    checkPassFail((appendSize < evenSize * 6 / 10), true)
+    checkPassFail(countScan(&index,-1,GT,numKeys,LT), numKeys)
+    checkPassFail(countScan(&index,25000,GTE,35000,LT), 10000)
+
+    // Keys below the largest key and duplicates of it still land in order.
+    for (int i = 0; i < numKeys; i += 1000)
+    {
+        keyRid.page_number = numKeys + i;
+        index.insertEntry(&i, keyRid);
+    }
+    int key = numKeys - 1;
+    for (int j = 0; j < 1000; j++)
+    {
+        keyRid.page_number = 2 * numKeys + j;
+        index.insertEntry(&key, keyRid);
+    }
+    checkPassFail(countScan(&index,-1,GT,numKeys,LT), numKeys + 1100)
+    std::vector<RecordId> rids;
+    checkPassFail(index.lookup(&key, rids), 1001)
+    checkPassFail(rids[1000].page_number, (PageId) (2 * numKeys + 999))
+
+    // Deleting the tail frees the rightmost leaves; appends then go to the new last leaf.
+    for (int i = numKeys / 2; i < numKeys; i++)
+    {
+        keyRid.page_number = i + 1;
+        index.deleteEntry(&i, keyRid);
+        if (i % 1000 == 0)
+        {
+            keyRid.page_number = numKeys + i;
+            index.deleteEntry(&i, keyRid);
+        }
+    }
+    for (int j = 0; j < 1000; j++)
+    {
+        keyRid.page_number = 2 * numKeys + j;
+        index.deleteEntry(&key, keyRid);
+    }
+    checkPassFail(countScan(&index,-1,GT,numKeys,LT), numKeys / 2 + 50)
+    for (int i = numKeys / 2; i < 2 * numKeys; i++)
+    {
+        keyRid.page_number = i + 1;
+        index.insertEntry(&i, keyRid);
+    }
+    checkPassFail(countScan(&index,-1,GT,2 * numKeys,LT), 2 * numKeys + 50)
+    checkPassFail(countScan(&index,numKeys - 10,GTE,numKeys + 10,LT), 20)
+}
+
+void appendDuplicateTests()
+{
+    // Random keys keep splitting the rightmost leaf with duplicates of its largest key,
+    // which must then go to the new leaf rather than the one it was split from.
+    std::cout << "Insert random keys with duplicates into an append optimized B+ Tree index" << std::endl;
+    const int numKeys = 20000;
+    const int distinct = 50;
+    int counts[distinct] = { 0 };
+    RecordId keyRid;
+    keyRid.slot_number = 1;
+    IndexOptions options;
+    options.appendOptimized = true;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+    for (int i = 0; i < numKeys; i++)
+    {
+        int key = random() % distinct * 10;
+        counts[key / 10]++;
+        keyRid.page_number = i + 1;
+        index.insertEntry(&key, keyRid);
+    }
+    int inRange = 0;
+    for (int v = 10; v < 30; v++)
+    {
+        inRange += counts[v];
+    }
+    checkPassFail(countScan(&index,-1,GT,distinct * 10,LT), numKeys)
+    checkPassFail(countScan(&index,100,GTE,300,LT), inRange)
+    checkPassFail(batchScan(&index,100,GTE,300,LT,64), inRange)
+    checkPassFail(descendingScan(&index,100,GTE,300,LT,1), inRange)
+    checkPassFail(descendingScan(&index,95,GT,295,LTE,64), inRange)
+    int wrong = 0;
+    std::vector<RecordId> rids;
+    for (int v = 0; v < distinct; v++)
+    {
+        int key = v * 10;
+        wrong += index.lookup(&key, rids) != counts[v];
+        wrong += countScan(&index,key,GTE,key,LTE) != counts[v];
+    }
+    checkPassFail(wrong, 0)
+}
+
+void packedLeafTests()
+{
+    // The packed index bulk loaded by largeIntTests keeps its layout when reopened
+    // without packLeaves.
+    std::cout << "Open the packed B+ Tree index on the integer field" << std::endl;
+    std::vector<RecordId> rids;
+    long packedSize;
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+        checkPassFail(intScan(&index,20000,GTE,35000,LTE), 15001)
+        int key = 4321;
+        checkPassFail(index.lookup(&key, rids), 1)
+        std::ifstream indexFile(intIndexName, std::ifstream::binary | std::ifstream::ate);
+        packedSize = indexFile.tellg();
+    }
+    File::remove(intIndexName);
+    long plainSize;
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+        std::ifstream indexFile(intIndexName, std::ifstream::binary | std::ifstream::ate);
+        plainSize = indexFile.tellg();
+    }
+    File::remove(intIndexName);
+    // Dense keys with rids on nearby pages take 5 bytes an entry instead of 12.
+    checkPassFail((packedSize < plainSize / 2), true)
+
+    std::cout << "Create a packed B+ Tree index on the integer field by inserting" << std::endl;
+    IndexOptions options;
+    options.bulkLoad = false;
+    options.packLeaves = true;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+    checkPassFail(countScan(&index,-1,GT,100000,LT), 100000)
+
+    // Keys far apart with rids on far pages need wider columns, so leaves repack as
+    // they arrive. The extreme keys stretch the key column as far as it goes.
+    const int numWide = 20000;
+    RecordId wideRid;
+    for (int j = 0; j < numWide; j++)
+    {
+        int key = 100000 + j * 997;
+        wideRid.page_number = 70000 + j * 13;
+        wideRid.slot_number = j % 1000;
+        index.insertEntry(&key, wideRid);
+    }
+    int key = -2000000000;
+    index.insertEntry(&key, wideRid);
+    key = 2000000000;
+    index.insertEntry(&key, wideRid);
+    checkPassFail(countScan(&index,-2000000000,GTE,2000000000,LTE), 100000 + numWide + 2)
+    key = 100000 + 5 * 997;
+    checkPassFail(index.lookup(&key, rids), 1)
+    checkPassFail(rids[0].page_number, (PageId) 70065)
+    checkPassFail(rids[0].slot_number, (SlotId) 5)
+    key = 100000 + 4 * 997 + 1;
+    checkPassFail(index.contains(&key), false)
+
+    // Duplicates of one key span several leaves; each is deleted by its rid.
+    const int numDuplicates = 3000;
+    RecordId dupRid;
+    dupRid.slot_number = 1;
+    key = -5;
+    for (int j = 0; j < numDuplicates; j++)
+    {
+        dupRid.page_number = 200000 + j;
+        index.insertEntry(&key, dupRid);
+    }
+    int deleted = 0;
+    for (int j = 0; j < 2000; j++)
+    {
+        dupRid.page_number = 200000 + (j * 7) % numDuplicates;
+        deleted += index.deleteEntry(&key, dupRid);
+    }
+    checkPassFail(deleted, 2000)
+    checkPassFail(index.lookup(&key, rids), 1000)
+
+    // Deleting most of the wide entries merges and evens out the leaves they were in.
+    deleted = 0;
+    for (int j = 0; j < numWide; j++)
+    {
+        if (j % 4 != 0)
+        {
+            key = 100000 + j * 997;
+            wideRid.page_number = 70000 + j * 13;
+            wideRid.slot_number = j % 1000;
+            deleted += index.deleteEntry(&key, wideRid);
+        }
+    }
+    checkPassFail(deleted, numWide / 4 * 3)
+    checkPassFail(countScan(&index,100000,GTE,100000 + numWide * 997,LT), numWide / 4)
+    checkPassFail(countScan(&index,-2000000000,GTE,2000000000,LTE), 100000 + numWide / 4 + 1000 + 2)
+}
+
+void postingListTests()
+{
+    // The relation holds 100000 records with the values 0 to 9, 10000 of each.
+    std::cout << "Create a B+ Tree index with posting lists on the integer field" << std::endl;
+    IndexOptions options;
+    options.postingLists = true;
+    std::vector<RecordId> rids;
+    long postingSize;
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+        checkPassFail(countScan(&index,3,GTE,3,LTE), 10000)
+        checkPassFail(countScan(&index,2,GT,7,LT), 40000)
+        checkPassFail(batchScan(&index,-1,GT,10,LT,1000), 100000)
+        int key = 6;
+        checkPassFail(index.lookup(&key, rids), 10000)
+        // The rids of a key come back in rid order.
+        bool sorted = true;
+        for (size_t r = 1; r < rids.size(); r++)
+        {
+            sorted = sorted && (rids[r-1].page_number < rids[r].page_number
+                                || (rids[r-1].page_number == rids[r].page_number
+                                    && rids[r-1].slot_number < rids[r].slot_number));
+        }
+        checkPassFail(sorted, true)
+        key = 10;
+        checkPassFail(index.contains(&key), false)
+        std::ifstream indexFile(intIndexName, std::ifstream::binary | std::ifstream::ate);
+        postingSize = indexFile.tellg();
+    }
+    File::remove(intIndexName);
+    long plainSize;
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+        std::ifstream indexFile(intIndexName, std::ifstream::binary | std::ifstream::ate);
+        plainSize = indexFile.tellg();
+    }
+    File::remove(intIndexName);
+    // Rids on nearby pages take 3 bytes an entry instead of 12 with the key.
+    checkPassFail((postingSize < plainSize / 3), true)
+
+    std::cout << "Create B+ Tree indexes with posting lists on the double and string fields" << std::endl;
+    {
+        BTreeIndex index(relationName, doubleIndexName, bufMgr, offsetof(tuple,d), DOUBLE, options);
+        checkPassFail(doubleScan(&index,2.5,GT,4.5,LT), 20000)
+    }
+    File::remove(doubleIndexName);
+    {
+        BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING, options);
+        checkPassFail(stringScan(&index,8,GTE,9,LTE), 20000)
+    }
+    File::remove(stringIndexName);
+
+    std::cout << "Create a B+ Tree index with posting lists on the integer field by inserting" << std::endl;
+    options.bulkLoad = false;
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+        checkPassFail(countScan(&index,-1,GT,10,LT), 100000)
+        // Rids on far pages and with large slot numbers make the leaves they go to
+        // re-encode wider.
+        RecordId wideRid;
+        int key = 4;
+        for (int j = 0; j < 5000; j++)
+        {
+            wideRid.page_number = 100000 + j * 977;
+            wideRid.slot_number = 300 + j;
+            index.insertEntry(&key, wideRid);
+        }
+        checkPassFail(index.lookup(&key, rids), 15000)
+        checkPassFail(countScan(&index,3,GT,5,LT), 15000)
+
+        // Every entry of one key is deleted, and every other one of another.
+        key = 2;
+        index.lookup(&key, rids);
+        int deleted = 0;
+        for (size_t r = 0; r < rids.size(); r++)
+        {
+            deleted += index.deleteEntry(&key, rids[r]);
+        }
+        checkPassFail(deleted, 10000)
+        checkPassFail(index.contains(&key), false)
+        key = 4;
+        index.lookup(&key, rids);
+        deleted = 0;
+        for (size_t r = 0; r < rids.size(); r += 2)
+        {
+            deleted += index.deleteEntry(&key, rids[r]);
+        }
+        checkPassFail(deleted, 7500)
+        checkPassFail(index.deleteEntry(&key, rids[0]), false)
+        checkPassFail(index.lookup(&key, rids), 7500)
+    }
+
+    // The index keeps its layout when reopened without postingLists.
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+    checkPassFail(countScan(&index,-1,GT,10,LT), 100000 + 5000 - 10000 - 7500)
+    checkPassFail(intScan(&index,0,GTE,1,LT), 10000)
+}
+
+void compositeKeyTests()
+{
+    std::cout << "Create a B+ Tree index on the (i, j) integer fields" << std::endl;
+    std::vector<KeyAttribute> pairKey = { { offsetof(pairTuple,i), INTEGER }, { offsetof(pairTuple,j), INTEGER } };
+    PAIRRECORD low, high;
+    memset(&low, 0, sizeof(low));
+    memset(&high, 0, sizeof(high));
+    {
+        BTreeIndex index(relationName, pairIndexName, bufMgr, pairKey);
+
+        // Prefix scans on i alone.
+        low.i = 10;
+        high.i = 19;
+        checkPassFail(prefixScan(&index, low, GTE, high, LTE, 1), 500)
+        high.i = 20;
+        checkPassFail(prefixScan(&index, low, GT, high, LT, 1), 450)
+        checkPassFail(prefixScan(&index, low, GTE, low, LTE, 1), 50)
+
+        // Full key scans and lookups.
+        low.j = 5;
+        high.i = 10;
+        high.j = 14;
+        checkPassFail(prefixScan(&index, low, GTE, high, LTE, 2), 10)
+        high.i = 11;
+        checkPassFail(prefixScan(&index, low, GT, high, LT, 2), 44 + 14)
+        low.i = 7;
+        low.j = 3;
+        std::vector<RecordId> rids;
+        checkPassFail(index.lookup(&low, rids), 1)
+        low.j = 50;
+        checkPassFail(index.contains(&low), false)
+
+        // Entries come back in (i, j) order, which is the order the records were added in.
+        low.i = 0;
+        high.i = 99;
+        index.startPrefixScan(&low, GTE, &high, LTE, 1);
+        std::vector<RecordId> all(5000);
+        checkPassFail(index.scanNextBatch(&all[0], 5000), 5000)
+        index.endScan();
+        int outOfOrder = 0;
+        for (int r = 1; r < 5000; r++)
+        {
+            outOfOrder += all[r].page_number < all[r-1].page_number
+                          || (all[r].page_number == all[r-1].page_number && all[r].slot_number <= all[r-1].slot_number);
+        }
+        checkPassFail(outOfOrder, 0)
+
+        bool thrown = false;
+        try
+        {
+            index.startPrefixScan(&low, GTE, &high, LTE, 3);
+        }
+        catch(const BadScanrangeException& e)
+        {
+            thrown = true;
+        }
+        checkPassFail(thrown, true)
+    }
+
+    std::cout << "Create a B+ Tree index on the (i, d) fields by inserts" << std::endl;
+    std::vector<KeyAttribute> intDoubleKey = { { offsetof(pairTuple,i), INTEGER }, { offsetof(pairTuple,d), DOUBLE } };
+    IndexOptions options;
+    options.bulkLoad = false;
+    {
+        BTreeIndex index(relationName, intDoubleIndexName, bufMgr, intDoubleKey, options);
+        low.i = 10;
+        high.i = 19;
+        checkPassFail(prefixScan(&index, low, GTE, high, LTE, 1), 500)
+        low.d = 0;
+        high.i = 12;
+        high.d = 0;
+        int expected = 0;
+        for (int k = 0; k < 5000; k++)
+        {
+            int i = k / 50;
+            double d = (k * 37) % 100 - 49.5;
+            expected += (i == 10 && d > 0) || i == 11 || (i == 12 && d < 0);
+        }
+        checkPassFail(prefixScan(&index, low, GT, high, LT, 2), expected)
+    }
+
+    std::cout << "Create a B+ Tree index on the (j, s, d) fields with posting lists" << std::endl;
+    std::vector<KeyAttribute> compositeKey = { { offsetof(pairTuple,j), INTEGER }, { offsetof(pairTuple,s), STRING },
+                                               { offsetof(pairTuple,d), DOUBLE } };
+    options.bulkLoad = true;
+    options.postingLists = true;
+    {
+        BTreeIndex index(relationName, compositeIndexName, bufMgr, compositeKey, options);
+        low.j = 3;
+        high.j = 4;
+        checkPassFail(prefixScan(&index, low, GTE, high, LTE, 1), 200)
+        sprintf(low.s, "%05d string record", 2);
+        high.j = 3;
+        sprintf(high.s, "%05d string record", 2);
+        low.d = -10;
+        high.d = 10;
+        int prefixExpected = 0;
+        int rangeExpected = 0;
+        for (int k = 0; k < 5000; k++)
+        {
+            double d = (k * 37) % 100 - 49.5;
+            bool prefix = k % 50 == 3 && k % 7 == 2;
+            prefixExpected += prefix;
+            rangeExpected += prefix && d >= -10 && d <= 10;
+        }
+        checkPassFail(prefixScan(&index, low, GTE, high, LTE, 2), prefixExpected)
+        checkPassFail(prefixScan(&index, low, GTE, high, LTE, 3), rangeExpected)
+        // Negative values sort before positive ones.
+        low.j = 0;
+        high.j = 0;
+        sprintf(low.s, "%05d string record", 0);
+        sprintf(high.s, "%05d string record", 0);
+        low.d = -100;
+        high.d = 0;
+        int negativeExpected = 0;
+        for (int k = 0; k < 5000; k += 50)
+        {
+            negativeExpected += k % 7 == 0 && (k * 37) % 100 - 49.5 < 0;
+        }
+        checkPassFail(prefixScan(&index, low, GTE, high, LT, 3), negativeExpected)
+        low.d = 0;
+        high.d = 100;
+        checkPassFail(prefixScan(&index, low, GT, high, LTE, 3), prefixScan(&index, low, GTE, high, LTE, 2) - negativeExpected)
+    }
+
+    // A file built over other attributes, and a key of one attribute, are refused.
+    std::vector<KeyAttribute> otherKey = { { offsetof(pairTuple,i), INTEGER }, { offsetof(pairTuple,j), DOUBLE } };
+    std::string name;
+    int refused = 0;
+    try
+    {
+        BTreeIndex index(relationName, name, bufMgr, otherKey);
+    }
+    catch(const BadIndexInfoException& e)
+    {
+        refused++;
+    }
+    otherKey.pop_back();
+    try
+    {
+        BTreeIndex index(relationName, name, bufMgr, otherKey);
+    }
+    catch(const BadIndexInfoException& e)
+    {
+        refused++;
+    }
+    checkPassFail(refused, 2)
+}
+
+void coveringIndexTests()
+{
+    std::cout << "Create a B+ Tree index on the integer field including d and s" << std::endl;
+    IndexOptions options;
+    options.bulkLoad = true;
+    options.includeAttributes = { { offsetof(tuple,d), sizeof(double) }, { offsetof(tuple,s), 16 } };
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+        checkPassFail(index.payloadSize(), 24)
+        checkPassFail(coveredScan(&index, 100, 10000, 0), 9900)
+        checkPassFail(coveredScan(&index, 0, 20000, 1000), 20000)
+        checkPassFail(countScan(&index, 4999, GT, 15000, LTE), 10001)
+
+        // Payloads stay with their entries as leaves are merged and refilled.
+        std::vector<RecordId> rids;
+        for (int key = 0; key < 5000; key++)
+        {
+            index.lookup(&key, rids);
+            index.deleteEntry(&key, rids[0]);
+        }
+        checkPassFail(coveredScan(&index, 5000, 20000, 333), 15000)
+    }
+
+    std::cout << "Reopen the covering index without the included attributes" << std::endl;
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+        checkPassFail(index.payloadSize(), 24)
+        checkPassFail(coveredScan(&index, 5000, 20000, 0), 15000)
+
+        // A record passed to insertEntry supplies the payload of the new entry.
+        RECORD record;
+        memset(&record, 0, sizeof(record));
+        record.i = 20000;
+        record.d = 20000;
+        sprintf(record.s, "%05d string record", 20000);
+        RecordId newRid;
+        newRid.page_number = 1;
+        newRid.slot_number = 0;
+        index.insertEntry(&record.i, newRid, &record);
+        checkPassFail(coveredScan(&index, 19000, 20001, 64), 1001)
+    }
+    File::remove(intIndexName);
+
+    std::cout << "Create the covering index by inserts" << std::endl;
+    options.bulkLoad = false;
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+        checkPassFail(coveredScan(&index, 0, 20000, 0), 20000)
+        checkPassFail(coveredScan(&index, 12345, 12346, 7), 1)
+    }
+    File::remove(intIndexName);
+
+    // Packed leaves are not used for covering indexes.
+    options.packLeaves = true;
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+        checkPassFail(coveredScan(&index, 0, 20000, 4096), 20000)
+    }
+    File::remove(intIndexName);
+
+    // Payloads over MAXPAYLOAD bytes are refused.
+    options.includeAttributes = { { offsetof(tuple,d), sizeof(double) }, { offsetof(tuple,s), 64 } };
+    std::string name;
+    bool refused = false;
+    try
+    {
+        BTreeIndex index(relationName, name, bufMgr, offsetof(tuple,i), INTEGER, options);
+    }
+    catch(const BadIndexInfoException& e)
+    {
+        refused = true;
+    }
+    checkPassFail(refused, true)
+}
+
+void descendingScanTests()
+{
+    // The relation holds the values 0 to 3999, 10 records of each.
+    const char* layouts[] = { "plain", "packed", "posting", "covering", "insert-built" };
+    for (int l = 0; l < 5; l++)
+    {
+        std::cout << "Create a B+ Tree index with " << layouts[l] << " leaves for descending scans" << std::endl;
+        IndexOptions options;
+        options.packLeaves = l == 1;
+        options.postingLists = l == 2;
+        if (l == 3)
+        {
+            options.includeAttributes = { { offsetof(tuple,d), sizeof(double) } };
+        }
+        options.bulkLoad = l != 4;
+        options.readAheadLeaves = l == 0 ? 4 : 0;
+        {
+            BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+            checkPassFail(descendingScan(&index, -1, GT, 4000, LT, 0), 40000)
+            checkPassFail(descendingScan(&index, 100, GTE, 2000, LT, 256), 19000)
+            checkPassFail(descendingScan(&index, 3990, GT, 3999, LTE, 7), 90)
+            checkPassFail(descendingScan(&index, 500, GTE, 500, LTE, 3), 10)
+            checkPassFail(descendingScan(&index, 4000, GTE, 5000, LTE, 0), 0)
+            if (l == 3)
+            {
+                // Payloads come back in the same order as their rids.
+                int low = 0, high = 3999;
+                RecordId rids[64];
+                double payloads[64];
+                index.startScan(&low, GTE, &high, LTE, DESCENDING);
+                checkPassFail(index.scanNextBatch(rids, payloads, 64), 64)
+                index.endScan();
+                checkPassFail((payloads[0] == 3999 && payloads[9] == 3999 && payloads[10] == 3998 && payloads[63] == 3993), true)
+            }
+            if (l == 4)
+            {
+                // Merges relink the leaves after the ones they free.
+                std::vector<RecordId> rids;
+                for (int key = 0; key < 2000; key++)
+                {
+                    index.lookup(&key, rids);
+                    for (size_t r = 0; r < rids.size(); r++)
+                    {
+                        index.deleteEntry(&key, rids[r]);
+                    }
+                }
+                checkPassFail(descendingScan(&index, -1, GT, 4000, LT, 100), 20000)
+                checkPassFail(descendingScan(&index, 1990, GT, 2010, LT, 0), 100)
+            }
+        }
+        File::remove(intIndexName);
+    }
+
+    std::cout << "Split leaves under a descending scan" << std::endl;
+    IndexOptions options;
+    options.fillFactor = 1.0;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+    int low = 0, high = 4000;
+    index.startScan(&low, GTE, &high, LT, DESCENDING);
+    std::vector<RecordId> seen;
+    RecordId scanRid;
+    for (int r = 0; r < 20000; r++)
+    {
+        index.scanNext(scanRid);
+        seen.push_back(scanRid);
+    }
+    // Every leaf left of the scan fills up and splits, some more than once.
+    for (int r = 0; r < 20000; r++)
+    {
+        int key = r % 2000;
+        RecordId newRid;
+        newRid.page_number = 1000000 + r;
+        newRid.slot_number = 0;
+        index.insertEntry(&key, newRid);
+    }
+    try
+    {
+        while (1)
+        {
+            index.scanNext(scanRid);
+            seen.push_back(scanRid);
+        }
+    }
+    catch(const IndexScanCompletedException& e)
+    {
+    }
+    index.endScan();
+    // Each entry of the relation comes back once; entries added behind the scan may too.
+    int original = 0;
+    std::set<std::pair<PageId, SlotId> > distinct;
+    for (size_t r = 0; r < seen.size(); r++)
+    {
+        original += seen[r].page_number < 1000000;
+        distinct.insert(std::make_pair(seen[r].page_number, seen[r].slot_number));
+    }
+    checkPassFail(original, 40000)
+    checkPassFail((distinct.size() == seen.size()), true)
+}
+
+void parallelScanTests()
+{
+    // The relation holds the values 0 to 3999, 10 records of each.
+    const char* layouts[] = { "plain", "packed", "posting", "covering" };
+    for (int l = 0; l < 4; l++)
+    {
+        std::cout << "Create a B+ Tree index with " << layouts[l] << " leaves for parallel scans" << std::endl;
+        IndexOptions options;
+        options.packLeaves = l == 1;
+        options.postingLists = l == 2;
+        if (l == 3)
+        {
+            options.includeAttributes = { { offsetof(tuple,d), sizeof(double) } };
+        }
+        options.readAheadLeaves = l == 0 ? 4 : 0;
+        {
+            BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+            checkPassFail(parallelScan(&index, -1, GT, 4000, LT, 4), 40000)
+            checkPassFail(parallelScan(&index, 100, GTE, 2000, LT, 8), 19000)
+            checkPassFail(parallelScan(&index, 3990, GT, 3999, LTE, 3), 90)
+            checkPassFail(parallelScan(&index, 500, GTE, 500, LTE, 16), 10)
+            checkPassFail(parallelScan(&index, 0, GTE, 3999, LTE, 1), 40000)
+            checkPassFail(parallelScan(&index, 4000, GTE, 5000, LTE, 4), 0)
+            if (l == 3)
+            {
+                // Each part streams its payloads in key order, below those of the next part.
+                std::vector<std::vector<double> > parts(6);
+                int low = 0, high = 3999;
+                long count = index.parallelScan(&low, GTE, &high, LTE, 6,
+                    [&parts](const int part, const RecordId* rids, const void* payloads, const int n) {
+                        const double* d = (const double*) payloads;
+                        parts[part].insert(parts[part].end(), d, d + n);
+                    });
+                std::vector<double> merged;
+                for (size_t p = 0; p < parts.size(); p++)
+                {
+                    merged.insert(merged.end(), parts[p].begin(), parts[p].end());
+                }
+                checkPassFail((count == 40000 && merged.size() == 40000), true)
+                checkPassFail((std::is_sorted(merged.begin(), merged.end()) && parts[5].size() > 0), true)
+            }
+        }
+        File::remove(intIndexName);
+    }
+
+    std::cout << "Parallel scan under concurrent inserts" << std::endl;
+    IndexOptions options;
+    options.concurrent = true;
+    options.fillFactor = 1.0;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+    // Keys from 4000 up split the leaves at the end of the range while it is scanned.
+    std::thread inserter([&index]() {
+        for (int r = 0; r < 20000; r++)
+        {
+            int key = 4000 + r % 500;
+            RecordId newRid;
+            newRid.page_number = 1000000 + r;
+            newRid.slot_number = 0;
+            index.insertEntry(&key, newRid);
+        }
+    });
+    int passed = 0;
+    for (int s = 0; s < 10; s++)
+    {
+        passed += parallelScan(&index, 0, GTE, 4000, LT, 4) == 40000;
+    }
+    inserter.join();
+    checkPassFail(passed, 10)
+    checkPassFail(parallelScan(&index, 3999, GTE, 5000, LT, 4), 20010)
+
+    int low = 10, high = 5;
+    try
+    {
+        index.parallelScan(&low, GTE, &high, LTE, 4, [](const int part, const RecordId* rids, const void* payloads, const int n) {});
+        std::cout << "parallelScan with low above high should throw" << std::endl;
+        exit(1);
+    }
+    catch(const BadScanrangeException& e)
+    {
+    }
+    try
+    {
+        index.parallelScan(&high, LTE, &low, GTE, 4, [](const int part, const RecordId* rids, const void* payloads, const int n) {});
+        std::cout << "parallelScan with bad operators should throw" << std::endl;
+        exit(1);
+    }
+    catch(const BadOpcodesException& e)
+    {
+    }
+}
+
+void innerNodeCacheTests()
+{
+    std::cout << "Create a B+ Tree index with cached non-leaf nodes" << std::endl;
+    IndexOptions options;
+    options.cacheInnerNodes = true;
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+        // Ascending keys leave the split leaves half full; enough of them split the root
+        // of non-leaves, and the new root, in the cache.
+        RecordId keyRid;
+        keyRid.slot_number = 1;
+        for (int key = 100000; key < 500000; key++)
+        {
+            keyRid.page_number = key + 1;
+            index.insertEntry(&key, keyRid);
+        }
+        checkPassFail(countScan(&index,-1,GT,500000,LT), 500000)
+        checkPassFail(countScan(&index,99990,GTE,100010,LT), 20)
+        std::vector<RecordId> rids;
+        int key = 377777;
+        checkPassFail((index.lookup(&key, rids) == 1 && rids[0].page_number == 377778), true)
+
+        // Deleting most of the keys merges leaves and non-leaves, freeing cached pages.
+        for (key = 100000; key < 450000; key++)
+        {
+            keyRid.page_number = key + 1;
+            index.deleteEntry(&key, keyRid);
+        }
+        checkPassFail(countScan(&index,-1,GT,500000,LT), 150000)
+        for (key = 200000; key < 300000; key++)
+        {
+            keyRid.page_number = key + 1;
+            index.insertEntry(&key, keyRid);
+        }
+        checkPassFail(countScan(&index,150000,GTE,460000,LT), 110000)
+    }
+
+    // Changes made to cached nodes are written out when the index is closed.
+    {
+        std::cout << "Reopen the B+ Tree index without the cache" << std::endl;
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+        checkPassFail(countScan(&index,-1,GT,500000,LT), 250000)
+        checkPassFail(countScan(&index,299990,GTE,450010,LT), 20)
+    }
+    File::remove(intIndexName);
+
+    // Buffered inserts make many small non-leaves. The cache takes only part of a small
+    // buffer pool, so the descents still find frames for the nodes it does not hold.
+    std::cout << "Create a B+ Tree index with cached non-leaf nodes and insert buffers in a small buffer pool" << std::endl;
+    BufMgr smallBufMgr(20);
+    options.bufferInserts = true;
+    BTreeIndex index(relationName, intIndexName, &smallBufMgr, offsetof(tuple,i), INTEGER, options);
+    RecordId keyRid;
+    keyRid.slot_number = 1;
+    for (int i = 0; i < 200000; i++)
+    {
+        int key = 100000 + random() % 1000000;
+        keyRid.page_number = key + 1;
+        index.insertEntry(&key, keyRid);
+    }
+    checkPassFail(countScan(&index,-1,GT,100000,LT), 100000)
+    checkPassFail(countScan(&index,-1,GT,1100000,LT), 300000)
+}
+
+void nodeDirectoryTests()
+{
+    std::cout << "Create a B+ Tree index with search directories in its non-leaf nodes" << std::endl;
+    IndexOptions options;
+    options.nodeDirectories = true;
+    options.bulkLoad = false;
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+        // Ascending keys split enough leaves to split the root non-leaf as well.
+        RecordId keyRid;
+        keyRid.slot_number = 1;
+        for (int key = 100000; key < 500000; key++)
+        {
+            keyRid.page_number = key + 1;
+            index.insertEntry(&key, keyRid);
+        }
+        // A run of duplicates whose equal separators fill several directory blocks.
+        int dup = 300000;
+        for (int i = 0; i < 50000; i++)
+        {
+            keyRid.page_number = 1000000 + i;
+            index.insertEntry(&dup, keyRid);
+        }
+        checkPassFail(countScan(&index,-1,GT,500000,LT), 550000)
+        checkPassFail(countScan(&index,300000,GTE,300000,LTE), 50001)
+        checkPassFail(countScan(&index,299999,GT,300001,LT), 50001)
+        checkPassFail(countScan(&index,299990,GTE,300010,LT), 50020)
+        std::vector<RecordId> rids;
+        checkPassFail(index.lookup(&dup, rids), 50001)
+        int key = 377777;
+        checkPassFail((index.lookup(&key, rids) == 1 && rids[0].page_number == 377778), true)
+
+        // Deleting most of the keys merges non-leaves and rotates keys between them.
+        for (key = 100000; key < 450000; key++)
+        {
+            keyRid.page_number = key + 1;
+            index.deleteEntry(&key, keyRid);
+        }
+        checkPassFail(countScan(&index,-1,GT,500000,LT), 200000)
+        checkPassFail(countScan(&index,300000,GTE,300000,LTE), 50000)
+    }
+
+    // The directories are part of the file, so reopening keeps them without the option.
+    std::cout << "Reopen the B+ Tree index without the option" << std::endl;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+    checkPassFail(countScan(&index,-1,GT,500000,LT), 200000)
+    checkPassFail(countScan(&index,449990,GTE,450010,LT), 10)
+    std::vector<RecordId> rids;
+    int dup = 300000;
+    checkPassFail(index.lookup(&dup, rids), 50000)
+}
+
+void bufferedInsertTests()
+{
+    std::cout << "Create a B+ Tree index with buffered inserts" << std::endl;
+    IndexOptions options;
+    options.bufferInserts = true;
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+        // Keys in scattered order, into far more leaves than the buffer pool holds.
+        RecordId keyRid;
+        keyRid.slot_number = 1;
+        for (int i = 0; i < 300000; i++)
+        {
+            int key = 100000 + (int) ((long) i * 7919 % 300000);
+            keyRid.page_number = key + 1;
+            index.insertEntry(&key, keyRid);
+        }
+        int dup = 250000;
+        for (int i = 0; i < 20000; i++)
+        {
+            keyRid.page_number = 1000000 + i;
+            index.insertEntry(&dup, keyRid);
+        }
+        std::vector<RecordId> rids;
+        int key = 377777;
+        checkPassFail((index.lookup(&key, rids) == 1 && rids[0].page_number == 377778), true)
+        // Duplicates reach their leaves in the order they were inserted.
+        checkPassFail(index.lookup(&dup, rids), 20001)
+        bool inOrder = true;
+        for (size_t r = 1; r < rids.size(); r++)
+        {
+            inOrder = inOrder && rids[r].page_number > rids[r-1].page_number;
+        }
+        checkPassFail(inOrder, true)
+        checkPassFail(countScan(&index,-1,GT,400000,LT), 420000)
+        checkPassFail(countScan(&index,249990,GTE,250010,LT), 20020)
+        checkPassFail(descendingScan(&index,150000,GTE,160000,LT,100), 10000)
+        checkPassFail(parallelScan(&index,-1,GT,400000,LT,4), 420000)
+
+        // Deletes pass the messages for their key down first; inserts go on being buffered.
+        for (key = 100000; key < 300000; key += 2)
+        {
+            keyRid.page_number = key + 1;
+            index.deleteEntry(&key, keyRid);
+        }
+        for (key = 400000; key < 450000; key++)
+        {
+            keyRid.page_number = key + 1;
+            index.insertEntry(&key, keyRid);
+        }
+        checkPassFail(countScan(&index,100000,GTE,300000,LT), 120000)
+    }
+
+    // A buffered file cannot be shared by threads.
+    IndexOptions concurrent;
+    concurrent.concurrent = true;
+    try
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, concurrent);
+        std::cout << "Opening a buffered index concurrently should throw" << std::endl;
+        exit(1);
+    }
+    catch(const BadIndexInfoException& e)
+    {
+    }
+
+    // Messages still buffered when the index was closed are kept in its file.
+    std::cout << "Reopen the B+ Tree index without the option" << std::endl;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+    checkPassFail(countScan(&index,420000,GTE,450000,LT), 30000)
+    checkPassFail(countScan(&index,-1,GT,450000,LT), 370000)
+    std::vector<RecordId> rids;
+    int dup = 250000;
+    checkPassFail(index.lookup(&dup, rids), 20000)
+}
+
+void bloomFilterTests()
+{
+    std::cout << "Create a B+ Tree index with a Bloom filter" << std::endl;
+    IndexOptions options;
+    options.bulkLoad = true;
+    options.bloomFilter = true;
+    std::vector<RecordId> rids;
+    {
+        // The bulk load sizes the filter for the 100000 keys of the relation.
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+        int found = 0;
+        for (int key = -100000; key < 200000; key++)
+        {
+            found += index.lookup(&key, rids);
+        }
+        checkPassFail(found, 100000)
+
+        // Twice as many inserts again make the filter grow, twice.
+        RecordId keyRid;
+        keyRid.slot_number = 1;
+        for (int key = 200000; key < 400000; key++)
+        {
+            keyRid.page_number = key + 1;
+            index.insertEntry(&key, keyRid);
+        }
+        found = 0;
+        for (int key = 100000; key < 500000; key++)
+        {
+            found += index.contains(&key) ? 1 : 0;
+        }
+        checkPassFail(found, 200000)
+
+        // Deleted keys stay in the filter, but their lookups still find nothing.
+        int deleted = 0;
+        for (int key = 200000; key < 400000; key += 2)
+        {
+            keyRid.page_number = key + 1;
+            deleted += index.deleteEntry(&key, keyRid) ? 1 : 0;
+            deleted += index.deleteEntry(&key, keyRid) ? 1 : 0;
+        }
+        checkPassFail(deleted, 100000)
+        int key = 250000;
+        checkPassFail(index.lookup(&key, rids), 0)
+        key = 250001;
+        checkPassFail((index.lookup(&key, rids) == 1 && rids[0].page_number == 250002), true)
+    }
+
+    // The filter is read back from the index file.
+    std::cout << "Reopen the B+ Tree index without the option" << std::endl;
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+        int found = 0;
+        for (int key = -100000; key < 500000; key++)
+        {
+            found += index.contains(&key) ? 1 : 0;
+        }
+        checkPassFail(found, 200000)
+        checkPassFail(countScan(&index,-1,GT,500000,LT), 200000)
+    }
+    File::remove(intIndexName);
+
+    // A buffered index grows its filter with the keys still waiting in its buffers too.
+    std::cout << "Create a buffered B+ Tree index with a Bloom filter" << std::endl;
+    options.bufferInserts = true;
+    options.bulkLoad = false;
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+        RecordId keyRid;
+        keyRid.slot_number = 1;
+        for (int i = 0; i < 300000; i++)
+        {
+            int key = 100000 + (int) ((long) i * 7919 % 300000);
+            keyRid.page_number = key + 1;
+            index.insertEntry(&key, keyRid);
+        }
+        int found = 0;
+        for (int key = 0; key < 500000; key += 7)
+        {
+            found += index.lookup(&key, rids);
+        }
+        checkPassFail(found, 57143)
+    }
+
+    std::cout << "Create a B+ Tree index on the string field with a Bloom filter" << std::endl;
+    options.bufferInserts = false;
+    options.bulkLoad = true;
+    {
+        BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING, options);
+        int found = 0;
+        char key[32];
+        for (int i = 0; i < 200000; i++)
+        {
+            snprintf(key, sizeof(key), "%05d stri", i);
+            found += index.contains(key) ? 1 : 0;
+        }
+        checkPassFail(found, 100000)
+    }
+}
+
+/**
+ * Whether an estimate lies within the given fraction of the true count.
+ */
+bool closeTo(long estimate, long count, double tolerance)
+{
+    return estimate >= count * (1 - tolerance) && estimate <= count * (1 + tolerance);
+}
+
+void statisticsTests()
+{
+    std::cout << "Create a B+ Tree index and read its statistics" << std::endl;
+    long leaves;
+    long estimate;
+    IndexOptions options;
+    options.bulkLoad = true;
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+        IndexStats stats = index.statistics();
+        checkPassFail(stats.entries, 100000)
+        checkPassFail((stats.distinctKeys == 100000), true)
+        checkPassFail((stats.minKey == 0 && stats.maxKey == 99999), true)
+        checkPassFail((stats.height == 2 && stats.leaves > 1), true)
+        checkPassFail((stats.fillFactor > 0.85 && stats.fillFactor < 0.95), true)
+        long inHistogram = 0;
+        for (size_t b = 0; b < stats.histogram.size(); b++)
+        {
+            inHistogram += stats.histogram[b].entries;
+        }
+        checkPassFail((stats.histogram.size() == HISTOGRAMBUCKETS && inHistogram == 100000), true)
+
+        int low = 2500;
+        int high = 5000;
+        checkPassFail(closeTo(index.estimateRange(&low, GT, &high, LT), 2499, 0.02), true)
+        low = 20000;
+        high = 35000;
+        checkPassFail(closeTo(index.estimateRange(&low, GTE, &high, LTE), 15001, 0.02), true)
+        low = 50000;
+        high = 500001;
+        checkPassFail(closeTo(index.estimateRange(&low, GT, &high, LT), 49999, 0.02), true)
+        low = 777;
+        checkPassFail(index.estimateRange(&low, GTE, &low, LTE), 1)
+        checkPassFail(index.estimateRange(&low, GT, &low, LTE), 0)
+        low = -100;
+        high = -1;
+        checkPassFail(index.estimateRange(&low, GT, &high, LT), 0)
+
+        // Inserts keep the counts up to date, but the histogram only learns of new keys
+        // when it is refreshed.
+        RecordId keyRid;
+        keyRid.slot_number = 1;
+        for (int key = 100000; key < 200000; key++)
+        {
+            keyRid.page_number = key + 1;
+            index.insertEntry(&key, keyRid);
+        }
+        int dup = 150000;
+        for (int i = 0; i < 50000; i++)
+        {
+            keyRid.page_number = 1000000 + i;
+            index.insertEntry(&dup, keyRid);
+        }
+        for (int key = 100000; key < 120000; key++)
+        {
+            keyRid.page_number = key + 1;
+            index.deleteEntry(&key, keyRid);
+        }
+        stats = index.statistics();
+        checkPassFail((stats.entries == 230000 && stats.minKey == 0 && stats.maxKey == 199999), true)
+        leaves = stats.leaves;
+        low = 100000;
+        high = 200000;
+        checkPassFail((index.estimateRange(&low, GTE, &high, LT) < 1000), true)
+
+        index.refreshStatistics();
+        stats = index.statistics();
+        checkPassFail((stats.entries == 230000 && stats.leaves == leaves), true)
+        checkPassFail((stats.distinctKeys == 180000), true)
+        checkPassFail(closeTo(index.estimateRange(&low, GTE, &high, LT), 130000, 0.02), true)
+        // A frequent key has a bucket of its own.
+        checkPassFail(index.estimateRange(&dup, GTE, &dup, LTE), 50001)
+        low = 150000;
+        high = 160000;
+        estimate = index.estimateRange(&low, GT, &high, LT);
+        checkPassFail(closeTo(estimate, 9999, 0.02), true)
+    }
+
+    // The counts and the histogram are kept in the index file.
+    std::cout << "Reopen the B+ Tree index" << std::endl;
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+        IndexStats stats = index.statistics();
+        checkPassFail((stats.entries == 230000 && stats.leaves == leaves && stats.histogramEntries == 230000), true)
+        int low = 150000;
+        int high = 160000;
+        checkPassFail(index.estimateRange(&low, GT, &high, LT), estimate)
+    }
+    File::remove(intIndexName);
+
+    // Pending messages count as entries, and are passed down before the leaves are read.
+    std::cout << "Create a buffered B+ Tree index and read its statistics" << std::endl;
+    options.bufferInserts = true;
+    options.bulkLoad = false;
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+        RecordId keyRid;
+        keyRid.slot_number = 1;
+        for (int key = -50000; key < 0; key++)
+        {
+            keyRid.page_number = key + 50001;
+            index.insertEntry(&key, keyRid);
+        }
+        IndexStats stats = index.statistics();
+        checkPassFail((stats.entries == 150000 && stats.minKey == -50000 && stats.maxKey == 99999), true)
+        checkPassFail(countScan(&index,-50001,GT,100000,LT), 150000)
+        index.refreshStatistics();
+        int low = -1000;
+        int high = 1000;
+        checkPassFail(closeTo(index.estimateRange(&low, GTE, &high, LT), 2000, 0.02), true)
+    }
+}
+
+/**
+ * Whether the exact count of a range matches what a scan of it returns.
+ */
+bool countMatches(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp)
+{
+    return index->countRange(&lowVal, lowOp, &highVal, highOp) == countScan(index, lowVal, lowOp, highVal, highOp);
+}
+
+void countedNodeTests()
+{
+    std::cout << "Create a B+ Tree index with counted nodes" << std::endl;
+    IndexOptions options;
+    options.bulkLoad = true;
+    options.countedNodes = true;
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+        int low = 2500;
+        int high = 5000;
+        checkPassFail(index.countRange(&low, GT, &high, LT), 2499)
+        low = 20000;
+        high = 35000;
+        checkPassFail(index.countRange(&low, GTE, &high, LTE), 15001)
+        low = -100;
+        high = -1;
+        checkPassFail(index.countRange(&low, GT, &high, LT), 0)
+        low = 4242;
+        checkPassFail(index.countRange(&low, GT, &low, LT), 0)
+        checkPassFail(index.countRange(&low, GTE, &low, LT), 0)
+        checkPassFail(index.countRange(&low, GTE, &low, LTE), 1)
+        int key = 12345;
+        checkPassFail(index.rank(&key), 12345)
+        key = -5;
+        checkPassFail(index.rank(&key), 0)
+        key = 200000;
+        checkPassFail(index.rank(&key), 100000)
+        // select finds the entry rank counts up to.
+        key = 4242;
+        std::vector<RecordId> rids;
+        index.lookup(&key, rids);
+        RecordId selected;
+        checkPassFail((index.select(4242, selected) && selected == rids[0]), true)
+        checkPassFail(index.select(100000, selected), false)
+        checkPassFail(index.select(-1, selected), false)
+
+        // Inserts in scattered order split leaves and non-leaves until the tree is three
+        // levels deep, with a run of duplicates spanning several leaves.
+        RecordId keyRid;
+        keyRid.slot_number = 1;
+        for (int i = 0; i < 300000; i++)
+        {
+            key = 100000 + (int) ((long) i * 7919 % 300000);
+            keyRid.page_number = key + 1;
+            index.insertEntry(&key, keyRid);
+        }
+        int dup = 777;
+        for (int i = 0; i < 5000; i++)
+        {
+            keyRid.page_number = 1000000 + i;
+            index.insertEntry(&dup, keyRid);
+        }
+        checkPassFail((index.statistics().height >= 3), true)
+        checkPassFail(index.countRange(&dup, GTE, &dup, LTE), 5001)
+        checkPassFail(index.countRange(&dup, GT, &dup, LT), 0)
+        checkPassFail(index.countRange(&dup, GT, &dup, LTE), 0)
+        low = -1;
+        high = 400000;
+        checkPassFail(index.countRange(&low, GT, &high, LT), 405000)
+        checkPassFail(countMatches(&index, 90000, GTE, 250000, LT), true)
+        checkPassFail(countMatches(&index, 700, GT, 1000, LTE), true)
+        key = 250000;
+        checkPassFail(index.rank(&key), 255000)
+        checkPassFail((index.select(255000, selected) && selected.page_number == 250001), true)
+
+        // Deletes merge and even out nodes on every level.
+        for (int key = 100000; key < 350000; key++)
+        {
+            keyRid.page_number = key + 1;
+            index.deleteEntry(&key, keyRid);
+        }
+        for (int i = 0; i < 4000; i++)
+        {
+            keyRid.page_number = 1000000 + i;
+            index.deleteEntry(&dup, keyRid);
+        }
+        checkPassFail(index.countRange(&low, GT, &high, LT), 151000)
+        checkPassFail(index.countRange(&dup, GTE, &dup, LTE), 1001)
+        checkPassFail(countMatches(&index, 50000, GT, 360000, LT), true)
+        key = 360000;
+        checkPassFail(index.rank(&key), 111000)
+        checkPassFail((index.select(111000, selected) && selected.page_number == 360001), true)
+    }
+
+    // The counts are kept in the nodes of the index file.
+    std::cout << "Reopen the B+ Tree index with counted nodes" << std::endl;
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+        int low = 99000;
+        int high = 399999;
+        checkPassFail(index.countRange(&low, GTE, &high, LTE), 51000)
+        checkPassFail(countMatches(&index, 1000, GTE, 99999, LT), true)
+    }
+    File::remove(intIndexName);
+
+    // Any other index counts the range by reading its leaves.
+    std::cout << "Count ranges of an index without counted nodes" << std::endl;
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+        int low = 20000;
+        int high = 35000;
+        checkPassFail(index.countRange(&low, GTE, &high, LTE), 15001)
+        low = 4242;
+        checkPassFail(index.countRange(&low, GT, &low, LT), 0)
+        checkPassFail(index.countRange(&low, GTE, &low, LTE), 1)
+        int key = 12345;
+        checkPassFail(index.rank(&key), 12345)
+        std::vector<RecordId> rids;
+        index.lookup(&key, rids);
+        RecordId selected;
+        checkPassFail((index.select(12345, selected) && selected == rids[0]), true)
+        checkPassFail(index.select(100000, selected), false)
+
+        // The same with the key repeated 300 more times.
+        RecordId keyRid;
+        keyRid.slot_number = 1;
+        int dup = 5;
+        for (int i = 0; i < 300; i++)
+        {
+            keyRid.page_number = 1000000 + i;
+            index.insertEntry(&dup, keyRid);
+        }
+        checkPassFail(index.countRange(&dup, GT, &dup, LT), 0)
+        checkPassFail(index.countRange(&dup, GTE, &dup, LT), 0)
+        checkPassFail(index.countRange(&dup, GTE, &dup, LTE), 301)
+    }
+}
+
+/**
+ * Counts the entries of the URL keys of varStringTests in [lowVal, highVal).
+ */
+int urlScan(BTreeIndex *index, int lowVal, int highVal)
+{
+    char low[64];
+    char high[64];
+    sprintf(low, "http://www.example.com/catalogue/products/item-%06d.html", lowVal);
+    sprintf(high, "http://www.example.com/catalogue/products/item-%06d.html", highVal);
+    index->startScan(low, GTE, high, LT);
+    RecordId rids[512];
+    int count = 0;
+    int n;
+    while ((n = index->scanNextBatch(rids, 512)) > 0)
+    {
+        count += n;
+    }
+    index->endScan();
+    return count;
+}
+
+void varStringTests()
+{
+    std::cout << "Create a B+ Tree index on the string field with variable-length keys" << std::endl;
+    IndexOptions options;
+    options.bulkLoad = true;
+    options.stringKeyLength = 64;
+    {
+        BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING, options);
+        checkPassFail(stringScan(&index,25,GT,40,LT), 14)
+        checkPassFail(stringScan(&index,996,GT,1001,LT), 4)
+        checkPassFail(stringScan(&index,3000,GTE,4000,LT), 1000)
+        // Keys are the whole string, not its first ten bytes.
+        char key[64];
+        std::vector<RecordId> rids;
+        sprintf(key, "%05d string record", 4242);
+        checkPassFail(index.lookup(key, rids), 1)
+        sprintf(key, "%05d string", 4242);
+        checkPassFail(index.contains(key), false)
+        long bulkLeaves = index.statistics().leaves;
+
+        // Long keys that share most of their bytes split leaves and non-leaves in scattered
+        // order. Each leaf stores the shared bytes once, so they take far fewer leaves than
+        // the full keys would fill.
+        RecordId keyRid;
+        keyRid.slot_number = 1;
+        for (int i = 0; i < 60000; i++)
+        {
+            int n = (int) ((long) i * 7919 % 60000);
+            sprintf(key, "http://www.example.com/catalogue/products/item-%06d.html", n);
+            keyRid.page_number = n + 1;
+            index.insertEntry(key, keyRid);
+        }
+        IndexStats stats = index.statistics();
+        checkPassFail((stats.height >= 3), true)
+        checkPassFail((stats.leaves - bulkLeaves < 60000 * (long) (sizeof(StringLeafSlot) + strlen(key)) / STRINGLEAFDATA), true)
+        checkPassFail(urlScan(&index, 0, 60000), 60000)
+        checkPassFail(urlScan(&index, 1000, 2000), 1000)
+        sprintf(key, "http://www.example.com/catalogue/products/item-%06d.html", 31337);
+        rids.clear();
+        checkPassFail((index.lookup(key, rids) == 1 && rids[0].page_number == 31338), true)
+        checkPassFail(stringScan(&index,3000,GTE,4000,LT), 1000)
+
+        // Deletes merge leaves and non-leaves.
+        for (int n = 10000; n < 50000; n++)
+        {
+            sprintf(key, "http://www.example.com/catalogue/products/item-%06d.html", n);
+            keyRid.page_number = n + 1;
+            index.deleteEntry(key, keyRid);
+        }
+        checkPassFail(urlScan(&index, 0, 60000), 20000)
+        checkPassFail(urlScan(&index, 9990, 10010), 10)
+        checkPassFail(urlScan(&index, 49990, 50010), 10)
+        checkPassFail((index.statistics().leaves < stats.leaves), true)
+        sprintf(key, "http://www.example.com/catalogue/products/item-%06d.html", 20000);
+        checkPassFail(index.contains(key), false)
+    }
+
+    // The key length is recorded in the index file.
+    std::cout << "Reopen the B+ Tree index with variable-length keys" << std::endl;
+    {
+        BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING);
+        checkPassFail(stringScan(&index,25,GT,40,LT), 14)
+        checkPassFail(urlScan(&index, 0, 60000), 20000)
+        char key[64];
+        sprintf(key, "http://www.example.com/catalogue/products/item-%06d.html", 55555);
+        checkPassFail(index.contains(key), true)
+    }
+    File::remove(stringIndexName);
+
+    // Keys are at most MAXSTRINGKEY bytes.
+    options.stringKeyLength = MAXSTRINGKEY + 1;
+    bool refused = false;
+    try
+    {
+        BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING, options);
+    }
+    catch(const BadIndexInfoException& e)
+    {
+        refused = true;
+    }
+    checkPassFail(refused, true)
+}
+
+void readAheadTests()
+{
+    std::cout << "Open the B+ Tree index on the integer field with read-ahead" << std::endl;
+    IndexOptions options;
+    options.readAheadLeaves = 16;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+
+    // Two cursors with overlapping ranges, advanced in turn while both read ahead.
+    IndexScanCursor first(&index);
+    IndexScanCursor second(&index);
+    int lowFirst = 0, highFirst = 60000;
+    int lowSecond = 30000, highSecond = 100000;
+    first.startScan(&lowFirst, GTE, &highFirst, LT);
+    second.startScan(&lowSecond, GTE, &highSecond, LT);
+    int firstCount = 0, secondCount = 0;
+    bool firstDone = false, secondDone = false;
+    RecordId scanRid;
+    while (!firstDone || !secondDone)
+    {
+        try
+        {
+            if (!firstDone)
+            {
+                first.scanNext(scanRid);
+                firstCount++;
+            }
+        }
+        catch(const IndexScanCompletedException& e)
+        {
+            firstDone = true;
+        }
+        try
+        {
+            if (!secondDone)
+            {
+                second.scanNext(scanRid);
+                secondCount++;
+            }
+        }
+        catch(const IndexScanCompletedException& e)
+        {
+            secondDone = true;
+        }
+    }
+    first.endScan();
+    second.endScan();
+    checkPassFail(firstCount, 60000)
+    checkPassFail(secondCount, 70000)
+
+    // Scans ended early, restarted or within one leaf stop their read-ahead cleanly.
+    int lowVal = 10;
+    int highVal = 90000;
+    for (int s = 0; s < 20; s++)
+    {
+        first.startScan(&lowVal, GT, &highVal, LT);
+        for (int i = 0; i < s * 500; i++)
+        {
+            first.scanNext(scanRid);
+        }
+    }
+    first.endScan();
+    checkPassFail(countScan(&index,20,GTE,30,LTE), 11)
+    checkPassFail(batchScan(&index,-1,GT,100000,LT,1000), 100000)
+
+    // The built-in scan is still running when the index is closed.
+    index.startScan(&lowVal, GT, &highVal, LT);
+    index.scanNext(scanRid);
+}
+
+int intScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp)
+{
+  RecordId scanRid;
+	Page *curPage;
+
+  std::cout << "Scan for ";
+  if( lowOp == GT ) { std::cout << "("; } else { std::cout << "["; }
+  std::cout << lowVal << "," << highVal;
+  if( highOp == LT ) { std::cout << ")"; } else { std::cout << "]"; }
+  std::cout << std::endl;
+
+  int numResults = 0;
+	
+	try
+	{
+  	index->startScan(&lowVal, lowOp, &highVal, highOp);
+	}
+	catch(NoSuchKeyFoundException e)
+	{
+    std::cout << "No Key Found satisfying the scan criteria." << std::endl;
+		return 0;
+	}
+
+	while(1)
+	{
+		try
+		{
+			index->scanNext(scanRid);
+			bufMgr->readPage(file1, scanRid.page_number, curPage);
+			RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(scanRid).data()));
+			bufMgr->unPinPage(file1, scanRid.page_number, false);
+
+			if( numResults < 5 )
+			{
+				std::cout << "at:" << scanRid.page_number << "," << scanRid.slot_number;
+				std::cout << " -->:" << myRec.i << ":" << myRec.d << ":" << myRec.s << ":" <<std::endl;
+			}
+			else if( numResults == 5 )
+			{
+				std::cout << "..." << std::endl;
+			}
+		}
+		catch(IndexScanCompletedException e)
 		{
-			File::remove(intIndexName);
+			break;
 		}
-  	catch(FileNotFoundException e)
-  	{
-  	}
+
+		numResults++;
+	}
+
+  if( numResults >= 5 )
+  {
+    std::cout << "Number of results: " << numResults << std::endl;
   }
+  index->endScan();
+  std::cout << std::endl;
+
+	return numResults;
 }
 
-// -----------------------------------------------------------------------------
-// intTests
-// -----------------------------------------------------------------------------
 
-void intTests()
+int doubleScan(BTreeIndex * index, double lowVal, Operator lowOp, double highVal, Operator highOp)
 {
-  std::cout << "Create a B+ Tree index on the integer field" << std::endl;
-  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+  RecordId scanRid;
+	Page *curPage;
 
-	// run some tests
-	checkPassFail(intScan(&index,25,GT,40,LT), 14)
-	checkPassFail(intScan(&index,20,GTE,35,LTE), 16)
-	checkPassFail(intScan(&index,-3,GT,3,LT), 3)
-	checkPassFail(intScan(&index,996,GT,1001,LT), 4)
-	checkPassFail(intScan(&index,0,GT,1,LT), 0)
-	checkPassFail(intScan(&index,300,GT,400,LT), 99)
-	checkPassFail(intScan(&index,3000,GTE,4000,LT), 1000)
-}
+  std::cout << "Scan for ";
+  if( lowOp == GT ) { std::cout << "("; } else { std::cout << "["; }
+  std::cout << lowVal << "," << highVal;
+  if( highOp == LT ) { std::cout << ")"; } else { std::cout << "]"; }
+  std::cout << std::endl;
 
-void negativeIntTests()
-{
-    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
-    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+  int numResults = 0;
 
-    // run some tests
-    checkPassFail(intScan(&index,-500,GT,500,LT), 999)
-    checkPassFail(intScan(&index,20,GTE,35,LTE), 16)
-    checkPassFail(intScan(&index,-1500,GT,1500,LT), 2999)
-    checkPassFail(intScan(&index,-3,GT,3,LT), 5)
-    checkPassFail(intScan(&index,-1000,GT,1000,LT), 1999)
-    checkPassFail(intScan(&index,0,GT,1,LT), 0)
-    checkPassFail(intScan(&index,-2000,GT,2000,LT), 3999)
-    checkPassFail(intScan(&index,300,GT,400,LT), 99)
-    checkPassFail(intScan(&index,-2500,GT,2500,LT), 4999)
-    checkPassFail(intScan(&index,3000,GTE,4000,LT), 0)
-    checkPassFail(intScan(&index,-3500,GT,3500,LT), 6999)
+	try
+	{
+  	index->startScan(&lowVal, lowOp, &highVal, highOp);
+	}
+	catch(const NoSuchKeyFoundException& e)
+	{
+    std::cout << "No Key Found satisfying the scan criteria." << std::endl;
+		return 0;
+	}
 
-}
+	while(1)
+	{
+		try
+		{
+			index->scanNext(scanRid);
+			bufMgr->readPage(file1, scanRid.page_number, curPage);
+			RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(scanRid).data()));
+			bufMgr->unPinPage(file1, scanRid.page_number, false);
 
-void largeIntTests()
-{
-    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
-    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+			if( numResults < 5 )
+			{
+				std::cout << "rid:" << scanRid.page_number << "," << scanRid.slot_number;
+				std::cout << " -->:" << myRec.i << ":" << myRec.d << ":" << myRec.s << ":" <<std::endl;
+			}
+			else if( numResults == 5 )
+			{
+				std::cout << "..." << std::endl;
+			}
+		}
+		catch(const IndexScanCompletedException& e)
+		{
+			break;
+		}
 
-    // run some tests
-    checkPassFail(intScan(&index,2500,GT,5000,LT), 2499)
-    checkPassFail(intScan(&index,20000,GTE,35000,LTE), 14999)
-    checkPassFail(intScan(&index,-3,GT,3,LT), 3)
-    checkPassFail(intScan(&index,996,GT,1001,LT), 4)
-    checkPassFail(intScan(&index,0,GT,1,LT), 0)
-    checkPassFail(intScan(&index,50000,GT,500001,LT), 0)
-    checkPassFail(intScan(&index,82250,GTE,95750,LT), 12499)
+		numResults++;
+	}
+
+  if( numResults >= 5 )
+  {
+    std::cout << "Number of results: " << numResults << std::endl;
+  }
+  index->endScan();
+  std::cout << std::endl;
+
+	return numResults;
 }
 
-int intScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp)
+int stringScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp)
 {
   RecordId scanRid;
 	Page *curPage;
@@ -726,13 +3526,18 @@ int intScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operato
   if( highOp == LT ) { std::cout << ")"; } else { std::cout << "]"; }
   std::cout << std::endl;
 
+  char lowValStr[100];
+  sprintf(lowValStr,"%05d string record",lowVal);
+  char highValStr[100];
+  sprintf(highValStr,"%05d string record",highVal);
+
   int numResults = 0;
-	
+
 	try
 	{
-  	index->startScan(&lowVal, lowOp, &highVal, highOp);
+  	index->startScan(lowValStr, lowOp, highValStr, highOp);
 	}
-	catch(NoSuchKeyFoundException e)
+	catch(const NoSuchKeyFoundException& e)
 	{
     std::cout << "No Key Found satisfying the scan criteria." << std::endl;
 		return 0;
@@ -749,7 +3554,7 @@ int intScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operato
 
 			if( numResults < 5 )
 			{
-				std::cout << "at:" << scanRid.page_number << "," << scanRid.slot_number;
+				std::cout << "rid:" << scanRid.page_number << "," << scanRid.slot_number;
 				std::cout << " -->:" << myRec.i << ":" << myRec.d << ":" << myRec.s << ":" <<std::endl;
 			}
 			else if( numResults == 5 )
@@ -757,7 +3562,7 @@ int intScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operato
 				std::cout << "..." << std::endl;
 			}
 		}
-		catch(IndexScanCompletedException e)
+		catch(const IndexScanCompletedException& e)
 		{
 			break;
 		}
@@ -775,6 +3580,226 @@ int intScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operato
 	return numResults;
 }
 
+int countScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp)
+{
+  // Counts the matches without reading the records their rids point to.
+  RecordId scanRid;
+  int numResults = 0;
+
+  try
+  {
+    index->startScan(&lowVal, lowOp, &highVal, highOp);
+  }
+  catch(const NoSuchKeyFoundException& e)
+  {
+    std::cout << "No Key Found satisfying the scan criteria." << std::endl;
+    return 0;
+  }
+
+  try
+  {
+    while(1)
+    {
+      index->scanNext(scanRid);
+      numResults++;
+    }
+  }
+  catch(const IndexScanCompletedException& e)
+  {
+  }
+  index->endScan();
+  std::cout << "Number of results: " << numResults << std::endl;
+
+	return numResults;
+}
+
+int batchScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp, int batchSize)
+{
+  // Counts the matches fetched batchSize at a time, checking each batch against
+  // the same entries fetched one by one from a second cursor.
+  std::vector<RecordId> batch(batchSize);
+  IndexScanCursor check(index);
+  int numResults = 0;
+  int mismatches = 0;
+
+  try
+  {
+    index->startScan(&lowVal, lowOp, &highVal, highOp);
+    check.startScan(&lowVal, lowOp, &highVal, highOp);
+  }
+  catch(const NoSuchKeyFoundException& e)
+  {
+    std::cout << "No Key Found satisfying the scan criteria." << std::endl;
+    return 0;
+  }
+
+  int n;
+  while ((n = index->scanNextBatch(&batch[0], batchSize)) > 0)
+  {
+    for (int i = 0; i < n; i++)
+    {
+      RecordId scanRid;
+      check.scanNext(scanRid);
+      if (!(scanRid == batch[i]))
+      {
+        mismatches++;
+      }
+    }
+    numResults += n;
+  }
+  index->endScan();
+  check.endScan();
+  std::cout << "Number of results: " << numResults << " in batches of " << batchSize << std::endl;
+
+	return mismatches == 0 ? numResults : -1;
+}
+
+int prefixScan(BTreeIndex * index, const PAIRRECORD& lowVal, Operator lowOp, const PAIRRECORD& highVal, Operator highOp, int numColumns)
+{
+  // Counts the matches of a scan bounded on the leading numColumns key attributes.
+  RecordId scanRid;
+  int numResults = 0;
+
+  try
+  {
+    index->startPrefixScan(&lowVal, lowOp, &highVal, highOp, numColumns);
+  }
+  catch(const NoSuchKeyFoundException& e)
+  {
+    std::cout << "No Key Found satisfying the scan criteria." << std::endl;
+    return 0;
+  }
+
+  try
+  {
+    while(1)
+    {
+      index->scanNext(scanRid);
+      numResults++;
+    }
+  }
+  catch(const IndexScanCompletedException& e)
+  {
+  }
+  index->endScan();
+  std::cout << "Number of results: " << numResults << std::endl;
+
+	return numResults;
+}
+
+// -----------------------------------------------------------------------------
+// coveredScan
+// -----------------------------------------------------------------------------
+
+int coveredScan(BTreeIndex * index, int lowVal, int highVal, int batchSize)
+{
+  // Scans the keys [lowVal, highVal), one at a time or batchSize at a time, and counts
+  // the entries whose payload holds the d and s fields of the record with that key.
+  int width = index->payloadSize();
+  std::vector<RecordId> rids(std::max(1, batchSize));
+  std::vector<char> payloads(std::max(1, batchSize) * width);
+  int numResults = 0;
+  int key = lowVal;
+
+  index->startScan(&lowVal, GTE, &highVal, LT);
+  while(1)
+  {
+    int n = 1;
+    if (batchSize == 0)
+    {
+      try
+      {
+        index->scanNext(rids[0], &payloads[0]);
+      }
+      catch(const IndexScanCompletedException& e)
+      {
+        break;
+      }
+    }
+    else if ((n = index->scanNextBatch(&rids[0], &payloads[0], batchSize)) == 0)
+    {
+      break;
+    }
+    for (int e = 0; e < n; e++, key++)
+    {
+      double d;
+      memcpy(&d, &payloads[e * width], sizeof(double));
+      char s[24];
+      sprintf(s, "%05d string record", key);
+      numResults += d == key && strncmp(&payloads[e * width + sizeof(double)], s, 16) == 0;
+    }
+  }
+  index->endScan();
+  std::cout << "Number of results: " << numResults << std::endl;
+
+	return numResults;
+}
+
+// -----------------------------------------------------------------------------
+// descendingScan
+// -----------------------------------------------------------------------------
+
+int descendingScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp, int batchSize)
+{
+  // Counts the matches of a descending scan, fetched one by one or batchSize at a time,
+  // checking that they are the matches of an ascending scan in reverse.
+  std::vector<RecordId> ascending;
+  std::vector<RecordId> descending;
+  IndexScanCursor check(index);
+  RecordId scanRid;
+
+  try
+  {
+    check.startScan(&lowVal, lowOp, &highVal, highOp);
+    index->startScan(&lowVal, lowOp, &highVal, highOp, DESCENDING);
+  }
+  catch(const NoSuchKeyFoundException& e)
+  {
+    std::cout << "No Key Found satisfying the scan criteria." << std::endl;
+    return 0;
+  }
+
+  try
+  {
+    while(1)
+    {
+      check.scanNext(scanRid);
+      ascending.push_back(scanRid);
+    }
+  }
+  catch(const IndexScanCompletedException& e)
+  {
+  }
+  if (batchSize == 0)
+  {
+    try
+    {
+      while(1)
+      {
+        index->scanNext(scanRid);
+        descending.push_back(scanRid);
+      }
+    }
+    catch(const IndexScanCompletedException& e)
+    {
+    }
+  }
+  else
+  {
+    std::vector<RecordId> batch(batchSize);
+    int n;
+    while ((n = index->scanNextBatch(&batch[0], batchSize)) > 0)
+    {
+      descending.insert(descending.end(), batch.begin(), batch.begin() + n);
+    }
+  }
+  index->endScan();
+  check.endScan();
+  std::cout << "Number of results: " << descending.size() << " descending" << std::endl;
+
+  std::reverse(ascending.begin(), ascending.end());
+	return ascending == descending ? (int) descending.size() : -1;
+}
 
 // -----------------------------------------------------------------------------
 // errorTests
@@ -908,3 +3933,34 @@ void deleteRelation()
 	{
 	}
 }
+
+int parallelScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp, int numWorkers)
+{
+  // Counts the matches of a parallel scan, checking that they come back in the order of
+  // a scan with one cursor.
+  std::vector<RecordId> serial;
+  std::vector<RecordId> parallel;
+  IndexScanCursor check(index);
+  RecordId scanRid;
+
+  long count = index->parallelScan(&lowVal, lowOp, &highVal, highOp, numWorkers, parallel);
+  try
+  {
+    check.startScan(&lowVal, lowOp, &highVal, highOp);
+    while(1)
+    {
+      check.scanNext(scanRid);
+      serial.push_back(scanRid);
+    }
+  }
+  catch(const NoSuchKeyFoundException& e)
+  {
+  }
+  catch(const IndexScanCompletedException& e)
+  {
+    check.endScan();
+  }
+  std::cout << "Number of results: " << parallel.size() << " in parallel" << std::endl;
+
+	return count == (long) parallel.size() && serial == parallel ? (int) count : -1;
+}
@@ -0,0 +1,201 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstring>
+#include <vector>
+#include "btree.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Children of a non-leaf node of an index built with IndexOptions::bufferInserts.
+ * The rest of the node holds its message buffer, so that a flush to the fullest child
+ * moves many messages at once.
+ */
+const int BUFFERFANOUT = 32;
+
+/**
+ * @brief Insert messages taken out of node buffers, oldest first.
+ */
+template <class T>
+struct MessageBatch
+{
+	std::vector<T> keys;
+	std::vector<RecordId> rids;
+
+  /**
+   * Included attributes of the messages, payloadBytes for each.
+   */
+	std::vector<char> payloads;
+
+	int size() const
+	{
+		return (int) keys.size();
+	}
+};
+
+/**
+ * @brief Message buffer of a non-leaf node of a buffered index: inserts that were routed
+ * to the node and not yet passed on to its children, in the order they arrived.
+ *
+ * The node keeps nodeOccupancy keys and one more child. The keys of the messages take
+ * the rest of the key array. Their rids, each followed by its included attributes, take
+ * the rest of the page number array but its last slot, which holds the number of
+ * messages. A zeroed node has an empty buffer.
+ */
+template <class T>
+class NodeBuffer
+{
+ public:
+	NodeBuffer(NonLeafNode<T>* node, const int nodeOccupancy, const int payloadBytes)
+		: node(node), occupancy(nodeOccupancy), payloadBytes(payloadBytes),
+		  recordBytes(sizeof(RecordId) + payloadBytes)
+	{
+	}
+
+  /**
+   * Most messages the buffer of a node with nodeOccupancy keys holds.
+   */
+	static int capacity(const int nodeOccupancy, const int payloadBytes)
+	{
+		int keys = NodeSize<T>::NONLEAF - nodeOccupancy;
+		int records = (int) ((NodeSize<T>::NONLEAF - nodeOccupancy - 1) * sizeof(PageId) / (sizeof(RecordId) + payloadBytes));
+		return keys < records ? keys : records;
+	}
+
+  /**
+   * Number of messages in the buffer.
+   */
+	int size() const
+	{
+		return (int) node->pageNoArray[NodeSize<T>::NONLEAF];
+	}
+
+  /**
+   * Key of message i.
+   */
+	const T& key(const int i) const
+	{
+		return node->keyArray[occupancy + i];
+	}
+
+  /**
+   * Adds a message after the others. The caller checks that there is room.
+   */
+	void append(const T& key, const RecordId& rid, const char* payload)
+	{
+		int n = size();
+		node->keyArray[occupancy + n] = key;
+		memcpy(record(n), &rid, sizeof(RecordId));
+		if (payloadBytes > 0)
+		{
+			memcpy(record(n) + sizeof(RecordId), payload, payloadBytes);
+		}
+		node->pageNoArray[NodeSize<T>::NONLEAF] = n + 1;
+	}
+
+  /**
+   * Adds every message of a batch, in order.
+   */
+	void append(const MessageBatch<T>& batch)
+	{
+		for (int i = 0; i < batch.size(); i++)
+		{
+			append(batch.keys[i], batch.rids[i], payloadBytes > 0 ? &batch.payloads[(size_t) i * payloadBytes] : nullptr);
+		}
+	}
+
+  /**
+   * Moves the messages whose key satisfies pred to the end of a batch, in order, and
+   * closes up the rest.
+   * @return	Number of messages moved.
+   */
+	template <class P>
+	int take(P pred, MessageBatch<T>& out)
+	{
+		int n = size();
+		int kept = 0;
+		for (int i = 0; i < n; i++)
+		{
+			if (pred(key(i)))
+			{
+				RecordId rid;
+				memcpy(&rid, record(i), sizeof(RecordId));
+				out.keys.push_back(key(i));
+				out.rids.push_back(rid);
+				out.payloads.insert(out.payloads.end(), record(i) + sizeof(RecordId), record(i) + recordBytes);
+				continue;
+			}
+			if (kept != i)
+			{
+				node->keyArray[occupancy + kept] = key(i);
+				memmove(record(kept), record(i), recordBytes);
+			}
+			kept++;
+		}
+		node->pageNoArray[NodeSize<T>::NONLEAF] = kept;
+		return n - kept;
+	}
+
+ private:
+	NonLeafNode<T>* node;
+	int occupancy;
+	int payloadBytes;
+	int recordBytes;
+
+	char* record(const int i)
+	{
+		return (char*) &node->pageNoArray[occupancy + 1] + (size_t) i * recordBytes;
+	}
+};
+
+/**
+ * @brief VarStringKey nodes have no room for a buffer, so their indexes never buffer
+ * inserts.
+ */
+template <>
+class NodeBuffer<VarStringKey>
+{
+ public:
+	NodeBuffer(NonLeafNode<VarStringKey>* node, const int nodeOccupancy, const int payloadBytes)
+	{
+	}
+
+	static int capacity(const int nodeOccupancy, const int payloadBytes)
+	{
+		return 0;
+	}
+
+	int size() const
+	{
+		return 0;
+	}
+
+	VarStringKey key(const int i) const
+	{
+		return VarStringKey();
+	}
+
+	void append(const VarStringKey& key, const RecordId& rid, const char* payload)
+	{
+	}
+
+	void append(const MessageBatch<VarStringKey>& batch)
+	{
+	}
+
+	template <class P>
+	int take(P pred, MessageBatch<VarStringKey>& out)
+	{
+		return 0;
+	}
+};
+
+}
@@ -0,0 +1,192 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include "types.h"
+#include "page.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Non-leaf pages of one index file that stay pinned in the buffer pool, indexed by
+ * page number. A cached node is found with two loads instead of a call to the buffer
+ * manager, and is changed in place in its frame like any pinned page, so the cache never
+ * goes stale. Entries are allocated in chunks like the latches of a LatchTable, the first
+ * time a page of the chunk is cached. Lookups take no lock.
+ *
+ * The cache holds one pin on each page in it. Whoever adds a page hands its own pin over
+ * to the cache, and whoever takes it out takes the pin back. It holds at most a given
+ * number of pages, so that the frames left to the rest of the pool do not run out; nodes
+ * read once it is full are pinned and unpinned like any page.
+ */
+class NodeCache
+{
+ public:
+  /**
+   * Number of entries allocated together.
+   */
+	static const PageId CHUNKSIZE = 4096;
+
+  /**
+   * Number of chunks. Pages numbered CHUNKSIZE * MAXCHUNKS and up are never cached.
+   */
+	static const PageId MAXCHUNKS = 65536;
+
+  /**
+   * @param capacity	Most pages held at once.
+   */
+	NodeCache(const PageId capacity)
+		: capacity(capacity), numCached(0)
+	{
+		for (PageId i = 0; i < MAXCHUNKS; i++)
+		{
+			chunks[i].store(nullptr, std::memory_order_relaxed);
+		}
+	}
+
+	~NodeCache()
+	{
+		for (PageId i = 0; i < MAXCHUNKS; i++)
+		{
+			delete [] chunks[i].load(std::memory_order_relaxed);
+		}
+	}
+
+  /**
+   * Returns the frame of a cached page, or null if the page is not cached.
+   * @param pageNo	Page number in the index file.
+   */
+	Page* get(const PageId pageNo) const
+	{
+		if (pageNo >= CHUNKSIZE * MAXCHUNKS)
+		{
+			return nullptr;
+		}
+		Entry* chunk = chunks[pageNo / CHUNKSIZE].load(std::memory_order_acquire);
+		if (chunk == nullptr)
+		{
+			return nullptr;
+		}
+		return chunk[pageNo % CHUNKSIZE].page.load(std::memory_order_acquire);
+	}
+
+  /**
+   * Caches a page pinned by the caller, taking over the pin.
+   * @param pageNo	Page number in the index file.
+   * @param page	Frame of the page.
+   * @return		False if the page is already cached or cannot be, in which case the
+   * 				caller keeps its pin.
+   */
+	bool add(const PageId pageNo, Page* page)
+	{
+		if (pageNo >= CHUNKSIZE * MAXCHUNKS)
+		{
+			return false;
+		}
+		// Reserve a place first, so that racing threads cannot overfill the cache.
+		if (numCached.fetch_add(1, std::memory_order_relaxed) >= capacity)
+		{
+			numCached.fetch_sub(1, std::memory_order_relaxed);
+			return false;
+		}
+		std::atomic<Entry*>& slot = chunks[pageNo / CHUNKSIZE];
+		Entry* chunk = slot.load(std::memory_order_acquire);
+		if (chunk == nullptr)
+		{
+			// Racing threads may both allocate; the loser frees its copy.
+			Entry* fresh = new Entry[CHUNKSIZE];
+			if (slot.compare_exchange_strong(chunk, fresh, std::memory_order_acq_rel))
+			{
+				chunk = fresh;
+			}
+			else
+			{
+				delete [] fresh;
+			}
+		}
+		Page* none = nullptr;
+		if (!chunk[pageNo % CHUNKSIZE].page.compare_exchange_strong(none, page, std::memory_order_acq_rel))
+		{
+			numCached.fetch_sub(1, std::memory_order_relaxed);
+			return false;
+		}
+		return true;
+	}
+
+  /**
+   * Records that a cached page was changed, so that it is written out once released.
+   * @param pageNo	Page number of a cached page.
+   */
+	void markDirty(const PageId pageNo)
+	{
+		chunks[pageNo / CHUNKSIZE].load(std::memory_order_acquire)[pageNo % CHUNKSIZE].dirty.store(true, std::memory_order_relaxed);
+	}
+
+  /**
+   * Takes a page out of the cache, handing its pin back to the caller.
+   * @param pageNo	Page number in the index file.
+   * @param dirty	Set to whether the page was changed while cached.
+   * @return		False if the page was not cached.
+   */
+	bool remove(const PageId pageNo, bool& dirty)
+	{
+		if (get(pageNo) == nullptr)
+		{
+			return false;
+		}
+		Entry& entry = chunks[pageNo / CHUNKSIZE].load(std::memory_order_acquire)[pageNo % CHUNKSIZE];
+		if (entry.page.exchange(nullptr, std::memory_order_acq_rel) == nullptr)
+		{
+			return false;
+		}
+		dirty = entry.dirty.exchange(false, std::memory_order_relaxed);
+		numCached.fetch_sub(1, std::memory_order_relaxed);
+		return true;
+	}
+
+  /**
+   * One past the last page number that may be cached, to walk the cache up to.
+   */
+	PageId limit() const
+	{
+		PageId end = 0;
+		for (PageId i = 0; i < MAXCHUNKS; i++)
+		{
+			if (chunks[i].load(std::memory_order_acquire) != nullptr)
+			{
+				end = (i + 1) * CHUNKSIZE;
+			}
+		}
+		return end;
+	}
+
+ private:
+	struct Entry
+	{
+		std::atomic<Page*>	page;
+		std::atomic<bool>	dirty;
+
+		Entry()
+			: page(nullptr), dirty(false)
+		{
+		}
+	};
+
+	std::atomic<Entry*> chunks[MAXCHUNKS];
+
+	const PageId capacity;
+
+	std::atomic<PageId> numCached;
+
+	NodeCache(const NodeCache&);
+	NodeCache& operator=(const NodeCache&);
+};
+
+}
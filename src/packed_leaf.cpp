@@ -0,0 +1,445 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <climits>
+#include "packed_leaf.h"
+#include "key_search.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PACKED_LEAF_X86
+#endif
+
+namespace badgerdb
+{
+
+/**
+ * Column widths and bases that hold a set of entries.
+ */
+struct PackedLayout
+{
+	int keyBytes;
+	int pageBytes;
+	int slotBytes;
+	int keyBase;
+	PageId pageBase;
+	int capacity;
+};
+
+/**
+ * Picks the narrowest layout for n sorted entries.
+ * @return	False if they do not fit in a leaf.
+ */
+static bool packedLayout(const int* keys, const RecordId* rids, const int n, PackedLayout& layout)
+{
+	layout.keyBytes = 2;
+	layout.pageBytes = 2;
+	layout.slotBytes = 1;
+	layout.keyBase = 0;
+	layout.pageBase = 0;
+	if (n > 0)
+	{
+		if ((long long) keys[n - 1] - keys[0] > USHRT_MAX)
+		{
+			layout.keyBytes = 4;
+			layout.keyBase = INT_MIN;
+		}
+		else
+		{
+			layout.keyBase = keys[0];
+		}
+		PageId minPage = rids[0].page_number;
+		PageId maxPage = rids[0].page_number;
+		SlotId maxSlot = rids[0].slot_number;
+		for (int i = 1; i < n; i++)
+		{
+			minPage = std::min(minPage, rids[i].page_number);
+			maxPage = std::max(maxPage, rids[i].page_number);
+			maxSlot = std::max(maxSlot, rids[i].slot_number);
+		}
+		if (maxPage - minPage > USHRT_MAX)
+		{
+			layout.pageBytes = 4;
+		}
+		else
+		{
+			layout.pageBase = minPage;
+		}
+		if (maxSlot > UCHAR_MAX)
+		{
+			layout.slotBytes = 2;
+		}
+	}
+	layout.capacity = std::min(PACKEDLEAFSIZE,
+	                           PACKEDLEAFDATA / (layout.keyBytes + layout.pageBytes + layout.slotBytes));
+	return n <= layout.capacity;
+}
+
+static void unpackKeysScalar(const char* col, const int keyBytes, const int keyBase,
+                             const int from, const int n, int* out)
+{
+	if (keyBytes == 4)
+	{
+		memcpy(out, col + 4 * from, n * sizeof(int));
+		return;
+	}
+	for (int j = 0; j < n; j++)
+	{
+		short k;
+		memcpy(&k, col + 2 * (from + j), sizeof(short));
+		out[j] = (int) ((unsigned) keyBase + (unsigned) (k + 32768));
+	}
+}
+
+static void unpackRidsScalar(const char* pages, const char* slots, const int pageBytes,
+                             const int slotBytes, const PageId pageBase, const int from,
+                             const int n, RecordId* out)
+{
+	for (int j = 0; j < n; j++)
+	{
+		int i = from + j;
+		if (pageBytes == 2)
+		{
+			unsigned short p;
+			memcpy(&p, pages + 2 * i, sizeof(p));
+			out[j].page_number = pageBase + p;
+		}
+		else
+		{
+			memcpy(&out[j].page_number, pages + 4 * i, sizeof(PageId));
+		}
+		if (slotBytes == 1)
+		{
+			out[j].slot_number = (unsigned char) slots[i];
+		}
+		else
+		{
+			memcpy(&out[j].slot_number, slots + 2 * i, sizeof(SlotId));
+		}
+	}
+}
+
+#ifdef PACKED_LEAF_X86
+
+/**
+ * Widens eight 16 bit keys per step. Returns the number of keys unpacked, a multiple
+ * of eight; the caller unpacks the rest.
+ */
+__attribute__((target("avx2")))
+static int unpackKeysAvx2(const char* col, const int keyBase, const int from, const int n, int* out)
+{
+	const __m256i base = _mm256_set1_epi32((int) ((unsigned) keyBase + 32768u));
+	int j = 0;
+	for (; j + 8 <= n; j += 8)
+	{
+		__m256i k = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*) (col + 2 * (from + j))));
+		_mm256_storeu_si256((__m256i*) (out + j), _mm256_add_epi32(k, base));
+	}
+	return j;
+}
+
+/**
+ * Unpacks eight record ids per step: the page numbers and slot numbers are widened to
+ * 32 bit lanes and interleaved into the 8 byte RecordId layout. Returns the number of
+ * record ids unpacked, a multiple of eight.
+ */
+__attribute__((target("avx2")))
+static int unpackRidsAvx2(const char* pages, const char* slots, const int pageBytes,
+                          const int slotBytes, const PageId pageBase, const int from,
+                          const int n, RecordId* out)
+{
+	const __m256i base = _mm256_set1_epi32(pageBytes == 2 ? (int) pageBase : 0);
+	int j = 0;
+	for (; j + 8 <= n; j += 8)
+	{
+		int i = from + j;
+		__m256i p = pageBytes == 2
+			? _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*) (pages + 2 * i)))
+			: _mm256_loadu_si256((const __m256i*) (pages + 4 * i));
+		p = _mm256_add_epi32(p, base);
+		__m256i s = slotBytes == 1
+			? _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*) (slots + i)))
+			: _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*) (slots + 2 * i)));
+		// lo holds rids 0, 1, 4, 5 and hi holds 2, 3, 6, 7; the lane swap restores the order.
+		__m256i lo = _mm256_unpacklo_epi32(p, s);
+		__m256i hi = _mm256_unpackhi_epi32(p, s);
+		_mm256_storeu_si256((__m256i*) (out + j), _mm256_permute2x128_si256(lo, hi, 0x20));
+		_mm256_storeu_si256((__m256i*) (out + j + 4), _mm256_permute2x128_si256(lo, hi, 0x31));
+	}
+	return j;
+}
+
+#endif
+
+void PackedIntLeaf::copyRids(const Page* page, const int from, const int n, RecordId* out)
+{
+	const PackedLeafHeader* h = header(page);
+	int cap = capacity(h->keyBytes, h->pageBytes, h->slotBytes);
+	const char* pages = data(page) + cap * h->keyBytes;
+	const char* slots = pages + cap * h->pageBytes;
+	int done = 0;
+#ifdef PACKED_LEAF_X86
+	if (searchKernel() == AVX2_KERNEL)
+	{
+		done = unpackRidsAvx2(pages, slots, h->pageBytes, h->slotBytes, h->pageBase, from, n, out);
+	}
+#endif
+	unpackRidsScalar(pages, slots, h->pageBytes, h->slotBytes, h->pageBase, from + done, n - done, out + done);
+}
+
+void PackedIntLeaf::decode(const Page* page, int* keys, RecordId* rids)
+{
+	const PackedLeafHeader* h = header(page);
+	int n = h->numKeys;
+	if (n == 0)
+	{
+		return;
+	}
+	int done = 0;
+#ifdef PACKED_LEAF_X86
+	if (h->keyBytes == 2 && searchKernel() == AVX2_KERNEL)
+	{
+		done = unpackKeysAvx2(data(page), h->keyBase, 0, n, keys);
+	}
+#endif
+	unpackKeysScalar(data(page), h->keyBytes, h->keyBase, done, n - done, keys + done);
+	copyRids(page, 0, n, rids);
+}
+
+bool PackedIntLeaf::encode(Page* page, const int* keys, const RecordId* rids, const int n)
+{
+	PackedLayout layout;
+	if (!packedLayout(keys, rids, n, layout))
+	{
+		return false;
+	}
+	PackedLeafHeader* h = (PackedLeafHeader*) page;
+	h->numKeys = (unsigned short) n;
+	h->keyBytes = (unsigned char) layout.keyBytes;
+	h->pageBytes = (unsigned char) layout.pageBytes;
+	h->slotBytes = (unsigned char) layout.slotBytes;
+	h->keyBase = layout.keyBase;
+	h->pageBase = layout.pageBase;
+	char* keyCol = data(page);
+	char* pageCol = keyCol + layout.capacity * layout.keyBytes;
+	char* slotCol = pageCol + layout.capacity * layout.pageBytes;
+	for (int i = 0; i < n; i++)
+	{
+		if (layout.keyBytes == 2)
+		{
+			short k = (short) ((long long) keys[i] - layout.keyBase - 32768);
+			memcpy(keyCol + 2 * i, &k, sizeof(short));
+		}
+		else
+		{
+			memcpy(keyCol + 4 * i, &keys[i], sizeof(int));
+		}
+		if (layout.pageBytes == 2)
+		{
+			unsigned short p = (unsigned short) (rids[i].page_number - layout.pageBase);
+			memcpy(pageCol + 2 * i, &p, sizeof(p));
+		}
+		else
+		{
+			memcpy(pageCol + 4 * i, &rids[i].page_number, sizeof(PageId));
+		}
+		if (layout.slotBytes == 1)
+		{
+			slotCol[i] = (char) rids[i].slot_number;
+		}
+		else
+		{
+			memcpy(slotCol + 2 * i, &rids[i].slot_number, sizeof(SlotId));
+		}
+	}
+	return true;
+}
+
+int PackedIntLeaf::lowerBound(const Page* page, const int key)
+{
+	const PackedLeafHeader* h = header(page);
+	int n = h->numKeys;
+	if (n == 0)
+	{
+		return 0;
+	}
+	if (h->keyBytes == 4)
+	{
+		return intLowerBound((const int*) data(page), n, key);
+	}
+	long long offset = (long long) key - h->keyBase;
+	if (offset < 0)
+	{
+		return 0;
+	}
+	if (offset > USHRT_MAX)
+	{
+		return n;
+	}
+	return shortLowerBound((const short*) data(page), n, (short) (offset - 32768));
+}
+
+int PackedIntLeaf::upperBound(const Page* page, const int key)
+{
+	const PackedLeafHeader* h = header(page);
+	int n = h->numKeys;
+	if (n == 0)
+	{
+		return 0;
+	}
+	if (h->keyBytes == 4)
+	{
+		return intUpperBound((const int*) data(page), n, key);
+	}
+	long long offset = (long long) key - h->keyBase;
+	if (offset < 0)
+	{
+		return 0;
+	}
+	if (offset > USHRT_MAX)
+	{
+		return n;
+	}
+	return shortUpperBound((const short*) data(page), n, (short) (offset - 32768));
+}
+
+bool PackedIntLeaf::insert(Page* page, const int key, const RecordId& rid, const char* payload)
+{
+	PackedLeafHeader* h = (PackedLeafHeader*) page;
+	int n = h->numKeys;
+	int pos = upperBound(page, key);
+	// In place if the entry fits the current encoding and there is a free slot.
+	bool fits = n > 0
+		&& (h->keyBytes == 4 || (key >= h->keyBase && (long long) key - h->keyBase <= USHRT_MAX))
+		&& (h->pageBytes == 4 || (rid.page_number >= h->pageBase && rid.page_number - h->pageBase <= USHRT_MAX))
+		&& (h->slotBytes == 2 || rid.slot_number <= UCHAR_MAX);
+	int cap = n > 0 ? capacity(h->keyBytes, h->pageBytes, h->slotBytes) : 0;
+	if (fits && n < cap)
+	{
+		char* keyCol = data(page);
+		char* pageCol = keyCol + cap * h->keyBytes;
+		char* slotCol = pageCol + cap * h->pageBytes;
+		int kb = h->keyBytes;
+		int pb = h->pageBytes;
+		int sb = h->slotBytes;
+		memmove(keyCol + (pos + 1) * kb, keyCol + pos * kb, (n - pos) * kb);
+		memmove(pageCol + (pos + 1) * pb, pageCol + pos * pb, (n - pos) * pb);
+		memmove(slotCol + (pos + 1) * sb, slotCol + pos * sb, (n - pos) * sb);
+		if (kb == 2)
+		{
+			short k = (short) ((long long) key - h->keyBase - 32768);
+			memcpy(keyCol + 2 * pos, &k, sizeof(short));
+		}
+		else
+		{
+			memcpy(keyCol + 4 * pos, &key, sizeof(int));
+		}
+		if (pb == 2)
+		{
+			unsigned short p = (unsigned short) (rid.page_number - h->pageBase);
+			memcpy(pageCol + 2 * pos, &p, sizeof(p));
+		}
+		else
+		{
+			memcpy(pageCol + 4 * pos, &rid.page_number, sizeof(PageId));
+		}
+		if (sb == 1)
+		{
+			slotCol[pos] = (char) rid.slot_number;
+		}
+		else
+		{
+			memcpy(slotCol + 2 * pos, &rid.slot_number, sizeof(SlotId));
+		}
+		h->numKeys = (unsigned short) (n + 1);
+		return true;
+	}
+	// Otherwise repack with the entry added, which fails if it does not fit.
+	if (n + 1 > PACKEDLEAFSIZE)
+	{
+		return false;
+	}
+	int keys[PACKEDLEAFSIZE];
+	RecordId rids[PACKEDLEAFSIZE];
+	decode(page, keys, rids);
+	memmove(&keys[pos + 1], &keys[pos], (n - pos) * sizeof(int));
+	memmove(&rids[pos + 1], &rids[pos], (n - pos) * sizeof(RecordId));
+	keys[pos] = key;
+	rids[pos] = rid;
+	return encode(page, keys, rids, n + 1);
+}
+
+void PackedIntLeaf::erase(Page* page, const int i)
+{
+	PackedLeafHeader* h = (PackedLeafHeader*) page;
+	int n = h->numKeys;
+	int kb = h->keyBytes;
+	int pb = h->pageBytes;
+	int sb = h->slotBytes;
+	int cap = capacity(kb, pb, sb);
+	char* keyCol = data(page);
+	char* pageCol = keyCol + cap * kb;
+	char* slotCol = pageCol + cap * pb;
+	memmove(keyCol + i * kb, keyCol + (i + 1) * kb, (n - i - 1) * kb);
+	memmove(pageCol + i * pb, pageCol + (i + 1) * pb, (n - i - 1) * pb);
+	memmove(slotCol + i * sb, slotCol + (i + 1) * sb, (n - i - 1) * sb);
+	h->numKeys = (unsigned short) (n - 1);
+}
+
+void PackedIntLeaf::split(Page* old, Page* fresh, const int at)
+{
+	int n = size(old);
+	int keys[PACKEDLEAFSIZE];
+	RecordId rids[PACKEDLEAFSIZE];
+	decode(old, keys, rids);
+	// Each part is a subset of entries that already fit, so both encodings succeed.
+	encode(old, keys, rids, at);
+	encode(fresh, keys + at, rids + at, n - at);
+}
+
+bool PackedIntLeaf::merge(Page* left, Page* right)
+{
+	int l = size(left);
+	int r = size(right);
+	if (l + r > PACKEDLEAFSIZE)
+	{
+		return false;
+	}
+	int keys[PACKEDLEAFSIZE];
+	RecordId rids[PACKEDLEAFSIZE];
+	decode(left, keys, rids);
+	decode(right, keys + l, rids + l);
+	if (!encode(left, keys, rids, l + r))
+	{
+		return false;
+	}
+	setRightSib(left, rightSib(right));
+	return true;
+}
+
+bool PackedIntLeaf::redistribute(Page* left, Page* right)
+{
+	int l = size(left);
+	int r = size(right);
+	int keys[2 * PACKEDLEAFSIZE];
+	RecordId rids[2 * PACKEDLEAFSIZE];
+	decode(left, keys, rids);
+	decode(right, keys + l, rids + l);
+	int newLeft = (l + r) / 2;
+	PackedLayout layout;
+	if (!packedLayout(keys, rids, newLeft, layout)
+	    || !packedLayout(keys + newLeft, rids + newLeft, l + r - newLeft, layout))
+	{
+		return false;
+	}
+	encode(left, keys, rids, newLeft);
+	encode(right, keys + newLeft, rids + newLeft, l + r - newLeft);
+	return true;
+}
+
+}
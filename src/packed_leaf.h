@@ -0,0 +1,320 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include "types.h"
+#include "page.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Header of a packed INTEGER leaf. The entries follow in three columns, keys,
+ * rid page numbers and rid slot numbers, each stored in as few whole bytes as the
+ * entries of the leaf need.
+ *
+ * Keys are stored as 16 bit offsets from keyBase when they span less than 2^16, and in
+ * full otherwise. Page numbers are stored as 16 bit offsets from pageBase the same way,
+ * and slot numbers in one byte while they are below 256. A zeroed page is an empty leaf.
+ */
+struct PackedLeafHeader{
+  /**
+   * Page number of the leaf on the right side.
+   */
+	PageId rightSibPageNo;
+
+  /**
+   * Page number of the leaf on the left side.
+   */
+	PageId leftSibPageNo;
+
+  /**
+   * Key that a stored 16 bit key of -32768 stands for. Unused with 4 byte keys.
+   */
+	int keyBase;
+
+  /**
+   * Page number that a stored 16 bit page number of 0 stands for. Unused with 4 byte ones.
+   */
+	PageId pageBase;
+
+  /**
+   * Number of entries in use.
+   */
+	unsigned short numKeys;
+
+  /**
+   * Bytes per key, 2 or 4. 0 until the first entry is added.
+   */
+	unsigned char keyBytes;
+
+  /**
+   * Bytes per rid page number, 2 or 4.
+   */
+	unsigned char pageBytes;
+
+  /**
+   * Bytes per rid slot number, 1 or 2.
+   */
+	unsigned char slotBytes;
+};
+
+/**
+ * @brief Bytes of a packed leaf available to the entry columns.
+ */
+const int PACKEDLEAFDATA = Page::SIZE - sizeof(PackedLeafHeader);
+
+/**
+ * @brief Most bytes one entry of a packed leaf can take.
+ */
+const int PACKEDMAXENTRY = sizeof(int) + sizeof(PageId) + sizeof(SlotId);
+
+/**
+ * @brief Most entries a packed leaf holds. Either half of a full leaf, plus one more
+ * entry, fits in a page even at the widest encoding, so a split always succeeds.
+ */
+const int PACKEDLEAFSIZE = 2 * (PACKEDLEAFDATA / PACKEDMAXENTRY - 1);
+
+/**
+ * @brief Leaf operations for INTEGER indexes built with IndexOptions::packLeaves. The
+ * same operations as the plain leaf layout, over the packed layout.
+ *
+ * Searches run on the packed key column with the vectorized kernels, and record ids are
+ * unpacked with vector instructions when the selected search kernel is AVX2.
+ */
+class PackedIntLeaf
+{
+ public:
+  /**
+   * Most entries a leaf holds.
+   */
+	static const int MAXENTRIES = PACKEDLEAFSIZE;
+
+  /**
+   * Number of entries in the leaf.
+   */
+	static int size(const Page* page)
+	{
+		return header(page)->numKeys;
+	}
+
+  /**
+   * Page number of the right sibling, 0 for the last leaf.
+   */
+	static PageId rightSib(const Page* page)
+	{
+		return header(page)->rightSibPageNo;
+	}
+
+	static void setRightSib(Page* page, const PageId pageNo)
+	{
+		((PackedLeafHeader*) page)->rightSibPageNo = pageNo;
+	}
+
+  /**
+   * Page number of the left sibling, 0 for the first leaf.
+   */
+	static PageId leftSib(const Page* page)
+	{
+		return header(page)->leftSibPageNo;
+	}
+
+	static void setLeftSib(Page* page, const PageId pageNo)
+	{
+		((PackedLeafHeader*) page)->leftSibPageNo = pageNo;
+	}
+
+  /**
+   * Key of entry i.
+   */
+	static int key(const Page* page, const int i)
+	{
+		const PackedLeafHeader* h = header(page);
+		const char* col = data(page);
+		if (h->keyBytes == 2)
+		{
+			short k;
+			memcpy(&k, col + 2 * i, sizeof(short));
+			return (int) ((long long) h->keyBase + k + 32768);
+		}
+		int k;
+		memcpy(&k, col + 4 * i, sizeof(int));
+		return k;
+	}
+
+  /**
+   * Record id of entry i.
+   */
+	static RecordId rid(const Page* page, const int i)
+	{
+		const PackedLeafHeader* h = header(page);
+		int cap = capacity(h->keyBytes, h->pageBytes, h->slotBytes);
+		const char* pages = data(page) + cap * h->keyBytes;
+		const char* slots = pages + cap * h->pageBytes;
+		RecordId rid;
+		if (h->pageBytes == 2)
+		{
+			unsigned short p;
+			memcpy(&p, pages + 2 * i, sizeof(p));
+			rid.page_number = h->pageBase + p;
+		}
+		else
+		{
+			memcpy(&rid.page_number, pages + 4 * i, sizeof(PageId));
+		}
+		if (h->slotBytes == 1)
+		{
+			rid.slot_number = (unsigned char) slots[i];
+		}
+		else
+		{
+			memcpy(&rid.slot_number, slots + 2 * i, sizeof(SlotId));
+		}
+		return rid;
+	}
+
+  /**
+   * Copies the record ids of entries [from, from + n) to out.
+   */
+	static void copyRids(const Page* page, const int from, const int n, RecordId* out);
+
+  /**
+   * Entries of this layout carry no included attributes.
+   */
+	static void copyPayloads(const Page* page, const int from, const int n, char* out)
+	{
+	}
+
+  /**
+   * Index of the first entry whose key is not less than key.
+   */
+	static int lowerBound(const Page* page, const int key);
+
+  /**
+   * Index of the first entry whose key is greater than key.
+   */
+	static int upperBound(const Page* page, const int key);
+
+  /**
+   * Tells whether any entry can be added without a split. Allows for the widest encoding,
+   * so a leaf that is not known to have room may still take a given entry.
+   */
+	static bool hasRoom(const Page* page)
+	{
+		return size(page) < PACKEDLEAFDATA / PACKEDMAXENTRY;
+	}
+
+  /**
+   * Adds an entry after any entries with the same key, repacking the leaf if the entry
+   * needs a wider encoding.
+   * @return	False, with nothing changed, if the entry does not fit.
+   */
+	static bool insert(Page* page, const int key, const RecordId& rid, const char* payload);
+
+  /**
+   * Adds an entry whose key is not below any key of the leaf.
+   * @return	False, with nothing changed, if the entry does not fit.
+   */
+	static bool append(Page* page, const int key, const RecordId& rid, const char* payload)
+	{
+		return insert(page, key, rid, payload);
+	}
+
+  /**
+   * Removes entry i.
+   */
+	static void erase(Page* page, const int i);
+
+  /**
+   * Moves entries [at, size) to the empty leaf fresh, repacking both leaves.
+   */
+	static void split(Page* old, Page* fresh, const int at);
+
+  /**
+   * Moves all entries of right to the end of left if they fit there.
+   * @return	False, with nothing changed, if they do not.
+   */
+	static bool merge(Page* left, Page* right);
+
+  /**
+   * Evens out the entries of two neighbouring leaves.
+   * @return	False, with nothing changed, if either half would not fit.
+   */
+	static bool redistribute(Page* left, Page* right);
+
+  /**
+   * Tells whether the entries of the leaf fill less than a third of it, so it should be
+   * refilled from a sibling.
+   */
+	static bool underfull(const Page* page)
+	{
+		return usedBytes(page) < PACKEDLEAFDATA / 3;
+	}
+
+  /**
+   * Tells whether a bulk load has filled the leaf to the fill factor, in entries or in bytes.
+   */
+	static bool filled(const Page* page, const double fillFactor)
+	{
+		int entries = (int) (PACKEDLEAFSIZE * fillFactor);
+		return size(page) >= (entries > 1 ? entries : 1) || usedBytes(page) >= PACKEDLEAFDATA * fillFactor;
+	}
+
+  /**
+   * Tells whether one entry can be removed without the leaf becoming underfull.
+   */
+	static bool safeToRemove(const Page* page)
+	{
+		const PackedLeafHeader* h = header(page);
+		return usedBytes(page) - (h->keyBytes + h->pageBytes + h->slotBytes) >= PACKEDLEAFDATA / 3;
+	}
+
+ private:
+	static const PackedLeafHeader* header(const Page* page)
+	{
+		return (const PackedLeafHeader*) page;
+	}
+
+	static const char* data(const Page* page)
+	{
+		return (const char*) page + sizeof(PackedLeafHeader);
+	}
+
+	static char* data(Page* page)
+	{
+		return (char*) page + sizeof(PackedLeafHeader);
+	}
+
+	static int capacity(const int keyBytes, const int pageBytes, const int slotBytes)
+	{
+		int cap = PACKEDLEAFDATA / (keyBytes + pageBytes + slotBytes);
+		return cap < PACKEDLEAFSIZE ? cap : PACKEDLEAFSIZE;
+	}
+
+	static int usedBytes(const Page* page)
+	{
+		const PackedLeafHeader* h = header(page);
+		return h->numKeys * (h->keyBytes + h->pageBytes + h->slotBytes);
+	}
+
+  /**
+   * Unpacks every entry of the leaf.
+   */
+	static void decode(const Page* page, int* keys, RecordId* rids);
+
+  /**
+   * Packs n sorted entries into the leaf with the narrowest encoding that holds them.
+   * Leaves the sibling links alone.
+   * @return	False, with nothing changed, if they do not fit.
+   */
+	static bool encode(Page* page, const int* keys, const RecordId* rids, const int n);
+};
+
+}
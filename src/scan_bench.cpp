@@ -0,0 +1,222 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/*
+ * Range scan benchmark. Builds an INTEGER index over an empty relation, then times a
+ * scan of every entry with scanNext against scanNextBatch at a few batch sizes, and
+ * equality probes through startScan against lookup and contains. Pass "packed" or
+ * "posting" to build the index with packed or posting list leaves, a number of
+ * distinct keys to have the keys repeat, as in a low cardinality attribute, and
+ * "cached" to keep the non-leaf nodes pinned.
+ *
+ * Build and run with:
+ *   $ make bench
+ *   $ ./src/scan_bench [keys] [plain|packed|posting] [distinct keys] [cached]
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include "btree.h"
+#include "exceptions/file_not_found_exception.h"
+#include "exceptions/index_scan_completed_exception.h"
+#include "exceptions/no_such_key_found_exception.h"
+
+using namespace badgerdb;
+
+/**
+ * Relation the index is built over. It stays empty; all keys come from insertEntry.
+ */
+const std::string BENCHRELATION = "scanrel";
+
+/**
+ * Number of timed full scans per method.
+ */
+const int NUMSCANS = 5;
+
+/**
+ * Number of timed equality probes per method. Half of the probed keys are missing.
+ */
+const int NUMPROBES = 1000000;
+
+static void removeFile(const std::string& name)
+{
+	try
+	{
+		File::remove(name);
+	}
+	catch(const FileNotFoundException&)
+	{
+	}
+}
+
+// Scans every entry one rid per call and returns the nanoseconds per entry.
+static double timeScanNext(BTreeIndex& index, int numKeys, long& count)
+{
+	int low = -1;
+	int high = numKeys;
+	count = 0;
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	for (int s = 0; s < NUMSCANS; s++)
+	{
+		index.startScan(&low, GT, &high, LT);
+		try
+		{
+			RecordId rid;
+			while (true)
+			{
+				index.scanNext(rid);
+				count++;
+			}
+		}
+		catch(const IndexScanCompletedException&)
+		{
+		}
+		index.endScan();
+	}
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::high_resolution_clock::now() - start;
+	return elapsed.count() / count;
+}
+
+// Scans every entry batchSize rids per call and returns the nanoseconds per entry.
+static double timeScanNextBatch(BTreeIndex& index, int numKeys, int batchSize, long& count)
+{
+	int low = -1;
+	int high = numKeys;
+	std::vector<RecordId> batch(batchSize);
+	count = 0;
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	for (int s = 0; s < NUMSCANS; s++)
+	{
+		index.startScan(&low, GT, &high, LT);
+		int n;
+		while ((n = index.scanNextBatch(&batch[0], batchSize)) > 0)
+		{
+			count += n;
+		}
+		index.endScan();
+	}
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::high_resolution_clock::now() - start;
+	return elapsed.count() / count;
+}
+
+// Probes each key with a one-key scan and returns the nanoseconds per probe.
+static double timeScanProbes(BTreeIndex& index, const std::vector<int>& probes, long& found)
+{
+	found = 0;
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	for (size_t p = 0; p < probes.size(); p++)
+	{
+		try
+		{
+			index.startScan(&probes[p], GTE, &probes[p], LTE);
+			RecordId rid;
+			index.scanNext(rid);
+			found++;
+			index.endScan();
+		}
+		catch(const NoSuchKeyFoundException&)
+		{
+		}
+	}
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::high_resolution_clock::now() - start;
+	return elapsed.count() / probes.size();
+}
+
+// Probes each key with lookup, or contains if rids is null, and returns the nanoseconds per probe.
+// Counts the probes that found a match, like timeScanProbes.
+static double timeLookupProbes(BTreeIndex& index, const std::vector<int>& probes,
+                               std::vector<RecordId>* rids, long& found)
+{
+	found = 0;
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	for (size_t p = 0; p < probes.size(); p++)
+	{
+		if (rids != nullptr)
+		{
+			found += index.lookup(&probes[p], *rids) > 0;
+		}
+		else
+		{
+			found += index.contains(&probes[p]);
+		}
+	}
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::high_resolution_clock::now() - start;
+	return elapsed.count() / probes.size();
+}
+
+int main(int argc, char** argv)
+{
+	int numKeys = argc > 1 ? atoi(argv[1]) : 1000000;
+	const char* layout = argc > 2 ? argv[2] : "plain";
+	int distinct = argc > 3 ? atoi(argv[3]) : numKeys;
+	IndexOptions options;
+	options.packLeaves = strcmp(layout, "packed") == 0;
+	options.postingLists = strcmp(layout, "posting") == 0;
+	options.cacheInnerNodes = argc > 4 && strcmp(argv[4], "cached") == 0;
+
+	removeFile(BENCHRELATION);
+	{
+		PageFile relation = PageFile::create(BENCHRELATION);
+	}
+	BufMgr* bufMgr = new BufMgr(4096);
+	std::string indexName;
+	{
+		BTreeIndex index(BENCHRELATION, indexName, bufMgr, 0, INTEGER, options);
+		for (int i = 0; i < numKeys; i++)
+		{
+			// Records of 50 to a page, in key order when every key is distinct.
+			RecordId rid;
+			rid.page_number = i / 50 + 1;
+			rid.slot_number = i % 50;
+			int key = i % distinct;
+			index.insertEntry(&key, rid);
+		}
+		std::ifstream indexFile(indexName, std::ifstream::binary | std::ifstream::ate);
+		std::cout << layout << " leaves" << (options.cacheInnerNodes ? " under cached non-leaves, " : ", ")
+		          << distinct << " distinct keys, index file of "
+		          << indexFile.tellg() / Page::SIZE << " pages" << std::endl;
+
+		std::cout << "Full scans of " << numKeys << " entries" << std::endl;
+		long count;
+		double ns = timeScanNext(index, numKeys, count);
+		std::cout << "  scanNext              " << ns << " ns/entry" << std::endl;
+		const int batchSizes[] = { 16, 256, 4096 };
+		for (int b = 0; b < 3; b++)
+		{
+			long batchCount;
+			ns = timeScanNextBatch(index, numKeys, batchSizes[b], batchCount);
+			std::cout << "  scanNextBatch(" << batchSizes[b] << ")";
+			std::cout << std::string(7 - std::to_string(batchSizes[b]).length(), ' ');
+			std::cout << ns << " ns/entry" << (batchCount == count ? "" : "  MISMATCH") << std::endl;
+		}
+
+		// Keys from distinct up miss.
+		std::vector<int> probes(NUMPROBES);
+		for (int p = 0; p < NUMPROBES; p++)
+		{
+			probes[p] = random() % (2 * distinct);
+		}
+		std::cout << "Equality probes, " << NUMPROBES << " random keys" << std::endl;
+		long found;
+		ns = timeScanProbes(index, probes, found);
+		std::cout << "  startScan/scanNext    " << ns << " ns/probe" << std::endl;
+		long lookupFound;
+		std::vector<RecordId> rids;
+		ns = timeLookupProbes(index, probes, &rids, lookupFound);
+		std::cout << "  lookup                " << ns << " ns/probe" << (lookupFound == found ? "" : "  MISMATCH") << std::endl;
+		ns = timeLookupProbes(index, probes, nullptr, lookupFound);
+		std::cout << "  contains              " << ns << " ns/probe" << (lookupFound == found ? "" : "  MISMATCH") << std::endl;
+	}
+	removeFile(indexName);
+	removeFile(BENCHRELATION);
+	delete bufMgr;
+	return 0;
+}